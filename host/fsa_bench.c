@@ -0,0 +1,2303 @@
+// Host-side measurements for the analyzer engine.
+//
+//   fsa_bench cache [--root DIR] [--depth N] [--fanout N] [--files N] [--touch N] [--keep]
+//   fsa_bench scan  [--root DIR] [--depth N] [--fanout N] [--files N] [--cancel-after MS] [--threads N] [--keep]
+//   fsa_bench types [--root DIR] [--depth N] [--fanout N] [--files N] [--keep]
+//   fsa_bench list  [--root DIR] [--files N] [--keep]
+//   fsa_bench walk  [--root DIR] [--depth N] [--fanout N] [--files N] [--threads N] [--touch N] [--latency-us US] [--keep]
+//   fsa_bench io    [--root DIR] [--depth N] [--fanout N] [--files N] [--chain N]
+//   fsa_bench purge [--root DIR] [--depth N] [--fanout N] [--files N] [--keep] [--check ...]
+//   fsa_bench dupes [--root DIR] [--files SETS] [--keep] [--check ...]
+//   fsa_bench largest [--root DIR] [--depth N] [--fanout N] [--files N] [--keep] [--check ...]
+//   fsa_bench treemap [--root DIR] [--depth N] [--fanout N] [--files N] [--frames N] [--keep] [--check ...]
+//   fsa_bench snapshot [--root DIR] [--depth N] [--fanout N] [--files N] [--keep] [--check ...]
+//   fsa_bench prefetch [--root DIR] [--depth N] [--fanout N] [--files N] [--keep] [--check ...]
+//   fsa_bench filters [--root DIR] [--depth N] [--fanout N] [--files N] [--keep] [--check ...]
+//   fsa_bench report [--root DIR] [--depth N] [--fanout N] [--files N] [--threads N] [--keep] [--check ...]
+//   fsa_bench spill [--root DIR] [--depth N] [--fanout N] [--files N] [--records N] [--budget-mb N] [--keep] [--check ...]
+//   fsa_bench search [--root DIR] [--depth N] [--fanout N] [--files N] [--entries N] [--threads N] [--keep] [--check ...]
+//   fsa_bench sort  [--root DIR] [--depth N] [--fanout N] [--files N] [--entries N] [--threads N] [--keep] [--check ...]
+//   fsa_bench suite [--root DIR] [--layout uniform|vita] [--depth N] [--fanout N] [--files N] [--json]
+//                   [--check KEY>=VALUE | KEY<=VALUE]...
+//   fsa_bench ui    [--frames N] [--check KEY>=VALUE | KEY<=VALUE]...
+//
+// Every command takes --layout. Output is one "key=value" pair per line;
+// suite prints one JSON object with --json; suite, ui, purge, dupes, largest,
+// treemap, snapshot, prefetch, filters, spill, report, search and sort exit 1
+// when a --check fails.
+#include "fs_tree.h"
+#include "fs_scanner.h"
+#include "fs_io.h"
+#include "fs_purge.h"
+#include "fs_dupes.h"
+#include "fs_hash.h"
+#include "fs_largest.h"
+#include "fs_treemap.h"
+#include "fs_snapshot.h"
+#include "fs_prefetch.h"
+#include "fs_filter.h"
+#include "fs_spill.h"
+#include "fs_report.h"
+#include "fs_search.h"
+#include "synth.h"
+#include "psp2_posix.h"
+#include "heap_track.h"
+#include "vita2d_rec.h"
+#include "frame_prof.h"
+#include "ui.h"
+#include <psp2/kernel/threadmgr.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/resource.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_CHECKS 32
+
+typedef struct {
+    const char* root;
+    SynthSpec   spec;
+    int         touch;
+    int         keep;
+    int         cancel_after_ms;
+    int         threads;
+    int         chain;
+    int         frames;
+    int         json;
+    int         records;
+    int         budget_mb;
+    int         entries;
+    const char* checks[MAX_CHECKS];
+    int         check_count;
+} BenchArgs;
+
+static double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static double hit_rate(const FsTree* t)
+{
+    uint32_t total = t->dirs_read + t->dirs_reused;
+    return total ? (double)t->dirs_reused / (double)total : 0.0;
+}
+
+// ---- fixture ----------------------------------------------------------------
+
+// Frees the fixture tree when given and removes the generated root unless --keep.
+static void bench_fixture_close(const BenchArgs* a, FsTree* t)
+{
+    if (t) fs_tree_free(t);
+    if (!a->keep) synth_remove(a->root);
+}
+
+// Generates a->root from `spec` (a->spec when NULL) and, when `t` is given,
+// walks it into t with `ctl`. On failure nothing is left behind, not even
+// with --keep, and the bench just returns 1.
+static int bench_fixture_open(const BenchArgs* a, const SynthSpec* spec, SynthStats* gen, FsTree* t, FsScanCtl* ctl)
+{
+    if (t) fs_tree_init(t);
+    if (synth_generate(a->root, spec ? spec : &a->spec, gen) < 0) {
+        fprintf(stderr, "cannot generate %s\n", a->root);
+        synth_remove(a->root);
+        return -1;
+    }
+    if (t && fs_tree_build(t, a->root, NULL, ctl) < 0) {
+        fprintf(stderr, "build failed\n");
+        synth_remove(a->root);
+        return -1;
+    }
+    return 0;
+}
+
+static int bench_cache(const BenchArgs* a)
+{
+    SynthStats gen;
+    double t0 = now_ms();
+    if (bench_fixture_open(a, NULL, &gen, NULL, NULL) < 0) return 1;
+    printf("gen_dirs=%llu\ngen_files=%llu\ngen_bytes=%llu\ngen_ms=%.1f\n",
+           (unsigned long long)gen.dirs, (unsigned long long)gen.files,
+           (unsigned long long)gen.bytes, now_ms() - t0);
+
+    char cache_path[4096];
+    snprintf(cache_path, sizeof(cache_path), "%s.index.bin", a->root);
+
+    FsTree full, cached, warm;
+    fs_tree_init(&full); fs_tree_init(&cached); fs_tree_init(&warm);
+
+    t0 = now_ms();
+    if (fs_tree_build(&full, a->root, NULL, NULL) < 0) { fprintf(stderr, "build failed\n"); bench_fixture_close(a, NULL); return 1; }
+    printf("full_build_ms=%.2f\nfull_dirs_read=%u\nnodes=%u\ntotal_bytes=%llu\n", now_ms() - t0,
+           full.dirs_read, full.node_count, (unsigned long long)full.nodes[0].size_bytes);
+
+    t0 = now_ms();
+    if (fs_tree_save(&full, cache_path, NULL) < 0) { fprintf(stderr, "save failed\n"); bench_fixture_close(a, &full); return 1; }
+    struct stat st;
+    stat(cache_path, &st);
+    printf("save_ms=%.2f\ncache_file_bytes=%lld\n", now_ms() - t0, (long long)st.st_size);
+
+    t0 = now_ms();
+    if (fs_tree_load(&cached, cache_path, NULL) < 0) {
+        fprintf(stderr, "load failed\n");
+        remove(cache_path);
+        bench_fixture_close(a, &full);
+        return 1;
+    }
+    printf("load_ms=%.2f\n", now_ms() - t0);
+
+    // A load with the cancel flag already up gives up without a tree
+    volatile int stop = 1;
+    FsTree dropped;
+    fs_tree_init(&dropped);
+    int cancel_ok = fs_tree_load(&dropped, cache_path, &stop) < 0 && dropped.node_count == 0;
+    printf("load_cancel_ok=%d\n", cancel_ok);
+
+    t0 = now_ms();
+    fs_tree_build(&warm, a->root, &cached, NULL);
+    printf("rescan_unchanged_ms=%.2f\nrescan_unchanged_hit_rate=%.4f\nrescan_unchanged_dirs_read=%u\n",
+           now_ms() - t0, hit_rate(&warm), warm.dirs_read);
+    int ok = warm.nodes[0].size_bytes == full.nodes[0].size_bytes;
+
+    uint64_t added = 0;
+    synth_touch_dirs(a->root, a->touch, a->spec.seed + 1, &added);
+    t0 = now_ms();
+    fs_tree_build(&warm, a->root, &cached, NULL);
+    printf("touched_dirs=%d\nrescan_touched_ms=%.2f\nrescan_touched_hit_rate=%.4f\nrescan_touched_dirs_read=%u\n",
+           a->touch, now_ms() - t0, hit_rate(&warm), warm.dirs_read);
+
+    fs_tree_build(&full, a->root, NULL, NULL);
+    ok = ok && warm.nodes[0].size_bytes == full.nodes[0].size_bytes &&
+         warm.node_count == full.node_count;
+    printf("rescan_matches_full_walk=%d\n", ok);
+    ok = ok && cancel_ok;
+
+    fs_tree_free(&full); fs_tree_free(&cached); fs_tree_free(&warm);
+    remove(cache_path);
+    bench_fixture_close(a, NULL);
+    return ok ? 0 : 1;
+}
+
+// Background scan: how often partial results arrive and how fast a cancel lands.
+static int bench_scan(const BenchArgs* a)
+{
+    SynthStats gen;
+    if (bench_fixture_open(a, NULL, &gen, NULL, NULL) < 0) return 1;
+
+    FsScanner s;
+    fs_scanner_init(&s);
+    double t0 = now_ms();
+    if (fs_scanner_start(&s, 0, a->root, NULL, gen.bytes, a->root, a->threads) < 0) {
+        fprintf(stderr, "start failed\n");
+        fs_scanner_deinit(&s);
+        bench_fixture_close(a, NULL);
+        return 1;
+    }
+
+    FsListing partial;
+    fs_listing_init(&partial);
+    int gen_seen = -1, updates = 0;
+    double first_partial_ms = -1.0;
+    FsScanProgress prog;
+    FsScanState st;
+    while ((st = fs_scanner_poll(&s, &partial, &gen_seen, &prog)) == FS_SCAN_RUNNING) {
+        if (partial.count > 0 && first_partial_ms < 0) first_partial_ms = now_ms() - t0;
+        updates++;
+        if (a->cancel_after_ms > 0 && now_ms() - t0 >= a->cancel_after_ms) {
+            double c0 = now_ms();
+            fs_scanner_cancel(&s);
+            printf("cancel_latency_ms=%.3f\nfiles_before_cancel=%llu\n", now_ms() - c0,
+                   (unsigned long long)prog.files);
+            break;
+        }
+        sceKernelDelayThread(5000);
+    }
+    printf("first_partial_ms=%.2f\npolls=%d\n", first_partial_ms, updates);
+
+    if (st == FS_SCAN_DONE) {
+        FsTree t;
+        fs_tree_init(&t);
+        fs_scanner_take(&s, &t);
+        printf("scan_ms=%.2f\nfiles=%llu\nfiles_per_sec=%llu\nbytes_per_sec=%llu\ntotal_bytes=%llu\n",
+               now_ms() - t0, (unsigned long long)prog.files, (unsigned long long)prog.files_per_sec,
+               (unsigned long long)prog.bytes_per_sec, (unsigned long long)t.nodes[0].size_bytes);
+        fs_tree_free(&t);
+    }
+    fs_scanner_deinit(&s);
+    fs_listing_free(&partial);
+    bench_fixture_close(a, NULL);
+    return 0;
+}
+
+// The per-filter extension lists the Square menu used to walk the tree with.
+static const char* OLD_FILTER_EXTS[FS_CAT_OTHER][6] = {
+    { ".iso", ".cso", ".pbp", ".bin" }, { ".mp3" }, { ".ogg" },
+    { ".jpg", ".jpeg", ".png", ".bmp", ".gif" }, { ".mp4", ".avi", ".mkv", ".mov" },
+    { ".txt", ".pdf", ".doc", ".docx", ".rtf" }, { ".zip", ".rar", ".7z", ".tar", ".gz" },
+    { ".vpk", ".self", ".suprx", ".skprx" }, { ".sav", ".dat", ".save" },
+};
+
+// All categories and extensions in one pass, against one walk per filter.
+static int bench_types(const BenchArgs* a)
+{
+    SynthStats gen;
+    FsTree t;
+    if (bench_fixture_open(a, NULL, &gen, &t, NULL) < 0) return 1;
+    printf("files=%llu\n", (unsigned long long)gen.files);
+
+    FsTypeStats ts;
+    fs_type_stats_init(&ts);
+    double t0 = now_ms();
+    fs_tree_type_stats(&t, 0, &ts, NULL);
+    double one_pass_ms = now_ms() - t0;
+
+    uint64_t old_bytes[FS_CAT_OTHER];
+    t0 = now_ms();
+    for (int c = 0; c < FS_CAT_OTHER; ++c) {
+        int n = 0;
+        while (n < 6 && OLD_FILTER_EXTS[c][n]) n++;
+        old_bytes[c] = fs_tree_size_by_extension(&t, 0, OLD_FILTER_EXTS[c], n);
+    }
+    double per_filter_ms = now_ms() - t0;
+
+    int ok = 1;
+    uint64_t sum = 0;
+    for (int c = 0; c < FS_CAT_COUNT; ++c) {
+        sum += ts.cat_bytes[c];
+        if (c < FS_CAT_OTHER) ok = ok && ts.cat_bytes[c] == old_bytes[c];
+    }
+    ok = ok && sum == t.nodes[0].size_bytes;
+
+    // The per-child rows split each category total between the root's entries
+    int rows_ok = ts.child_count == t.nodes[0].child_count;
+    for (int c = 0; c < FS_CAT_COUNT && rows_ok; ++c) {
+        uint64_t rows = 0;
+        for (uint32_t i = 0; i < ts.child_count; ++i) rows += ts.child_bytes[(size_t)i * FS_CAT_COUNT + c];
+        rows_ok = rows == ts.cat_bytes[c];
+    }
+    // ... and drilling into the largest child agrees with its own row
+    uint32_t child = t.nodes[0].first_child;
+    if (rows_ok && t.nodes[0].child_count && (t.nodes[child].flags & FS_NODE_DIR)) {
+        uint64_t row[FS_CAT_COUNT];
+        memcpy(row, ts.child_bytes, sizeof(row));
+        t0 = now_ms();
+        fs_tree_type_stats(&t, child, &ts, NULL);
+        printf("drill_down_ms=%.3f\n", now_ms() - t0);
+        for (int c = 0; c < FS_CAT_COUNT; ++c) rows_ok = rows_ok && row[c] == ts.cat_bytes[c];
+    }
+    printf("child_rows_match=%d\n", rows_ok);
+    ok = ok && rows_ok;
+    printf("one_pass_ms=%.3f\nper_filter_walks_ms=%.3f\nextensions=%u\nnames_per_sec=%.0f\n", one_pass_ms,
+           per_filter_ms, ts.ext_used, one_pass_ms > 0 ? (double)gen.files * 1000.0 / one_pass_ms : 0.0);
+    printf("categories_match=%d\n", ok);
+
+    fs_type_stats_free(&ts);
+    bench_fixture_close(a, &t);
+    return ok ? 0 : 1;
+}
+
+// One flat folder with --files entries: every entry must come back, largest first.
+static int bench_list(const BenchArgs* a)
+{
+    SynthSpec spec = a->spec;
+    spec.layout = SYNTH_LAYOUT_UNIFORM;
+    spec.depth = 0;
+    SynthStats gen;
+    if (bench_fixture_open(a, &spec, &gen, NULL, NULL) < 0) return 1;
+    printf("gen_files=%llu\n", (unsigned long long)gen.files);
+
+    FsListing l;
+    fs_listing_init(&l);
+    double t0 = now_ms();
+    int n = fs_scan_directory(a->root, &l);
+    printf("scan_directory_ms=%.2f\nscan_directory_entries=%d\n", now_ms() - t0, n);
+    int ok = n == (int)gen.files;
+    for (uint32_t i = 1; i < l.count; ++i) ok = ok && fs_listing_size(&l, i - 1) >= fs_listing_size(&l, i);
+
+    uint32_t* top = (uint32_t*)malloc(FS_SCAN_MAX_PARTIAL * sizeof(uint32_t));
+    t0 = now_ms();
+    uint32_t k = l.count ? fs_top_k(&l.items[0].size_bytes, sizeof(FsListItem), l.count, FS_SCAN_MAX_PARTIAL, top) : 0;
+    printf("top_k_us=%.1f\n", (now_ms() - t0) * 1000.0);
+    for (uint32_t i = 0; i < k; ++i) ok = ok && fs_listing_size(&l, top[i]) == fs_listing_size(&l, i);
+    free(top);
+
+    FsTree t;
+    fs_tree_init(&t);
+    fs_tree_build(&t, a->root, NULL, NULL);
+    FsListing view;
+    fs_listing_init(&view);
+    t0 = now_ms();
+    fs_listing_view(&view, &t, 0);
+    printf("tree_view_us=%.1f\ntree_view_entries=%u\n", (now_ms() - t0) * 1000.0, view.count);
+    ok = ok && view.count == gen.files && fs_listing_size(&view, 0) == fs_listing_size(&l, 0);
+    printf("listing_ok=%d\n", ok);
+
+    fs_listing_free(&view);
+    fs_tree_free(&t);
+    fs_listing_free(&l);
+    bench_fixture_close(a, NULL);
+    return ok ? 0 : 1;
+}
+
+// Full walk with 1..N directory readers. --latency-us stands in for the
+// memory card's per-request latency, which the host page cache hides.
+static int bench_walk(const BenchArgs* a)
+{
+    SynthStats gen;
+    if (bench_fixture_open(a, NULL, &gen, NULL, NULL) < 0) return 1;
+    printf("gen_dirs=%llu\ngen_files=%llu\n", (unsigned long long)gen.dirs, (unsigned long long)gen.files);
+
+    int ok = 1;
+    double base_ms = 0.0;
+    FsTree base;
+    fs_tree_init(&base);
+    for (int n = 1; n <= a->threads; ++n) {
+        FsScanCtl ctl;
+        memset(&ctl, 0, sizeof(ctl));
+        ctl.threads = n;
+        FsTree t;
+        fs_tree_init(&t);
+        double t0 = now_ms();
+        if (fs_tree_build(&t, a->root, NULL, &ctl) < 0) {
+            fprintf(stderr, "build failed\n");
+            fs_tree_free(&base);
+            bench_fixture_close(a, NULL);
+            return 1;
+        }
+        double ms = now_ms() - t0;
+        if (n == 1) base_ms = ms;
+        ok = ok && (n == 1 || (t.nodes[0].size_bytes == base.nodes[0].size_bytes && t.node_count == base.node_count));
+        printf("threads_%d_ms=%.2f\nthreads_%d_dirs_per_sec=%.0f\nthreads_%d_speedup=%.2f\n",
+               n, ms, n, ms > 0 ? (double)ctl.dirs * 1000.0 / ms : 0.0, n, ms > 0 ? base_ms / ms : 0.0);
+        if (n == 1) base = t;
+        else fs_tree_free(&t);
+    }
+    printf("walks_match=%d\n", ok);
+
+    // Rescan against the first tree after touching some folders: the workers
+    // stat reused folders ahead of the builder and list the touched ones
+    uint64_t added = 0;
+    synth_touch_dirs(a->root, a->touch, a->spec.seed + 1, &added);
+    FsScanCtl ctl;
+    memset(&ctl, 0, sizeof(ctl));
+    ctl.threads = a->threads;
+    FsTree warm, full;
+    fs_tree_init(&warm);
+    fs_tree_init(&full);
+    double t0 = now_ms();
+    int rescan_ok = fs_tree_build(&warm, a->root, &base, &ctl) == 0;
+    double rescan_ms = now_ms() - t0;
+    rescan_ok = rescan_ok && fs_tree_build(&full, a->root, NULL, NULL) == 0 &&
+                warm.nodes[0].size_bytes == full.nodes[0].size_bytes && warm.node_count == full.node_count;
+    printf("rescan_threads_ms=%.2f\nrescan_threads_hit_rate=%.4f\nrescan_threads_ok=%d\n",
+           rescan_ms, hit_rate(&warm), rescan_ok);
+    ok = ok && rescan_ok;
+    fs_tree_free(&warm);
+    fs_tree_free(&full);
+    fs_tree_free(&base);
+    bench_fixture_close(a, NULL);
+    return ok ? 0 : 1;
+}
+
+static double per_entry(const HostIoCounts* c, uint64_t entries)
+{
+    return entries ? (double)host_io_total(c) / (double)entries : 0.0;
+}
+
+// The wrapper layer has to see exactly the calls the shim served
+static int io_counts_match(const HostIoCounts* c, const FsIoStats* s)
+{
+    return s->op[FS_IO_DOPEN].calls == c->dopen && s->op[FS_IO_DREAD].calls == c->dread &&
+           s->op[FS_IO_DCLOSE].calls == c->dclose && s->op[FS_IO_GETSTAT].calls == c->getstat &&
+           s->op[FS_IO_REMOVE].calls == c->remove && s->op[FS_IO_RMDIR].calls == c->rmdir;
+}
+
+// Resets both the shim's counters and the wrapper statistics
+static void io_reset(void)
+{
+    host_io_reset();
+    fs_io_reset();
+}
+
+// Syscalls per entry of the direct-disk analyzer paths (size walk, folder
+// listing, delete), plus a --chain levels deep tree that has to be counted
+// and deleted in full.
+static int bench_io(const BenchArgs* a)
+{
+    SynthStats gen;
+    if (bench_fixture_open(a, NULL, &gen, NULL, NULL) < 0) return 1;
+    uint64_t entries = gen.files + gen.dirs - 1;
+    printf("entries=%llu\n", (unsigned long long)entries);
+
+    HostIoCounts c;
+    FsIoStats s;
+    int counts_match = 1;
+    fs_io_enable(1);
+    io_reset();
+    double t0 = now_ms();
+    uint64_t total = fs_size_by_extension(a->root, NULL, 0);
+    double ms = now_ms() - t0;
+    host_io_counts(&c);
+    fs_io_snapshot(&s);
+    counts_match = counts_match && io_counts_match(&c, &s);
+    int ok = total == gen.bytes;
+    printf("size_walk_ms=%.2f\nsize_walk_syscalls_per_entry=%.3f\nsize_walk_getstat=%llu\n", ms,
+           per_entry(&c, entries), (unsigned long long)c.getstat);
+
+    FsListing l;
+    fs_listing_init(&l);
+    io_reset();
+    t0 = now_ms();
+    fs_scan_directory(a->root, &l);
+    ms = now_ms() - t0;
+    host_io_counts(&c);
+    fs_io_snapshot(&s);
+    counts_match = counts_match && io_counts_match(&c, &s);
+    printf("dopen_p50_us=%llu\ndopen_p99_us=%llu\n", (unsigned long long)fs_io_percentile_us(&s.op[FS_IO_DOPEN], 500),
+           (unsigned long long)fs_io_percentile_us(&s.op[FS_IO_DOPEN], 990));
+    uint64_t listed = 0;
+    for (uint32_t i = 0; i < l.count; ++i) listed += fs_listing_size(&l, i);
+    ok = ok && listed == gen.bytes;
+    printf("scan_directory_ms=%.2f\nscan_directory_syscalls_per_entry=%.3f\n", ms, per_entry(&c, entries));
+    fs_listing_free(&l);
+
+    io_reset();
+    t0 = now_ms();
+    int del = fs_delete_entry(a->root);
+    ms = now_ms() - t0;
+    host_io_counts(&c);
+    fs_io_snapshot(&s);
+    counts_match = counts_match && io_counts_match(&c, &s);
+    fs_io_enable(0);
+    printf("fs_io_counts_match=%d\n", counts_match);
+    ok = ok && counts_match;
+    struct stat st;
+    ok = ok && del == 0 && stat(a->root, &st) < 0;
+    printf("delete_ms=%.2f\ndelete_syscalls_per_entry=%.3f\ndelete_getstat=%llu\n", ms,
+           per_entry(&c, entries + 1), (unsigned long long)c.getstat);
+
+    // One directory per level with a file in each, deeper than any fixed limit
+    SynthSpec deep = a->spec;
+    deep.layout = SYNTH_LAYOUT_UNIFORM;
+    deep.depth = a->chain;
+    deep.fanout = 1;
+    deep.files_per_dir = 1;
+    if (bench_fixture_open(a, &deep, &gen, NULL, NULL) < 0) return 1;
+    int deep_walked = fs_size_by_extension(a->root, NULL, 0) == gen.bytes;
+    int deep_tree = 1;
+    for (int n = 1; n <= 2; ++n) {
+        FsScanCtl ctl;
+        memset(&ctl, 0, sizeof(ctl));
+        ctl.threads = n;
+        FsTree t;
+        fs_tree_init(&t);
+        deep_tree = deep_tree && fs_tree_build(&t, a->root, NULL, &ctl) == 0 && t.nodes[0].size_bytes == gen.bytes;
+        fs_tree_free(&t);
+    }
+    int deep_deleted = fs_delete_entry(a->root) == 0 && stat(a->root, &st) < 0;
+    printf("chain_levels=%d\nchain_walk_counted=%d\nchain_tree_counted=%d\nchain_deleted=%d\n", a->chain,
+           deep_walked, deep_tree, deep_deleted);
+    ok = ok && deep_walked && deep_tree && deep_deleted;
+    if (!deep_deleted) synth_remove(a->root);
+
+    printf("io_ok=%d\n", ok);
+    return ok ? 0 : 1;
+}
+
+// ---- suite ------------------------------------------------------------------
+
+typedef enum { OP_BASELINE = 0, OP_SCAN_DIRECTORY, OP_TOP_ENTRIES, OP_SIZE_BY_EXTENSION, OP_DELETE, OP__COUNT } SuiteOp;
+
+static const char* OP_NAMES[OP__COUNT] = { "baseline", "scan_directory", "top_entries", "size_by_extension", "delete" };
+
+typedef struct {
+    double   ms;
+    uint64_t bytes;   // bytes the call reported
+    int64_t  peak_heap;
+    int      ok;
+} OpResult;
+
+typedef struct {
+    double   ms;
+    double   entries_per_sec;
+    double   bytes_per_sec;
+    double   peak_heap_kb;
+    long     peak_rss_kb; // max RSS of the run above an idle child's
+    int      ok;
+} OpStats;
+
+static OpResult run_op(SuiteOp op, const char* root, uint64_t expect_bytes, uint64_t expect_games)
+{
+    OpResult r = { 0.0, 0, 0, 1 };
+    heap_track_reset();
+    double t0 = now_ms();
+    if (op == OP_SCAN_DIRECTORY) {
+        FsListing l;
+        fs_listing_init(&l);
+        r.ok = fs_scan_directory(root, &l) >= 0;
+        for (uint32_t i = 0; i < l.count; ++i) r.bytes += fs_listing_size(&l, i);
+        r.ok = r.ok && r.bytes == expect_bytes;
+        fs_listing_free(&l);
+    } else if (op == OP_TOP_ENTRIES) {
+        FolderUsage top[16];
+        int n = fs_top_entries_in_root(root, top, 16);
+        for (int i = 0; i < n; ++i) r.bytes += top[i].size_bytes;
+        r.ok = n > 0 && r.bytes <= expect_bytes;
+    } else if (op == OP_SIZE_BY_EXTENSION) {
+        r.bytes = fs_size_by_extension(root, OLD_FILTER_EXTS[FS_CAT_GAMES], 4);
+        r.ok = r.bytes == expect_games;
+    } else if (op == OP_DELETE) {
+        struct stat st;
+        r.ok = fs_delete_entry(root) == 0 && stat(root, &st) < 0;
+        r.bytes = expect_bytes;
+    }
+    r.ms = now_ms() - t0;
+    r.peak_heap = heap_track_peak();
+    return r;
+}
+
+// Runs one operation in a child process, whose peak RSS wait4() reports
+// on its own.
+static int measure_op(SuiteOp op, const char* root, uint64_t expect_bytes, uint64_t expect_games,
+                      OpResult* out, long* maxrss_kb)
+{
+    int fd[2];
+    if (pipe(fd) < 0) return -1;
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) { close(fd[0]); close(fd[1]); return -1; }
+    if (pid == 0) {
+        close(fd[0]);
+        OpResult r = run_op(op, root, expect_bytes, expect_games);
+        _exit(write(fd[1], &r, sizeof(r)) == (ssize_t)sizeof(r) ? 0 : 1);
+    }
+    close(fd[1]);
+    ssize_t n = read(fd[0], out, sizeof(*out));
+    close(fd[0]);
+    int status = 0;
+    struct rusage ru;
+    memset(&ru, 0, sizeof(ru));
+    if (wait4(pid, &status, 0, &ru) < 0) return -1;
+    *maxrss_kb = ru.ru_maxrss;
+    return (n == (ssize_t)sizeof(*out) && WIFEXITED(status) && WEXITSTATUS(status) == 0) ? 0 : -1;
+}
+
+static int check_value(const char* check, const char* key, double value, int* matched)
+{
+    const char* op = strpbrk(check, "<>");
+    if (!op || op[1] != '=' || strlen(key) != (size_t)(op - check) || strncmp(check, key, op - check) != 0) return 1;
+    *matched = 1;
+    double limit = atof(op + 2);
+    return (*op == '>') ? value >= limit : value <= limit;
+}
+
+// Every --check against a flat set of metrics; returns how many failed
+static int apply_checks(const BenchArgs* a, const char* const* keys, const double* vals, int n)
+{
+    int failed = 0;
+    for (int k = 0; k < a->check_count; ++k) {
+        int matched = 0;
+        for (int m = 0; m < n; ++m) {
+            if (check_value(a->checks[k], keys[m], vals[m], &matched)) continue;
+            fprintf(stderr, "check failed: %s (got %.3f)\n", a->checks[k], vals[m]);
+            failed++;
+        }
+        if (!matched) { fprintf(stderr, "check matches no metric: %s\n", a->checks[k]); failed++; }
+    }
+    return failed;
+}
+
+// The direct-disk analyzer calls on one generated tree: throughput, peak
+// memory and a correctness bit each, checked against --check thresholds.
+static int bench_suite(const BenchArgs* a)
+{
+    SynthStats gen;
+    FsTree t;
+    if (bench_fixture_open(a, NULL, &gen, &t, NULL) < 0) return 1;
+    uint64_t entries = gen.files + gen.dirs - 1;
+    uint64_t expect_games = fs_tree_size_by_extension(&t, 0, OLD_FILTER_EXTS[FS_CAT_GAMES], 4);
+    fs_tree_free(&t);
+
+    OpStats stats[OP__COUNT];
+    memset(stats, 0, sizeof(stats));
+    long base_kb = 0;
+    for (int op = 0; op < OP__COUNT; ++op) {
+        OpResult r;
+        long kb = 0;
+        if (measure_op((SuiteOp)op, a->root, gen.bytes, expect_games, &r, &kb) < 0) r.ok = 0, r.ms = 0.0;
+        if (op == OP_BASELINE) { base_kb = kb; continue; }
+        OpStats* o = &stats[op];
+        o->ms = r.ms;
+        o->entries_per_sec = r.ms > 0 ? (double)(entries + (op == OP_DELETE)) * 1000.0 / r.ms : 0.0;
+        o->bytes_per_sec = r.ms > 0 ? (double)gen.bytes * 1000.0 / r.ms : 0.0;
+        o->peak_heap_kb = (double)r.peak_heap / 1024.0;
+        o->peak_rss_kb = kb > base_kb ? kb - base_kb : 0;
+        o->ok = r.ok;
+    }
+    struct stat st;
+    if (stat(a->root, &st) == 0) synth_remove(a->root);
+
+    int failed = 0;
+    int matched[MAX_CHECKS] = { 0 };
+    for (int op = 1; op < OP__COUNT; ++op) {
+        const OpStats* o = &stats[op];
+        const char* metric[] = { "ms", "entries_per_sec", "bytes_per_sec", "peak_heap_kb", "peak_rss_kb", "ok" };
+        double value[] = { o->ms, o->entries_per_sec, o->bytes_per_sec, o->peak_heap_kb, (double)o->peak_rss_kb,
+                           (double)o->ok };
+        for (int m = 0; m < 6; ++m) {
+            char key[64];
+            snprintf(key, sizeof(key), "%s.%s", OP_NAMES[op], metric[m]);
+            for (int c = 0; c < a->check_count; ++c) {
+                if (check_value(a->checks[c], key, value[m], &matched[c])) continue;
+                fprintf(stderr, "check failed: %s (got %.3f)\n", a->checks[c], value[m]);
+                failed++;
+            }
+        }
+        if (!o->ok) failed++;
+    }
+    for (int c = 0; c < a->check_count; ++c)
+        if (!matched[c]) { fprintf(stderr, "check matches no metric: %s\n", a->checks[c]); failed++; }
+
+    const char* layout = (a->spec.layout == SYNTH_LAYOUT_VITA) ? "vita" : "uniform";
+    if (a->json) {
+        printf("{\"layout\":\"%s\",\"entries\":%llu,\"bytes\":%llu,\"ops\":{", layout,
+               (unsigned long long)entries, (unsigned long long)gen.bytes);
+        for (int op = 1; op < OP__COUNT; ++op) {
+            const OpStats* o = &stats[op];
+            printf("%s\"%s\":{\"ms\":%.3f,\"entries_per_sec\":%.0f,\"bytes_per_sec\":%.0f,"
+                   "\"peak_heap_kb\":%.1f,\"peak_rss_kb\":%ld,\"ok\":%d}", op > 1 ? "," : "", OP_NAMES[op], o->ms,
+                   o->entries_per_sec, o->bytes_per_sec, o->peak_heap_kb, o->peak_rss_kb, o->ok);
+        }
+        printf("},\"failed\":%d}\n", failed);
+    } else {
+        printf("layout=%s\nentries=%llu\nbytes=%llu\n", layout, (unsigned long long)entries,
+               (unsigned long long)gen.bytes);
+        for (int op = 1; op < OP__COUNT; ++op) {
+            const OpStats* o = &stats[op];
+            const char* n = OP_NAMES[op];
+            printf("%s.ms=%.3f\n%s.entries_per_sec=%.0f\n%s.bytes_per_sec=%.0f\n%s.peak_heap_kb=%.1f\n"
+                   "%s.peak_rss_kb=%ld\n%s.ok=%d\n", n, o->ms, n, o->entries_per_sec, n, o->bytes_per_sec,
+                   n, o->peak_heap_kb, n, o->peak_rss_kb, n, o->ok);
+        }
+        printf("failed=%d\n", failed);
+    }
+    return failed ? 1 : 0;
+}
+
+// ---- ui -----------------------------------------------------------------------
+
+typedef enum { UI_LIST = 0, UI_DIALOG, UI_IO_PANEL, UI_FRAME_PANEL, UI__COUNT } UiScene;
+
+static const char* UI_SCENES[UI__COUNT] = { "list", "dialog", "io_panel", "frame_panel" };
+
+// Draw calls and CPU time per ui_draw frame through the recording vita2d
+// backend, for a full folder listing under each overlay.
+static int bench_ui(const BenchArgs* a)
+{
+    PartitionInfo parts[2];
+    memset(parts, 0, sizeof(parts));
+    parts[0].label = "ux0"; parts[0].path = "ux0:/";
+    parts[0].total_bytes = 64ull << 30; parts[0].free_bytes = 20ull << 30;
+    parts[1].label = "ur0"; parts[1].path = "ur0:/";
+    parts[1].total_bytes = 4ull << 30; parts[1].free_bytes = 3ull << 30;
+
+    // Sizes from 32 GB down, so every visible bar has a long fill
+    FsListing l;
+    fs_listing_init(&l);
+    char name[64];
+    for (int i = 0; i < 500; ++i) {
+        snprintf(name, sizeof(name), "PCSE%05d", i);
+        fs_listing_add(&l, name, (32ull << 30) >> (i / 50), i % 3 ? FS_ENTRY_DIR : 0);
+    }
+    fs_listing_sort(&l);
+
+    FsScanProgress prog;
+    memset(&prog, 0, sizeof(prog));
+    prog.files = 12345; prog.bytes = 5ull << 30; prog.expected_bytes = 44ull << 30;
+    prog.files_per_sec = 2000; prog.bytes_per_sec = 40ull << 20; prog.eta_sec = 125;
+
+    FsIoStats io;
+    memset(&io, 0, sizeof(io));
+    for (int op = 0; op < 4; ++op) {
+        io.op[op].calls = 1000;
+        for (int b = 0; b < 12; ++b) io.op[op].hist[b] = 80 + b;
+    }
+
+    const char* labels[] = { "All", "Games", "MP3" };
+    const char* long_name = "A folder name far too long to fit the delete dialog in one line, so it gets cut short.mp4";
+    ui_init();
+    int failed = 0;
+    int matched[MAX_CHECKS] = { 0 };
+    UiFrame uf;
+    memset(&uf, 0, sizeof(uf));
+    uf.parts = parts;
+    uf.parts_count = 2;
+    uf.folders = &l;
+    uf.battery_percent = 80;
+    uf.scan = &prog;
+    uf.overlay_labels = labels;
+    uf.overlay_count = 3;
+    uf.delete_confirm_name = long_name;
+    for (int sc = 0; sc < UI__COUNT; ++sc) {
+        vita2d_rec_reset();
+        uf.delete_confirm_active = sc == UI_DIALOG;
+        uf.io_panel = sc == UI_IO_PANEL ? &io : NULL;
+        uf.frame_panel = sc == UI_FRAME_PANEL;
+        double t0 = now_ms();
+        for (int f = 0; f < a->frames; ++f) {
+            frame_prof_begin();
+            uf.current_folder_index = f % (int)l.count;
+            ui_draw(&uf);
+        }
+        double ms = (now_ms() - t0) / a->frames;
+        Vita2dRecCounts c;
+        vita2d_rec_counts(&c);
+        double value[] = { (double)vita2d_rec_draw_calls(&c) / c.frames, (double)c.vertices / c.frames,
+                           (double)c.width_calls / c.frames, (double)c.pool_peak / 1024.0, (double)c.pool_fails, ms };
+        const char* metric[] = { "draw_calls_per_frame", "vertices_per_frame", "text_widths_per_frame",
+                                 "pool_peak_kb", "pool_fails", "ms_per_frame" };
+        for (int m = 0; m < 6; ++m) {
+            char key[64];
+            snprintf(key, sizeof(key), "%s.%s", UI_SCENES[sc], metric[m]);
+            printf("%s=%.3f\n", key, value[m]);
+            for (int k = 0; k < a->check_count; ++k) {
+                if (check_value(a->checks[k], key, value[m], &matched[k])) continue;
+                fprintf(stderr, "check failed: %s (got %.3f)\n", a->checks[k], value[m]);
+                failed++;
+            }
+        }
+    }
+    ui_deinit();
+    fs_listing_free(&l);
+    for (int k = 0; k < a->check_count; ++k)
+        if (!matched[k]) { fprintf(stderr, "check matches no metric: %s\n", a->checks[k]); failed++; }
+    printf("failed=%d\n", failed);
+    return failed ? 1 : 0;
+}
+
+// ---- purge ------------------------------------------------------------------
+
+// Trashes the largest top-level folders: the rename step against the
+// purge behind it, the tree kept in step without a re-walk, and a purge
+// cancelled half way that the next run picks up from the trash.
+static int bench_purge(const BenchArgs* a)
+{
+    SynthStats gen;
+    FsTree t;
+    if (bench_fixture_open(a, NULL, &gen, &t, NULL) < 0) return 1;
+
+    // Children are sorted largest first: trash the first two now, the third
+    // later for the cancel check
+    uint32_t kids = t.nodes[0].child_count < 3 ? t.nodes[0].child_count : 3;
+    if (kids < 2) { fprintf(stderr, "tree too small\n"); bench_fixture_close(a, &t); return 1; }
+    char paths[3][1024];
+    const char* ptrs[3];
+    uint64_t sizes[3];
+    for (uint32_t i = 0; i < kids; ++i) {
+        uint32_t n = t.nodes[0].first_child + i;
+        fs_tree_path(&t, n, paths[i], sizeof(paths[i]));
+        ptrs[i] = paths[i];
+        sizes[i] = t.nodes[n].size_bytes;
+    }
+
+    FsPurger pg;
+    fs_purger_init(&pg);
+    int moved[3];
+
+    // With the queue full nothing may move: the caller deletes in place instead
+    struct stat st;
+    pg.count = FS_PURGE_JOBS;
+    int full_ok = fs_purger_trash(&pg, a->root, ptrs, sizes, 2, moved) < 0 && !moved[0] && !moved[1] &&
+                  stat(paths[0], &st) == 0 && stat(paths[1], &st) == 0;
+    pg.count = 0;
+    printf("full_queue_ok=%d\n", full_ok);
+
+    HostIoCounts c;
+    io_reset();
+    double t0 = now_ms();
+    int n = fs_purger_trash(&pg, a->root, ptrs, sizes, 2, moved);
+    double trash_ms = now_ms() - t0;
+    host_io_counts(&c);
+    printf("trash_ms=%.3f\ntrash_syscalls=%llu\n", trash_ms,
+           (unsigned long long)host_io_total(&c));
+
+    t0 = now_ms();
+    int tree_ok = n == 2;
+    for (int i = 0; i < 2; ++i) tree_ok = tree_ok && fs_tree_remove(&t, fs_tree_lookup(&t, paths[i])) == 0;
+    printf("tree_remove_us=%.1f\n", (now_ms() - t0) * 1000.0);
+    tree_ok = tree_ok && t.nodes[0].size_bytes == gen.bytes - sizes[0] - sizes[1];
+    for (uint32_t i = 1; i < t.nodes[0].child_count; ++i) {
+        uint32_t c0 = t.nodes[0].first_child + i;
+        tree_ok = tree_ok && t.nodes[c0 - 1].size_bytes >= t.nodes[c0].size_bytes && t.nodes[c0].parent == 0;
+    }
+
+    FsPurgeProgress pr;
+    uint32_t polls = 0;
+    t0 = now_ms();
+    while (fs_purger_poll(&pg, &pr)) { polls++; sceKernelDelayThread(1000); }
+    printf("purge_ms=%.1f\npurge_entries=%llu\npurge_polls=%u\npurge_errors=%u\n", now_ms() - t0,
+           (unsigned long long)pr.entries, polls, pr.errors);
+    int purge_ok = pr.bytes == sizes[0] + sizes[1] && pr.errors == 0;
+
+    // Whatever the tree says now must match a fresh walk of the disk
+    FsTree fresh;
+    fs_tree_init(&fresh);
+    fs_tree_build(&fresh, a->root, NULL, NULL);
+    tree_ok = tree_ok && fresh.nodes[0].size_bytes == t.nodes[0].size_bytes;
+    fs_tree_free(&fresh);
+
+    // The cache write runs on the worker: one released before it starts is
+    // dropped, the next one lands and loads back as the same tree
+    char cache[1024], gone[1024];
+    snprintf(cache, sizeof(cache), "%s.purge.bin", a->root);
+    remove(cache);
+    fs_purger_save(&pg, &t, cache);
+    fs_purger_release(&pg, &t);
+    int save_ok = fs_purger_save(&pg, &t, cache) == 0;
+    while (pg.active) sceKernelDelayThread(1000);
+    save_ok = save_ok && fs_tree_load(&fresh, cache, NULL) == 0 && fresh.nodes[0].child_count == t.nodes[0].child_count &&
+              fresh.nodes[0].size_bytes == t.nodes[0].size_bytes;
+    fs_tree_free(&fresh);
+    remove(cache);
+
+    // In place: a folder goes, and a path that cannot be removed is reported
+    snprintf(gone, sizeof(gone), "%s/in_place", a->root);
+    mkdir(gone, 0777);
+    snprintf(cache, sizeof(cache), "%s/in_place/f", a->root);
+    FILE* f = fopen(cache, "w");
+    if (f) fclose(f);
+    uint32_t errors = pr.errors;
+    save_ok = save_ok && fs_purger_delete(&pg, gone, 0) == 0;
+    snprintf(cache, sizeof(cache), "%s/no_such_entry", a->root);
+    save_ok = save_ok && fs_purger_delete(&pg, cache, 0) == 0;
+    while (fs_purger_poll(&pg, &pr)) sceKernelDelayThread(1000);
+    save_ok = save_ok && stat(gone, &st) < 0 && pr.errors == errors + 1;
+    printf("save_ok=%d\n", save_ok);
+
+    // Cancel right after queueing, then resume the leftovers in a new purger
+    int resume_ok = 1;
+    if (kids == 3) {
+        fs_purger_trash(&pg, a->root, &ptrs[2], &sizes[2], 1, moved);
+        fs_purger_cancel(&pg);
+        fs_purger_poll(&pg, &pr);
+        uint64_t first = pr.bytes;
+        fs_purger_deinit(&pg);
+
+        // The leftovers sit in the trash, where neither walk of the root may see them
+        fs_tree_build(&fresh, a->root, NULL, NULL);
+        int hidden = fresh.node_count > 0 && fresh.nodes[0].size_bytes == gen.bytes - sizes[0] - sizes[1] - sizes[2];
+        for (uint32_t c0 = fresh.nodes[0].first_child; c0 < fresh.nodes[0].first_child + fresh.nodes[0].child_count; ++c0)
+            hidden = hidden && !fs_is_trash(fs_tree_name(&fresh, c0));
+        fs_tree_free(&fresh);
+        FsListing l;
+        fs_listing_init(&l);
+        hidden = hidden && fs_scan_directory(a->root, &l) >= 0;
+        for (uint32_t i = 0; i < l.count; ++i) hidden = hidden && !fs_is_trash(fs_listing_name(&l, i));
+        fs_listing_free(&l);
+        printf("trash_hidden=%d\n", hidden);
+        resume_ok = hidden;
+
+        fs_purger_init(&pg);
+        int jobs = fs_purger_resume(&pg, a->root);
+        while (fs_purger_poll(&pg, &pr)) sceKernelDelayThread(1000);
+        printf("cancel_bytes=%llu\nresume_jobs=%d\nresume_bytes=%llu\n", (unsigned long long)first, jobs,
+               (unsigned long long)pr.bytes);
+        resume_ok = resume_ok && first + pr.bytes == sizes[2] && pr.errors == 0;
+    }
+    fs_purger_deinit(&pg);
+
+    char trash[1024];
+    snprintf(trash, sizeof(trash), "%s/%s", a->root, FS_TRASH_DIR);
+    SceUID d = fs_io_dopen(trash);
+    int left = 0;
+    if (d >= 0) {
+        SceIoDirent de;
+        while (fs_io_dread(d, &de) > 0) left += strcmp(de.d_name, ".") && strcmp(de.d_name, "..");
+        fs_io_dclose(d);
+    }
+    printf("trash_left=%d\n", left);
+
+    int ok = tree_ok && purge_ok && resume_ok && full_ok && save_ok && !left;
+    printf("tree_ok=%d\npurge_ok=%d\nresume_ok=%d\n", tree_ok, purge_ok, resume_ok);
+    const char* keys[] = { "trash_ms", "purge_errors" };
+    double vals[] = { trash_ms, (double)pr.errors };
+    ok = apply_checks(a, keys, vals, 2) == 0 && ok;
+    printf("purge_ok_all=%d\n", ok);
+    bench_fixture_close(a, &t);
+    return ok ? 0 : 1;
+}
+
+// ---- largest ----------------------------------------------------------------
+
+static int cmp_u64_desc(const void* a, const void* b)
+{
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return x < y ? 1 : x > y ? -1 : 0;
+}
+
+// Top-N files of the whole tree, from memory and from a disk walk, against
+// a full sort of every file size. The walk's heap growth is the O(N) part.
+static int bench_largest(const BenchArgs* a)
+{
+    SynthStats gen;
+    FsTree t;
+    if (bench_fixture_open(a, NULL, &gen, &t, NULL) < 0) return 1;
+
+    uint64_t* all = (uint64_t*)malloc((size_t)t.node_count * sizeof(uint64_t));
+    uint32_t files = 0;
+    for (uint32_t i = 1; i < t.node_count; ++i)
+        if (!(t.nodes[i].flags & FS_NODE_DIR)) all[files++] = t.nodes[i].size_bytes;
+    qsort(all, files, sizeof(uint64_t), cmp_u64_desc);
+
+    FsLargest l;
+    fs_largest_init(&l, FS_LARGEST_COUNT);
+    double t0 = now_ms();
+    int ok = fs_largest_from_tree(&l, &t, 0) == 0;
+    double tree_us = (now_ms() - t0) * 1000.0;
+    uint32_t want = files < FS_LARGEST_COUNT ? files : FS_LARGEST_COUNT;
+    ok = ok && l.count == want && l.files == files;
+    for (uint32_t i = 0; ok && i < l.count; ++i) {
+        SceIoStat st;
+        ok = l.items[i].size == all[i] && fs_io_getstat(fs_largest_path(&l, i), &st) == 0 &&
+             (uint64_t)st.st_size == all[i];
+    }
+    printf("files=%u\ntree_us=%.1f\n", files, tree_us);
+    fs_largest_free(&l);
+
+    heap_track_reset();
+    t0 = now_ms();
+    fs_largest_init(&l, FS_LARGEST_COUNT);
+    int walked = fs_largest_walk(&l, a->root, NULL) == 0;
+    double walk_ms = now_ms() - t0;
+    double peak_kb = heap_track_peak() / 1024.0;
+    walked = walked && l.count == want && l.files == files;
+    for (uint32_t i = 0; walked && i < l.count; ++i) {
+        SceIoStat st;
+        walked = l.items[i].size == all[i] && fs_io_getstat(fs_largest_path(&l, i), &st) == 0 &&
+                 (uint64_t)st.st_size == all[i];
+    }
+    printf("walk_ms=%.1f\nwalk_peak_heap_kb=%.1f\n", walk_ms, peak_kb);
+
+    // The worker hands over the same list, and a cancelled one nothing
+    FsLargestWalker w;
+    fs_largest_walker_init(&w, FS_LARGEST_COUNT);
+    FsLargest got;
+    memset(&got, 0, sizeof(got));
+    uint64_t seen = 0;
+    FsLargestState st;
+    int worker_ok = fs_largest_walker_start(&w, a->root) == 0;
+    while (worker_ok && (st = fs_largest_walker_poll(&w, &seen)) == FS_LARGEST_RUNNING) sceKernelDelayThread(1000);
+    worker_ok = worker_ok && st == FS_LARGEST_DONE && seen == files;
+    if (worker_ok) fs_largest_walker_take(&w, &got);
+    worker_ok = worker_ok && got.count == l.count && got.files == l.files;
+    for (uint32_t i = 0; worker_ok && i < got.count; ++i)
+        worker_ok = got.items[i].size == l.items[i].size;
+    worker_ok = worker_ok && fs_largest_walker_start(&w, a->root) == 0;
+    fs_largest_walker_cancel(&w);
+    worker_ok = worker_ok && fs_largest_walker_poll(&w, NULL) == FS_LARGEST_IDLE && w.thread < 0;
+    fs_largest_walker_deinit(&w);
+    fs_largest_free(&got);
+    printf("worker_ok=%d\n", worker_ok);
+    fs_largest_free(&l);
+    ok = ok && walked && worker_ok;
+    printf("largest_ok=%d\n", ok);
+
+    const char* keys[] = { "tree_us", "walk_ms", "walk_peak_heap_kb" };
+    double vals[] = { tree_us, walk_ms, peak_kb };
+    ok = apply_checks(a, keys, vals, 3) == 0 && ok;
+    free(all);
+    bench_fixture_close(a, &t);
+    return ok ? 0 : 1;
+}
+
+// ---- dupes ------------------------------------------------------------------
+
+// Known answers of the reference XXH64 with seed 0, and the streamed digest
+// against one call, fed in uneven pieces that straddle the 32-byte stripes
+static int xxh64_ok(void)
+{
+    static const struct { const char* in; uint64_t want; } kat[] = {
+        { "", 0xef46db3751d8e999ull }, { "a", 0xd24ec4f1a98c6e5bull }, { "abc", 0x44bc2cf5ad770999ull },
+    };
+    int ok = 1;
+    for (size_t i = 0; i < sizeof(kat) / sizeof(kat[0]); ++i)
+        ok = ok && fs_xxh64(kat[i].in, strlen(kat[i].in), 0) == kat[i].want;
+
+    uint8_t data[1000];
+    uint32_t x = 12345;
+    for (size_t i = 0; i < sizeof(data); ++i) { x = x * 1103515245u + 12345u; data[i] = (uint8_t)(x >> 16); }
+    static const size_t pieces[] = { 1, 3, 7, 31, 32, 33, 64, 100 };
+    for (size_t len = 0; len <= sizeof(data); len += 97) {
+        FsXxh64 h;
+        fs_xxh64_init(&h, len);
+        for (size_t off = 0, k = 0; off < len; ++k) {
+            size_t n = pieces[k % (sizeof(pieces) / sizeof(pieces[0]))];
+            if (n > len - off) n = len - off;
+            fs_xxh64_update(&h, data + off, n);
+            off += n;
+        }
+        ok = ok && fs_xxh64_digest(&h) == fs_xxh64(data, len, len);
+    }
+    return ok;
+}
+
+// Duplicate finder over files with real contents: every planted set found
+// and nothing else, and how much of the candidate bytes had to be read.
+static int bench_dupes(const BenchArgs* a)
+{
+    SynthDupeStats gen;
+    synth_remove(a->root);
+    if (synth_dupes(a->root, a->spec.files_per_dir, 256 << 10, a->spec.seed, &gen) < 0) {
+        fprintf(stderr, "cannot generate %s\n", a->root);
+        synth_remove(a->root);
+        return 1;
+    }
+    FsTree t;
+    fs_tree_init(&t);
+    if (fs_tree_build(&t, a->root, NULL, NULL) < 0) { fprintf(stderr, "build failed\n"); bench_fixture_close(a, NULL); return 1; }
+
+    int hash_ok = xxh64_ok();
+    printf("xxh64_ok=%d\n", hash_ok);
+
+    FsDupes d;
+    fs_dupes_init(&d);
+    double t0 = now_ms();
+    int ok = hash_ok && fs_dupes_collect(&d, &t, 1, 1) == 0;
+    double collect_ms = now_ms() - t0;
+    fs_io_enable(1);
+    fs_io_reset();
+    t0 = now_ms();
+    ok = ok && fs_dupes_hash(&d, NULL) == 0;
+    double hash_ms = now_ms() - t0;
+    FsIoStats s;
+    fs_io_snapshot(&s);
+    fs_io_enable(0);
+
+    const FsDupeStats* st = &d.stats;
+    double ratio = st->candidate_bytes ? (double)st->bytes_read / (double)st->candidate_bytes : 0.0;
+    uint32_t reads = s.op[FS_IO_READ].calls;
+    printf("files=%llu\ncandidates=%llu\ncandidate_bytes=%llu\npartial_files=%llu\nfull_files=%llu\n",
+           (unsigned long long)st->files, (unsigned long long)st->candidates,
+           (unsigned long long)st->candidate_bytes, (unsigned long long)st->partial_files,
+           (unsigned long long)st->full_files);
+    printf("bytes_read=%llu\nread_ratio=%.3f\nread_calls=%u\navg_read_kb=%.1f\n", (unsigned long long)st->bytes_read,
+           ratio, reads, reads ? st->bytes_read / 1024.0 / reads : 0.0);
+    printf("collect_ms=%.2f\nhash_ms=%.1f\nhash_mb_per_s=%.1f\ngroups=%u\nreclaim_bytes=%llu\n", collect_ms, hash_ms,
+           hash_ms > 0 ? st->bytes_read / 1048576.0 / (hash_ms / 1000.0) : 0.0, st->groups,
+           (unsigned long long)st->reclaim_bytes);
+
+    // Exactly the planted sets, largest reclaim first, no patched look-alike
+    uint64_t copies = 0;
+    ok = ok && st->groups == gen.groups && st->reclaim_bytes == gen.reclaim_bytes && st->errors == 0;
+    for (uint32_t g = 0; g < d.group_count; ++g) {
+        const FsDupeGroup* grp = &d.groups[g];
+        copies += grp->count;
+        ok = ok && (g == 0 || d.groups[g - 1].reclaim >= grp->reclaim);
+        for (uint32_t i = grp->first; i < grp->first + grp->count; ++i)
+            ok = ok && d.files[i].size == grp->size && strstr(fs_dupes_path(&d, i), "/set_") &&
+                 !strstr(fs_dupes_path(&d, i), "_patched");
+    }
+    ok = ok && copies == gen.copies;
+
+    // Same answer from the worker thread
+    FsDupeFinder f;
+    fs_dupe_finder_init(&f);
+    FsDupeStats prog;
+    int finder_ok = fs_dupe_finder_start(&f, &t, 1, 1) == 0;
+    while (finder_ok && fs_dupe_finder_poll(&f, &prog) == FS_DUPES_RUNNING) sceKernelDelayThread(1000);
+    finder_ok = finder_ok && f.state == FS_DUPES_DONE && prog.groups == gen.groups && prog.stage == 3;
+    fs_dupe_finder_deinit(&f);
+    printf("finder_ok=%d\n", finder_ok);
+    ok = ok && finder_ok;
+    printf("dupes_ok=%d\n", ok);
+
+    const char* keys[] = { "read_ratio", "hash_ms", "avg_read_kb" };
+    double vals[] = { ratio, hash_ms, reads ? st->bytes_read / 1024.0 / reads : 0.0 };
+    ok = apply_checks(a, keys, vals, 3) == 0 && ok;
+
+    fs_dupes_free(&d);
+    bench_fixture_close(a, &t);
+    return ok ? 0 : 1;
+}
+
+// ---- treemap ----------------------------------------------------------------
+
+// Tiles inside the area and top-level tiles covering all of it
+static int treemap_sane(const FsTreemap* m)
+{
+    double area = 0;
+    for (uint32_t i = 0; i < m->count; ++i) {
+        const FsTile* tl = &m->tiles[i];
+        if (tl->x < -0.01f || tl->y < -0.01f || tl->w < 0 || tl->h < 0 ||
+            tl->x + tl->w > m->w + 0.01f || tl->y + tl->h > m->h + 0.01f) return 0;
+        if (!tl->depth) area += (double)tl->w * tl->h;
+    }
+    return area > 0.999 * m->w * m->h && area < 1.001 * m->w * m->h;
+}
+
+// Layout time and tile count for the root of a generated tree, the cache
+// answering a second request without a layout and a changed tree with one,
+// and the draw calls of the treemap screen.
+static int bench_treemap(const BenchArgs* a)
+{
+    SynthStats gen;
+    FsTree t;
+    if (bench_fixture_open(a, NULL, &gen, &t, NULL) < 0) return 1;
+
+    FsTreemap m;
+    fs_treemap_init(&m, FS_TREEMAP_MAX_TILES);
+    const int runs = 20;
+    double t0 = now_ms();
+    int ok = 1;
+    for (int i = 0; i < runs; ++i) ok = fs_treemap_layout(&m, &t, 0, UI_TREEMAP_W, UI_TREEMAP_H, NULL) == 0 && ok;
+    double layout_ms = (now_ms() - t0) / runs;
+    uint32_t depth = 0, other = 0;
+    for (uint32_t i = 0; i < m.count; ++i) {
+        if (m.tiles[i].depth > depth) depth = m.tiles[i].depth;
+        if (m.tiles[i].flags & FS_TILE_OTHER) other++;
+    }
+    ok = ok && treemap_sane(&m);
+    printf("nodes=%u\nlayout_ms=%.3f\ntiles=%u\nother_tiles=%u\nmax_depth=%u\nunexpanded=%u\n",
+           t.node_count, layout_ms, m.count, other, depth, m.unexpanded);
+    uint32_t tiles = m.count;
+    fs_treemap_free(&m);
+
+    // Worker: one layout, then a cache hit, then a new one once sizes change
+    FsTreemapper tm;
+    fs_treemapper_init(&tm);
+    const FsTreemap* map;
+    t0 = now_ms();
+    while (!(map = fs_treemapper_get(&tm, &t, 0, UI_TREEMAP_W, UI_TREEMAP_H))) sceKernelDelayThread(500);
+    double worker_ms = now_ms() - t0;
+    int cached = fs_treemapper_get(&tm, &t, 0, UI_TREEMAP_W, UI_TREEMAP_H) == map && tm.layouts == 1;
+    fs_treemapper_release(&tm, &t);
+    fs_tree_refresh(&t, 0);
+    int stale = fs_treemapper_get(&tm, &t, 0, UI_TREEMAP_W, UI_TREEMAP_H) == NULL;
+    while (!(map = fs_treemapper_get(&tm, &t, 0, UI_TREEMAP_W, UI_TREEMAP_H))) sceKernelDelayThread(500);
+    int relaid = stale && tm.layouts == 2 && map->tree_gen == t.gen;
+    printf("worker_ms=%.2f\ncache_hit=%d\nrelayout_on_change=%d\n", worker_ms, cached, relaid);
+    ok = ok && cached && relaid;
+
+    PartitionInfo part;
+    memset(&part, 0, sizeof(part));
+    part.label = "ux0"; part.path = "ux0:/";
+    part.total_bytes = 64ull << 30; part.free_bytes = 20ull << 30;
+    FsListing l;
+    fs_listing_init(&l);
+    fs_listing_view(&l, &t, 0);
+    const char* labels[] = { "All" };
+    UiFrame uf;
+    memset(&uf, 0, sizeof(uf));
+    uf.parts = &part;
+    uf.parts_count = 1;
+    uf.folders = &l;
+    uf.battery_percent = 80;
+    uf.treemap_view = 1;
+    uf.treemap = map;
+    uf.overlay_labels = labels;
+    uf.overlay_count = 1;
+    ui_init();
+    vita2d_rec_reset();
+    t0 = now_ms();
+    for (int f = 0; f < a->frames; ++f) {
+        frame_prof_begin();
+        uf.current_folder_index = f % (int)l.count;
+        ui_draw(&uf);
+    }
+    double ms = (now_ms() - t0) / a->frames;
+    Vita2dRecCounts c;
+    vita2d_rec_counts(&c);
+    double calls = (double)vita2d_rec_draw_calls(&c) / c.frames;
+    ui_deinit();
+    printf("draw_calls_per_frame=%.1f\nms_per_frame=%.3f\n", calls, ms);
+    printf("treemap_ok=%d\n", ok);
+
+    const char* keys[] = { "layout_ms", "tiles", "draw_calls_per_frame", "ms_per_frame" };
+    double vals[] = { layout_ms, (double)tiles, calls, ms };
+    ok = apply_checks(a, keys, vals, 4) == 0 && ok;
+
+    fs_treemapper_deinit(&tm);
+    fs_listing_free(&l);
+    bench_fixture_close(a, &t);
+    return ok ? 0 : 1;
+}
+
+// ---- snapshot ---------------------------------------------------------------
+
+// Every node of the snapshot against the tree, in pre-order
+static int snapshot_matches(const FsSnapshot* s, const FsTree* t)
+{
+    uint64_t files = 0, snap_files = 0;
+    for (uint32_t i = 1; i < t->node_count; ++i) files += !(t->nodes[i].flags & FS_NODE_DIR);
+    for (uint32_t i = 1; i < s->node_count; ++i) snap_files += !(s->nodes[i].name & FS_SNAP_DIR);
+    return s->node_count == t->node_count && snap_files == files &&
+           fs_snapshot_size(s, 0) == t->nodes[0].size_bytes && s->nodes[0].next == s->node_count;
+}
+
+// Snapshot size per node, build/save/load/map times, and a diff after one
+// folder grew and another was deleted that must name exactly those two.
+static int bench_snapshot(const BenchArgs* a)
+{
+    SynthStats gen;
+    FsTree t;
+    if (bench_fixture_open(a, NULL, &gen, &t, NULL) < 0) return 1;
+
+    char path[1024];
+    snprintf(path, sizeof(path), "%s.fsas", a->root);
+    FsSnapshot before, loaded, mapped;
+    double t0 = now_ms();
+    int ok = fs_snapshot_build(&before, &t, 1000) == 0;
+    double build_ms = now_ms() - t0;
+    t0 = now_ms();
+    ok = ok && fs_snapshot_save(&before, path) == 0;
+    double save_ms = now_ms() - t0;
+    t0 = now_ms();
+    ok = fs_snapshot_load(&loaded, path) == 0 && ok;
+    double load_ms = now_ms() - t0;
+
+    t0 = now_ms();
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    void* map = MAP_FAILED;
+    if (fd >= 0 && fstat(fd, &st) == 0) map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ok = map != MAP_FAILED && fs_snapshot_attach(&mapped, map, (size_t)st.st_size) == 0 && ok;
+    double map_us = (now_ms() - t0) * 1000.0;
+    if (fd >= 0) close(fd);
+    ok = ok && snapshot_matches(&before, &t) && snapshot_matches(&loaded, &t) && snapshot_matches(&mapped, &t);
+    printf("nodes=%u\nsnapshot_bytes=%zu\nbytes_per_node=%.1f\nbuild_ms=%.2f\nsave_ms=%.2f\nload_ms=%.2f\nmap_us=%.1f\n",
+           t.node_count, before.size, (double)before.size / t.node_count, build_ms, save_ms, load_ms, map_us);
+
+    // Grow the first top-level folder by 8 MB and delete the second
+    uint32_t grow = FS_TREE_NONE, gone = FS_TREE_NONE;
+    for (uint32_t c = t.nodes[0].first_child; c < t.nodes[0].first_child + t.nodes[0].child_count; ++c) {
+        if (!(t.nodes[c].flags & FS_NODE_DIR)) continue;
+        if (grow == FS_TREE_NONE) grow = c;
+        else if (gone == FS_TREE_NONE) gone = c;
+    }
+    if (gone == FS_TREE_NONE) { fprintf(stderr, "tree too small\n"); bench_fixture_close(a, &t); return 1; }
+    char grow_name[256], gone_name[256], file[1024];
+    snprintf(grow_name, sizeof(grow_name), "%s", fs_tree_name(&t, grow));
+    snprintf(gone_name, sizeof(gone_name), "%s", fs_tree_name(&t, gone));
+    uint64_t gone_bytes = t.nodes[gone].size_bytes;
+    snprintf(file, sizeof(file), "%s/%s/grown.bin", a->root, grow_name);
+    FILE* f = fopen(file, "wb");
+    if (f) { fseek(f, (8 << 20) - 1, SEEK_SET); fputc(0, f); fclose(f); }
+    snprintf(file, sizeof(file), "%s/%s", a->root, gone_name);
+    fs_delete_entry(file);
+
+    FsTree t2;
+    fs_tree_init(&t2);
+    FsSnapshot after;
+    FsSnapDiff d;
+    ok = fs_tree_build(&t2, a->root, NULL, NULL) == 0 && fs_snapshot_build(&after, &t2, 2000) == 0 && ok;
+    t0 = now_ms();
+    ok = ok && fs_snapshot_diff(&mapped, &after, &d) == 0;
+    double diff_ms = now_ms() - t0;
+    int diff_ok = ok && d.grew_count == 1 && !strcmp(d.grew[0].path, grow_name) && d.grew[0].delta == (8 << 20) &&
+                  d.shrank_count >= 1 && !strcmp(d.shrank[0].path, gone_name) && d.shrank[0].delta == -(int64_t)gone_bytes &&
+                  d.total_delta == (int64_t)(8 << 20) - (int64_t)gone_bytes && d.folders_added == 0 && d.folders_removed > 0;
+    printf("diff_ms=%.2f\nfolders_compared=%u\nfolders_removed=%u\ndiff_ok=%d\n", diff_ms, d.folders_compared,
+           d.folders_removed, diff_ok);
+    ok = ok && diff_ok;
+    printf("snapshot_ok=%d\n", ok);
+
+    const char* keys[] = { "bytes_per_node", "build_ms", "load_ms", "map_us", "diff_ms" };
+    double vals[] = { (double)before.size / t.node_count, build_ms, load_ms, map_us, diff_ms };
+    ok = apply_checks(a, keys, vals, 5) == 0 && ok;
+
+    if (map != MAP_FAILED) munmap(map, (size_t)st.st_size);
+    fs_snapshot_free(&before);
+    fs_snapshot_free(&loaded);
+    fs_snapshot_free(&after);
+    fs_tree_free(&t2);
+    remove(path);
+    bench_fixture_close(a, &t);
+    return ok ? 0 : 1;
+}
+
+// ---- prefetch ---------------------------------------------------------------
+
+// Top-level folder breakdowns computed on demand, then again after the
+// worker prefetched them: the warm pass has to hit the cache every time and
+// return the same numbers, with the cache inside its memory budget.
+static int bench_prefetch(const BenchArgs* a)
+{
+    SynthStats gen;
+    FsTree t;
+    if (bench_fixture_open(a, NULL, &gen, &t, NULL) < 0) return 1;
+
+    uint32_t dirs[FS_PREFETCH_QUEUE];
+    int n = 0;
+    for (uint32_t c = t.nodes[0].first_child; c < t.nodes[0].first_child + t.nodes[0].child_count && n < FS_PREFETCH_QUEUE; ++c)
+        if (t.nodes[c].flags & FS_NODE_DIR) dirs[n++] = c;
+    if (n == 0) { fprintf(stderr, "tree too small\n"); bench_fixture_close(a, &t); return 1; }
+
+    FsPrefetcher p;
+    fs_prefetcher_init(&p);
+    FsTypeStats ref;
+    fs_type_stats_init(&ref);
+    int ok = 1;
+
+    double t0 = now_ms();
+    for (int i = 0; i < n; ++i) ok = fs_prefetcher_acquire(&p, &t, dirs[i]) != NULL && ok;
+    double cold_ms = now_ms() - t0;
+
+    // A second tree generation leaves nothing to hit
+    fs_prefetcher_release(&p, &t);
+    t.gen++;
+    t0 = now_ms();
+    fs_prefetcher_hint(&p, &t, dirs, n);
+    for (int w = 0; w < 10000 && p.active; ++w) usleep(100);
+    double prefetch_ms = now_ms() - t0;
+    ok = !p.active && p.prefetched == (uint32_t)n && ok;
+
+    uint32_t hits0 = p.hits;
+    t0 = now_ms();
+    for (int i = 0; i < n; ++i) ok = fs_prefetcher_acquire(&p, &t, dirs[i]) != NULL && ok;
+    double warm_us = (now_ms() - t0) * 1000.0 / n;
+    double hit_rate = (double)(p.hits - hits0) / n;
+    for (int i = 0; i < n; ++i) {
+        const FsTypeStats* s = fs_prefetcher_acquire(&p, &t, dirs[i]);
+        ok = s && fs_tree_type_stats(&t, dirs[i], &ref, NULL) == 0 && ok;
+        ok = ok && !memcmp(s->cat_bytes, ref.cat_bytes, sizeof(ref.cat_bytes)) && s->ext_used == ref.ext_used;
+    }
+    double cache_kb = p.bytes / 1024.0;
+    ok = ok && p.bytes <= FS_PREFETCH_BUDGET;
+
+    fs_prefetcher_release(&p, &t);
+    ok = ok && p.thread < 0 && p.queued == 0;
+
+    // Release stops a pass part way instead of waiting for it to finish
+    volatile int stop = 1;
+    ok = ok && fs_tree_type_stats(&t, 0, &ref, &stop) < 0;
+    t.gen++;
+    fs_prefetcher_hint(&p, &t, dirs, n);
+    t0 = now_ms();
+    fs_prefetcher_release(&p, &t);
+    double release_ms = now_ms() - t0;
+    ok = ok && p.thread < 0 && p.queued == 0;
+    printf("folders=%d\ncold_ms=%.2f\nprefetch_ms=%.2f\nwarm_us=%.2f\nhit_rate=%.2f\ncache_kb=%.1f\nrelease_ms=%.2f\nprefetch_ok=%d\n",
+           n, cold_ms, prefetch_ms, warm_us, hit_rate, cache_kb, release_ms, ok);
+
+    const char* keys[] = { "cold_ms", "prefetch_ms", "warm_us", "hit_rate", "cache_kb" };
+    double vals[] = { cold_ms, prefetch_ms, warm_us, hit_rate, cache_kb };
+    ok = apply_checks(a, keys, vals, 5) == 0 && ok;
+
+    fs_type_stats_free(&ref);
+    fs_prefetcher_deinit(&p);
+    bench_fixture_close(a, &t);
+    return ok ? 0 : 1;
+}
+
+// ---- filters ----------------------------------------------------------------
+
+// Known answers for the glob forms filters.txt documents
+static int filter_globs_ok(void)
+{
+    FsFilterSet f;
+    fs_filter_init(&f);
+    const char* text = "ISOs = ux0:/pspemu/**/*.iso\nSaves = */savedata/*\nMusic = *.mp3 track_??.ogg\n";
+    int ok = fs_filter_parse(&f, text, strlen(text)) == 0 && f.filter_count == 3 && f.skipped == 0;
+    static const struct { const char* path; uint32_t mask; } cases[] = {
+        { "ux0:/pspemu/ISO/Game.ISO", 1 },
+        { "ux0:/pspemu/game.iso", 1 },
+        { "ur0:/pspemu/game.iso", 0 },
+        { "ux0:/pspemu/ISO/game.iso.txt", 0 },
+        { "ux0:/user/00/savedata/PCSE00001/sdslot.dat", 2 },
+        { "ux0:/user/00/savedata", 0 },
+        { "ux0:/savedata.txt", 0 },
+        { "ux0:/music/a.mp3", 4 },
+        { "ux0:/music/track_01.ogg", 4 },
+        { "ux0:/music/track_1.ogg", 0 },
+        { "ux0:/pspemu/savedata/x/y.mp3", 6 },
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+        uint32_t got = fs_filter_match(&f, cases[i].path);
+        if (got != cases[i].mask) { fprintf(stderr, "glob mismatch: %s -> %u\n", cases[i].path, got); ok = 0; }
+    }
+    fs_filter_free(&f);
+    return ok;
+}
+
+// Names/s of the per-extension loop against the compiled filters, for
+// growing rule sets; the filters' rate should stay flat.
+static int bench_filters(const BenchArgs* a)
+{
+    SynthStats gen;
+    FsTree t;
+    if (bench_fixture_open(a, NULL, &gen, &t, NULL) < 0) return 1;
+
+    uint32_t name_count = 0;
+    const char** names = (const char**)malloc(t.node_count * sizeof(*names));
+    for (uint32_t i = 0; names && i < t.node_count; ++i)
+        if (!(t.nodes[i].flags & FS_NODE_DIR)) names[name_count++] = fs_tree_name(&t, i);
+    if (!name_count) { fprintf(stderr, "no files\n"); free(names); bench_fixture_close(a, &t); return 1; }
+    uint32_t passes = 1000000 / name_count + 1;
+
+    // The Square menu's extensions first, then made-up ones
+    enum { RULES_MAX = 512 };
+    static char ext_buf[RULES_MAX][16];
+    const char* exts[RULES_MAX];
+    int n_ext = 0;
+    for (int c = 0; c < FS_CAT_OTHER; ++c)
+        for (int i = 0; i < 6 && OLD_FILTER_EXTS[c][i]; ++i) snprintf(ext_buf[n_ext++], 16, "%s", OLD_FILTER_EXTS[c][i]);
+    for (int i = 0; n_ext < RULES_MAX; ++i) snprintf(ext_buf[n_ext++], 16, ".x%03d", i);
+    for (int i = 0; i < RULES_MAX; ++i) exts[i] = ext_buf[i];
+
+    int ok = filter_globs_ok();
+    printf("files=%u\nglobs_ok=%d\n", name_count, ok);
+    static const int sizes[] = { 8, 64, 512 };
+    double loop_nps[3], dfa_nps[3];
+    for (int k = 0; k < 3; ++k) {
+        int n = sizes[k];
+        FsFilterSet f;
+        fs_filter_init(&f);
+        char glob[24], label[16];
+        for (int i = 0; i < n; ++i) {
+            snprintf(glob, sizeof(glob), "*%s", exts[i]);
+            snprintf(label, sizeof(label), "f%d", i % FS_FILTER_MAX);
+            fs_filter_add(&f, label, glob);
+        }
+        ok = fs_filter_compile(&f) == 0 && ok;
+
+        uint64_t loop_hits = 0, dfa_hits = 0;
+        double t0 = now_ms();
+        for (uint32_t p = 0; p < passes; ++p)
+            for (uint32_t i = 0; i < name_count; ++i) loop_hits += fs_match_extension(names[i], exts, n) != 0;
+        double loop_ms = now_ms() - t0;
+        t0 = now_ms();
+        for (uint32_t p = 0; p < passes; ++p)
+            for (uint32_t i = 0; i < name_count; ++i) {
+                uint32_t state = fs_filter_run(&f, FS_FILTER_START, names[i]);
+                dfa_hits += f.accept[state] != 0;
+            }
+        double dfa_ms = now_ms() - t0;
+        double total = (double)passes * name_count;
+        loop_nps[k] = loop_ms > 0 ? total * 1000.0 / loop_ms : 0.0;
+        dfa_nps[k] = dfa_ms > 0 ? total * 1000.0 / dfa_ms : 0.0;
+        ok = ok && loop_hits == dfa_hits;
+        printf("rules_%d_loop_names_per_sec=%.0f\nrules_%d_filter_names_per_sec=%.0f\nrules_%d_states=%u\nrules_%d_match=%d\n",
+               n, loop_nps[k], n, dfa_nps[k], n, f.state_count, n, loop_hits == dfa_hits);
+        fs_filter_free(&f);
+    }
+
+    // Folder totals from one walk against matching every full path
+    FsFilterSet f;
+    fs_filter_init(&f);
+    char text[256];
+    snprintf(text, sizeof(text), "Media = *.mp3 *.ogg *.jpg\nISOs = %s/**/*.iso\nDocs = */docs/*\n", a->root);
+    ok = fs_filter_parse(&f, text, strlen(text)) == 0 && ok;
+    FsFilterStats st;
+    fs_filter_stats_init(&st);
+    double t0 = now_ms();
+    ok = fs_filter_tree_stats(&f, &t, 0, &st) == 0 && ok;
+    double tree_ms = now_ms() - t0;
+    uint64_t want[FS_FILTER_MAX] = { 0 };
+    char path[4096];
+    for (uint32_t i = 0; i < t.node_count; ++i) {
+        if (t.nodes[i].flags & FS_NODE_DIR) continue;
+        fs_tree_path(&t, i, path, sizeof(path));
+        for (uint32_t m = fs_filter_match(&f, path); m; m &= m - 1) want[__builtin_ctz(m)] += t.nodes[i].size_bytes;
+    }
+    int tree_ok = 1;
+    for (uint32_t i = 0; i < f.filter_count; ++i) {
+        uint64_t rows = 0;
+        for (uint32_t c = 0; c < st.child_count; ++c) rows += st.child_bytes[(size_t)c * st.stride + i];
+        tree_ok = tree_ok && st.bytes[i] == want[i] && rows == want[i];
+    }
+    printf("tree_ms=%.2f\ntree_ok=%d\n", tree_ms, tree_ok);
+    ok = ok && tree_ok;
+    fs_filter_stats_free(&st);
+    fs_filter_free(&f);
+
+    double flatness = dfa_nps[0] > 0 ? dfa_nps[2] / dfa_nps[0] : 0.0;
+    double speedup = loop_nps[2] > 0 ? dfa_nps[2] / loop_nps[2] : 0.0;
+    printf("flatness=%.2f\nspeedup_512=%.1f\nfilters_ok=%d\n", flatness, speedup, ok);
+    const char* keys[] = { "flatness", "speedup_512", "tree_ms" };
+    double vals[] = { flatness, speedup, tree_ms };
+    ok = apply_checks(a, keys, vals, 3) == 0 && ok;
+
+    free(names);
+    bench_fixture_close(a, &t);
+    return ok ? 0 : 1;
+}
+
+// ---- spill ------------------------------------------------------------------
+
+// Index listing of `dir` against the tree's children of `node`
+static int spill_listing_matches(FsPathIndex* x, const char* dir, const FsTree* t, uint32_t node, FsListing* l)
+{
+    if (fs_path_index_list(x, dir, l) < 0 || l->count != t->nodes[node].child_count) return 0;
+    for (uint32_t i = 0; i < l->count; ++i) {
+        uint32_t c = t->nodes[node].first_child, end = c + t->nodes[node].child_count;
+        while (c < end && strcmp(fs_tree_name(t, c), fs_listing_name(l, i))) c++;
+        if (c == end || t->nodes[c].size_bytes != fs_listing_size(l, i) ||
+            !(t->nodes[c].flags & FS_NODE_DIR) != !fs_listing_is_dir(l, i)) return 0;
+    }
+    return 1;
+}
+
+typedef struct {
+    double       add_ms;
+    double       finish_ms;
+    double       read_ms;
+    FsSpillStats stats;
+    int          ok;
+} SpillResult;
+
+// `records` files in 100 x 100 folders, each folder's names out of order and
+// the folder itself after them, the way a walk hands them over
+static SpillResult run_spill(const char* index_path, const char* tmp_dir, uint32_t records, size_t budget)
+{
+    SpillResult r;
+    memset(&r, 0, sizeof(r));
+    uint32_t per = records / 10000 ? records / 10000 : 1;
+    FsSpill s;
+    if (fs_spill_init(&s, budget, tmp_dir, "/synthetic") < 0) return r;
+    char path[64];
+    uint64_t total = 0;
+    int ok = 1;
+    double t0 = now_ms();
+    for (uint32_t d = 0; d < 100 && ok; ++d) {
+        uint64_t top = 0;
+        for (uint32_t sub = 0; sub < 100 && ok; ++sub) {
+            uint64_t sum = 0;
+            for (uint32_t f = 0; f < per && ok; ++f) {
+                uint32_t k = (uint32_t)(((uint64_t)f * 7919) % per);
+                uint64_t size = 512 + (uint64_t)((d * 131 + sub * 31 + k) % 4096) * 16;
+                snprintf(path, sizeof(path), "d%02u/s%02u/f%06u.dat", d, sub, k);
+                ok = fs_spill_add(&s, path, size, 0) == 0;
+                sum += size;
+            }
+            snprintf(path, sizeof(path), "d%02u/s%02u", d, sub);
+            ok = ok && fs_spill_add(&s, path, sum, FS_SPILL_DIR) == 0;
+            top += sum;
+        }
+        snprintf(path, sizeof(path), "d%02u", d);
+        ok = ok && fs_spill_add(&s, path, top, FS_SPILL_DIR) == 0;
+        total += top;
+    }
+    r.add_ms = now_ms() - t0;
+    t0 = now_ms();
+    ok = ok && fs_spill_finish(&s, index_path) == 0;
+    r.finish_ms = now_ms() - t0;
+    r.stats = s.stats;
+    fs_spill_free(&s);
+
+    // Everything comes back once, in order, with the folders' ends in place
+    FsPathIndex x;
+    t0 = now_ms();
+    if (ok && fs_path_index_open(&x, index_path) == 0) {
+        uint64_t n = 0;
+        static char prev[FS_SPILL_PATH];
+        uint32_t prev_len = 0;
+        const FsSpillRecord* rec;
+        while ((rec = fs_path_index_next(&x)) != NULL) {
+            if (n && fs_path_compare(prev, prev_len, rec->path, rec->len) >= 0) { ok = 0; break; }
+            memcpy(prev, rec->path, rec->len);
+            prev_len = rec->len;
+            n++;
+        }
+        ok = ok && n == (uint64_t)per * 10000 + 10100 && x.hdr.records == n && x.hdr.total_bytes == total;
+        FsListing l;
+        fs_listing_init(&l);
+        ok = ok && fs_path_index_list(&x, "", &l) == 0 && l.count == 100;
+        ok = ok && fs_path_index_list(&x, "d57/s03", &l) == 0 && l.count == per;
+        fs_listing_free(&l);
+        fs_path_index_close(&x);
+    } else {
+        ok = 0;
+    }
+    r.read_ms = now_ms() - t0;
+    r.ok = ok;
+    return r;
+}
+
+// Forks for run_spill, or for nothing at all when records is 0
+static int measure_spill(const char* index_path, const char* tmp_dir, uint32_t records, size_t budget,
+                         SpillResult* out, long* maxrss_kb)
+{
+    int fd[2];
+    if (pipe(fd) < 0) return -1;
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) { close(fd[0]); close(fd[1]); return -1; }
+    if (pid == 0) {
+        close(fd[0]);
+        SpillResult r;
+        memset(&r, 0, sizeof(r));
+        r.ok = 1;
+        if (records) r = run_spill(index_path, tmp_dir, records, budget);
+        _exit(write(fd[1], &r, sizeof(r)) == (ssize_t)sizeof(r) ? 0 : 1);
+    }
+    close(fd[1]);
+    ssize_t n = read(fd[0], out, sizeof(*out));
+    close(fd[0]);
+    int status = 0;
+    struct rusage ru;
+    memset(&ru, 0, sizeof(ru));
+    if (wait4(pid, &status, 0, &ru) < 0) return -1;
+    *maxrss_kb = ru.ru_maxrss;
+    return (n == (ssize_t)sizeof(*out) && WIFEXITED(status) && WEXITSTATUS(status) == 0) ? 0 : -1;
+}
+
+// A scan of a generated tree into a path index with the smallest budget,
+// whose listings must match the in-memory tree, then --records synthetic
+// entries through a --budget-mb buffer in a child process whose peak RSS
+// has to stay near the budget.
+static int bench_spill(const BenchArgs* a)
+{
+    SynthStats gen;
+    FsTree t;
+    if (bench_fixture_open(a, NULL, &gen, &t, NULL) < 0) return 1;
+
+    // A tree build over its budget stops and says why
+    FsTree capped;
+    fs_tree_init(&capped);
+    FsScanCtl ctl;
+    memset(&ctl, 0, sizeof(ctl));
+    ctl.max_bytes = 64 * 1024;
+    int budget_ok = fs_tree_build(&capped, a->root, NULL, &ctl) < 0 && ctl.over_budget && capped.node_count == 0;
+    fs_tree_free(&capped);
+
+    char index_path[1024], tmp_dir[1024];
+    snprintf(index_path, sizeof(index_path), "%s.fsap", a->root);
+    FsSpillStats st;
+    memset(&st, 0, sizeof(st));
+    memset(&ctl, 0, sizeof(ctl));
+    double t0 = now_ms();
+    int ok = budget_ok && fs_spill_scan(a->root, FS_SPILL_MIN, index_path, &ctl, &st) == 0;
+    double scan_ms = now_ms() - t0;
+    ok = ok && st.records == t.node_count - 1 && ctl.bytes == t.nodes[0].size_bytes;
+
+    FsPathIndex x;
+    FsListing l;
+    fs_listing_init(&l);
+    int lists_ok = 0;
+    if (ok && fs_path_index_open(&x, index_path) == 0) {
+        lists_ok = x.hdr.total_bytes == t.nodes[0].size_bytes && spill_listing_matches(&x, "", &t, 0, &l);
+        char dir[1024];
+        for (uint32_t c = t.nodes[0].first_child; c < t.nodes[0].first_child + t.nodes[0].child_count; ++c) {
+            if (!(t.nodes[c].flags & FS_NODE_DIR)) continue;
+            snprintf(dir, sizeof(dir), "%s", fs_tree_name(&t, c));
+            lists_ok = lists_ok && spill_listing_matches(&x, dir, &t, c, &l);
+            uint32_t g = t.nodes[c].first_child, end = g + t.nodes[c].child_count;
+            while (g < end && !(t.nodes[g].flags & FS_NODE_DIR)) g++;
+            if (g == end) continue;
+            snprintf(dir, sizeof(dir), "%s/%s", fs_tree_name(&t, c), fs_tree_name(&t, g));
+            lists_ok = lists_ok && spill_listing_matches(&x, dir, &t, g, &l);
+        }
+        fs_path_index_close(&x);
+    }
+    fs_listing_free(&l);
+    remove(index_path);
+    printf("budget_ok=%d\ntree_records=%llu\ntree_runs=%u\nscan_ms=%.2f\nlists_ok=%d\n", budget_ok,
+           (unsigned long long)st.records, st.runs, scan_ms, lists_ok);
+    ok = ok && lists_ok;
+
+    size_t budget = (size_t)a->budget_mb << 20;
+    snprintf(tmp_dir, sizeof(tmp_dir), "%s_spill", a->root);
+    SpillResult base, r;
+    long base_kb = 0, rss_kb = 0;
+    int big_ok = measure_spill(index_path, tmp_dir, 0, budget, &base, &base_kb) == 0 &&
+                 measure_spill(index_path, tmp_dir, (uint32_t)a->records, budget, &r, &rss_kb) == 0 && r.ok;
+    if (!big_ok) memset(&r, 0, sizeof(r));
+    remove(index_path);
+    double over_kb = (double)(rss_kb - base_kb);
+    double secs = (r.add_ms + r.finish_ms) / 1000.0;
+    double rps = secs > 0 ? (double)r.stats.records / secs : 0.0;
+    printf("records=%llu\nbudget_kb=%zu\npeak_held_kb=%zu\npeak_rss_over_baseline_kb=%.0f\nruns=%u\nmerge_passes=%u\n"
+           "spilled_mb=%.1f\nindex_mb=%.1f\nadd_ms=%.1f\nfinish_ms=%.1f\nread_ms=%.1f\nrecords_per_sec=%.0f\n",
+           (unsigned long long)r.stats.records, budget >> 10, r.stats.peak_bytes >> 10, over_kb, r.stats.runs,
+           r.stats.merge_passes, r.stats.spilled_bytes / 1048576.0, r.stats.index_bytes / 1048576.0, r.add_ms,
+           r.finish_ms, r.read_ms, rps);
+    ok = ok && big_ok && r.stats.peak_bytes <= budget + (budget >> 4);
+    printf("spill_ok=%d\n", ok);
+
+    const char* keys[] = { "peak_rss_over_baseline_kb", "peak_held_kb", "records_per_sec", "scan_ms" };
+    double vals[] = { over_kb, (double)(r.stats.peak_bytes >> 10), rps, scan_ms };
+    ok = apply_checks(a, keys, vals, 4) == 0 && ok;
+
+    bench_fixture_close(a, &t);
+    return ok ? 0 : 1;
+}
+
+// ---- report -----------------------------------------------------------------
+
+// Known answers for the escaping of both formats
+static int report_escapes_ok(void)
+{
+    static const char* names[] = { "a\"b", "c,d", "e\nf", "g\\h" };
+    static const char* want[2] = {
+        "{\"rank\":1,\"name\":\"a\\\"b\",\"type\":\"file\",\"size\":4}\n"
+        "{\"rank\":2,\"name\":\"c,d\",\"type\":\"file\",\"size\":3}\n"
+        "{\"rank\":3,\"name\":\"e\\u000af\",\"type\":\"file\",\"size\":2}\n"
+        "{\"rank\":4,\"name\":\"g\\\\h\",\"type\":\"dir\",\"size\":1}\n",
+        "rank,name,type,size\n1,\"a\"\"b\",file,4\n2,\"c,d\",file,3\n3,\"e\nf\",file,2\n4,g\\h,dir,1\n" };
+    FsListing l;
+    fs_listing_init(&l);
+    for (int i = 0; i < 4; ++i) fs_listing_add(&l, names[i], (uint64_t)(4 - i), i == 3 ? FS_ENTRY_DIR : 0);
+    fs_listing_sort(&l);
+    int ok = 1;
+    char path[] = "/tmp/fsa_report_XXXXXX";
+    for (int f = 0; f < 2; ++f) {
+        int fd = mkstemp(path);
+        FsReport r;
+        ok = fd >= 0 && fs_report_open(&r, fd, f) == 0 && fs_report_listing(&r, &l, 10) == 0 && ok;
+        ok = fs_report_close(&r) == 0 && ok;
+        char got[512] = { 0 };
+        ok = ok && lseek(fd, 0, SEEK_SET) == 0 && read(fd, got, sizeof(got) - 1) > 0 && !strcmp(got, want[f]);
+        if (fd >= 0) { close(fd); unlink(path); }
+        strcpy(path, "/tmp/fsa_report_XXXXXX");
+    }
+    fs_listing_free(&l);
+    return ok;
+}
+
+// Lines in a file, and whether every one is a JSON object
+static uint64_t count_lines(const char* path, int* objects)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f) return 0;
+    static char line[8192];
+    uint64_t n = 0;
+    *objects = 1;
+    while (fgets(line, sizeof(line), f)) {
+        size_t len = strlen(line);
+        *objects = *objects && line[0] == '{' && len >= 3 && line[len - 2] == '}' && line[len - 1] == '\n';
+        n++;
+    }
+    fclose(f);
+    return n;
+}
+
+// Every entry of a generated tree written as JSON Lines and CSV to
+// /dev/null against the time the walk took, then to files that must hold
+// one row per entry, and once more through the device's export thread.
+static int bench_report(const BenchArgs* a)
+{
+    SynthStats gen;
+    if (bench_fixture_open(a, NULL, &gen, NULL, NULL) < 0) return 1;
+    FsTree t;
+    fs_tree_init(&t);
+    FsScanCtl ctl;
+    memset(&ctl, 0, sizeof(ctl));
+    ctl.threads = a->threads;
+    double t0 = now_ms();
+    if (fs_tree_build(&t, a->root, NULL, &ctl) < 0) { fprintf(stderr, "build failed\n"); bench_fixture_close(a, NULL); return 1; }
+    double scan_ms = now_ms() - t0;
+
+    int ok = report_escapes_ok();
+    printf("entries=%u\nscan_ms=%.2f\nescapes_ok=%d\n", t.node_count, scan_ms, ok);
+    double ms[2], mbps[2];
+    for (int f = 0; f < 2; ++f) {
+        int fd = open("/dev/null", O_WRONLY);
+        FsReport r;
+        t0 = now_ms();
+        ok = fd >= 0 && fs_report_open(&r, fd, f) == 0 && fs_report_tree(&r, &t, 0, NULL) == 0 && ok;
+        ok = fs_report_close(&r) == 0 && ok;
+        ms[f] = now_ms() - t0;
+        if (fd >= 0) close(fd);
+        mbps[f] = ms[f] > 0 ? r.bytes / 1048576.0 / (ms[f] / 1000.0) : 0.0;
+        printf("%s_ms=%.2f\n%s_rows_per_sec=%.0f\n%s_mb_per_sec=%.1f\n%s_bytes_per_row=%.1f\n", fs_report_suffix(f), ms[f],
+               fs_report_suffix(f), ms[f] > 0 ? r.rows * 1000.0 / ms[f] : 0.0, fs_report_suffix(f), mbps[f],
+               fs_report_suffix(f), (double)r.bytes / t.node_count);
+    }
+
+    char path[1024];
+    snprintf(path, sizeof(path), "%s.jsonl", a->root);
+    int objects = 0;
+    FsExporter e;
+    fs_exporter_init(&e);
+    uint64_t rows = 0;
+    ok = fs_exporter_start(&e, &t, 0, path, FS_REPORT_JSONL) == 0 && ok;
+    FsExportState st;
+    while ((st = fs_exporter_poll(&e, &rows)) == FS_EXPORT_RUNNING) usleep(1000);
+    uint64_t lines = count_lines(path, &objects);
+    int export_ok = st == FS_EXPORT_DONE && rows == t.node_count && lines == t.node_count && objects;
+    fs_exporter_deinit(&e);
+    remove(path);
+
+    snprintf(path, sizeof(path), "%s.csv", a->root);
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    FsReport r;
+    int csv_ok = fd >= 0 && fs_report_open(&r, fd, FS_REPORT_CSV) == 0 && fs_report_tree(&r, &t, 0, NULL) == 0;
+    csv_ok = fs_report_close(&r) == 0 && csv_ok;
+    if (fd >= 0) close(fd);
+    csv_ok = csv_ok && count_lines(path, &objects) == (uint64_t)t.node_count + 1;
+    remove(path);
+
+    double write_vs_scan = scan_ms > 0 ? ms[0] / scan_ms : 0.0;
+    printf("write_vs_scan=%.3f\nexport_ok=%d\ncsv_ok=%d\n", write_vs_scan, export_ok, csv_ok);
+    ok = ok && export_ok && csv_ok;
+    printf("report_ok=%d\n", ok);
+
+    const char* keys[] = { "write_vs_scan", "jsonl_mb_per_sec", "csv_mb_per_sec" };
+    double vals[] = { write_vs_scan, mbps[0], mbps[1] };
+    ok = apply_checks(a, keys, vals, 3) == 0 && ok;
+
+    bench_fixture_close(a, &t);
+    return ok ? 0 : 1;
+}
+
+// ---- search -----------------------------------------------------------------
+
+#define SEARCH_PER_DIR 50 // synth_mem_tree fan-out: folders of about 50 entries
+
+static int name_has(const char* name, const char* query)
+{
+    size_t ql = strlen(query);
+    for (; *name; ++name)
+        if (!strncasecmp(name, query, ql)) return 1;
+    return ql == 0;
+}
+
+// Checks one query's result against every live node: the count, and that
+// the hits are the largest matches, largest first
+static int search_matches(const FsSearch* s, const FsTree* t, const char* query, double* brute_ms)
+{
+    double t0 = now_ms();
+    uint32_t count = 0;
+    uint64_t cut = s->hit_count ? t->nodes[s->hits[s->hit_count - 1]].size_bytes : 0;
+    uint32_t above = 0;
+    uint32_t* stack = (uint32_t*)malloc((size_t)t->node_count * sizeof(uint32_t));
+    if (!stack) return 0;
+    uint32_t sp = 0;
+    stack[sp++] = 0;
+    while (sp > 0) {
+        const FsNode* n = &t->nodes[stack[--sp]];
+        for (uint32_t c = n->first_child; c < n->first_child + n->child_count; ++c) {
+            stack[sp++] = c;
+            if (!*query || !name_has(fs_tree_name(t, c), query)) continue;
+            count++;
+            if (t->nodes[c].size_bytes > cut) above++;
+        }
+    }
+    free(stack);
+    *brute_ms += now_ms() - t0;
+
+    uint32_t want = count < FS_SEARCH_MAX_HITS ? count : FS_SEARCH_MAX_HITS;
+    int ok = s->match_count == count && s->hit_count == want && above < want + (want == 0);
+    for (uint32_t i = 0; ok && i < s->hit_count; ++i) {
+        ok = name_has(fs_tree_name(t, s->hits[i]), query);
+        if (ok && i > 0) ok = t->nodes[s->hits[i]].size_bytes <= t->nodes[s->hits[i - 1]].size_bytes;
+    }
+    return ok;
+}
+
+// A walk through the scanner hands over a name index of its tree; after a
+// delete the rebuilt index must drop the entry
+static int search_scan_ok(const BenchArgs* a)
+{
+    FsScanner s;
+    fs_scanner_init(&s);
+    FsTree t;
+    fs_tree_init(&t);
+    FsNameIndex x;
+    fs_name_index_init(&x);
+    FsSearch q;
+    fs_search_init(&q);
+    int ok = fs_scanner_start(&s, 0, a->root, NULL, 0, a->root, a->threads) == 0;
+    while (ok && fs_scanner_poll(&s, NULL, NULL, NULL) == FS_SCAN_RUNNING) sceKernelDelayThread(2000);
+    ok = ok && fs_scanner_take(&s, &t) == 0;
+    if (ok) fs_scanner_take_names(&s, &x);
+    ok = ok && x.gen == t.gen && x.node_count == t.node_count - 1;
+
+    // The largest file below the first folder, searched by its whole name
+    uint32_t file = FS_TREE_NONE;
+    for (uint32_t i = 1; ok && i < t.node_count && file == FS_TREE_NONE; ++i)
+        if (!(t.nodes[i].flags & FS_NODE_DIR)) file = i;
+    double brute_ms = 0;
+    char name[256];
+    ok = ok && file != FS_TREE_NONE;
+    if (ok) snprintf(name, sizeof(name), "%s", fs_tree_name(&t, file));
+    ok = ok && fs_search_run(&q, &x, &t, name) > 0 && search_matches(&q, &t, name, &brute_ms);
+    uint32_t before = q.match_count;
+    ok = ok && fs_tree_remove(&t, file) == 0 && fs_search_run(&q, &x, &t, name) < 0;
+    ok = ok && fs_name_index_build(&x, &t, NULL) == 0 && fs_search_run(&q, &x, &t, name) >= 0;
+    ok = ok && q.match_count == before - 1 && search_matches(&q, &t, name, &brute_ms);
+
+    fs_search_free(&q);
+    fs_name_index_free(&x);
+    fs_tree_free(&t);
+    fs_scanner_deinit(&s);
+    return ok;
+}
+
+// Queries typed one key at a time, then erased back, over --entries names:
+// every keystroke's time with the state of the one before, against a cold
+// query and a brute-force pass over the tree that also checks the result.
+static int bench_search(const BenchArgs* a)
+{
+    static const char* const typed[] = { "trophy_album", "DATA_save_1", "eboot", "patch_icon_12.png", "x", "zzzz" };
+    SynthStats gen;
+    if (bench_fixture_open(a, NULL, &gen, NULL, NULL) < 0) return 1;
+    int scan_ok = search_scan_ok(a);
+    bench_fixture_close(a, NULL);
+
+    char cache[1024];
+    snprintf(cache, sizeof(cache), "%s.fsai", a->root);
+    FsTree t;
+    fs_tree_init(&t);
+    if (synth_mem_tree(&t, (uint32_t)a->entries, SEARCH_PER_DIR, 7, cache) < 0) { fprintf(stderr, "cannot make the tree\n"); return 1; }
+
+    // A cancelled scan must not sit in the index build or the cache write
+    FsNameIndex x;
+    fs_name_index_init(&x);
+    volatile int stop = 1;
+    double t0 = now_ms();
+    int cancel_ok = fs_name_index_build(&x, &t, &stop) < 0 && x.gen == 0;
+    cancel_ok = fs_tree_save(&t, cache, &stop) < 0 && access(cache, F_OK) != 0 && cancel_ok;
+    double cancel_ms = now_ms() - t0;
+
+    t0 = now_ms();
+    int ok = fs_name_index_build(&x, &t, NULL) == 0;
+    double build_ms = now_ms() - t0;
+
+    FsSearch warm, cold;
+    fs_search_init(&warm);
+    fs_search_init(&cold);
+    double key_max = 0, key_sum = 0, cold_max = 0, brute_ms = 0;
+    int keys = 0, results_ok = ok;
+    uint64_t checked = 0;
+    char query[FS_SEARCH_QUERY];
+    for (size_t w = 0; ok && w < sizeof(typed) / sizeof(typed[0]); ++w) {
+        size_t len = strlen(typed[w]);
+        // Typed up to the whole word, then erased down to one key
+        for (size_t step = 1; step < 2 * len; ++step) {
+            size_t n = step <= len ? step : 2 * len - step;
+            memcpy(query, typed[w], n);
+            query[n] = '\0';
+            t0 = now_ms();
+            int r = fs_search_run(&warm, &x, &t, query);
+            double ms = now_ms() - t0;
+            key_sum += ms;
+            if (ms > key_max) key_max = ms;
+            keys++;
+            checked += warm.checked;
+            results_ok = results_ok && r >= 0 && search_matches(&warm, &t, query, &brute_ms);
+
+            fs_search_free(&cold);
+            t0 = now_ms();
+            r = fs_search_run(&cold, &x, &t, query);
+            ms = now_ms() - t0;
+            if (ms > cold_max) cold_max = ms;
+            results_ok = results_ok && r >= 0 && cold.match_count == warm.match_count;
+        }
+    }
+    // The worker builds the same index, and a released one leaves nothing
+    FsNameIndexer ix;
+    fs_name_indexer_init(&ix);
+    FsNameIndex y;
+    fs_name_index_init(&y);
+    int worker_ok = ok && fs_name_indexer_start(&ix, &t) == 0;
+    FsIndexState st;
+    while (worker_ok && (st = fs_name_indexer_poll(&ix)) == FS_INDEX_RUNNING) sceKernelDelayThread(1000);
+    worker_ok = worker_ok && st == FS_INDEX_DONE;
+    if (worker_ok) fs_name_indexer_take(&ix, &y);
+    worker_ok = worker_ok && y.gen == x.gen && y.name_count == x.name_count && y.node_count == x.node_count &&
+                y.bytes == x.bytes && !memcmp(y.post, x.post, x.post_off[FS_SEARCH_BUCKETS]);
+    worker_ok = worker_ok && fs_name_indexer_start(&ix, &t) == 0;
+    fs_name_indexer_release(&ix, &t);
+    worker_ok = worker_ok && ix.thread < 0 && fs_name_indexer_poll(&ix) == FS_INDEX_IDLE && ix.result.gen == 0;
+    fs_name_indexer_deinit(&ix);
+    fs_name_index_free(&y);
+    cancel_ok = cancel_ok && worker_ok;
+
+    double key_avg = keys ? key_sum / keys : 0.0;
+    double brute_avg = keys ? brute_ms / keys : 0.0;
+    printf("entries=%u\nnames=%u\nbuild_ms=%.1f\nindex_kb=%zu\nindex_bytes_per_entry=%.1f\nkeystrokes=%d\n"
+           "keystroke_ms_avg=%.3f\nkeystroke_ms_max=%.3f\ncold_ms_max=%.3f\nbrute_ms_avg=%.3f\nnames_checked_avg=%.0f\n"
+           "scan_ok=%d\nresults_ok=%d\ncancel_ms=%.2f\nworker_ok=%d\ncancel_ok=%d\n",
+           t.node_count, x.name_count, build_ms, x.bytes >> 10, t.node_count ? (double)x.bytes / t.node_count : 0.0,
+           keys, key_avg, key_max, cold_max, brute_avg, keys ? (double)checked / keys : 0.0, scan_ok, results_ok,
+           cancel_ms, worker_ok, cancel_ok);
+    ok = ok && scan_ok && results_ok && cancel_ok;
+    printf("search_ok=%d\n", ok);
+
+    const char* keys_[] = { "keystroke_ms_max", "keystroke_ms_avg", "cold_ms_max", "build_ms", "index_bytes_per_entry",
+                            "cancel_ms" };
+    double vals[] = { key_max, key_avg, cold_max, build_ms, t.node_count ? (double)x.bytes / t.node_count : 0.0,
+                      cancel_ms };
+    ok = apply_checks(a, keys_, vals, 6) == 0 && ok;
+
+    fs_search_free(&warm);
+    fs_search_free(&cold);
+    fs_name_index_free(&x);
+    fs_tree_free(&t);
+    return ok ? 0 : 1;
+}
+
+// ---- sort -------------------------------------------------------------------
+
+// Counts every live node's files, folders and newest mtime again from the
+// files and folders below it, and compares them with the tree's. Children
+// always sit after their parent, so one forward pass finds the live nodes.
+static int aggregates_match(const FsTree* t)
+{
+    uint32_t n = t->node_count;
+    uint32_t* files = (uint32_t*)calloc(n, sizeof(uint32_t));
+    uint32_t* dirs = (uint32_t*)calloc(n, sizeof(uint32_t));
+    uint32_t* newest = (uint32_t*)calloc(n, sizeof(uint32_t));
+    uint8_t* live = (uint8_t*)calloc(n, 1);
+    int ok = files && dirs && newest && live && n > 0;
+    if (ok) live[0] = 1;
+    for (uint32_t i = 0; ok && i < n; ++i) {
+        const FsNode* d = &t->nodes[i];
+        if (!live[i]) continue;
+        for (uint32_t c = d->first_child; c < d->first_child + d->child_count; ++c) live[c] = 1;
+        int dir = (d->flags & FS_NODE_DIR) != 0;
+        if (!dir) { files[i] = 1; newest[i] = d->mtime; }
+        for (uint32_t p = d->parent; i != 0 && p != FS_TREE_NONE; p = t->nodes[p].parent) {
+            if (dir) { dirs[p]++; continue; }
+            files[p]++;
+            if (d->mtime > newest[p]) newest[p] = d->mtime;
+        }
+    }
+    for (uint32_t i = 0; ok && i < n; ++i)
+        ok = !live[i] || (t->nodes[i].files == files[i] && t->nodes[i].dirs == dirs[i] && t->nodes[i].newest == newest[i]);
+    free(files);
+    free(dirs);
+    free(newest);
+    free(live);
+    return ok;
+}
+
+// The root's histogram and age buckets against a count straight off its files
+static int folder_stats_match(const FsTree* t, uint32_t now)
+{
+    FsFolderStats got, want;
+    memset(&want, 0, sizeof(want));
+    if (fs_tree_folder_stats(t, 0, now, &got) < 0) return 0;
+    want.files = t->nodes[0].files;
+    want.dirs = t->nodes[0].dirs;
+    want.newest = t->nodes[0].newest;
+    uint32_t* stack = (uint32_t*)malloc((size_t)t->node_count * sizeof(uint32_t));
+    if (!stack) return 0;
+    uint32_t sp = 0;
+    stack[sp++] = 0;
+    while (sp > 0) {
+        const FsNode* d = &t->nodes[stack[--sp]];
+        for (uint32_t c = d->first_child; c < d->first_child + d->child_count; ++c) {
+            const FsNode* f = &t->nodes[c];
+            if (f->flags & FS_NODE_DIR) { stack[sp++] = c; continue; }
+            int b = 0;
+            while (b < FS_SIZE_BUCKETS - 1 && f->size_bytes >= (1ull << b)) b++;
+            uint32_t age = now > f->mtime ? now - f->mtime : 0;
+            int g = !f->mtime ? FS_AGE_UNKNOWN : age < 30u * 86400u ? FS_AGE_MONTH : age < 365u * 86400u ? FS_AGE_YEAR
+                  : age < 3u * 365u * 86400u ? FS_AGE_3_YEARS : FS_AGE_OLDER;
+            want.size_files[b]++;
+            want.size_bytes[b] += f->size_bytes;
+            want.age_files[g]++;
+            want.age_bytes[g] += f->size_bytes;
+            uint64_t clusters = (f->size_bytes + FS_CLUSTER_BYTES - 1) / FS_CLUSTER_BYTES;
+            want.slack_bytes += clusters * FS_CLUSTER_BYTES - f->size_bytes;
+        }
+    }
+    free(stack);
+    return !memcmp(&got, &want, sizeof(got));
+}
+
+// Aggregates after a build, after the cache round trip and after a file
+// goes and a folder is re-read
+static int sort_scan_ok(const BenchArgs* a, uint32_t now, int* stats_ok)
+{
+    FsTree t, c;
+    fs_tree_init(&t);
+    fs_tree_init(&c);
+    FsScanCtl ctl;
+    memset(&ctl, 0, sizeof(ctl));
+    ctl.threads = a->threads;
+    char cache[1024];
+    snprintf(cache, sizeof(cache), "%s.fsac", a->root);
+    int ok = fs_tree_build(&t, a->root, NULL, &ctl) == 0 && aggregates_match(&t);
+    *stats_ok = ok && folder_stats_match(&t, now);
+    ok = ok && fs_tree_save(&t, cache, NULL) == 0 && fs_tree_load(&c, cache, NULL) == 0 && aggregates_match(&c);
+    ok = ok && c.nodes[0].files == t.nodes[0].files && c.nodes[0].newest == t.nodes[0].newest;
+    remove(cache);
+
+    uint32_t file = FS_TREE_NONE, dir = FS_TREE_NONE;
+    for (uint32_t i = 1; ok && i < t.node_count && (file == FS_TREE_NONE || dir == FS_TREE_NONE); ++i) {
+        if (t.nodes[i].flags & FS_NODE_DIR) dir = i;
+        else if (file == FS_TREE_NONE) file = i;
+    }
+    uint32_t files = t.nodes[0].files;
+    ok = ok && file != FS_TREE_NONE && fs_tree_remove(&t, file) == 0 && t.nodes[0].files == files - 1 && aggregates_match(&t);
+    ok = ok && dir != FS_TREE_NONE && fs_tree_refresh(&t, dir) == 0 && aggregates_match(&t);
+    *stats_ok = *stats_ok && ok && folder_stats_match(&t, now);
+    fs_tree_free(&t);
+    fs_tree_free(&c);
+    return ok;
+}
+
+#define SORT_PER_DIR 4    // --entries / 4 folders under the root, the rows sorted
+
+// qsort's view of each order, ties broken by size order like the radix sort
+static const FsTree* g_sort_tree;
+static int g_sort_key;
+
+static int cmp_sort_row(const void* a, const void* b)
+{
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    const FsNode* p = &g_sort_tree->nodes[x];
+    const FsNode* q = &g_sort_tree->nodes[y];
+    int c = 0;
+    if (g_sort_key == FS_SORT_SIZE) {
+        c = p->size_bytes > q->size_bytes ? -1 : p->size_bytes < q->size_bytes;
+    } else if (g_sort_key == FS_SORT_COUNT) {
+        c = p->files > q->files ? -1 : p->files < q->files;
+    } else if (g_sort_key == FS_SORT_AGE) {
+        uint32_t u = p->newest ? p->newest : 0xFFFFFFFFu, v = q->newest ? q->newest : 0xFFFFFFFFu;
+        c = u < v ? -1 : u > v;
+    } else {
+        const unsigned char* s = (const unsigned char*)g_sort_tree->names + p->name;
+        const unsigned char* r = (const unsigned char*)g_sort_tree->names + q->name;
+        for (; !c; ++s, ++r) {
+            int u = (*s >= 'A' && *s <= 'Z') ? *s - 'A' + 'a' : *s, v = (*r >= 'A' && *r <= 'Z') ? *r - 'A' + 'a' : *r;
+            c = u < v ? -1 : u > v;
+            if (!u || !v) break;
+        }
+    }
+    return c ? c : (x < y ? -1 : x > y);
+}
+
+// Every order of a big folder, radix sorted by the listing against qsort
+// of the same rows, after checking the aggregates on a walked tree
+static int bench_sort(const BenchArgs* a)
+{
+    uint32_t now = (uint32_t)time(NULL);
+    SynthStats gen;
+    if (bench_fixture_open(a, NULL, &gen, NULL, NULL) < 0) return 1;
+    int stats_ok = 0;
+    int scan_ok = sort_scan_ok(a, now, &stats_ok);
+    bench_fixture_close(a, NULL);
+
+    char cache[1024];
+    snprintf(cache, sizeof(cache), "%s.fsao", a->root);
+    FsTree t;
+    fs_tree_init(&t);
+    if (synth_mem_tree(&t, (uint32_t)a->entries, SORT_PER_DIR, 11, cache) < 0) { fprintf(stderr, "cannot make the tree\n"); return 1; }
+    int aggregates_ok = aggregates_match(&t);
+
+    FsListing l;
+    fs_listing_init(&l);
+    uint32_t rows = t.nodes[0].child_count;
+    uint32_t* want = (uint32_t*)malloc((size_t)rows * sizeof(uint32_t) + 1);
+    int order_ok = want != NULL;
+    double radix_ms[FS_SORT__COUNT], qsort_ms[FS_SORT__COUNT], radix_max = 0, speedup_min = 0;
+    for (int k = 0; order_ok && k < FS_SORT__COUNT; ++k) {
+        // From the size order each time, as the UI starts every folder
+        radix_ms[k] = 0;
+        for (int rep = 0; rep < 3; ++rep) {
+            fs_listing_view(&l, &t, 0);
+            if (k == FS_SORT_SIZE) fs_listing_sort_by(&l, FS_SORT_NAME);
+            double t0 = now_ms();
+            order_ok = fs_listing_sort_by(&l, k) == 0 && order_ok;
+            double ms = now_ms() - t0;
+            if (rep == 0 || ms < radix_ms[k]) radix_ms[k] = ms;
+        }
+        for (uint32_t i = 0; i < rows; ++i) want[i] = t.nodes[0].first_child + i;
+        g_sort_tree = &t;
+        g_sort_key = k;
+        double t0 = now_ms();
+        qsort(want, rows, sizeof(uint32_t), cmp_sort_row);
+        qsort_ms[k] = now_ms() - t0;
+        for (uint32_t i = 0; order_ok && i < rows; ++i) order_ok = fs_listing_node(&l, i) == want[i];
+        if (radix_ms[k] > radix_max) radix_max = radix_ms[k];
+        double speedup = radix_ms[k] > 0 ? qsort_ms[k] / radix_ms[k] : 0.0;
+        if (k == 0 || speedup < speedup_min) speedup_min = speedup;
+        printf("%s_radix_ms=%.2f\n%s_qsort_ms=%.2f\n", fs_sort_name(k), radix_ms[k], fs_sort_name(k), qsort_ms[k]);
+    }
+    printf("rows=%u\nentries=%u\nnode_bytes=%zu\nsort_ms_max=%.2f\nspeedup_min=%.2f\n"
+           "scan_ok=%d\nstats_ok=%d\naggregates_ok=%d\norder_ok=%d\n",
+           rows, t.node_count, sizeof(FsNode), radix_max, speedup_min, scan_ok, stats_ok, aggregates_ok, order_ok);
+    int ok = scan_ok && stats_ok && aggregates_ok && order_ok;
+    printf("sort_ok=%d\n", ok);
+
+    const char* keys[] = { "sort_ms_max", "speedup_min" };
+    double vals[] = { radix_max, speedup_min };
+    ok = apply_checks(a, keys, vals, 2) == 0 && ok;
+
+    free(want);
+    fs_listing_free(&l);
+    fs_tree_free(&t);
+    return ok ? 0 : 1;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: fsa_bench cache|scan|walk|list|types|io|purge|dupes|largest|treemap|snapshot|prefetch|filters|spill|report|search|sort|suite|ui [--root DIR] [--depth N] [--fanout N] [--files N]\n"
+                    "                  [--records N] [--budget-mb N] [--entries N] [--touch N] [--cancel-after MS] [--threads N] [--latency-us US] [--chain N] [--frames N] [--keep]\n"
+                    "                  [--layout uniform|vita] [--json] [--check KEY>=VALUE|KEY<=VALUE]...\n");
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) { usage(); return 2; }
+
+    BenchArgs a;
+    memset(&a, 0, sizeof(a));
+    a.root = "/tmp/fsa_bench_tree";
+    a.touch = 10;
+    a.threads = 4;
+    a.chain = 100;
+    a.frames = 300;
+    a.records = 5000000;
+    a.budget_mb = 16;
+    a.entries = 500000;
+    synth_default_spec(&a.spec);
+
+    for (int i = 2; i < argc; ++i) {
+        const char* v = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (!strcmp(argv[i], "--keep")) { a.keep = 1; continue; }
+        if (!strcmp(argv[i], "--json")) { a.json = 1; continue; }
+        if (!v) { usage(); return 2; }
+        if (!strcmp(argv[i], "--root")) a.root = v;
+        else if (!strcmp(argv[i], "--depth")) a.spec.depth = atoi(v);
+        else if (!strcmp(argv[i], "--fanout")) a.spec.fanout = atoi(v);
+        else if (!strcmp(argv[i], "--files")) a.spec.files_per_dir = atoi(v);
+        else if (!strcmp(argv[i], "--touch")) a.touch = atoi(v);
+        else if (!strcmp(argv[i], "--cancel-after")) a.cancel_after_ms = atoi(v);
+        else if (!strcmp(argv[i], "--threads")) a.threads = atoi(v);
+        else if (!strcmp(argv[i], "--chain")) a.chain = atoi(v);
+        else if (!strcmp(argv[i], "--frames") && atoi(v) > 0) a.frames = atoi(v);
+        else if (!strcmp(argv[i], "--records") && atoi(v) > 0) a.records = atoi(v);
+        else if (!strcmp(argv[i], "--budget-mb") && atoi(v) > 0) a.budget_mb = atoi(v);
+        else if (!strcmp(argv[i], "--entries") && atoi(v) > 0) a.entries = atoi(v);
+        else if (!strcmp(argv[i], "--layout") && (!strcmp(v, "vita") || !strcmp(v, "uniform")))
+            a.spec.layout = !strcmp(v, "vita") ? SYNTH_LAYOUT_VITA : SYNTH_LAYOUT_UNIFORM;
+        else if (!strcmp(argv[i], "--check") && a.check_count < MAX_CHECKS) a.checks[a.check_count++] = v;
+        else if (!strcmp(argv[i], "--latency-us")) setenv("FSA_IO_LATENCY_US", v, 1);
+        else { usage(); return 2; }
+        ++i;
+    }
+
+    if (!strcmp(argv[1], "cache")) return bench_cache(&a);
+    if (!strcmp(argv[1], "scan")) return bench_scan(&a);
+    if (!strcmp(argv[1], "walk")) return bench_walk(&a);
+    if (!strcmp(argv[1], "list")) return bench_list(&a);
+    if (!strcmp(argv[1], "types")) return bench_types(&a);
+    if (!strcmp(argv[1], "io")) return bench_io(&a);
+    if (!strcmp(argv[1], "purge")) return bench_purge(&a);
+    if (!strcmp(argv[1], "dupes")) return bench_dupes(&a);
+    if (!strcmp(argv[1], "largest")) return bench_largest(&a);
+    if (!strcmp(argv[1], "treemap")) return bench_treemap(&a);
+    if (!strcmp(argv[1], "snapshot")) return bench_snapshot(&a);
+    if (!strcmp(argv[1], "prefetch")) return bench_prefetch(&a);
+    if (!strcmp(argv[1], "filters")) return bench_filters(&a);
+    if (!strcmp(argv[1], "spill")) return bench_spill(&a);
+    if (!strcmp(argv[1], "report")) return bench_report(&a);
+    if (!strcmp(argv[1], "search")) return bench_search(&a);
+    if (!strcmp(argv[1], "sort")) return bench_sort(&a);
+    if (!strcmp(argv[1], "suite")) return bench_suite(&a);
+    if (!strcmp(argv[1], "ui")) return bench_ui(&a);
+    usage();
+    return 2;
+}
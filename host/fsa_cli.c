@@ -0,0 +1,150 @@
+// Headless reports from the analyzer engine, for scripts run against card
+// images and mounted cards.
+//
+//   fsa-cli scan DIR [--format jsonl|csv] [--threads N] [--budget-mb N]
+//   fsa-cli top  DIR [--format jsonl|csv] [--threads N] [--count N]
+//   fsa-cli ext  DIR [--format jsonl|csv] [--threads N] [--ext .iso,.cso,...]
+//
+// scan writes every entry below DIR with its full path, type, size, mtime and
+// depth; top the largest entries right below DIR; ext the space taken per
+// extension. Rows go to stdout as they are formatted, one JSON object per
+// line or CSV with a header. With --budget-mb, a tree that would not fit is
+// walked into a temporary path index and streamed from there. --stats prints
+// timings to stderr.
+#include "fs_tree.h"
+#include "fs_report.h"
+#include "fs_spill.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_EXTS 64
+
+typedef struct {
+    const char* cmd;
+    const char* root;
+    int         format;
+    int         threads;
+    int         count;
+    int         budget_mb;
+    int         stats;
+    const char* exts[MAX_EXTS];
+    int         ext_count;
+    char        ext_buf[1024];
+} CliArgs;
+
+static double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// Splits a comma-separated list in place
+static void parse_exts(CliArgs* a, const char* list)
+{
+    snprintf(a->ext_buf, sizeof(a->ext_buf), "%s", list);
+    for (char* p = strtok(a->ext_buf, ","); p && a->ext_count < MAX_EXTS; p = strtok(NULL, ","))
+        if (*p) a->exts[a->ext_count++] = p;
+}
+
+// A partition too big for the tree: the path index goes next to the other
+// temporary files and is gone once streamed
+static int scan_indexed(const CliArgs* a, FsReport* r, FsScanCtl* ctl)
+{
+    char index_path[512];
+    const char* tmp = getenv("TMPDIR");
+    snprintf(index_path, sizeof(index_path), "%s/fsa-cli-%d.fsap", tmp && *tmp ? tmp : "/tmp", (int)getpid());
+    ctl->files = ctl->dirs = ctl->bytes = 0;
+    FsPathIndex x;
+    int res = -1;
+    if (fs_spill_scan(a->root, (size_t)a->budget_mb << 20, index_path, ctl, NULL) == 0 &&
+        fs_path_index_open(&x, index_path) == 0) {
+        res = fs_report_index(r, &x, NULL);
+        fs_path_index_close(&x);
+    }
+    remove(index_path);
+    return res;
+}
+
+static int run(const CliArgs* a)
+{
+    FsReport r;
+    if (fs_report_open(&r, STDOUT_FILENO, a->format) < 0) return 1;
+    FsScanCtl ctl;
+    memset(&ctl, 0, sizeof(ctl));
+    ctl.threads = a->threads;
+    if (!strcmp(a->cmd, "scan")) ctl.max_bytes = (size_t)a->budget_mb << 20;
+
+    FsTree t;
+    fs_tree_init(&t);
+    double t0 = now_ms();
+    int built = fs_tree_build(&t, a->root, NULL, &ctl) == 0;
+    double scan_ms = now_ms() - t0;
+    int res = -1;
+    t0 = now_ms();
+    if (!built && ctl.over_budget) {
+        res = scan_indexed(a, &r, &ctl);
+    } else if (!built) {
+        fprintf(stderr, "fsa-cli: cannot walk %s\n", a->root);
+    } else if (!strcmp(a->cmd, "scan")) {
+        res = fs_report_tree(&r, &t, 0, NULL);
+    } else if (!strcmp(a->cmd, "top")) {
+        // Children are kept largest first
+        FsListing l;
+        fs_listing_init(&l);
+        fs_listing_view(&l, &t, 0);
+        res = fs_report_listing(&r, &l, (uint32_t)a->count);
+        fs_listing_free(&l);
+    } else {
+        FsTypeStats s;
+        fs_type_stats_init(&s);
+        res = fs_tree_type_stats(&t, 0, &s, NULL);
+        if (res == 0) res = fs_report_exts(&r, &s, a->exts, a->ext_count);
+        fs_type_stats_free(&s);
+    }
+    if (fs_report_close(&r) < 0) res = -1;
+    double write_ms = now_ms() - t0;
+    if (a->stats)
+        fprintf(stderr, "entries=%u\nrows=%llu\nout_bytes=%llu\nscan_ms=%.1f\nwrite_ms=%.1f\nindexed=%d\n",
+                t.node_count, (unsigned long long)r.rows, (unsigned long long)r.bytes, scan_ms, write_ms,
+                !built && ctl.over_budget);
+    fs_tree_free(&t);
+    return res == 0 ? 0 : 1;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: fsa-cli scan|top|ext DIR [--format jsonl|csv] [--threads N] [--count N]\n"
+                    "               [--ext .a,.b,...] [--budget-mb N] [--stats]\n");
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3) { usage(); return 2; }
+
+    CliArgs a;
+    memset(&a, 0, sizeof(a));
+    a.cmd = argv[1];
+    a.root = argv[2];
+    a.format = FS_REPORT_JSONL;
+    a.threads = 4;
+    a.count = 20;
+    if (strcmp(a.cmd, "scan") && strcmp(a.cmd, "top") && strcmp(a.cmd, "ext")) { usage(); return 2; }
+
+    for (int i = 3; i < argc; ++i) {
+        const char* v = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (!strcmp(argv[i], "--stats")) { a.stats = 1; continue; }
+        if (!v) { usage(); return 2; }
+        if (!strcmp(argv[i], "--format") && fs_report_parse_format(v) >= 0) a.format = fs_report_parse_format(v);
+        else if (!strcmp(argv[i], "--threads") && atoi(v) > 0) a.threads = atoi(v);
+        else if (!strcmp(argv[i], "--count") && atoi(v) > 0) a.count = atoi(v);
+        else if (!strcmp(argv[i], "--budget-mb") && atoi(v) > 0) a.budget_mb = atoi(v);
+        else if (!strcmp(argv[i], "--ext")) parse_exts(&a, v);
+        else { usage(); return 2; }
+        ++i;
+    }
+    return run(&a);
+}
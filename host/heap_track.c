@@ -0,0 +1,60 @@
+#define _GNU_SOURCE
+#include "heap_track.h"
+#include <malloc.h>
+#include <stdlib.h>
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t n, size_t size);
+void* __real_realloc(void* p, size_t size);
+void  __real_free(void* p);
+
+static int64_t g_live;
+static int64_t g_peak;
+
+static void account(int64_t delta)
+{
+    int64_t live = __atomic_add_fetch(&g_live, delta, __ATOMIC_RELAXED);
+    int64_t peak = __atomic_load_n(&g_peak, __ATOMIC_RELAXED);
+    while (live > peak && !__atomic_compare_exchange_n(&g_peak, &peak, live, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}
+}
+
+void* __wrap_malloc(size_t size)
+{
+    void* p = __real_malloc(size);
+    if (p) account((int64_t)malloc_usable_size(p));
+    return p;
+}
+
+void* __wrap_calloc(size_t n, size_t size)
+{
+    void* p = __real_calloc(n, size);
+    if (p) account((int64_t)malloc_usable_size(p));
+    return p;
+}
+
+void* __wrap_realloc(void* p, size_t size)
+{
+    int64_t old = p ? (int64_t)malloc_usable_size(p) : 0;
+    void* q = __real_realloc(p, size);
+    if (q) account((int64_t)malloc_usable_size(q) - old);
+    else if (size == 0) account(-old);
+    return q;
+}
+
+void __wrap_free(void* p)
+{
+    if (!p) return;
+    account(-(int64_t)malloc_usable_size(p));
+    __real_free(p);
+}
+
+void heap_track_reset(void)
+{
+    __atomic_store_n(&g_live, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_peak, 0, __ATOMIC_RELAXED);
+}
+
+int64_t heap_track_peak(void)
+{
+    return __atomic_load_n(&g_peak, __ATOMIC_RELAXED);
+}
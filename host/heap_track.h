@@ -0,0 +1,10 @@
+#pragma once
+#include <stdint.h>
+
+// Heap growth seen through malloc/calloc/realloc/free, which fsa_bench wraps
+// at link time (-Wl,--wrap). Blocks freed after a reset that were allocated
+// before it push the live count below zero, so the peak is the largest net
+// growth since the reset.
+void heap_track_reset(void);
+
+int64_t heap_track_peak(void);
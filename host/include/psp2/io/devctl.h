@@ -0,0 +1,11 @@
+#pragma once
+#include <psp2/types.h>
+
+typedef struct SceIoDevInfo {
+    SceOff  max_size;
+    SceOff  free_size;
+    SceSize cluster_size;
+    void*   unk;
+} SceIoDevInfo;
+
+int sceIoDevctl(const char* dev, unsigned int cmd, const void* indata, int inlen, void* outdata, int outlen);
@@ -0,0 +1,26 @@
+#pragma once
+#include <psp2/types.h>
+
+#define SCE_S_IFMT  0xF000
+#define SCE_S_IFDIR 0x1000
+#define SCE_S_IFREG 0x2000
+#define SCE_S_ISDIR(m) (((m) & SCE_S_IFMT) == SCE_S_IFDIR)
+#define SCE_S_ISREG(m) (((m) & SCE_S_IFMT) == SCE_S_IFREG)
+
+#define SCE_S_IRWXU 0x01C0
+#define SCE_S_IRWXG 0x0038
+#define SCE_S_IRWXO 0x0007
+
+typedef struct SceIoStat {
+    SceMode      st_mode;
+    unsigned int st_attr;
+    SceOff       st_size;
+    SceDateTime  st_ctime;
+    SceDateTime  st_atime;
+    SceDateTime  st_mtime;
+    unsigned int st_private[6];
+} SceIoStat;
+
+int sceIoGetstat(const char* file, SceIoStat* stat);
+int sceIoMkdir(const char* dir, SceMode mode);
+int sceIoRmdir(const char* path);
@@ -0,0 +1,4 @@
+#pragma once
+#include <psp2/types.h>
+
+SceUInt64 sceKernelGetProcessTimeWide(void);
@@ -0,0 +1,21 @@
+#pragma once
+#include <psp2/types.h>
+
+typedef int (*SceKernelThreadEntry)(SceSize args, void* argp);
+
+#define SCE_KERNEL_CPU_MASK_USER_0   0x00010000
+#define SCE_KERNEL_CPU_MASK_USER_1   0x00020000
+#define SCE_KERNEL_CPU_MASK_USER_2   0x00040000
+#define SCE_KERNEL_CPU_MASK_USER_ALL 0x00070000
+
+SceUID sceKernelCreateThread(const char* name, SceKernelThreadEntry entry, int initPriority,
+                             int stackSize, SceUInt attr, int cpuAffinityMask, const void* option);
+int sceKernelStartThread(SceUID thid, SceSize arglen, void* argp);
+int sceKernelWaitThreadEnd(SceUID thid, int* stat, SceUInt* timeout);
+int sceKernelDeleteThread(SceUID thid);
+int sceKernelDelayThread(SceUInt delay);
+
+SceUID sceKernelCreateMutex(const char* name, SceUInt attr, int initCount, void* option);
+int sceKernelLockMutex(SceUID mutexid, int lockCount, unsigned int* timeout);
+int sceKernelUnlockMutex(SceUID mutexid, int unlockCount);
+int sceKernelDeleteMutex(SceUID mutexid);
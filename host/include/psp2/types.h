@@ -0,0 +1,22 @@
+#pragma once
+// Host build: the subset of the VitaSDK types used by the analyzer engine.
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int          SceUID;
+typedef unsigned int SceSize;
+typedef int64_t      SceOff;
+typedef int          SceMode;
+typedef unsigned int SceUInt;
+typedef uint64_t     SceUInt64;
+typedef int64_t      SceInt64;
+
+typedef struct SceDateTime {
+    unsigned short year;
+    unsigned short month;
+    unsigned short day;
+    unsigned short hour;
+    unsigned short minute;
+    unsigned short second;
+    unsigned int   microsecond;
+} SceDateTime;
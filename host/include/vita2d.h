@@ -0,0 +1,38 @@
+#pragma once
+// Host build: the subset of vita2d used by the UI, served by vita2d_rec.c,
+// which records the draw calls instead of rendering them.
+#include <psp2/types.h>
+
+#define RGBA8(r, g, b, a) ((((a) & 0xFF) << 24) | (((b) & 0xFF) << 16) | (((g) & 0xFF) << 8) | (((r) & 0xFF) << 0))
+
+typedef enum {
+    SCE_GXM_PRIMITIVE_TRIANGLES      = 0,
+    SCE_GXM_PRIMITIVE_LINES          = 1,
+    SCE_GXM_PRIMITIVE_POINTS         = 2,
+    SCE_GXM_PRIMITIVE_TRIANGLE_STRIP = 3,
+    SCE_GXM_PRIMITIVE_TRIANGLE_FAN   = 4
+} SceGxmPrimitiveType;
+
+typedef struct vita2d_color_vertex {
+    float x, y, z;
+    unsigned int color;
+} vita2d_color_vertex;
+
+typedef struct vita2d_pgf vita2d_pgf;
+
+int vita2d_init(void);
+int vita2d_fini(void);
+void vita2d_start_drawing(void);
+void vita2d_end_drawing(void);
+void vita2d_swap_buffers(void);
+void vita2d_clear_screen(void);
+
+void vita2d_draw_rectangle(float x, float y, float w, float h, unsigned int color);
+void vita2d_draw_array(SceGxmPrimitiveType mode, const vita2d_color_vertex* vertices, size_t count);
+void* vita2d_pool_memalign(unsigned int size, unsigned int alignment);
+
+vita2d_pgf* vita2d_load_default_pgf(void);
+void vita2d_free_pgf(vita2d_pgf* font);
+int vita2d_pgf_draw_text(vita2d_pgf* font, int x, int y, unsigned int color, float scale, const char* text);
+int vita2d_pgf_text_width(vita2d_pgf* font, float scale, const char* text);
+int vita2d_pgf_text_height(vita2d_pgf* font, float scale, const char* text);
@@ -0,0 +1,448 @@
+// POSIX implementation of the sceIo* / sceKernel* calls used by the analyzer
+// engine, so fs_analyzer.c and friends build and run unchanged on Linux.
+//
+// Vita-style paths ("ux0:/app") are mapped under $FSA_ROOT ("$FSA_ROOT/ux0/app");
+// absolute host paths are used as-is.
+//
+// $FSA_IO_LATENCY_US adds a fixed delay to every Dopen and Getstat, to mimic
+// the per-request latency of a memory card on top of the host page cache.
+//
+// Every directory and metadata call is counted; see psp2_posix.h.
+#define _GNU_SOURCE
+#include "psp2_posix.h"
+#include <psp2/io/dirent.h>
+#include <psp2/io/stat.h>
+#include <psp2/io/fcntl.h>
+#include <psp2/io/devctl.h>
+#include <psp2/kernel/processmgr.h>
+#include <psp2/kernel/threadmgr.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <time.h>
+#include <unistd.h>
+
+// glibc aliases st_[amc]time to struct timespec members, which would clash
+// with the SceIoStat fields of the same name.
+#undef st_atime
+#undef st_mtime
+#undef st_ctime
+
+#define HOST_MAX_DIRS 256
+#define HOST_ERROR(e) ((int)(0x80010000u | (unsigned)(e)))
+
+static DIR* g_dirs[HOST_MAX_DIRS];
+static pthread_mutex_t g_dirs_lock = PTHREAD_MUTEX_INITIALIZER;
+static HostIoCounts g_counts;
+
+#define COUNT_CALL(field) __atomic_fetch_add(&g_counts.field, 1, __ATOMIC_RELAXED)
+
+void host_io_counts(HostIoCounts* out)
+{
+    out->dopen = __atomic_load_n(&g_counts.dopen, __ATOMIC_RELAXED);
+    out->dread = __atomic_load_n(&g_counts.dread, __ATOMIC_RELAXED);
+    out->dclose = __atomic_load_n(&g_counts.dclose, __ATOMIC_RELAXED);
+    out->getstat = __atomic_load_n(&g_counts.getstat, __ATOMIC_RELAXED);
+    out->remove = __atomic_load_n(&g_counts.remove, __ATOMIC_RELAXED);
+    out->rmdir = __atomic_load_n(&g_counts.rmdir, __ATOMIC_RELAXED);
+    out->rename = __atomic_load_n(&g_counts.rename, __ATOMIC_RELAXED);
+    out->mkdir = __atomic_load_n(&g_counts.mkdir, __ATOMIC_RELAXED);
+}
+
+void host_io_reset(void)
+{
+    __atomic_store_n(&g_counts.dopen, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_counts.dread, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_counts.dclose, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_counts.getstat, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_counts.remove, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_counts.rmdir, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_counts.rename, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_counts.mkdir, 0, __ATOMIC_RELAXED);
+}
+
+uint64_t host_io_total(const HostIoCounts* c)
+{
+    return c->dopen + c->dread + c->dclose + c->getstat + c->remove + c->rmdir + c->rename + c->mkdir;
+}
+
+static void host_path(const char* path, char* out, size_t outsz)
+{
+    const char* colon = strchr(path, ':');
+    const char* slash = strchr(path, '/');
+    if (!colon || (slash && slash < colon)) { snprintf(out, outsz, "%s", path); return; }
+
+    const char* root = getenv("FSA_ROOT");
+    if (!root || !*root) root = ".";
+    const char* rest = colon + 1;
+    while (*rest == '/') rest++;
+    snprintf(out, outsz, "%s/%.*s%s%s", root, (int)(colon - path), path, *rest ? "/" : "", rest);
+}
+
+static void io_latency(void)
+{
+    static int latency_us = -1;
+    if (latency_us < 0) {
+        const char* v = getenv("FSA_IO_LATENCY_US");
+        latency_us = v ? atoi(v) : 0;
+    }
+    if (latency_us > 0) {
+        struct timespec ts = { latency_us / 1000000, (long)(latency_us % 1000000) * 1000 };
+        nanosleep(&ts, NULL);
+    }
+}
+
+static void to_datetime(time_t t, SceDateTime* dt)
+{
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    dt->year = (unsigned short)(tm.tm_year + 1900);
+    dt->month = (unsigned short)(tm.tm_mon + 1);
+    dt->day = (unsigned short)tm.tm_mday;
+    dt->hour = (unsigned short)tm.tm_hour;
+    dt->minute = (unsigned short)tm.tm_min;
+    dt->second = (unsigned short)tm.tm_sec;
+    dt->microsecond = 0;
+}
+
+static void to_sce_stat(const struct stat* st, SceIoStat* out)
+{
+    memset(out, 0, sizeof(*out));
+    out->st_mode = (S_ISDIR(st->st_mode) ? SCE_S_IFDIR : SCE_S_IFREG) | (st->st_mode & 0777);
+    out->st_size = S_ISDIR(st->st_mode) ? 0 : (SceOff)st->st_size;
+    to_datetime(st->st_ctim.tv_sec, &out->st_ctime);
+    to_datetime(st->st_atim.tv_sec, &out->st_atime);
+    to_datetime(st->st_mtim.tv_sec, &out->st_mtime);
+}
+
+// ---- directories ------------------------------------------------------------
+
+SceUID sceIoDopen(const char* dirname)
+{
+    COUNT_CALL(dopen);
+    char p[4096];
+    host_path(dirname, p, sizeof(p));
+    io_latency();
+    DIR* d = opendir(p);
+    if (!d) return HOST_ERROR(errno);
+
+    pthread_mutex_lock(&g_dirs_lock);
+    for (int i = 0; i < HOST_MAX_DIRS; ++i) {
+        if (!g_dirs[i]) {
+            g_dirs[i] = d;
+            pthread_mutex_unlock(&g_dirs_lock);
+            return i;
+        }
+    }
+    pthread_mutex_unlock(&g_dirs_lock);
+    closedir(d);
+    return HOST_ERROR(EMFILE);
+}
+
+int sceIoDread(SceUID fd, SceIoDirent* dir)
+{
+    COUNT_CALL(dread);
+    if (fd < 0 || fd >= HOST_MAX_DIRS || !g_dirs[fd]) return HOST_ERROR(EBADF);
+    DIR* d = g_dirs[fd];
+
+    struct dirent* e = readdir(d);
+    if (!e) return 0;
+
+    struct stat st;
+    if (fstatat(dirfd(d), e->d_name, &st, AT_SYMLINK_NOFOLLOW) < 0) memset(&st, 0, sizeof(st));
+    to_sce_stat(&st, &dir->d_stat);
+    snprintf(dir->d_name, sizeof(dir->d_name), "%s", e->d_name);
+    return 1;
+}
+
+int sceIoDclose(SceUID fd)
+{
+    COUNT_CALL(dclose);
+    if (fd < 0 || fd >= HOST_MAX_DIRS) return HOST_ERROR(EBADF);
+    pthread_mutex_lock(&g_dirs_lock);
+    DIR* d = g_dirs[fd];
+    g_dirs[fd] = NULL;
+    pthread_mutex_unlock(&g_dirs_lock);
+    if (!d) return HOST_ERROR(EBADF);
+    closedir(d);
+    return 0;
+}
+
+// ---- metadata ---------------------------------------------------------------
+
+int sceIoGetstat(const char* file, SceIoStat* stat)
+{
+    COUNT_CALL(getstat);
+    char p[4096];
+    host_path(file, p, sizeof(p));
+    io_latency();
+    struct stat st;
+    if (lstat(p, &st) < 0) return HOST_ERROR(errno);
+    to_sce_stat(&st, stat);
+    return 0;
+}
+
+int sceIoMkdir(const char* dir, SceMode mode)
+{
+    COUNT_CALL(mkdir);
+    char p[4096];
+    host_path(dir, p, sizeof(p));
+    return mkdir(p, (mode_t)mode) < 0 ? HOST_ERROR(errno) : 0;
+}
+
+int sceIoRmdir(const char* path)
+{
+    COUNT_CALL(rmdir);
+    char p[4096];
+    host_path(path, p, sizeof(p));
+    return rmdir(p) < 0 ? HOST_ERROR(errno) : 0;
+}
+
+int sceIoRemove(const char* file)
+{
+    COUNT_CALL(remove);
+    char p[4096];
+    host_path(file, p, sizeof(p));
+    return unlink(p) < 0 ? HOST_ERROR(errno) : 0;
+}
+
+int sceIoRename(const char* oldname, const char* newname)
+{
+    COUNT_CALL(rename);
+    char a[4096], b[4096];
+    host_path(oldname, a, sizeof(a));
+    host_path(newname, b, sizeof(b));
+    return rename(a, b) < 0 ? HOST_ERROR(errno) : 0;
+}
+
+int sceIoDevctl(const char* dev, unsigned int cmd, const void* indata, int inlen, void* outdata, int outlen)
+{
+    (void)indata; (void)inlen;
+    if (cmd != 0x3001 || !outdata || outlen < (int)sizeof(SceIoDevInfo)) return HOST_ERROR(EINVAL);
+
+    char p[4096];
+    host_path(dev, p, sizeof(p));
+    struct statvfs vfs;
+    if (statvfs(p, &vfs) < 0) return HOST_ERROR(errno);
+
+    SceIoDevInfo* info = (SceIoDevInfo*)outdata;
+    info->max_size = (SceOff)vfs.f_blocks * (SceOff)vfs.f_frsize;
+    info->free_size = (SceOff)vfs.f_bavail * (SceOff)vfs.f_frsize;
+    info->cluster_size = (SceSize)vfs.f_bsize;
+    return 0;
+}
+
+// ---- files ------------------------------------------------------------------
+
+SceUID sceIoOpen(const char* file, int flags, SceMode mode)
+{
+    char p[4096];
+    host_path(file, p, sizeof(p));
+    int of = 0;
+    switch (flags & SCE_O_RDWR) {
+        case SCE_O_WRONLY: of = O_WRONLY; break;
+        case SCE_O_RDWR:   of = O_RDWR;   break;
+        default:           of = O_RDONLY; break;
+    }
+    if (flags & SCE_O_APPEND) of |= O_APPEND;
+    if (flags & SCE_O_CREAT)  of |= O_CREAT;
+    if (flags & SCE_O_TRUNC)  of |= O_TRUNC;
+    int fd = open(p, of, (mode_t)mode);
+    return fd < 0 ? HOST_ERROR(errno) : fd;
+}
+
+int sceIoClose(SceUID fd)
+{
+    return close(fd) < 0 ? HOST_ERROR(errno) : 0;
+}
+
+int sceIoRead(SceUID fd, void* data, SceSize size)
+{
+    ssize_t r = read(fd, data, size);
+    return r < 0 ? HOST_ERROR(errno) : (int)r;
+}
+
+int sceIoWrite(SceUID fd, const void* data, SceSize size)
+{
+    ssize_t r = write(fd, data, size);
+    return r < 0 ? HOST_ERROR(errno) : (int)r;
+}
+
+SceOff sceIoLseek(SceUID fd, SceOff offset, int whence)
+{
+    off_t r = lseek(fd, (off_t)offset, whence);
+    return r < 0 ? HOST_ERROR(errno) : (SceOff)r;
+}
+
+// ---- kernel -----------------------------------------------------------------
+
+SceUInt64 sceKernelGetProcessTimeWide(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (SceUInt64)ts.tv_sec * 1000000ULL + (SceUInt64)(ts.tv_nsec / 1000);
+}
+
+// Threads and mutexes are backed by pthreads. UIDs index small static tables.
+
+#define HOST_MAX_THREADS 64
+#define HOST_MAX_MUTEXES 64
+#define HOST_THREAD_UID  0x1000
+#define HOST_MUTEX_UID   0x2000
+
+typedef struct {
+    int                  used;
+    int                  started;
+    pthread_t            handle;
+    SceKernelThreadEntry entry;
+    void*                args;
+    SceSize              arglen;
+    int                  exit_status;
+} HostThread;
+
+static HostThread g_threads[HOST_MAX_THREADS];
+static pthread_mutex_t* g_mutexes[HOST_MAX_MUTEXES];
+static pthread_mutex_t g_kernel_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static HostThread* host_thread(SceUID thid)
+{
+    int i = thid - HOST_THREAD_UID;
+    if (i < 0 || i >= HOST_MAX_THREADS || !g_threads[i].used) return NULL;
+    return &g_threads[i];
+}
+
+static void* host_thread_main(void* arg)
+{
+    HostThread* th = (HostThread*)arg;
+    th->exit_status = th->entry(th->arglen, th->args);
+    return NULL;
+}
+
+SceUID sceKernelCreateThread(const char* name, SceKernelThreadEntry entry, int initPriority,
+                             int stackSize, SceUInt attr, int cpuAffinityMask, const void* option)
+{
+    (void)name; (void)initPriority; (void)stackSize; (void)attr; (void)cpuAffinityMask; (void)option;
+    pthread_mutex_lock(&g_kernel_lock);
+    for (int i = 0; i < HOST_MAX_THREADS; ++i) {
+        if (!g_threads[i].used) {
+            memset(&g_threads[i], 0, sizeof(g_threads[i]));
+            g_threads[i].used = 1;
+            g_threads[i].entry = entry;
+            pthread_mutex_unlock(&g_kernel_lock);
+            return HOST_THREAD_UID + i;
+        }
+    }
+    pthread_mutex_unlock(&g_kernel_lock);
+    return HOST_ERROR(EAGAIN);
+}
+
+int sceKernelStartThread(SceUID thid, SceSize arglen, void* argp)
+{
+    HostThread* th = host_thread(thid);
+    if (!th || th->started) return HOST_ERROR(EINVAL);
+    // Like the Vita kernel, hand the thread its own copy of the argument block
+    if (arglen > 0 && argp) {
+        th->args = malloc(arglen);
+        if (!th->args) return HOST_ERROR(ENOMEM);
+        memcpy(th->args, argp, arglen);
+    }
+    th->arglen = arglen;
+    if (pthread_create(&th->handle, NULL, host_thread_main, th) != 0) return HOST_ERROR(EAGAIN);
+    th->started = 1;
+    return 0;
+}
+
+int sceKernelWaitThreadEnd(SceUID thid, int* stat, SceUInt* timeout)
+{
+    (void)timeout;
+    HostThread* th = host_thread(thid);
+    if (!th || !th->started) return HOST_ERROR(EINVAL);
+    pthread_join(th->handle, NULL);
+    th->started = 0;
+    if (stat) *stat = th->exit_status;
+    return 0;
+}
+
+int sceKernelDeleteThread(SceUID thid)
+{
+    HostThread* th = host_thread(thid);
+    if (!th) return HOST_ERROR(EINVAL);
+    if (th->started) pthread_detach(th->handle);
+    free(th->args);
+    pthread_mutex_lock(&g_kernel_lock);
+    th->used = 0;
+    pthread_mutex_unlock(&g_kernel_lock);
+    return 0;
+}
+
+int sceKernelDelayThread(SceUInt delay)
+{
+    struct timespec ts = { delay / 1000000, (long)(delay % 1000000) * 1000 };
+    nanosleep(&ts, NULL);
+    return 0;
+}
+
+SceUID sceKernelCreateMutex(const char* name, SceUInt attr, int initCount, void* option)
+{
+    (void)name; (void)attr; (void)option;
+    pthread_mutex_t* m = (pthread_mutex_t*)malloc(sizeof(pthread_mutex_t));
+    if (!m) return HOST_ERROR(ENOMEM);
+    pthread_mutex_init(m, NULL);
+    if (initCount > 0) pthread_mutex_lock(m);
+
+    pthread_mutex_lock(&g_kernel_lock);
+    for (int i = 0; i < HOST_MAX_MUTEXES; ++i) {
+        if (!g_mutexes[i]) {
+            g_mutexes[i] = m;
+            pthread_mutex_unlock(&g_kernel_lock);
+            return HOST_MUTEX_UID + i;
+        }
+    }
+    pthread_mutex_unlock(&g_kernel_lock);
+    pthread_mutex_destroy(m);
+    free(m);
+    return HOST_ERROR(EAGAIN);
+}
+
+static pthread_mutex_t* host_mutex(SceUID id)
+{
+    int i = id - HOST_MUTEX_UID;
+    if (i < 0 || i >= HOST_MAX_MUTEXES) return NULL;
+    return g_mutexes[i];
+}
+
+int sceKernelLockMutex(SceUID mutexid, int lockCount, unsigned int* timeout)
+{
+    (void)lockCount; (void)timeout;
+    pthread_mutex_t* m = host_mutex(mutexid);
+    if (!m) return HOST_ERROR(EINVAL);
+    pthread_mutex_lock(m);
+    return 0;
+}
+
+int sceKernelUnlockMutex(SceUID mutexid, int unlockCount)
+{
+    (void)unlockCount;
+    pthread_mutex_t* m = host_mutex(mutexid);
+    if (!m) return HOST_ERROR(EINVAL);
+    pthread_mutex_unlock(m);
+    return 0;
+}
+
+int sceKernelDeleteMutex(SceUID mutexid)
+{
+    pthread_mutex_t* m = host_mutex(mutexid);
+    if (!m) return HOST_ERROR(EINVAL);
+    pthread_mutex_lock(&g_kernel_lock);
+    g_mutexes[mutexid - HOST_MUTEX_UID] = NULL;
+    pthread_mutex_unlock(&g_kernel_lock);
+    pthread_mutex_destroy(m);
+    free(m);
+    return 0;
+}
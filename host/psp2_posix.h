@@ -0,0 +1,21 @@
+#pragma once
+#include <stdint.h>
+
+// Calls made into the POSIX shim since the last reset, for syscall budgets
+// in fsa_bench. Counted on every thread.
+typedef struct {
+    uint64_t dopen;
+    uint64_t dread;
+    uint64_t dclose;
+    uint64_t getstat;
+    uint64_t remove;
+    uint64_t rmdir;
+    uint64_t rename;
+    uint64_t mkdir;
+} HostIoCounts;
+
+void host_io_counts(HostIoCounts* out);
+
+void host_io_reset(void);
+
+uint64_t host_io_total(const HostIoCounts* c);
@@ -0,0 +1,424 @@
+#define _GNU_SOURCE
+#include "synth.h"
+#include "fs_tree.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <dirent.h>
+#include <unistd.h>
+
+#define SYNTH_EPOCH 1577836800 // 2020-01-01, so later edits always move mtime
+
+static uint32_t rng_next(uint32_t* s)
+{
+    uint32_t x = *s;
+    x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+    return *s = x ? x : 0x9E3779B9u;
+}
+
+static uint64_t rng_size(uint32_t* s, uint64_t lo, uint64_t hi)
+{
+    if (hi <= lo) return lo;
+    // log-uniform: pick a bit width, then a value inside it
+    int lo_bits = 0, hi_bits = 0;
+    while ((lo >> lo_bits) > 1) lo_bits++;
+    while ((hi >> hi_bits) > 1) hi_bits++;
+    int bits = lo_bits + (int)(rng_next(s) % (uint32_t)(hi_bits - lo_bits + 1));
+    uint64_t v = ((uint64_t)1 << bits) + (((uint64_t)rng_next(s) << 32 | rng_next(s)) & (((uint64_t)1 << bits) - 1));
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+static int make_file(const char* path, uint64_t size)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return -1;
+    int r = ftruncate(fd, (off_t)size);
+    close(fd);
+    return r;
+}
+
+static void set_mtime(const char* path, time_t t)
+{
+    struct timeval tv[2] = { { t, 0 }, { t, 0 } };
+    utimes(path, tv);
+}
+
+// Mix of known and unknown extensions, in both cases, for the type breakdown
+static const char* SYNTH_EXTS[] = { "bin", "iso", "mp3", "ogg", "png", "JPG", "mp4", "txt",
+                                    "zip", "vpk", "sav", "dat", "sfo", "xml", "log", "" };
+#define SYNTH_EXT_COUNT (sizeof(SYNTH_EXTS) / sizeof(SYNTH_EXTS[0]))
+
+static int gen_dir(const char* path, int level, const SynthSpec* spec, uint32_t* rng, SynthStats* st)
+{
+    if (mkdir(path, 0755) < 0 && errno != EEXIST) return -1;
+    st->dirs++;
+
+    char child[4096];
+    for (int i = 0; i < spec->files_per_dir; ++i) {
+        uint64_t sz = rng_size(rng, spec->min_file_size, spec->max_file_size);
+        const char* ext = SYNTH_EXTS[rng_next(rng) % SYNTH_EXT_COUNT];
+        snprintf(child, sizeof(child), "%s/file_%04d%s%s", path, i, *ext ? "." : "", ext);
+        if (make_file(child, sz) < 0) return -1;
+        set_mtime(child, SYNTH_EPOCH);
+        st->files++;
+        st->bytes += sz;
+    }
+    if (level < spec->depth) {
+        for (int i = 0; i < spec->fanout; ++i) {
+            snprintf(child, sizeof(child), "%s/dir_%04d", path, i);
+            if (gen_dir(child, level + 1, spec, rng, st) < 0) return -1;
+        }
+    }
+    set_mtime(path, SYNTH_EPOCH);
+    return 0;
+}
+
+// ---- Vita-like layout --------------------------------------------------------
+
+static int make_dir(const char* path, SynthStats* st)
+{
+    if (mkdir(path, 0755) < 0 && errno != EEXIST) return -1;
+    st->dirs++;
+    return 0;
+}
+
+static int add_file(const char* dir, const char* name, uint64_t lo, uint64_t hi, uint32_t* rng, SynthStats* st)
+{
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    uint64_t sz = rng_size(rng, lo, hi);
+    if (make_file(path, sz) < 0) return -1;
+    set_mtime(path, SYNTH_EPOCH);
+    st->files++;
+    st->bytes += sz;
+    return 0;
+}
+
+// One installed title: a large eboot, sce_sys metadata, a few plugins and
+// `files` resource blobs of very mixed sizes.
+static int gen_app(const char* dir, int files, uint32_t* rng, SynthStats* st)
+{
+    char sub[4096], name[64];
+    if (make_dir(dir, st) < 0 || add_file(dir, "eboot.bin", 4ull << 20, 64ull << 20, rng, st) < 0) return -1;
+    snprintf(sub, sizeof(sub), "%s/sce_sys", dir);
+    if (make_dir(sub, st) < 0 || add_file(sub, "param.sfo", 1024, 4096, rng, st) < 0 ||
+        add_file(sub, "icon0.png", 16 << 10, 64 << 10, rng, st) < 0 ||
+        add_file(sub, "pic0.png", 256 << 10, 1 << 20, rng, st) < 0) return -1;
+    set_mtime(sub, SYNTH_EPOCH);
+    snprintf(sub, sizeof(sub), "%s/sce_module", dir);
+    if (make_dir(sub, st) < 0 || add_file(sub, "libc.suprx", 64 << 10, 512 << 10, rng, st) < 0 ||
+        add_file(sub, "libfios2.suprx", 64 << 10, 512 << 10, rng, st) < 0) return -1;
+    set_mtime(sub, SYNTH_EPOCH);
+    snprintf(sub, sizeof(sub), "%s/resource", dir);
+    if (make_dir(sub, st) < 0) return -1;
+    for (int i = 0; i < files; ++i) {
+        snprintf(name, sizeof(name), "res_%04d.dat", i);
+        if (add_file(sub, name, 4 << 10, 256ull << 20, rng, st) < 0) return -1;
+    }
+    set_mtime(sub, SYNTH_EPOCH);
+    set_mtime(dir, SYNTH_EPOCH);
+    return 0;
+}
+
+// `fanout` scales the number of titles, ISOs and saves; `depth` and
+// `files_per_dir` shape the homebrew data/ subtree as in the uniform layout.
+static int gen_vita(const char* root, const SynthSpec* spec, uint32_t* rng, SynthStats* st)
+{
+    char dir[4096], sub[4096], name[64];
+    int titles = spec->fanout * 4;
+    if (make_dir(root, st) < 0) return -1;
+
+    snprintf(dir, sizeof(dir), "%s/app", root);
+    if (make_dir(dir, st) < 0) return -1;
+    for (int i = 0; i < titles; ++i) {
+        snprintf(sub, sizeof(sub), "%s/PCSE%05d", dir, i);
+        if (gen_app(sub, spec->files_per_dir * 2, rng, st) < 0) return -1;
+    }
+    set_mtime(dir, SYNTH_EPOCH);
+
+    snprintf(dir, sizeof(dir), "%s/pspemu", root);
+    if (make_dir(dir, st) < 0) return -1;
+    snprintf(sub, sizeof(sub), "%s/ISO", dir);
+    if (make_dir(sub, st) < 0) return -1;
+    for (int i = 0; i < spec->fanout * 2; ++i) {
+        snprintf(name, sizeof(name), "game_%03d.iso", i);
+        if (add_file(sub, name, 100ull << 20, 1800ull << 20, rng, st) < 0) return -1;
+    }
+    set_mtime(sub, SYNTH_EPOCH);
+    snprintf(sub, sizeof(sub), "%s/PSP", dir);
+    if (make_dir(sub, st) < 0) return -1;
+    snprintf(sub, sizeof(sub), "%s/PSP/SAVEDATA", dir);
+    if (make_dir(sub, st) < 0) return -1;
+    for (int i = 0; i < spec->fanout * 3; ++i) {
+        char save[4096];
+        snprintf(save, sizeof(save), "%s/ULUS%05d", sub, 10000 + i);
+        if (make_dir(save, st) < 0 || add_file(save, "DATA.BIN", 8 << 10, 4 << 20, rng, st) < 0 ||
+            add_file(save, "PARAM.SFO", 1024, 8192, rng, st) < 0 ||
+            add_file(save, "ICON0.PNG", 8 << 10, 32 << 10, rng, st) < 0) return -1;
+        set_mtime(save, SYNTH_EPOCH);
+    }
+    set_mtime(sub, SYNTH_EPOCH);
+    snprintf(sub, sizeof(sub), "%s/PSP", dir);
+    set_mtime(sub, SYNTH_EPOCH);
+    set_mtime(dir, SYNTH_EPOCH);
+
+    snprintf(dir, sizeof(dir), "%s/data", root);
+    if (gen_dir(dir, 0, spec, rng, st) < 0) return -1;
+
+    snprintf(dir, sizeof(dir), "%s/music", root);
+    if (make_dir(dir, st) < 0) return -1;
+    for (int i = 0; i < spec->files_per_dir * 4; ++i) {
+        snprintf(name, sizeof(name), "track_%03d.mp3", i);
+        if (add_file(dir, name, 3ull << 20, 12ull << 20, rng, st) < 0) return -1;
+    }
+    set_mtime(dir, SYNTH_EPOCH);
+
+    snprintf(dir, sizeof(dir), "%s/picture", root);
+    if (make_dir(dir, st) < 0) return -1;
+    for (int i = 0; i < spec->files_per_dir * 8; ++i) {
+        snprintf(name, sizeof(name), "IMG_%04d.JPG", i);
+        if (add_file(dir, name, 1ull << 20, 6ull << 20, rng, st) < 0) return -1;
+    }
+    set_mtime(dir, SYNTH_EPOCH);
+
+    if (add_file(root, "id.dat", 512, 1024, rng, st) < 0) return -1;
+    set_mtime(root, SYNTH_EPOCH);
+    return 0;
+}
+
+// ---- public API -------------------------------------------------------------
+
+void synth_default_spec(SynthSpec* spec)
+{
+    spec->layout = SYNTH_LAYOUT_UNIFORM;
+    spec->depth = 4;
+    spec->fanout = 6;
+    spec->files_per_dir = 8;
+    spec->min_file_size = 1024;
+    spec->max_file_size = 64ull << 20;
+    spec->seed = 12345;
+}
+
+int synth_generate(const char* root, const SynthSpec* spec, SynthStats* out)
+{
+    SynthStats st = {0, 0, 0};
+    uint32_t rng = spec->seed ? spec->seed : 1;
+    int r = (spec->layout == SYNTH_LAYOUT_VITA) ? gen_vita(root, spec, &rng, &st) : gen_dir(root, 0, spec, &rng, &st);
+    if (out) *out = st;
+    return r;
+}
+
+static int collect_dirs(const char* path, char*** list, int* n, int* cap)
+{
+    if (*n == *cap) {
+        *cap = *cap ? *cap * 2 : 256;
+        char** l = (char**)realloc(*list, (size_t)*cap * sizeof(char*));
+        if (!l) return -1;
+        *list = l;
+    }
+    (*list)[(*n)++] = strdup(path);
+
+    DIR* d = opendir(path);
+    if (!d) return 0;
+    struct dirent* e;
+    char child[4096];
+    while ((e = readdir(d))) {
+        if (e->d_type != DT_DIR || !strcmp(e->d_name, ".") || !strcmp(e->d_name, "..")) continue;
+        snprintf(child, sizeof(child), "%s/%s", path, e->d_name);
+        if (collect_dirs(child, list, n, cap) < 0) { closedir(d); return -1; }
+    }
+    closedir(d);
+    return 0;
+}
+
+int synth_touch_dirs(const char* root, int count, uint32_t seed, uint64_t* added_bytes)
+{
+    char** dirs = NULL;
+    int n = 0, cap = 0;
+    if (collect_dirs(root, &dirs, &n, &cap) < 0 || n == 0) return -1;
+
+    uint32_t rng = seed ? seed : 1;
+    uint64_t added = 0;
+    char path[4096];
+    for (int i = 0; i < count; ++i) {
+        const char* dir = dirs[rng_next(&rng) % (uint32_t)n];
+        uint64_t sz = 4096 + rng_next(&rng) % (1u << 20);
+        snprintf(path, sizeof(path), "%s/touched_%d_%u.bin", dir, i, seed);
+        if (make_file(path, sz) == 0) added += sz;
+    }
+    for (int i = 0; i < n; ++i) free(dirs[i]);
+    free(dirs);
+    if (added_bytes) *added_bytes = added;
+    return 0;
+}
+
+// Pseudo-random contents from `seed`; `flip` (< size) changes one byte
+static int write_contents(const char* path, uint64_t size, uint32_t seed, uint64_t flip)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return -1;
+    uint32_t rng = seed ? seed : 1, buf[16384];
+    int r = 0;
+    for (uint64_t off = 0; off < size && r == 0; off += sizeof(buf)) {
+        for (size_t i = 0; i < sizeof(buf) / 4; ++i) buf[i] = rng_next(&rng);
+        size_t n = size - off < sizeof(buf) ? (size_t)(size - off) : sizeof(buf);
+        if (flip >= off && flip < off + n) ((uint8_t*)buf)[flip - off] ^= 0xFF;
+        if (write(fd, buf, n) != (ssize_t)n) r = -1;
+    }
+    close(fd);
+    return r;
+}
+
+#define DUPE_LOOKALIKES 12 // same size as a set, different contents
+
+int synth_dupes(const char* root, int sets, uint64_t size, uint32_t seed, SynthDupeStats* out)
+{
+    SynthDupeStats st = {0, 0, 0, 0, 0};
+    const char* dirs[] = { "ISO", "backup", "misc" };
+    char path[4096];
+    if (mkdir(root, 0755) < 0 && errno != EEXIST) return -1;
+    for (int d = 0; d < 3; ++d) {
+        snprintf(path, sizeof(path), "%s/%s", root, dirs[d]);
+        if (mkdir(path, 0755) < 0 && errno != EEXIST) return -1;
+    }
+
+    uint32_t rng = seed ? seed : 1;
+    for (int s = 0; s < sets; ++s) {
+        uint64_t sz = size + (uint64_t)s * 8192 + 1;
+        uint32_t content = rng_next(&rng);
+        int copies = 2 + s % 2;
+        for (int c = 0; c < copies; ++c) {
+            snprintf(path, sizeof(path), "%s/%s/set_%03d.iso", root, dirs[c], s);
+            if (write_contents(path, sz, content, UINT64_MAX) < 0) return -1;
+        }
+        st.groups++;
+        st.copies += copies;
+        st.reclaim_bytes += sz * (copies - 1);
+
+        // Same head and tail as the set, one byte off in the middle
+        snprintf(path, sizeof(path), "%s/misc/set_%03d_patched.iso", root, s);
+        if (write_contents(path, sz, content, sz / 2) < 0) return -1;
+        for (int i = 0; i < DUPE_LOOKALIKES; ++i) {
+            snprintf(path, sizeof(path), "%s/misc/other_%03d_%02d.bin", root, s, i);
+            if (write_contents(path, sz, rng_next(&rng), UINT64_MAX) < 0) return -1;
+        }
+        snprintf(path, sizeof(path), "%s/misc/unique_%03d.bin", root, s);
+        if (make_file(path, sz + 4096) < 0) return -1;
+        st.files += copies + 2 + DUPE_LOOKALIKES;
+        st.bytes += sz * (copies + 1 + DUPE_LOOKALIKES) + sz + 4096;
+    }
+    if (out) *out = st;
+    return 0;
+}
+
+// ---- in-memory trees --------------------------------------------------------
+
+static const char* const MEM_WORDS[] = {
+    "save", "data", "game", "music", "photo", "video", "patch", "dump", "backup", "title",
+    "eboot", "param", "icon", "trophy", "album", "track", "shot", "license", "theme", "vpk" };
+static const char* const MEM_EXTS[] = { "bin", "sfo", "png", "mp3", "mp4", "iso", "dat", "txt" };
+#define MEM_WORD_COUNT (uint32_t)(sizeof(MEM_WORDS) / sizeof(MEM_WORDS[0]))
+#define MEM_EXT_COUNT  (uint32_t)(sizeof(MEM_EXTS) / sizeof(MEM_EXTS[0]))
+
+// Appends name id `j` to the pool the first time it is used; FS_TREE_NONE
+// when the pool cannot grow
+static uint32_t mem_name(FsTree* t, uint32_t* offs, uint32_t j, int dir)
+{
+    if (offs[j] != FS_TREE_NONE) return offs[j];
+    char name[96];
+    uint32_t w = MEM_WORD_COUNT;
+    if (dir) snprintf(name, sizeof(name), "%s%u", MEM_WORDS[j % w], j);
+    else snprintf(name, sizeof(name), "%s_%s_%u.%s", MEM_WORDS[j % w], MEM_WORDS[(j / w) % w], j / (w * w),
+                  MEM_EXTS[j % MEM_EXT_COUNT]);
+    uint32_t len = (uint32_t)strlen(name) + 1;
+    if (t->names_len + len > t->names_cap) {
+        uint32_t cap = t->names_cap ? t->names_cap * 2 : 1 << 20;
+        char* p = (char*)realloc(t->names, cap);
+        if (!p) return FS_TREE_NONE;
+        t->names = p;
+        t->names_cap = cap;
+    }
+    memcpy(t->names + t->names_len, name, len);
+    offs[j] = t->names_len;
+    t->names_len += len;
+    return offs[j];
+}
+
+static int cmp_node_size_desc(const void* a, const void* b)
+{
+    uint64_t x = ((const FsNode*)a)->size_bytes, y = ((const FsNode*)b)->size_bytes;
+    return x > y ? -1 : x < y;
+}
+
+int synth_mem_tree(FsTree* t, uint32_t entries, uint32_t fanout, uint32_t seed, const char* cache_path)
+{
+    if (fanout < 2) fanout = 2;
+    uint32_t dirs = entries / fanout ? entries / fanout : 1;
+    uint32_t distinct = entries / 5 * 3 + 1;
+    uint32_t* offs = (uint32_t*)malloc((size_t)(distinct + dirs) * sizeof(uint32_t));
+    FsTree m;
+    fs_tree_init(&m);
+    m.nodes = (FsNode*)calloc((size_t)1 + (size_t)dirs * (2 * fanout - 1), sizeof(FsNode));
+    m.names = (char*)calloc(1, 1 << 20);
+    if (!offs || !m.nodes || !m.names) { free(offs); fs_tree_free(&m); return -1; }
+    memset(offs, 0xff, (size_t)(distinct + dirs) * sizeof(uint32_t));
+    m.names_cap = 1 << 20;
+    m.names_len = 1;  // the root's empty name
+
+    uint32_t rng = seed ? seed : 1;
+    int res = 0;
+    m.nodes[0].parent = FS_TREE_NONE;
+    m.nodes[0].flags = FS_NODE_DIR;
+    m.nodes[0].first_child = 1;
+    m.nodes[0].child_count = dirs;
+    uint32_t next = 1 + dirs;
+    for (uint32_t d = 0; d < dirs && res == 0; ++d) {
+        FsNode* dn = &m.nodes[1 + d];
+        dn->name = mem_name(&m, offs, distinct + d, 1);
+        dn->parent = 0;
+        dn->flags = FS_NODE_DIR;
+        dn->first_child = next;
+        dn->child_count = rng_next(&rng) % (2 * fanout - 1);
+        if (dn->name == FS_TREE_NONE) res = -1;
+        for (uint32_t i = 0; i < dn->child_count && res == 0; ++i, ++next) {
+            uint32_t r = rng_next(&rng);
+            FsNode* f = &m.nodes[next];
+            f->name = mem_name(&m, offs, (r >> 4) % distinct, 0);
+            f->parent = 1 + d;
+            f->size_bytes = 1 + (rng_next(&rng) >> 5) % (1u << (r % 27));
+            f->mtime = r % 8 ? 1300000000u + rng_next(&rng) % 500000000u : 0;
+            dn->size_bytes += f->size_bytes;
+            if (f->name == FS_TREE_NONE) res = -1;
+        }
+        qsort(&m.nodes[dn->first_child], dn->child_count, sizeof(FsNode), cmp_node_size_desc);
+        m.nodes[0].size_bytes += dn->size_bytes;
+    }
+    free(offs);
+    // Child blocks run largest first, as a walk leaves them
+    qsort(&m.nodes[1], dirs, sizeof(FsNode), cmp_node_size_desc);
+    for (uint32_t d = 1; d <= dirs; ++d)
+        for (uint32_t i = m.nodes[d].first_child; i < m.nodes[d].first_child + m.nodes[d].child_count; ++i)
+            m.nodes[i].parent = d;
+    m.node_count = next;
+    snprintf(m.root_path, sizeof(m.root_path), "ux0:");
+    if (res == 0) res = fs_tree_save(&m, cache_path, NULL) == 0 && fs_tree_load(t, cache_path, NULL) == 0 ? 0 : -1;
+    fs_tree_free(&m);
+    remove(cache_path);
+    return res;
+}
+
+static int rm_entry(const char* path, const struct stat* st, int type, struct FTW* ftw)
+{
+    (void)st; (void)type; (void)ftw;
+    return remove(path);
+}
+
+int synth_remove(const char* root)
+{
+    return nftw(root, rm_entry, 64, FTW_DEPTH | FTW_PHYS);
+}
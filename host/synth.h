@@ -0,0 +1,58 @@
+#pragma once
+#include <stdint.h>
+
+typedef enum {
+    SYNTH_LAYOUT_UNIFORM = 0, // every directory has `fanout` subdirectories down to `depth`
+    SYNTH_LAYOUT_VITA         // ux0-like: app/, pspemu/, data/, music/, picture/
+} SynthLayout;
+
+// Deterministic synthetic directory trees for host-side measurements.
+typedef struct {
+    int      layout;         // SynthLayout
+    int      depth;          // directory levels below the root
+    int      fanout;         // subdirectories per directory
+    int      files_per_dir;
+    uint64_t min_file_size;
+    uint64_t max_file_size;  // sizes are log-uniform in [min, max]
+    uint32_t seed;
+} SynthSpec;
+
+typedef struct {
+    uint64_t dirs;
+    uint64_t files;
+    uint64_t bytes;
+} SynthStats;
+
+void synth_default_spec(SynthSpec* spec);
+
+// Files are created sparse, so large trees cost inodes but almost no disk.
+int synth_generate(const char* root, const SynthSpec* spec, SynthStats* out);
+
+// Adds one file to `count` pseudo-randomly chosen directories, bumping their mtime.
+int synth_touch_dirs(const char* root, int count, uint32_t seed, uint64_t* added_bytes);
+
+typedef struct {
+    uint64_t files;
+    uint64_t bytes;
+    uint64_t groups;         // sets of identical files
+    uint64_t copies;         // files in those sets
+    uint64_t reclaim_bytes;  // all but one copy of each set
+} SynthDupeStats;
+
+// Files with real contents for the duplicate finder: `sets` groups of 2-3
+// identical copies spread over three folders, next to same-sized files that
+// differ at the start or only in the middle, and files of unique sizes.
+int synth_dupes(const char* root, int sets, uint64_t size, uint32_t seed, SynthDupeStats* out);
+
+struct FsTree;
+
+// A size tree of about `entries` nodes made in memory, too many to generate
+// on disk: entries / fanout folders right under the root, each with 0 to
+// 2 * (fanout - 1) files. File names are built from a few words, so short
+// queries match many of them and names repeat across folders; sizes are
+// spread over 27 bit widths and one mtime in eight is unknown. The tree is
+// written to cache_path and loaded back, which leaves it exactly like one
+// from the cache, child blocks largest first.
+int synth_mem_tree(struct FsTree* t, uint32_t entries, uint32_t fanout, uint32_t seed, const char* cache_path);
+
+int synth_remove(const char* root);
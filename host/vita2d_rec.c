@@ -0,0 +1,101 @@
+// Recording vita2d backend for the host build: every call is counted and
+// nothing is rendered. The temporary pool mirrors vita2d's 1 MiB per-frame
+// pool, so a frame that would run it dry on the Vita fails here as well.
+#include "vita2d.h"
+#include "vita2d_rec.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define POOL_SIZE (1u << 20)
+
+static Vita2dRecCounts g_counts;
+static unsigned char* g_pool;
+static unsigned int g_pool_used;
+
+struct vita2d_pgf { int unused; };
+static struct vita2d_pgf g_font;
+
+void vita2d_rec_reset(void)
+{
+    memset(&g_counts, 0, sizeof(g_counts));
+}
+
+void vita2d_rec_counts(Vita2dRecCounts* out)
+{
+    *out = g_counts;
+}
+
+uint64_t vita2d_rec_draw_calls(const Vita2dRecCounts* c)
+{
+    return c->rect_calls + c->array_calls + c->text_calls;
+}
+
+int vita2d_init(void)
+{
+    if (!g_pool) g_pool = (unsigned char*)malloc(POOL_SIZE);
+    return g_pool ? 1 : 0;
+}
+
+int vita2d_fini(void)
+{
+    free(g_pool);
+    g_pool = NULL;
+    return 1;
+}
+
+void vita2d_start_drawing(void) {}
+
+void vita2d_end_drawing(void) {}
+
+void vita2d_clear_screen(void) {}
+
+void vita2d_swap_buffers(void)
+{
+    if (g_pool_used > g_counts.pool_peak) g_counts.pool_peak = g_pool_used;
+    g_pool_used = 0;
+    g_counts.frames++;
+}
+
+void* vita2d_pool_memalign(unsigned int size, unsigned int alignment)
+{
+    unsigned int at = (g_pool_used + alignment - 1) & ~(alignment - 1);
+    if (!g_pool || at + size > POOL_SIZE) { g_counts.pool_fails++; return NULL; }
+    g_pool_used = at + size;
+    return g_pool + at;
+}
+
+void vita2d_draw_rectangle(float x, float y, float w, float h, unsigned int color)
+{
+    // vita2d takes the four corners from the pool too
+    vita2d_pool_memalign(4 * sizeof(vita2d_color_vertex), sizeof(vita2d_color_vertex));
+    g_counts.rect_calls++;
+    g_counts.vertices += 4;
+}
+
+void vita2d_draw_array(SceGxmPrimitiveType mode, const vita2d_color_vertex* vertices, size_t count)
+{
+    g_counts.array_calls++;
+    g_counts.vertices += count;
+}
+
+vita2d_pgf* vita2d_load_default_pgf(void) { return &g_font; }
+
+void vita2d_free_pgf(vita2d_pgf* font) {}
+
+int vita2d_pgf_draw_text(vita2d_pgf* font, int x, int y, unsigned int color, float scale, const char* text)
+{
+    g_counts.text_calls++;
+    return (int)(strlen(text) * 11.0f * scale);
+}
+
+// Roughly the advance of the Vita's default PGF font
+int vita2d_pgf_text_width(vita2d_pgf* font, float scale, const char* text)
+{
+    g_counts.width_calls++;
+    return (int)(strlen(text) * 11.0f * scale);
+}
+
+int vita2d_pgf_text_height(vita2d_pgf* font, float scale, const char* text)
+{
+    return (int)(17.0f * scale);
+}
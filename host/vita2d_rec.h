@@ -0,0 +1,21 @@
+#pragma once
+#include <stdint.h>
+
+// What the UI asked vita2d to draw since the last reset, for per-frame draw
+// call budgets in fsa_bench.
+typedef struct {
+    uint64_t frames;      // vita2d_swap_buffers calls
+    uint64_t rect_calls;  // vita2d_draw_rectangle
+    uint64_t array_calls; // vita2d_draw_array
+    uint64_t text_calls;  // vita2d_pgf_draw_text
+    uint64_t width_calls; // vita2d_pgf_text_width made by the UI
+    uint64_t vertices;    // sent to the GPU, 4 per rectangle
+    uint64_t pool_peak;   // most temporary pool bytes used by one frame
+    uint64_t pool_fails;  // vita2d_pool_memalign calls that did not fit
+} Vita2dRecCounts;
+
+void vita2d_rec_reset(void);
+
+void vita2d_rec_counts(Vita2dRecCounts* out);
+
+uint64_t vita2d_rec_draw_calls(const Vita2dRecCounts* c);
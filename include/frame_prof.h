@@ -0,0 +1,56 @@
+#pragma once
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Parts of one main-loop iteration, in the order they run
+typedef enum {
+    FRAME_INPUT = 0, // pad, battery and navigation
+    FRAME_SCAN,      // polling scanners, taking trees, building the listing
+    FRAME_UI,        // vita2d draw calls
+    FRAME_GPU,       // vita2d_end_drawing: scene submission
+    FRAME_SWAP,      // vita2d_swap_buffers: display queue and vsync
+    FRAME_IDLE,      // nothing changed: waiting for the next vblank instead of drawing
+    FRAME_PHASE_COUNT
+} FramePhase;
+
+#define FRAME_RING 256
+
+typedef struct {
+    uint64_t start_us;
+    uint32_t total_us;                      // start to start of the next frame
+    uint32_t phase_us[FRAME_PHASE_COUNT];
+    uint32_t skipped;                       // 1 if the screen was left as it was
+} FrameRecord;
+
+typedef struct {
+    uint32_t frames;                        // rendered frames the times below cover
+    uint32_t skipped;
+    uint32_t min_us, avg_us, p99_us, max_us;
+    uint32_t phase_avg_us[FRAME_PHASE_COUNT];
+    float    fps;                           // rendered frames per second of wall time
+} FrameSummary;
+
+void frame_prof_begin(void);
+
+void frame_prof_mark(FramePhase phase);
+
+void frame_prof_skip(void);
+
+void frame_prof_totals(uint64_t* rendered, uint64_t* skipped);
+
+uint32_t frame_prof_count(void);
+
+const FrameRecord* frame_prof_get(uint32_t back);
+
+void frame_prof_summary(uint32_t frames, FrameSummary* out);
+
+const char* frame_prof_phase_name(FramePhase phase);
+
+int frame_prof_write_trace(const char* path);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,5 +1,6 @@
 #pragma once
 #include <stdint.h>
+#include "fs_listing.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -7,10 +8,15 @@ extern "C" {
 
 #define MAX_PARTITIONS 4
 
+// Physical device behind a mount. Walks on different media do not compete
+// for the same bus, so they can run side by side.
+typedef enum { FS_MEDIUM_INTERNAL = 0, FS_MEDIUM_MEMCARD, FS_MEDIUM_EXTERNAL } FsMedium;
+
 typedef struct {
     const char* label;   
     const char* path;    
     uint8_t     present; 
+    uint8_t     medium;  // FsMedium
     uint64_t    total_bytes;
     uint64_t    free_bytes;
 } PartitionInfo;
@@ -28,9 +34,11 @@ void format_bytes(uint64_t bytes, char* out, int outsz);
 
 uint64_t fs_size_by_extension(const char* root_path, const char** extensions, int ext_count);
 
+int fs_match_extension(const char* name, const char** extensions, int ext_count);
+
 int fs_is_directory(const char* path);
 
-int fs_scan_directory(const char* full_path, FolderUsage* out, int max_items);
+int fs_scan_directory(const char* full_path, FsListing* out);
 
 void fs_build_path(const char* current_path, const char* entry_name, char* out_path, int max_len);
 
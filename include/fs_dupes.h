@@ -0,0 +1,110 @@
+#pragma once
+#include <stdint.h>
+#include <psp2/types.h>
+#include "fs_tree.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FS_DUPES_EDGE      (4 * 1024)    // bytes hashed at each end of a file in the partial pass
+#define FS_DUPES_CHUNK     (256 * 1024)  // read size of the full pass
+#define FS_DUPES_MIN_SIZE  (64 * 1024)   // smaller files are not worth the reads
+
+typedef enum {
+    FS_DUPE_PENDING = 0,
+    FS_DUPE_PARTIAL,     // head and tail hashed
+    FS_DUPE_FULL,        // whole file hashed
+    FS_DUPE_UNIQUE,      // ruled out by its size or a hash
+    FS_DUPE_FAILED       // could not be read
+} FsDupeFileState;
+
+typedef struct {
+    uint64_t size;
+    uint64_t hash;       // partial, then full once a partial hash collides
+    uint32_t path;       // offset into FsDupes.paths
+    uint32_t node;       // in the tree it came from, as of the collect
+    uint8_t  part;       // index of that tree
+    uint8_t  state;      // FsDupeFileState
+} FsDupeFile;
+
+// Copies of one file: files[first .. first+count-1], all the same size and hash
+typedef struct {
+    uint64_t size;
+    uint64_t reclaim;    // size * (count - 1)
+    uint32_t first;
+    uint32_t count;
+} FsDupeGroup;
+
+typedef struct {
+    uint64_t files;           // files of at least the minimum size
+    uint64_t candidates;      // files sharing their size with another
+    uint64_t candidate_bytes;
+    uint64_t partial_files;   // head and tail hashed
+    uint64_t full_files;      // read in full and hashed
+    uint64_t bytes_read;
+    uint32_t errors;
+    uint32_t stage;           // 1 partial pass, 2 full pass, 3 done
+    uint32_t groups;
+    uint64_t reclaim_bytes;
+} FsDupeStats;
+
+typedef struct FsDupeCtl {
+    volatile int cancel;
+    void       (*on_progress)(struct FsDupeCtl* ctl, const FsDupeStats* stats);
+    void*        user;
+} FsDupeCtl;
+
+// Duplicate files across several size trees. Collecting groups the trees'
+// files by size in memory; hashing then reads only what still collides.
+typedef struct {
+    FsDupeFile*  files;
+    uint32_t     file_count;
+    uint32_t     file_cap;
+
+    char*        paths;
+    uint32_t     paths_len;
+    uint32_t     paths_cap;
+
+    FsDupeGroup* groups;     // largest reclaim first
+    uint32_t     group_count;
+
+    FsDupeStats  stats;
+} FsDupes;
+
+void fs_dupes_init(FsDupes* d);
+
+void fs_dupes_free(FsDupes* d);
+
+int fs_dupes_collect(FsDupes* d, const FsTree* trees, int tree_count, uint64_t min_size);
+
+int fs_dupes_hash(FsDupes* d, FsDupeCtl* ctl);
+
+const char* fs_dupes_path(const FsDupes* d, uint32_t file);
+
+typedef enum { FS_DUPES_IDLE = 0, FS_DUPES_RUNNING, FS_DUPES_DONE, FS_DUPES_CANCELLED } FsDupeState;
+
+// Runs fs_dupes_hash on a worker thread. `result` belongs to the worker
+// until poll reports FS_DUPES_DONE.
+typedef struct {
+    SceUID       thread;
+    SceUID       lock;
+    volatile int state;      // FsDupeState
+    FsDupeCtl    ctl;
+    FsDupes      result;
+    FsDupeStats  progress;   // under lock
+} FsDupeFinder;
+
+void fs_dupe_finder_init(FsDupeFinder* f);
+
+void fs_dupe_finder_deinit(FsDupeFinder* f);
+
+int fs_dupe_finder_start(FsDupeFinder* f, const FsTree* trees, int tree_count, uint64_t min_size);
+
+void fs_dupe_finder_cancel(FsDupeFinder* f);
+
+FsDupeState fs_dupe_finder_poll(FsDupeFinder* f, FsDupeStats* out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,81 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "fs_tree.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FS_FILTER_MAX      24    // user filters, one menu entry each
+#define FS_FILTER_LABEL    32
+#define FS_FILTER_PATTERNS 1024  // globs over all filters
+#define FS_FILTER_STATES   2048  // automaton states kept before the cache is flushed
+#define FS_FILTER_DEAD     0     // state from which nothing can match any more
+#define FS_FILTER_START    1
+
+// Every glob of every filter compiled into one automaton, built lazily as
+// names are matched: each state is the set of glob positions still alive,
+// so a name is matched against all filters in one pass over its bytes.
+typedef struct {
+    uint32_t  filter_count;
+    char      labels[FS_FILTER_MAX][FS_FILTER_LABEL];
+    uint32_t  pattern_count;
+    uint32_t  skipped;          // lines and globs that did not parse
+
+    // Glob positions of every pattern back to back
+    uint8_t*  kind;
+    uint8_t*  arg;
+    uint32_t  pos_count, pos_cap;
+    uint32_t  words;            // 32-bit words per position set
+
+    // Automaton; state ids are valid until the next flush
+    uint8_t   byte_class[256];
+    uint8_t   class_byte[256];  // one byte standing for each class
+    uint32_t  class_count;
+    uint32_t* sets;             // state_cap x words
+    uint32_t* hashes;
+    uint32_t* next;             // state_cap x class_count
+    uint32_t* accept;           // filters matched in each state, one bit each
+    uint32_t  state_count, state_cap;
+    uint32_t* table;            // open-addressed state ids + 1
+    uint32_t  table_cap;
+    uint32_t* scratch;          // words x 2
+    uint32_t  epoch;            // bumped on every flush
+    uint32_t  flushes;
+} FsFilterSet;
+
+// Bytes below one folder per user filter, plus each direct child's share
+typedef struct {
+    uint64_t  bytes[FS_FILTER_MAX];
+    uint64_t* child_bytes;      // child_count x stride, one row per direct child
+    uint32_t  child_count;
+    uint32_t  child_cap;        // cells allocated
+    uint32_t  stride;           // filter_count when filled
+} FsFilterStats;
+
+void fs_filter_init(FsFilterSet* s);
+
+void fs_filter_free(FsFilterSet* s);
+
+int fs_filter_add(FsFilterSet* s, const char* label, const char* glob);
+
+int fs_filter_compile(FsFilterSet* s);
+
+int fs_filter_parse(FsFilterSet* s, const char* text, size_t len);
+
+int fs_filter_load(FsFilterSet* s, const char* file_path);
+
+uint32_t fs_filter_run(FsFilterSet* s, uint32_t state, const char* str);
+
+uint32_t fs_filter_match(FsFilterSet* s, const char* path);
+
+void fs_filter_stats_init(FsFilterStats* st);
+
+void fs_filter_stats_free(FsFilterStats* st);
+
+int fs_filter_tree_stats(FsFilterSet* s, const FsTree* t, uint32_t node, FsFilterStats* out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,28 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// XXH64, streamed: same digest as one fs_xxh64 call over all the input
+typedef struct {
+    uint64_t v[4];
+    uint64_t seed;
+    uint64_t total;
+    uint8_t  buf[32];
+    uint32_t buf_len;
+} FsXxh64;
+
+void fs_xxh64_init(FsXxh64* s, uint64_t seed);
+
+void fs_xxh64_update(FsXxh64* s, const void* data, size_t len);
+
+uint64_t fs_xxh64_digest(const FsXxh64* s);
+
+uint64_t fs_xxh64(const void* data, size_t len, uint64_t seed);
+
+#ifdef __cplusplus
+}
+#endif
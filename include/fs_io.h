@@ -0,0 +1,82 @@
+#pragma once
+#include <stdint.h>
+#include <psp2/types.h>
+#include <psp2/io/dirent.h>
+#include <psp2/io/stat.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    FS_IO_DOPEN = 0,
+    FS_IO_DREAD,
+    FS_IO_DCLOSE,
+    FS_IO_GETSTAT,
+    FS_IO_DEVCTL,
+    FS_IO_OPEN,
+    FS_IO_READ,
+    FS_IO_LSEEK,
+    FS_IO_WRITE,
+    FS_IO_CLOSE,
+    FS_IO_REMOVE,
+    FS_IO_RMDIR,
+    FS_IO_RENAME,
+    FS_IO_MKDIR,
+    FS_IO_OP_COUNT
+} FsIoOp;
+
+#define FS_IO_BUCKETS 24 // bucket b counts latencies in [2^(b-1), 2^b) us; bucket 0 is < 1 us
+
+typedef struct {
+    uint32_t calls;
+    uint32_t errors;
+    uint64_t total_us;
+    uint32_t max_us;
+    uint32_t hist[FS_IO_BUCKETS];
+} FsIoOpStats;
+
+typedef struct {
+    FsIoOpStats op[FS_IO_OP_COUNT];
+} FsIoStats;
+
+// Every sceIo call the engine makes goes through these. While recording is
+// off they cost one branch on top of the call.
+SceUID fs_io_dopen(const char* path);
+int    fs_io_dread(SceUID fd, SceIoDirent* de);
+int    fs_io_dclose(SceUID fd);
+int    fs_io_getstat(const char* path, SceIoStat* st);
+int    fs_io_devctl(const char* dev, unsigned int cmd, const void* in, int inlen, void* out, int outlen);
+SceUID fs_io_open(const char* path, int flags, SceMode mode);
+int    fs_io_read(SceUID fd, void* buf, SceSize size);
+SceOff fs_io_lseek(SceUID fd, SceOff offset, int whence);
+int    fs_io_write(SceUID fd, const void* buf, SceSize size);
+int    fs_io_close(SceUID fd);
+int    fs_io_remove(const char* path);
+int    fs_io_rmdir(const char* path);
+int    fs_io_rename(const char* from, const char* to);
+int    fs_io_mkdir(const char* path, SceMode mode);
+
+void fs_io_enable(int on);
+
+int fs_io_enabled(void);
+
+void fs_io_reset(void);
+
+void fs_io_snapshot(FsIoStats* out);
+
+void fs_io_diff(const FsIoStats* now, const FsIoStats* before, FsIoStats* out);
+
+uint64_t fs_io_total_calls(const FsIoStats* s);
+
+const char* fs_io_op_name(FsIoOp op);
+
+uint32_t fs_io_percentile_us(const FsIoOpStats* s, uint32_t permille);
+
+int fs_io_format(const FsIoOpStats* s, FsIoOp op, char* out, int outsz);
+
+int fs_io_write_log(const char* file_path, const char* title, const FsIoStats* s);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,77 @@
+#pragma once
+#include <stdint.h>
+#include <psp2/io/dirent.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    FS_ITER_END = 0,
+    FS_ITER_FILE,
+    FS_ITER_DIR,      // descended into on the next call unless skipped
+    FS_ITER_DIR_DONE  // everything below it has been returned
+} FsIterEvent;
+
+#define FS_ITER_SKIP_TRASH 1  // leave the root's FS_TRASH_DIR out
+
+typedef struct {
+    uint64_t size;
+    uint32_t name;        // offset into FsIter.names
+    uint32_t mode;        // SceIoStat st_mode
+} FsIterEntry;
+
+typedef struct {
+    uint32_t next;        // next unread entry
+    uint32_t end;
+    uint32_t names_len;   // names pool mark to restore on pop
+    uint32_t path_len;    // length of this directory's path
+    uint32_t name;        // offset of its name in the path
+} FsIterFrame;
+
+// Depth-first walk below one directory with an explicit stack and a single
+// path buffer. Each directory is read in one go and closed before the walk
+// descends, so no handles pile up and depth is bounded only by memory.
+// For FILE and DIR events `path`, `name`, `size` and `mode` describe the
+// entry; for DIR_DONE only `path` and `name` do. `depth` is the number of
+// directories on the stack, 1 for entries of the root.
+typedef struct {
+    char*        path;
+    uint32_t     path_len;
+    uint32_t     path_cap;
+    const char*  name;
+    uint64_t     size;
+    uint32_t     mode;
+
+    FsIterFrame* stack;
+    uint32_t     depth;
+    uint32_t     stack_cap;
+    FsIterEntry* entries;     // unread entries of every directory on the stack
+    uint32_t     entry_count;
+    uint32_t     entry_cap;
+    char*        names;
+    uint32_t     names_len;
+    uint32_t     names_cap;
+
+    int          flags;       // FS_ITER_* for the root
+    int          pending;     // last event was FS_ITER_DIR
+    int          descend;
+    uint32_t     errors;      // directories that could not be read
+    SceIoDirent  de;
+} FsIter;
+
+typedef int (*FsDirEntryFn)(void* user, const SceIoDirent* de);
+
+int fs_iter_read_dir(const char* path, int flags, SceIoDirent* de, FsDirEntryFn fn, void* user);
+
+int fs_iter_open(FsIter* it, const char* root, int flags);
+
+FsIterEvent fs_iter_next(FsIter* it);
+
+void fs_iter_skip(FsIter* it);
+
+void fs_iter_close(FsIter* it);
+
+#ifdef __cplusplus
+}
+#endif
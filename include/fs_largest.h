@@ -0,0 +1,75 @@
+#pragma once
+#include <stdint.h>
+#include <psp2/types.h>
+#include "fs_tree.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FS_LARGEST_COUNT 100  // files the view keeps
+#define FS_LARGEST_PATH  512  // bytes per stored path
+
+typedef struct {
+    uint64_t size;
+    uint32_t node;   // tree node, FS_TREE_NONE for a disk walk
+    uint32_t slot;   // path slot in FsLargest.paths
+} FsLargestEntry;
+
+// The N largest files below one folder. Entries form a min-heap while a
+// pass runs and are largest first afterwards; memory is N entries and N
+// path slots whatever the number of files.
+typedef struct {
+    FsLargestEntry* items;
+    uint32_t        count;
+    uint32_t        cap;
+    char*           paths;   // cap slots of FS_LARGEST_PATH bytes
+    uint64_t        files;   // files the last pass looked at
+} FsLargest;
+
+typedef struct FsLargestCtl {
+    volatile int cancel;
+    void       (*on_progress)(struct FsLargestCtl* ctl, uint64_t files);
+    void*        user;
+} FsLargestCtl;
+
+int fs_largest_init(FsLargest* l, uint32_t n);
+
+void fs_largest_free(FsLargest* l);
+
+int fs_largest_from_tree(FsLargest* l, const FsTree* t, uint32_t node);
+
+int fs_largest_walk(FsLargest* l, const char* root, FsLargestCtl* ctl);
+
+const char* fs_largest_path(const FsLargest* l, uint32_t i);
+
+typedef enum { FS_LARGEST_IDLE = 0, FS_LARGEST_RUNNING, FS_LARGEST_DONE, FS_LARGEST_FAILED } FsLargestState;
+
+// Runs fs_largest_walk on a worker thread for a partition without a tree.
+// `result` belongs to the worker until poll reports FS_LARGEST_DONE.
+typedef struct {
+    SceUID       thread;
+    SceUID       lock;
+    volatile int state;      // FsLargestState
+    FsLargestCtl ctl;
+    FsLargest    result;
+    uint32_t     n;
+    char         root[FS_LARGEST_PATH];
+    uint64_t     files;      // under lock
+} FsLargestWalker;
+
+void fs_largest_walker_init(FsLargestWalker* w, uint32_t n);
+
+void fs_largest_walker_deinit(FsLargestWalker* w);
+
+int fs_largest_walker_start(FsLargestWalker* w, const char* root);
+
+void fs_largest_walker_cancel(FsLargestWalker* w);
+
+FsLargestState fs_largest_walker_poll(FsLargestWalker* w, uint64_t* files);
+
+void fs_largest_walker_take(FsLargestWalker* w, FsLargest* out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,74 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct FsTree;
+
+#define FS_ENTRY_DIR 0x1
+
+typedef enum { FS_SORT_SIZE = 0, FS_SORT_COUNT, FS_SORT_NAME, FS_SORT_AGE, FS_SORT__COUNT } FsSortKey;
+
+typedef struct {
+    uint64_t size_bytes;
+    uint32_t name;        // offset into FsListing.names
+    uint32_t flags;       // FS_ENTRY_DIR
+} FsListItem;
+
+// Entries of one folder, largest first unless re-sorted. Either a view of a
+// directory's child block in a size tree (nothing copied), or entries owned
+// by the listing. Readers go through the accessors, one row at a time.
+typedef struct {
+    const struct FsTree* tree; // set for a view
+    uint32_t    first;
+    uint32_t    count;
+    uint32_t    gen;           // changes with every edit; no two listings share one
+    int         sort;          // FsSortKey the rows are in
+    uint32_t*   order;         // row -> child of a view not sorted by size
+    uint32_t    order_cap;
+
+    FsListItem* items;
+    uint32_t    cap;
+    char*       names;
+    uint32_t    names_len;
+    uint32_t    names_cap;
+} FsListing;
+
+void fs_listing_init(FsListing* l);
+
+void fs_listing_free(FsListing* l);
+
+void fs_listing_clear(FsListing* l);
+
+void fs_listing_view(FsListing* l, const struct FsTree* t, uint32_t node);
+
+int fs_listing_add(FsListing* l, const char* name, uint64_t size_bytes, uint32_t flags);
+
+void fs_listing_sort(FsListing* l);
+
+int fs_listing_sort_by(FsListing* l, int key);
+
+const char* fs_sort_name(int key);
+
+int fs_listing_copy(FsListing* dst, const FsListing* src);
+
+const char* fs_listing_name(const FsListing* l, uint32_t i);
+
+uint64_t fs_listing_size(const FsListing* l, uint32_t i);
+
+int fs_listing_is_dir(const FsListing* l, uint32_t i);
+
+uint32_t fs_listing_node(const FsListing* l, uint32_t i);
+
+uint32_t fs_listing_files(const FsListing* l, uint32_t i);
+
+uint32_t fs_listing_newest(const FsListing* l, uint32_t i);
+
+uint32_t fs_top_k(const uint64_t* keys, size_t stride, uint32_t n, uint32_t k, uint32_t* out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,65 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <psp2/types.h>
+#include "fs_tree.h"
+#include "fs_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FS_PREFETCH_SLOTS  32
+#define FS_PREFETCH_BUDGET (4 * 1024 * 1024)  // bytes of breakdowns kept
+#define FS_PREFETCH_QUEUE  8
+
+// Category breakdown of one folder as of one tree generation
+typedef struct {
+    const FsTree* tree;
+    uint32_t      gen;
+    uint32_t      node;
+    uint32_t      used;     // last use, for eviction
+    int           valid;
+    int           pinned;   // on screen; never evicted or overwritten
+    FsTypeStats   stats;
+} FsStatsEntry;
+
+typedef struct {
+    const FsTree* tree;
+    uint32_t      gen;
+    uint32_t      node;
+} FsPrefetchJob;
+
+// Folder breakdowns kept in a memory-bounded LRU, with a low-priority worker
+// filling in the folders the user is likely to open next.
+typedef struct {
+    SceUID        thread;
+    SceUID        lock;
+    volatile int  active;    // the worker is running or about to exit
+    volatile int  cancel;
+
+    FsStatsEntry  entries[FS_PREFETCH_SLOTS];   // under lock
+    uint32_t      clock;
+    size_t        bytes;                        // held by valid entries
+
+    FsPrefetchJob queue[FS_PREFETCH_QUEUE];     // under lock, next first
+    uint32_t      queued;
+
+    FsTypeStats   scratch[2];                   // the worker's and the caller's
+
+    uint32_t      hits, misses, prefetched;
+} FsPrefetcher;
+
+void fs_prefetcher_init(FsPrefetcher* p);
+
+void fs_prefetcher_deinit(FsPrefetcher* p);
+
+void fs_prefetcher_hint(FsPrefetcher* p, const FsTree* t, const uint32_t* nodes, int count);
+
+const FsTypeStats* fs_prefetcher_acquire(FsPrefetcher* p, const FsTree* t, uint32_t node);
+
+void fs_prefetcher_release(FsPrefetcher* p, const FsTree* t);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,72 @@
+#pragma once
+#include <stdint.h>
+#include <psp2/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct FsTree;
+
+#define FS_TRASH_DIR     ".fsa_trash"  // below each partition root
+#define FS_PURGE_JOBS    32
+#define FS_PURGE_PATH    256
+
+typedef struct {
+    uint64_t entries;      // files and folders removed so far
+    uint64_t bytes;        // file bytes removed so far
+    uint64_t total_bytes;  // bytes queued, when known
+    uint32_t errors;       // entries that could not be removed, since init
+    uint32_t jobs;         // jobs still queued or running
+} FsPurgeProgress;
+
+// Empties trashed entries on a worker thread. Deletes first rename what
+// goes into a fresh job folder under the partition's trash, which is one
+// metadata operation per entry; the worker then removes the job folders
+// one after the other, publishing progress every batch of removals. An
+// entry that cannot be trashed is queued to be removed where it is, and
+// the tree cache written after a delete goes through the same worker.
+typedef struct {
+    SceUID          thread;
+    SceUID          lock;
+    volatile int    active;   // the worker is running or about to exit
+    volatile int    cancel;
+
+    char            jobs[FS_PURGE_JOBS][FS_PURGE_PATH];
+    uint32_t        head, count;
+    uint32_t        serial;
+
+    const struct FsTree* save_tree;   // under lock: cache write waiting, or NULL
+    const struct FsTree* saving;      // under lock: cache write in progress
+    char            save_path[FS_PURGE_PATH];
+    volatile int    save_cancel;
+
+    FsPurgeProgress progress; // under lock
+} FsPurger;
+
+// True for the trash folder's name. Walks leave it out below their root
+// (FS_ITER_SKIP_TRASH): what it holds is already deleted as far as the UI goes.
+int fs_is_trash(const char* name);
+
+void fs_purger_init(FsPurger* p);
+
+void fs_purger_deinit(FsPurger* p);
+
+int fs_purger_trash(FsPurger* p, const char* part_root, const char* const* paths, const uint64_t* sizes,
+                    int count, int* moved);
+
+int fs_purger_resume(FsPurger* p, const char* part_root);
+
+int fs_purger_delete(FsPurger* p, const char* path, uint64_t bytes);
+
+int fs_purger_save(FsPurger* p, const struct FsTree* tree, const char* path);
+
+void fs_purger_release(FsPurger* p, const struct FsTree* tree);
+
+void fs_purger_cancel(FsPurger* p);
+
+int fs_purger_poll(FsPurger* p, FsPurgeProgress* out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,72 @@
+#pragma once
+#include <stdint.h>
+#include <psp2/types.h>
+#include "fs_tree.h"
+#include "fs_types.h"
+#include "fs_listing.h"
+#include "fs_spill.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FS_REPORT_BUF (64 * 1024)
+
+typedef enum { FS_REPORT_JSONL = 0, FS_REPORT_CSV } FsReportFormat;
+
+// Rows formatted straight into one buffer that goes out whenever it fills.
+// Each table is one row per entry: a JSON object per line, or CSV with a
+// header line.
+typedef struct {
+    SceUID   fd;
+    int      format;      // FsReportFormat
+    char*    buf;
+    uint32_t len;
+    uint64_t rows;
+    uint64_t bytes;       // written to fd so far
+    int      err;
+} FsReport;
+
+typedef enum { FS_EXPORT_IDLE = 0, FS_EXPORT_RUNNING, FS_EXPORT_DONE, FS_EXPORT_FAILED } FsExportState;
+
+// Writes the report of one tree to a file on a worker thread
+typedef struct {
+    SceUID            thread;
+    volatile int      state;
+    volatile int      cancel;
+    const FsTree*     tree;
+    uint32_t          node;
+    int               format;
+    char              path[256];
+    volatile uint64_t rows;
+} FsExporter;
+
+int fs_report_open(FsReport* r, SceUID fd, int format);
+
+int fs_report_close(FsReport* r);
+
+int fs_report_tree(FsReport* r, const FsTree* t, uint32_t node, volatile int* cancel);
+
+int fs_report_index(FsReport* r, FsPathIndex* x, volatile int* cancel);
+
+int fs_report_listing(FsReport* r, const FsListing* l, uint32_t max_rows);
+
+int fs_report_exts(FsReport* r, const FsTypeStats* s, const char* const* only, int only_count);
+
+int fs_report_parse_format(const char* name);
+
+const char* fs_report_suffix(int format);
+
+void fs_exporter_init(FsExporter* e);
+
+void fs_exporter_deinit(FsExporter* e);
+
+int fs_exporter_start(FsExporter* e, const FsTree* t, uint32_t node, const char* file_path, int format);
+
+FsExportState fs_exporter_poll(FsExporter* e, uint64_t* rows);
+
+void fs_exporter_release(FsExporter* e, const FsTree* t);
+
+#ifdef __cplusplus
+}
+#endif
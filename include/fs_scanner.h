@@ -0,0 +1,79 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <psp2/types.h>
+#include "fs_analyzer.h"
+#include "fs_tree.h"
+#include "fs_io.h"
+#include "fs_search.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FS_SCAN_MAX_PARTIAL 512 // largest children published while a walk runs
+
+typedef enum { FS_SCAN_IDLE = 0, FS_SCAN_RUNNING, FS_SCAN_DONE, FS_SCAN_FAILED } FsScanState;
+
+typedef struct {
+    uint64_t files;
+    uint64_t bytes;
+    uint64_t expected_bytes; // used bytes of the partition, for the ETA
+    uint64_t elapsed_us;
+    uint64_t files_per_sec;
+    uint64_t bytes_per_sec;
+    int      eta_sec;        // -1 while unknown
+} FsScanProgress;
+
+// Builds one partition tree on a worker thread. While it runs, the children of
+// the focus folder are published as each of them finishes.
+typedef struct {
+    SceUID         thread;
+    SceUID         lock;
+    volatile int   state;
+    int            part;
+    char           root[256];
+    char           cache_path[256];
+    size_t         max_bytes;  // tree budget, 0 for none
+    char           index_path[256]; // where a walk over the budget spills to
+    int            indexed;    // the last walk left a path index instead of a tree
+    uint64_t       start_us;
+    uint64_t       last_publish_us;
+
+    FsScanCtl      ctl;
+    FsTree         tree;       // owned by the worker until taken
+    FsNameIndex    names;      // name search index of tree, built once it is done
+
+    char           focus[512]; // written by the UI thread under lock
+    uint32_t       focus_node; // worker-side lookup of focus in the partial tree
+    volatile int   focus_dirty;
+
+    FsListing      partial;
+    uint32_t*      partial_top;
+    int            partial_gen;
+    FsScanProgress progress;
+    FsIoStats      io;         // I/O made while the scan ran, set when it ends
+} FsScanner;
+
+void fs_scanner_init(FsScanner* s);
+
+void fs_scanner_deinit(FsScanner* s);
+
+int fs_scanner_start(FsScanner* s, int part, const char* root, const char* cache_path,
+                     uint64_t expected_bytes, const char* focus, int threads);
+
+void fs_scanner_set_budget(FsScanner* s, size_t max_bytes, const char* index_path);
+
+void fs_scanner_set_focus(FsScanner* s, const char* focus);
+
+void fs_scanner_cancel(FsScanner* s);
+
+FsScanState fs_scanner_poll(FsScanner* s, FsListing* out, int* gen, FsScanProgress* progress);
+
+int fs_scanner_take(FsScanner* s, FsTree* out);
+
+void fs_scanner_take_names(FsScanner* s, FsNameIndex* out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,90 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <psp2/types.h>
+#include "fs_tree.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FS_SEARCH_BUCKET_BITS 17
+#define FS_SEARCH_BUCKETS     (1u << FS_SEARCH_BUCKET_BITS) // trigram hash buckets
+#define FS_SEARCH_MAX_HITS    200   // largest matches kept per query
+#define FS_SEARCH_QUERY       64
+
+// Names of one tree's live nodes, for substring search. Name ids follow the
+// order of the tree's name pool. Each name is in the posting list of every
+// trigram of its lowercased bytes; a list is the ascending ids as varint
+// gaps.
+typedef struct {
+    uint32_t  gen;          // tree gen the index was built from, 0 for none
+    uint32_t  name_count;
+    uint32_t* name_off;     // id -> offset into the tree's name pool, ascending
+    uint32_t* node_first;   // id -> first of its nodes in `nodes`; name_count + 1 entries
+    uint32_t* nodes;        // live nodes grouped by name id
+    uint32_t  node_count;
+    uint64_t* name_max;     // id -> size of its largest node
+    uint32_t* post_off;     // bucket -> byte offset into post; FS_SEARCH_BUCKETS + 1 entries
+    uint8_t*  post;
+    size_t    bytes;        // held by the arrays above
+} FsNameIndex;
+
+typedef struct {
+    uint64_t size_bytes;
+    uint32_t node;
+} FsSearchHit;
+
+// One query and the state kept for the next: a query that contains the last
+// one only checks the names that matched it.
+typedef struct {
+    char         query[FS_SEARCH_QUERY]; // lowercased
+    uint32_t     gen;          // index the names below came from
+    uint32_t*    names;        // every name id matching query
+    uint32_t     name_count, name_cap;
+    FsSearchHit  top[FS_SEARCH_MAX_HITS];  // min-heap while a query runs
+    uint32_t     hits[FS_SEARCH_MAX_HITS]; // nodes, largest first
+    uint32_t     hit_count;
+    uint32_t     match_count;  // nodes matching
+    uint32_t     checked;      // names compared by the last query
+} FsSearch;
+
+void fs_name_index_init(FsNameIndex* x);
+
+void fs_name_index_free(FsNameIndex* x);
+
+int fs_name_index_build(FsNameIndex* x, const FsTree* t, volatile int* cancel);
+
+void fs_search_init(FsSearch* s);
+
+void fs_search_free(FsSearch* s);
+
+int fs_search_run(FsSearch* s, const FsNameIndex* x, const FsTree* t, const char* query);
+
+typedef enum { FS_INDEX_IDLE = 0, FS_INDEX_RUNNING, FS_INDEX_DONE, FS_INDEX_FAILED } FsIndexState;
+
+// Runs fs_name_index_build on a worker thread. `result` belongs to the
+// worker until poll reports FS_INDEX_DONE; release before `tree` changes.
+typedef struct {
+    SceUID        thread;
+    volatile int  state;     // FsIndexState
+    volatile int  cancel;
+    const FsTree* tree;
+    FsNameIndex   result;
+} FsNameIndexer;
+
+void fs_name_indexer_init(FsNameIndexer* ix);
+
+void fs_name_indexer_deinit(FsNameIndexer* ix);
+
+int fs_name_indexer_start(FsNameIndexer* ix, const FsTree* t);
+
+void fs_name_indexer_release(FsNameIndexer* ix, const FsTree* t);
+
+FsIndexState fs_name_indexer_poll(FsNameIndexer* ix);
+
+void fs_name_indexer_take(FsNameIndexer* ix, FsNameIndex* out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,85 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "fs_tree.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FS_SNAP_MAGIC   0x53415346u  // "FSAS"
+#define FS_SNAP_VERSION 1
+#define FS_SNAP_DIR     0x80000000u  // in FsSnapNode.name
+#define FS_SNAP_PATH    256
+#define FS_DIFF_TOP     20
+
+// File layout, little endian and usable in place: the header, the node
+// table, the name pool, then one varint per node with its size.
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t node_count;
+    uint32_t names_len;
+    uint32_t sizes_len;
+    uint32_t reserved;
+    uint64_t taken;          // seconds since 1970
+    uint64_t total_bytes;    // size of the root
+    char     root_path[256];
+} FsSnapHeader;
+
+// Nodes in pre-order; a node's subtree is [index, next)
+typedef struct {
+    uint32_t name;           // offset into the name pool, | FS_SNAP_DIR for folders
+    uint32_t next;
+    uint32_t size_off;       // offset of its size in the varint stream
+} FsSnapNode;
+
+typedef struct {
+    const FsSnapHeader* hdr;
+    const FsSnapNode*   nodes;
+    const char*         names;
+    const uint8_t*      sizes;
+    uint32_t            node_count;
+    void*               owned;   // buffer freed with the snapshot, NULL when attached
+    size_t              size;
+} FsSnapshot;
+
+// One folder that changed between two snapshots
+typedef struct {
+    int64_t  delta;
+    uint64_t before, after;
+    char     path[FS_SNAP_PATH]; // below the root
+} FsSnapChange;
+
+typedef struct {
+    FsSnapChange grew[FS_DIFF_TOP];    // largest growth first
+    uint32_t     grew_count;
+    FsSnapChange shrank[FS_DIFF_TOP];  // largest loss first
+    uint32_t     shrank_count;
+    int64_t      total_delta;
+    uint32_t     folders_compared;
+    uint32_t     folders_added;
+    uint32_t     folders_removed;
+} FsSnapDiff;
+
+int fs_snapshot_build(FsSnapshot* s, const FsTree* t, uint64_t taken);
+
+int fs_snapshot_save(const FsSnapshot* s, const char* file_path);
+
+int fs_snapshot_load(FsSnapshot* s, const char* file_path);
+
+int fs_snapshot_attach(FsSnapshot* s, const void* data, size_t size);
+
+int fs_snapshot_peek(const char* file_path, FsSnapHeader* out);
+
+void fs_snapshot_free(FsSnapshot* s);
+
+const char* fs_snapshot_name(const FsSnapshot* s, uint32_t node);
+
+uint64_t fs_snapshot_size(const FsSnapshot* s, uint32_t node);
+
+int fs_snapshot_diff(const FsSnapshot* before, const FsSnapshot* after, FsSnapDiff* out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,119 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <psp2/types.h>
+#include "fs_tree.h"
+#include "fs_listing.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FS_SPILL_MAGIC    0x50415346u  // "FSAP"
+#define FS_SPILL_VERSION  1
+#define FS_SPILL_MIN      (1024 * 1024) // smallest budget accepted
+#define FS_SPILL_FANIN    32            // runs merged at once
+#define FS_SPILL_BLOCK    4096          // index bytes between restart points
+#define FS_SPILL_PATH     1024
+#define FS_SPILL_DEPTH    256
+#define FS_SPILL_DIR      0x01          // record flag
+#define FS_SPILL_TMP_NAME ".fsa_spill"
+
+// Path index file: this header, then one record per entry in path order
+// with '/' sorting before any other byte, so every folder is followed by
+// its whole subtree. A record is the bytes shared with the previous path
+// (never more than its parent's path and the '/'), the rest of the path,
+// the size as varints, a flag byte and, for folders, the u32 offset where
+// its subtree ends. Restart points every FS_SPILL_BLOCK bytes share nothing
+// and are listed as u32 offsets after the records.
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t records;
+    uint64_t dirs;
+    uint64_t total_bytes;
+    uint32_t data_off;
+    uint32_t data_end;
+    uint32_t restarts;
+    uint32_t reserved;
+    char     root_path[256];
+} FsPathIndexHeader;
+
+typedef struct {
+    uint64_t records;
+    uint32_t runs;          // sorted runs written to disk
+    uint32_t merge_passes;  // passes before the final one
+    uint64_t spilled_bytes;
+    uint64_t index_bytes;
+    size_t   peak_bytes;    // most memory held at once
+} FsSpillStats;
+
+// Collects path records within a memory budget. Whenever the buffer is
+// full it is sorted and written out as a run; finishing merges the runs
+// into a path index.
+typedef struct {
+    size_t          budget;
+    char            tmp_dir[256];
+    char            root_path[256];
+    uint8_t*        out_buf;  // shared by every file written
+    uint8_t*        buf;      // varint length, path, varint size, flags
+    size_t          buf_len, buf_cap;
+    const uint8_t** recs;
+    uint32_t        count, rec_cap;
+    uint32_t*       runs;     // file numbers of the runs not merged yet
+    uint32_t        run_count, run_cap;
+    uint32_t        next_run;
+    int             tmp_made;
+    size_t          held;
+    int             err;
+    FsSpillStats    stats;
+} FsSpill;
+
+// Buffered reader over a run or an index file
+typedef struct {
+    SceUID   fd;
+    uint8_t* buf;
+    uint32_t cap, len, pos;
+    uint32_t off;             // file offset of buf[0]
+} FsSpillReader;
+
+typedef struct {
+    char     path[FS_SPILL_PATH];
+    uint32_t len;
+    uint64_t size;
+    uint32_t flags;
+    uint32_t end;             // folders in an index: where the subtree ends
+} FsSpillRecord;
+
+typedef struct {
+    FsPathIndexHeader hdr;
+    uint32_t*         restarts;
+    FsSpillReader     in;
+    FsSpillRecord     rec;
+} FsPathIndex;
+
+int fs_spill_init(FsSpill* s, size_t budget, const char* tmp_dir, const char* root_path);
+
+int fs_spill_add(FsSpill* s, const char* path, uint64_t size, uint32_t flags);
+
+int fs_spill_finish(FsSpill* s, const char* index_path);
+
+void fs_spill_free(FsSpill* s);
+
+int fs_spill_scan(const char* root, size_t budget, const char* index_path, FsScanCtl* ctl, FsSpillStats* stats);
+
+int fs_path_index_open(FsPathIndex* x, const char* file_path);
+
+void fs_path_index_close(FsPathIndex* x);
+
+int fs_path_index_list(FsPathIndex* x, const char* dir, FsListing* out);
+
+int fs_path_index_rewind(FsPathIndex* x);
+
+const FsSpillRecord* fs_path_index_next(FsPathIndex* x);
+
+int fs_path_compare(const char* a, size_t al, const char* b, size_t bl);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,117 @@
+#pragma once
+#include <stdint.h>
+#include "fs_analyzer.h"
+#include "fs_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FS_TREE_NONE 0xFFFFFFFFu
+
+#define FS_NODE_DIR 0x1
+
+// One file or directory. Children of a directory are stored contiguously
+// (first_child .. first_child+child_count-1), sorted by size descending.
+typedef struct {
+    uint32_t name;        // offset into the interned name pool
+    uint32_t parent;
+    uint32_t first_child;
+    uint32_t child_count;
+    uint64_t size_bytes;  // file size, or aggregated size for directories
+    uint32_t flags;
+    uint32_t mtime;       // seconds since 1970, 0 if unknown
+    uint32_t files;       // files in the subtree; 1 for a file
+    uint32_t dirs;        // directories below a directory
+    uint32_t newest;      // latest file mtime in the subtree, 0 if none known
+} FsNode;
+
+#define FS_SIZE_BUCKETS  41     // 0 bytes, then [2^(b-1), 2^b) for b = 1..40
+#define FS_AGE_BUCKETS   5      // FsAgeBucket
+#define FS_CLUSTER_BYTES 32768  // exFAT cluster of a memory card, for slack
+
+typedef enum { FS_AGE_MONTH = 0, FS_AGE_YEAR, FS_AGE_3_YEARS, FS_AGE_OLDER, FS_AGE_UNKNOWN } FsAgeBucket;
+
+// Files below one folder by size and by age, from the tree alone
+typedef struct {
+    uint32_t files;
+    uint32_t dirs;
+    uint32_t newest;
+    uint32_t size_files[FS_SIZE_BUCKETS];
+    uint64_t size_bytes[FS_SIZE_BUCKETS];
+    uint32_t age_files[FS_AGE_BUCKETS];
+    uint64_t age_bytes[FS_AGE_BUCKETS];
+    uint64_t slack_bytes; // allocated past the end of each file's last cluster
+} FsFolderStats;
+
+struct FsTree;
+struct FsWalker;
+
+// Optional hooks for a build running on a worker thread. The walker bumps the
+// counters as it goes and stops as soon as `cancel` is set.
+typedef struct FsScanCtl {
+    volatile int cancel;
+    int          threads;     // directory readers; 0 or 1 walks on the calling thread
+    uint64_t     files;
+    uint64_t     dirs;
+    uint64_t     bytes;
+    size_t       max_bytes;   // nodes, names and intern table; 0 for no limit
+    int          over_budget; // set when a build stopped at max_bytes
+    void       (*on_dir_done)(struct FsScanCtl* ctl, const struct FsTree* t, uint32_t dir);
+    void*        user;
+} FsScanCtl;
+
+// Whole-partition size tree built by a single walk. Node 0 is the root.
+typedef struct FsTree {
+    FsNode*   nodes;
+    uint32_t  node_count;
+    uint32_t  node_cap;
+
+    char*     names;
+    uint32_t  names_len;
+    uint32_t  names_cap;
+
+    uint32_t* intern;      // open-addressed name offsets (+1, 0 = empty)
+    uint32_t  intern_cap;
+    uint32_t  intern_used;
+
+    char      root_path[256];
+
+    uint32_t  dirs_read;   // directories listed from disk by the last build
+    uint32_t  dirs_reused; // directories taken over from the previous tree
+    uint32_t  gen;         // changes whenever sizes or node positions change
+    FsScanCtl* ctl;        // set only while a build is running
+    struct FsWalker* walker;
+} FsTree;
+
+void fs_tree_init(FsTree* t);
+
+void fs_tree_free(FsTree* t);
+
+int fs_tree_build(FsTree* t, const char* root_path, const FsTree* prev, FsScanCtl* ctl);
+
+int fs_tree_refresh(FsTree* t, uint32_t node);
+
+int fs_tree_remove(FsTree* t, uint32_t node);
+
+uint32_t fs_tree_lookup(const FsTree* t, const char* path);
+
+const char* fs_tree_name(const FsTree* t, uint32_t node);
+
+int fs_tree_path(const FsTree* t, uint32_t node, char* out, int outsz);
+
+uint64_t fs_tree_size_by_extension(const FsTree* t, uint32_t node, const char** extensions, int ext_count);
+
+int fs_tree_type_stats(const FsTree* t, uint32_t node, FsTypeStats* out, volatile int* cancel);
+
+int fs_tree_folder_stats(const FsTree* t, uint32_t node, uint32_t now, FsFolderStats* out);
+
+int fs_size_bucket(uint64_t size_bytes);
+
+int fs_tree_save(const FsTree* t, const char* file_path, volatile int* cancel);
+
+int fs_tree_load(FsTree* t, const char* file_path, volatile int* cancel);
+
+#ifdef __cplusplus
+}
+#endif
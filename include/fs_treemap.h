@@ -0,0 +1,73 @@
+#pragma once
+#include <stdint.h>
+#include <psp2/types.h>
+#include "fs_tree.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FS_TREEMAP_MAX_TILES 2048
+#define FS_TREEMAP_MIN_AREA  36.0f  // px^2; smaller children share one "other" tile
+#define FS_TREEMAP_INSET     2.0f   // px between a folder's edge and its children
+#define FS_TREEMAP_TITLE     16.0f  // px kept above a top-level folder's children for its name
+#define FS_TREEMAP_CACHE     4      // layouts kept, one per folder and size
+
+#define FS_TILE_DIR   0x1
+#define FS_TILE_OTHER 0x2
+
+typedef struct {
+    float    x, y, w, h;
+    uint64_t size;
+    uint32_t node;      // FS_TREE_NONE for an "other" tile
+    uint32_t merged;    // children an "other" tile stands for
+    uint16_t depth;     // 0 for children of the laid-out folder
+    uint16_t flags;
+} FsTile;
+
+// Squarified treemap of one folder's descendants, nested breadth first until
+// tiles get too small or the tile budget runs out.
+typedef struct {
+    FsTile*  tiles;     // parents before their children
+    uint32_t count;
+    uint32_t cap;
+
+    const FsTree* tree; // what it was laid out from
+    uint32_t tree_gen;
+    uint32_t node;
+    float    w, h;
+    uint32_t unexpanded; // folders left without children for lack of tiles
+} FsTreemap;
+
+int fs_treemap_init(FsTreemap* m, uint32_t max_tiles);
+
+void fs_treemap_free(FsTreemap* m);
+
+int fs_treemap_layout(FsTreemap* m, const FsTree* t, uint32_t node, float w, float h, volatile int* cancel);
+
+// Lays folders out on a worker thread and keeps the last few layouts, so
+// revisiting a folder whose sizes did not change costs nothing.
+typedef struct {
+    SceUID        thread;
+    volatile int  busy;
+    volatile int  cancel;
+    int           job;                       // cache slot being laid out, -1 for none
+    volatile int  job_result;
+    FsTreemap     cache[FS_TREEMAP_CACHE];
+    int           valid[FS_TREEMAP_CACHE];
+    uint32_t      used[FS_TREEMAP_CACHE];    // last lookup, for eviction
+    uint32_t      clock;
+    uint32_t      layouts;                   // layouts computed so far
+} FsTreemapper;
+
+int fs_treemapper_init(FsTreemapper* tm);
+
+void fs_treemapper_deinit(FsTreemapper* tm);
+
+const FsTreemap* fs_treemapper_get(FsTreemapper* tm, const FsTree* t, uint32_t node, float w, float h);
+
+void fs_treemapper_release(FsTreemapper* tm, const FsTree* t);
+
+#ifdef __cplusplus
+}
+#endif
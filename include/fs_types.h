@@ -0,0 +1,62 @@
+#pragma once
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// File categories behind the Square-menu filters.
+typedef enum {
+    FS_CAT_GAMES = 0,
+    FS_CAT_MP3,
+    FS_CAT_OGG,
+    FS_CAT_PHOTO,
+    FS_CAT_VIDEO,
+    FS_CAT_DOCS,
+    FS_CAT_ARCHIVES,
+    FS_CAT_HOMEBREW,
+    FS_CAT_SAVEDATA,
+    FS_CAT_OTHER,
+    FS_CAT_COUNT
+} FsCategory;
+
+#define FS_EXT_MAX 16 // longer suffixes are counted as no extension
+
+typedef struct {
+    char     ext[FS_EXT_MAX]; // lower case, without the dot; "" for none
+    uint32_t hash;
+    uint32_t files;           // 0 marks an empty slot
+    uint64_t bytes;
+} FsExtStat;
+
+// Space per category and per extension below one folder.
+typedef struct {
+    uint64_t   cat_bytes[FS_CAT_COUNT];
+    uint32_t   cat_files[FS_CAT_COUNT];
+    FsExtStat* exts;          // open-addressed table of ext_cap slots
+    uint32_t   ext_cap;
+    uint32_t   ext_used;
+    uint64_t*  child_bytes;   // child_count x FS_CAT_COUNT, one row per direct child
+    uint32_t   child_count;
+    uint32_t   child_cap;
+} FsTypeStats;
+
+FsCategory fs_classify(const char* name);
+
+const char* fs_category_label(FsCategory cat);
+
+FsCategory fs_ext_category(const FsExtStat* e);
+
+void fs_type_stats_init(FsTypeStats* s);
+
+void fs_type_stats_free(FsTypeStats* s);
+
+void fs_type_stats_clear(FsTypeStats* s);
+
+int fs_type_stats_set_children(FsTypeStats* s, uint32_t count);
+
+int fs_type_stats_add(FsTypeStats* s, const char* name, uint64_t size_bytes);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,48 @@
+#pragma once
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct FsTree;
+
+#define FS_WALK_MAX_THREADS 8
+
+typedef struct {
+    uint32_t name;    // offset into FsWalkListing.names
+    uint32_t mtime;   // seconds since 1970, 0 if unknown
+    uint64_t size;
+    uint32_t is_dir;
+} FsWalkEntry;
+
+// Raw contents of one directory, as returned by a single Dopen/Dread pass.
+typedef struct {
+    FsWalkEntry* entries;
+    uint32_t     count;
+    char*        names;
+} FsWalkListing;
+
+// Pool of threads that list directories ahead of the tree builder. Each worker
+// owns a deque of directory tasks: it pushes the subdirectories it discovers,
+// pops its newest task (depth first, like the builder) and steals the oldest
+// task of another worker when its own deque runs dry. Finished results are
+// released as soon as the builder claims them, so only listings it has yet
+// to reach count against the pool's budget.
+typedef struct FsWalker FsWalker;
+
+FsWalker* fs_walker_create(int workers, const struct FsTree* prev);
+
+void fs_walker_destroy(FsWalker* w);
+
+int fs_walker_list(FsWalker* w, const char* path, uint32_t prev_dir, int flags, FsWalkListing** out);
+
+void fs_walker_reuse(FsWalker* w, const char* path);
+
+uint32_t fs_walker_mtime(FsWalker* w, const char* path);
+
+void fs_walker_free_listing(FsWalkListing* l);
+
+#ifdef __cplusplus
+}
+#endif
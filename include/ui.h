@@ -1,18 +1,61 @@
-#pragma once
-#include <stdint.h>
-#include "fs_analyzer.h"
-#include <vita2d.h>
-
-void ui_init(void);
-
-void ui_deinit(void);
-
-void ui_set_filter_label(const char* label);
-
-void ui_draw(const PartitionInfo* parts, int parts_count, int current_part_index,
-             const FolderUsage* folders, int folders_count,
-             int battery_percent, int fps, float calc_alpha, int current_folder_index,
-             int overlay_active, int overlay_sel,
-             const char* overlay_labels[], int overlay_count,
-             int delete_confirm_active, const char* delete_confirm_name,
-             int startup_active);
+#pragma once
+#include <stdint.h>
+#include "fs_analyzer.h"
+#include "fs_scanner.h"
+#include "fs_purge.h"
+#include "fs_dupes.h"
+#include "fs_treemap.h"
+#include <vita2d.h>
+
+// Treemap area, in pixels
+#define UI_TREEMAP_W 912
+#define UI_TREEMAP_H 276
+
+// Search keyboard, in keys
+#define UI_SEARCH_COLS 10
+#define UI_SEARCH_ROWS 4
+
+void ui_init(void);
+
+void ui_deinit(void);
+
+void ui_set_filter_label(const char* label);
+
+void ui_set_notice(const char* text);
+
+void ui_set_detail(const char* text);
+
+void ui_set_search(const char* query, int key, int on_results);
+
+char ui_search_key(int key);
+
+int ui_animating(void);
+
+// What one frame shows. Zeroed fields are left out: a NULL progress hides
+// its status line, a NULL io_panel its panel.
+typedef struct {
+    const PartitionInfo*   parts;
+    int                    parts_count;
+    int                    current_part_index;
+    const FsListing*       folders;
+    int                    current_folder_index;
+    const uint8_t*         selected;              // one mark per row, or NULL
+    int                    battery_percent;
+    float                  calc_alpha;            // "Updating..." fade
+    const FsScanProgress*  scan;
+    const FsPurgeProgress* purge;
+    const FsDupeStats*     dupes;
+    int                    treemap_view;
+    const FsTreemap*       treemap;               // NULL while it is laid out
+    int                    overlay_active;
+    int                    overlay_sel;
+    const char**           overlay_labels;
+    int                    overlay_count;
+    int                    delete_confirm_active;
+    const char*            delete_confirm_name;
+    const FsIoStats*       io_panel;
+    int                    frame_panel;
+    int                    startup_active;
+} UiFrame;
+
+void ui_draw(const UiFrame* f);
@@ -0,0 +1,18 @@
+#pragma once
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void ui_batch_rect(float x, float y, float w, float h, uint32_t color);
+
+void ui_batch_hgrad(float x, float y, float w, float h, uint32_t left, uint32_t right);
+
+void ui_batch_vgrad(float x, float y, float w, float h, uint32_t top, uint32_t bottom);
+
+void ui_batch_flush(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,46 @@
+#pragma once
+#include <stdint.h>
+#include <vita2d.h>
+#include "fs_listing.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Formatted text of one listing row
+typedef struct {
+    uint32_t gen;        // FsListing.gen it was built from
+    uint32_t index;
+    char     name[128];  // "NN. name/" for folders
+    char     size[32];
+    int      size_width; // at scale 1.0
+    char     detail[32]; // file count or newest date, when sorted by either
+    int      detail_width; // at scale 0.8
+} UiTextRow;
+
+// A line that is only reformatted when the values behind it change
+typedef struct {
+    uint64_t key;
+    int      valid;
+    char     text[160];
+} UiTextLine;
+
+void ui_text_init(vita2d_pgf* font);
+
+void ui_text_format_bytes(uint64_t bytes, char* out, int outsz);
+
+void ui_text_format_date(uint32_t unix_secs, char* out, int outsz);
+
+int ui_text_width(float scale, const char* text);
+
+const UiTextRow* ui_text_row(const FsListing* l, uint32_t i);
+
+const char* ui_text_fit(float scale, const char* text, int max_width);
+
+uint64_t ui_text_key(uint64_t a, uint64_t b);
+
+int ui_text_stale(UiTextLine* line, uint64_t key);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,152 @@
+#include "frame_prof.h"
+#include <psp2/io/fcntl.h>
+#include <psp2/kernel/processmgr.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Only the main loop touches the profiler, so no locking. The ring holds the
+// last FRAME_RING finished frames; g_cur is the one in progress.
+static FrameRecord g_ring[FRAME_RING];
+static uint32_t g_done;
+static FrameRecord g_cur;
+static uint64_t g_last_mark;
+static uint64_t g_rendered, g_skipped;
+
+static const char* PHASE_NAMES[FRAME_PHASE_COUNT] = { "input", "scan", "ui", "gpu", "swap", "idle" };
+
+const char* frame_prof_phase_name(FramePhase phase)
+{
+    return (unsigned)phase < FRAME_PHASE_COUNT ? PHASE_NAMES[phase] : "?";
+}
+
+// ---- recording --------------------------------------------------------------
+
+// Closes the previous frame and opens the next; call at the top of the loop.
+void frame_prof_begin(void)
+{
+    uint64_t now = sceKernelGetProcessTimeWide();
+    if (g_cur.start_us) {
+        uint64_t t = now - g_cur.start_us;
+        g_cur.total_us = t > 0xFFFFFFFFu ? 0xFFFFFFFFu : (uint32_t)t;
+        g_ring[g_done % FRAME_RING] = g_cur;
+        g_done++;
+        if (g_cur.skipped) g_skipped++;
+        else g_rendered++;
+    }
+    memset(&g_cur, 0, sizeof(g_cur));
+    g_cur.start_us = g_last_mark = now;
+}
+
+// Charges the time since the previous mark (or the frame start) to `phase`.
+// Marking a phase twice in one frame adds up both stretches.
+void frame_prof_mark(FramePhase phase)
+{
+    uint64_t now = sceKernelGetProcessTimeWide();
+    if (!g_cur.start_us || (unsigned)phase >= FRAME_PHASE_COUNT) return;
+    g_cur.phase_us[phase] += (uint32_t)(now - g_last_mark);
+    g_last_mark = now;
+}
+
+// The loop left the screen alone this time; the wait that follows the
+// decision is charged to FRAME_IDLE.
+void frame_prof_skip(void)
+{
+    frame_prof_mark(FRAME_IDLE);
+    g_cur.skipped = 1;
+}
+
+// Frames rendered and skipped since startup
+void frame_prof_totals(uint64_t* rendered, uint64_t* skipped)
+{
+    if (rendered) *rendered = g_rendered;
+    if (skipped) *skipped = g_skipped;
+}
+
+uint32_t frame_prof_count(void)
+{
+    return g_done < FRAME_RING ? g_done : FRAME_RING;
+}
+
+// `back` 0 is the most recent finished frame
+const FrameRecord* frame_prof_get(uint32_t back)
+{
+    if (back >= frame_prof_count()) return NULL;
+    return &g_ring[(g_done - 1 - back) % FRAME_RING];
+}
+
+// ---- reporting --------------------------------------------------------------
+
+static int cmp_u32(const void* a, const void* b)
+{
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+// Frame time statistics over the rendered frames among the last `frames`
+// finished ones; skipped frames only count toward the wall time behind fps.
+void frame_prof_summary(uint32_t frames, FrameSummary* out)
+{
+    memset(out, 0, sizeof(*out));
+    uint32_t n = frame_prof_count();
+    if (frames < n) n = frames;
+
+    uint32_t sorted[FRAME_RING];
+    uint32_t drawn = 0;
+    uint64_t total = 0, wall = 0, phase[FRAME_PHASE_COUNT] = {0};
+    for (uint32_t i = 0; i < n; ++i) {
+        const FrameRecord* f = frame_prof_get(i);
+        wall += f->total_us;
+        if (f->skipped) { out->skipped++; continue; }
+        sorted[drawn++] = f->total_us;
+        total += f->total_us;
+        for (int p = 0; p < FRAME_PHASE_COUNT; ++p) phase[p] += f->phase_us[p];
+    }
+    if (!drawn) return;
+    qsort(sorted, drawn, sizeof(uint32_t), cmp_u32);
+
+    out->frames = drawn;
+    out->min_us = sorted[0];
+    out->max_us = sorted[drawn - 1];
+    out->avg_us = (uint32_t)(total / drawn);
+    out->p99_us = sorted[(drawn * 99 + 99) / 100 - 1];
+    for (int p = 0; p < FRAME_PHASE_COUNT; ++p) out->phase_avg_us[p] = (uint32_t)(phase[p] / drawn);
+    out->fps = wall ? (float)drawn * 1000000.0f / (float)wall : 0.0f;
+}
+
+// Dumps the ring, oldest frame first, in the Chrome trace event format: one
+// "frame" span per frame on track 0 and its phases back to back on track 1,
+// so chrome://tracing or Perfetto lines up stalls with what caused them.
+int frame_prof_write_trace(const char* path)
+{
+    SceUID fd = sceIoOpen(path, SCE_O_WRONLY | SCE_O_CREAT | SCE_O_TRUNC, 0777);
+    if (fd < 0) return -1;
+
+    char buf[1024];
+    int res = 0;
+    int n = snprintf(buf, sizeof(buf), "{\"traceEvents\":[\n");
+    if (sceIoWrite(fd, buf, n) != n) res = -1;
+
+    uint32_t count = frame_prof_count();
+    for (uint32_t i = count; i-- > 0 && res == 0;) {
+        const FrameRecord* f = frame_prof_get(i);
+        n = snprintf(buf, sizeof(buf),
+                     "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":0,\"ts\":%llu,\"dur\":%u}",
+                     f->skipped ? "skipped" : "frame", (unsigned long long)f->start_us, (unsigned)f->total_us);
+        uint64_t ts = f->start_us;
+        for (int p = 0; p < FRAME_PHASE_COUNT; ++p) {
+            if (!f->phase_us[p]) continue;
+            n += snprintf(buf + n, sizeof(buf) - n,
+                          ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%llu,\"dur\":%u}",
+                          PHASE_NAMES[p], (unsigned long long)ts, (unsigned)f->phase_us[p]);
+            ts += f->phase_us[p];
+        }
+        n += snprintf(buf + n, sizeof(buf) - n, "%s\n", i ? "," : "");
+        if (sceIoWrite(fd, buf, n) != n) res = -1;
+    }
+
+    n = snprintf(buf, sizeof(buf), "]}\n");
+    if (res == 0 && sceIoWrite(fd, buf, n) != n) res = -1;
+    sceIoClose(fd);
+    return res;
+}
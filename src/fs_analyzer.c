@@ -1,298 +1,231 @@
-#include "fs_analyzer.h"
-#include <psp2/io/dirent.h>
-#include <psp2/io/stat.h>
-#include <psp2/io/fcntl.h>
-#include <psp2/io/devctl.h>
-#include <string.h>
-#include <stdio.h>
-#include <stdlib.h>
-#include <ctype.h>
-
-// ---- internal helpers -------------------------------------------------------
-
-static int get_fs_info(const char* mount, uint64_t* total, uint64_t* freeb)
-{
-    SceIoDevInfo info;
-    memset(&info, 0, sizeof(info));
-    int res = sceIoDevctl(mount, 0x3001, NULL, 0, &info, sizeof(info));
-    if (res < 0) return res;
-    if (total) *total = info.max_size;
-    if (freeb) *freeb = info.free_size;
-    return 0;
-}
-
-static int exists_path(const char* path)
-{
-    SceIoStat st; memset(&st, 0, sizeof(st));
-    int r = sceIoGetstat(path, &st);
-    return (r >= 0);
-}
-
-static int ends_with_case_insensitive(const char* name, const char* ext)
-{
-    if (!name || !ext) return 0;
-    size_t ln = strlen(name);
-    size_t le = strlen(ext);
-    if (le == 0 || ln < le) return 0;
-
-    // allow both "mp3" and ".mp3"
-    const char* e = ext;
-    if (ext[0] == '.') { e = ext + 1; le -= 1; if (ln < le) return 0; }
-
-    // find last '.'
-    const char* dot = strrchr(name, '.');
-    if (!dot) return 0;
-    dot++; // skip '.'
-
-    // compare case-insensitive
-    for (size_t i = 0; i < le; ++i) {
-        char a = (char)tolower((unsigned char)dot[i]);
-        char b = (char)tolower((unsigned char)e[i]);
-        if (a != b) return 0;
-    }
-    return dot[le] == '\0';
-}
-
-// recursive accumulator; if extensions==NULL or ext_count==0 -> count all files
-static uint64_t accumulate_path_size(const char* path, int depth,
-                                     const char** extensions, int ext_count)
-{
-    if (depth > 16) return 0;
-
-    SceUID dfd = sceIoDopen(path);
-    if (dfd < 0) {
-        SceIoStat st; 
-        if (sceIoGetstat(path, &st) >= 0) return st.st_size;
-        return 0;
-    }
-
-    uint64_t total = 0;
-    SceIoDirent de; memset(&de, 0, sizeof(de));
-    while (sceIoDread(dfd, &de) > 0) {
-        if (!strcmp(de.d_name, ".") || !strcmp(de.d_name, "..")) { memset(&de,0,sizeof(de)); continue; }
-        char child[1024];
-        snprintf(child, sizeof(child), "%s%s%s", path, (path[strlen(path)-1]=='/')? "":"/", de.d_name);
-
-        if (SCE_S_ISDIR(de.d_stat.st_mode)) {
-            total += accumulate_path_size(child, depth+1, extensions, ext_count);
-        } else {
-            if (extensions && ext_count > 0) {
-                int match = 0;
-                for (int i = 0; i < ext_count && extensions[i]; ++i) {
-                    if (ends_with_case_insensitive(de.d_name, extensions[i])) { match = 1; break; }
-                }
-                if (match) total += de.d_stat.st_size;
-            } else {
-                total += de.d_stat.st_size;
-            }
-        }
-        memset(&de, 0, sizeof(de));
-    }
-    sceIoDclose(dfd);
-    return total;
-}
-
-// ---- public API -------------------------------------------------------------
-
-int fs_detect_partitions(PartitionInfo out_list[], int *out_count)
-{
-    const char* names[] = {"ux0", "ur0", "uma0", "imc0"};
-    const char* paths[] = {"ux0:/", "ur0:/", "uma0:/", "imc0:/"};
-
-    int n = 0;
-    for (int i = 0; i < 4; ++i) {
-        PartitionInfo pi; memset(&pi, 0, sizeof(pi));
-        pi.label = names[i];
-        pi.path  = paths[i];
-        pi.present = exists_path(paths[i]) ? 1 : 0;
-        if (pi.present) {
-            if (get_fs_info(paths[i], &pi.total_bytes, &pi.free_bytes) < 0) {
-                pi.total_bytes = 0;
-                pi.free_bytes  = 0;
-            }
-            out_list[n++] = pi;
-        }
-    }
-    *out_count = n;
-    return n > 0 ? 0 : -1;
-}
-
-int fs_top_entries_in_root(const char* root_path, FolderUsage* out, int max_items)
-{
-    if (!root_path || !out || max_items <= 0) return -1;
-
-    SceUID dfd = sceIoDopen(root_path);
-    if (dfd < 0) return -1;
-
-    FolderUsage tmp[128];
-    int count = 0;
-
-    SceIoDirent de; memset(&de, 0, sizeof(de));
-    while (sceIoDread(dfd, &de) > 0 && count < 128) {
-        if (!strcmp(de.d_name, ".") || !strcmp(de.d_name, "..")) { memset(&de,0,sizeof(de)); continue; }
-        char child[1024];
-        snprintf(child, sizeof(child), "%s%s%s", root_path, (root_path[strlen(root_path)-1]=='/')? "":"/", de.d_name);
-        FolderUsage fu; memset(&fu, 0, sizeof(fu));
-        snprintf(fu.name, sizeof(fu.name), "%s", de.d_name);
-        if (SCE_S_ISDIR(de.d_stat.st_mode)) {
-            fu.size_bytes = accumulate_path_size(child, 0, NULL, 0);
-        } else {
-            fu.size_bytes = de.d_stat.st_size;
-        }
-        tmp[count++] = fu;
-        memset(&de, 0, sizeof(de));
-    }
-    sceIoDclose(dfd);
-
-    for (int i = 0; i < count; ++i) {
-        for (int j = i+1; j < count; ++j) {
-            if (tmp[j].size_bytes > tmp[i].size_bytes) {
-                FolderUsage t = tmp[i]; tmp[i] = tmp[j]; tmp[j] = t;
-            }
-        }
-    }
-
-    int outn = (count < max_items) ? count : max_items;
-    for (int i = 0; i < outn; ++i) out[i] = tmp[i];
-    return outn;
-}
-
-uint64_t fs_size_by_extension(const char* root_path, const char** extensions, int ext_count)
-{
-    if (!root_path) return 0;
-    return accumulate_path_size(root_path, 0, extensions, ext_count);
-}
-
-void format_bytes(uint64_t bytes, char* out, int outsz)
-{
-    const char* units[] = {"B", "KB", "MB", "GB", "TB"};
-    double val = (double)bytes;
-    int u = 0;
-    while (val >= 1024.0 && u < 4) { val /= 1024.0; ++u; }
-    snprintf(out, outsz, u >= 2 ? "%.2f %s" : "%.0f %s", val, units[u]);
-}
-
-// ---- Navigation functions ----
-int fs_is_directory(const char* path)
-{
-    if (!path) return 0;
-    SceIoStat st;
-    memset(&st, 0, sizeof(st));
-    int result = sceIoGetstat(path, &st);
-    if (result < 0) return 0;
-    return SCE_S_ISDIR(st.st_mode);
-}
-
-int fs_scan_directory(const char* full_path, FolderUsage* out, int max_items)
-{
-    if (!full_path || !out || max_items <= 0) return -1;
-
-    SceUID dfd = sceIoDopen(full_path);
-    if (dfd < 0) return -1;
-
-    FolderUsage tmp[128];
-    int count = 0;
-
-    SceIoDirent de;
-    memset(&de, 0, sizeof(de));
-    while (sceIoDread(dfd, &de) > 0 && count < 128) {
-        if (!strcmp(de.d_name, ".") || !strcmp(de.d_name, "..")) {
-            memset(&de, 0, sizeof(de));
-            continue;
-        }
-        
-        char child[1024];
-        snprintf(child, sizeof(child), "%s%s%s", full_path, 
-                 (full_path[strlen(full_path)-1]=='/')? "":"/", de.d_name);
-        
-        FolderUsage fu;
-        memset(&fu, 0, sizeof(fu));
-        snprintf(fu.name, sizeof(fu.name), "%s%s", de.d_name, 
-                 SCE_S_ISDIR(de.d_stat.st_mode) ? "/" : "");
-        
-        if (SCE_S_ISDIR(de.d_stat.st_mode)) {
-            fu.size_bytes = accumulate_path_size(child, 0, NULL, 0);
-        } else {
-            fu.size_bytes = de.d_stat.st_size;
-        }
-        
-        tmp[count++] = fu;
-        memset(&de, 0, sizeof(de));
-    }
-    sceIoDclose(dfd);
-
-    for (int i = 0; i < count; ++i) {
-        for (int j = i+1; j < count; ++j) {
-            if (tmp[j].size_bytes > tmp[i].size_bytes) {
-                FolderUsage t = tmp[i];
-                tmp[i] = tmp[j];
-                tmp[j] = t;
-            }
-        }
-    }
-
-    int outn = (count < max_items) ? count : max_items;
-    for (int i = 0; i < outn; ++i) out[i] = tmp[i];
-    return outn;
-}
-
-void fs_build_path(const char* current_path, const char* entry_name, char* out_path, int max_len)
-{
-    if (!current_path || !entry_name || !out_path || max_len <= 0) return;
-
-    // Remove trailing slash from entry_name if it's a directory marker
-    char clean_entry[256];
-    strncpy(clean_entry, entry_name, sizeof(clean_entry) - 1);
-    clean_entry[sizeof(clean_entry) - 1] = '\0';
-    int len = strlen(clean_entry);
-    if (len > 0 && clean_entry[len - 1] == '/') {
-        clean_entry[len - 1] = '\0';
-    }
-
-    snprintf(out_path, max_len, "%s%s%s", current_path,
-             (current_path[strlen(current_path)-1] == '/') ? "" : "/",
-             clean_entry);
-}
-
-// Recursive delete helper
-static int recursive_delete(const char* path, int depth)
-{
-    if (depth > 16) return -1; 
-
-    SceIoStat st;
-    memset(&st, 0, sizeof(st));
-    if (sceIoGetstat(path, &st) < 0) return -1;
-
-    if (SCE_S_ISDIR(st.st_mode)) {
-        SceUID dfd = sceIoDopen(path);
-        if (dfd < 0) return -1;
-
-        SceIoDirent de;
-        memset(&de, 0, sizeof(de));
-        while (sceIoDread(dfd, &de) > 0) {
-            if (!strcmp(de.d_name, ".") || !strcmp(de.d_name, "..")) {
-                memset(&de, 0, sizeof(de));
-                continue;
-            }
-            char child[1024];
-            snprintf(child, sizeof(child), "%s%s%s", path,
-                     (path[strlen(path)-1]=='/')? "":"/", de.d_name);
-            int res = recursive_delete(child, depth + 1);
-            if (res < 0) {
-                sceIoDclose(dfd);
-                return res;
-            }
-            memset(&de, 0, sizeof(de));
-        }
-        sceIoDclose(dfd);
-        return sceIoRmdir(path);
-    } else {
-        return sceIoRemove(path);
-    }
-}
-
-int fs_delete_entry(const char* path)
-{
-    if (!path) return -1;
-    return recursive_delete(path, 0);
-}
+#include "fs_analyzer.h"
+#include "fs_iter.h"
+#include "fs_io.h"
+#include <psp2/io/dirent.h>
+#include <psp2/io/stat.h>
+#include <psp2/io/fcntl.h>
+#include <psp2/io/devctl.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+// ---- internal helpers -------------------------------------------------------
+
+static int get_fs_info(const char* mount, uint64_t* total, uint64_t* freeb)
+{
+    SceIoDevInfo info;
+    memset(&info, 0, sizeof(info));
+    int res = fs_io_devctl(mount, 0x3001, NULL, 0, &info, sizeof(info));
+    if (res < 0) return res;
+    if (total) *total = info.max_size;
+    if (freeb) *freeb = info.free_size;
+    return 0;
+}
+
+static int exists_path(const char* path)
+{
+    SceIoStat st; memset(&st, 0, sizeof(st));
+    int r = fs_io_getstat(path, &st);
+    return (r >= 0);
+}
+
+static int ends_with_case_insensitive(const char* name, const char* ext)
+{
+    if (!name || !ext) return 0;
+    size_t ln = strlen(name);
+    size_t le = strlen(ext);
+    if (le == 0 || ln < le) return 0;
+
+    // allow both "mp3" and ".mp3"
+    const char* e = ext;
+    if (ext[0] == '.') { e = ext + 1; le -= 1; if (ln < le) return 0; }
+
+    // find last '.'
+    const char* dot = strrchr(name, '.');
+    if (!dot) return 0;
+    dot++; // skip '.'
+
+    // compare case-insensitive
+    for (size_t i = 0; i < le; ++i) {
+        char a = (char)tolower((unsigned char)dot[i]);
+        char b = (char)tolower((unsigned char)e[i]);
+        if (a != b) return 0;
+    }
+    return dot[le] == '\0';
+}
+
+// Bytes of the files below `path` that match one of `extensions` (all files
+// when ext_count is 0), or the size of `path` itself when it is a file.
+static uint64_t accumulate_path_size(const char* path, const char** extensions, int ext_count)
+{
+    FsIter it;
+    if (fs_iter_open(&it, path, FS_ITER_SKIP_TRASH) < 0) {
+        SceIoStat st;
+        if (fs_io_getstat(path, &st) >= 0) return st.st_size;
+        return 0;
+    }
+
+    uint64_t total = 0;
+    FsIterEvent ev;
+    while ((ev = fs_iter_next(&it)) != FS_ITER_END) {
+        if (ev != FS_ITER_FILE) continue;
+        if (extensions && ext_count > 0 && !fs_match_extension(it.name, extensions, ext_count)) continue;
+        total += it.size;
+    }
+    fs_iter_close(&it);
+    return total;
+}
+
+// ---- public API -------------------------------------------------------------
+
+int fs_detect_partitions(PartitionInfo out_list[], int *out_count)
+{
+    const char* names[] = {"ux0", "ur0", "uma0", "imc0"};
+    const char* paths[] = {"ux0:/", "ur0:/", "uma0:/", "imc0:/"};
+    // ur0 and imc0 share the internal eMMC; uma0 is the SD2Vita / USB mount
+    const uint8_t media[] = {FS_MEDIUM_MEMCARD, FS_MEDIUM_INTERNAL, FS_MEDIUM_EXTERNAL, FS_MEDIUM_INTERNAL};
+
+    int n = 0;
+    for (int i = 0; i < (int)(sizeof(names) / sizeof(names[0])) && n < MAX_PARTITIONS; ++i) {
+        PartitionInfo pi; memset(&pi, 0, sizeof(pi));
+        pi.label = names[i];
+        pi.path  = paths[i];
+        pi.medium = media[i];
+        pi.present = exists_path(paths[i]) ? 1 : 0;
+        if (pi.present) {
+            if (get_fs_info(paths[i], &pi.total_bytes, &pi.free_bytes) < 0) {
+                pi.total_bytes = 0;
+                pi.free_bytes  = 0;
+            }
+            out_list[n++] = pi;
+        }
+    }
+    *out_count = n;
+    return n > 0 ? 0 : -1;
+}
+
+// Reads one directory into `out` and sizes its subdirectories, all in a
+// single walk: everything below the root's entries lands on the last one added.
+static int read_directory_sizes(const char* path, FsListing* out)
+{
+    FsIter it;
+    if (fs_iter_open(&it, path, FS_ITER_SKIP_TRASH) < 0) return -1;
+
+    fs_listing_clear(out);
+    int res = 0;
+    FsIterEvent ev;
+    while (res == 0 && (ev = fs_iter_next(&it)) != FS_ITER_END) {
+        if (it.depth == 1 && ev == FS_ITER_DIR)
+            res = fs_listing_add(out, it.name, 0, FS_ENTRY_DIR);
+        else if (it.depth == 1 && ev == FS_ITER_FILE)
+            res = fs_listing_add(out, it.name, it.size, 0);
+        else if (ev == FS_ITER_FILE)
+            out->items[out->count - 1].size_bytes += it.size;
+    }
+    fs_iter_close(&it);
+    return res;
+}
+
+int fs_top_entries_in_root(const char* root_path, FolderUsage* out, int max_items)
+{
+    if (!root_path || !out || max_items <= 0) return -1;
+
+    FsListing all;
+    fs_listing_init(&all);
+    uint32_t* top = (uint32_t*)malloc((size_t)max_items * sizeof(uint32_t));
+    if (!top || read_directory_sizes(root_path, &all) < 0) { free(top); fs_listing_free(&all); return -1; }
+
+    uint32_t n = all.count ? fs_top_k(&all.items[0].size_bytes, sizeof(FsListItem), all.count, (uint32_t)max_items, top) : 0;
+    for (uint32_t i = 0; i < n; ++i) {
+        snprintf(out[i].name, sizeof(out[i].name), "%s", fs_listing_name(&all, top[i]));
+        out[i].size_bytes = fs_listing_size(&all, top[i]);
+    }
+    free(top);
+    fs_listing_free(&all);
+    return (int)n;
+}
+
+int fs_match_extension(const char* name, const char** extensions, int ext_count)
+{
+    for (int i = 0; i < ext_count && extensions[i]; ++i) {
+        if (ends_with_case_insensitive(name, extensions[i])) return 1;
+    }
+    return 0;
+}
+
+uint64_t fs_size_by_extension(const char* root_path, const char** extensions, int ext_count)
+{
+    if (!root_path) return 0;
+    return accumulate_path_size(root_path, extensions, ext_count);
+}
+
+void format_bytes(uint64_t bytes, char* out, int outsz)
+{
+    const char* units[] = {"B", "KB", "MB", "GB", "TB"};
+    double val = (double)bytes;
+    int u = 0;
+    while (val >= 1024.0 && u < 4) { val /= 1024.0; ++u; }
+    snprintf(out, outsz, u >= 2 ? "%.2f %s" : "%.0f %s", val, units[u]);
+}
+
+// ---- Navigation functions ----
+int fs_is_directory(const char* path)
+{
+    if (!path) return 0;
+    SceIoStat st;
+    memset(&st, 0, sizeof(st));
+    int result = fs_io_getstat(path, &st);
+    if (result < 0) return 0;
+    return SCE_S_ISDIR(st.st_mode);
+}
+
+int fs_scan_directory(const char* full_path, FsListing* out)
+{
+    if (!full_path || !out) return -1;
+    if (read_directory_sizes(full_path, out) < 0) return -1;
+    fs_listing_sort(out);
+    return (int)out->count;
+}
+
+void fs_build_path(const char* current_path, const char* entry_name, char* out_path, int max_len)
+{
+    if (!current_path || !entry_name || !out_path || max_len <= 0) return;
+
+    // Remove trailing slash from entry_name if it's a directory marker
+    char clean_entry[256];
+    strncpy(clean_entry, entry_name, sizeof(clean_entry) - 1);
+    clean_entry[sizeof(clean_entry) - 1] = '\0';
+    int len = strlen(clean_entry);
+    if (len > 0 && clean_entry[len - 1] == '/') {
+        clean_entry[len - 1] = '\0';
+    }
+
+    snprintf(out_path, max_len, "%s%s%s", current_path,
+             (current_path[strlen(current_path)-1] == '/') ? "" : "/",
+             clean_entry);
+}
+
+// Removes a file, or a directory with everything below it: files on the way
+// down, each directory once everything below it is gone. An entry that
+// cannot be removed is skipped, and so are the folders holding it; returns
+// the first error once everything else is gone.
+int fs_delete_entry(const char* path)
+{
+    if (!path) return -1;
+    FsIter it;
+    if (fs_iter_open(&it, path, 0) < 0) return fs_io_remove(path);
+
+    int res = 0;
+    FsIterEvent ev;
+    while ((ev = fs_iter_next(&it)) != FS_ITER_END) {
+        int r = 0;
+        if (ev == FS_ITER_FILE) r = fs_io_remove(it.path);
+        else if (ev == FS_ITER_DIR_DONE) r = fs_io_rmdir(it.path);
+        if (r < 0 && res >= 0) res = r;
+    }
+    if (it.errors && res >= 0) res = -1;
+    fs_iter_close(&it);
+    int r = fs_io_rmdir(path);
+    return res < 0 ? res : r;
+}
@@ -0,0 +1,378 @@
+#include "fs_dupes.h"
+#include "fs_hash.h"
+#include "fs_io.h"
+#include <psp2/io/fcntl.h>
+#include <psp2/kernel/threadmgr.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#define DUPES_THREAD_PRIORITY (0x10000100 + 24)
+#define DUPES_THREAD_STACK    (64 * 1024)
+#define DUPES_REPORT_CHUNKS   16   // full-pass reads between progress reports
+
+// ---- collecting -------------------------------------------------------------
+
+static int add_file(FsDupes* d, uint64_t size, uint32_t node, int part)
+{
+    if (d->file_count == d->file_cap) {
+        uint32_t cap = d->file_cap ? d->file_cap * 2 : 1024;
+        FsDupeFile* f = (FsDupeFile*)realloc(d->files, (size_t)cap * sizeof(FsDupeFile));
+        if (!f) return -1;
+        d->files = f;
+        d->file_cap = cap;
+    }
+    FsDupeFile* f = &d->files[d->file_count++];
+    memset(f, 0, sizeof(*f));
+    f->size = size;
+    f->node = node;
+    f->part = (uint8_t)part;
+    return 0;
+}
+
+static int add_path(FsDupes* d, const char* path, uint32_t* out)
+{
+    uint32_t len = (uint32_t)strlen(path) + 1;
+    if (d->paths_len + len > d->paths_cap) {
+        uint32_t cap = d->paths_cap ? d->paths_cap : 16384;
+        while (cap < d->paths_len + len) cap *= 2;
+        char* p = (char*)realloc(d->paths, cap);
+        if (!p) return -1;
+        d->paths = p;
+        d->paths_cap = cap;
+    }
+    memcpy(d->paths + d->paths_len, path, len);
+    *out = d->paths_len;
+    d->paths_len += len;
+    return 0;
+}
+
+// Every file below the root of one tree, except what waits in the trash
+static int collect_tree(FsDupes* d, const FsTree* t, int part, uint64_t min_size)
+{
+    uint32_t* stack = (uint32_t*)malloc((size_t)t->node_count * sizeof(uint32_t));
+    if (!stack) return -1;
+    uint32_t sp = 0;
+    stack[sp++] = 0;
+    while (sp > 0) {
+        uint32_t dir = stack[--sp];
+        const FsNode* n = &t->nodes[dir];
+        for (uint32_t c = n->first_child; c < n->first_child + n->child_count; ++c) {
+            const FsNode* ch = &t->nodes[c];
+            if (ch->flags & FS_NODE_DIR) {
+                stack[sp++] = c;
+            } else if (ch->size_bytes >= min_size && add_file(d, ch->size_bytes, c, part) < 0) {
+                free(stack);
+                return -1;
+            }
+        }
+    }
+    free(stack);
+    return 0;
+}
+
+// Largest first, then by state and hash, so equal hashes of one pass are
+// adjacent and unreadable files sort last in their size
+static int cmp_file(const void* a, const void* b)
+{
+    const FsDupeFile* x = (const FsDupeFile*)a;
+    const FsDupeFile* y = (const FsDupeFile*)b;
+    if (x->size != y->size) return x->size > y->size ? -1 : 1;
+    if (x->state != y->state) return (int)x->state - (int)y->state;
+    if (x->hash != y->hash) return x->hash < y->hash ? -1 : 1;
+    return 0;
+}
+
+void fs_dupes_init(FsDupes* d)
+{
+    memset(d, 0, sizeof(*d));
+}
+
+void fs_dupes_free(FsDupes* d)
+{
+    free(d->files);
+    free(d->paths);
+    free(d->groups);
+    memset(d, 0, sizeof(*d));
+}
+
+const char* fs_dupes_path(const FsDupes* d, uint32_t file)
+{
+    return file < d->file_count ? d->paths + d->files[file].path : "";
+}
+
+// Gathers the files of at least `min_size` bytes from `tree_count` trees and
+// keeps those whose size another file shares, with their full paths, so the
+// hashing that follows needs neither the trees nor a walk of the disk.
+int fs_dupes_collect(FsDupes* d, const FsTree* trees, int tree_count, uint64_t min_size)
+{
+    d->file_count = d->paths_len = d->group_count = 0;
+    memset(&d->stats, 0, sizeof(d->stats));
+    for (int i = 0; i < tree_count; ++i)
+        if (trees[i].node_count > 0 && collect_tree(d, &trees[i], i, min_size) < 0) return -1;
+    d->stats.files = d->file_count;
+    if (d->file_count) qsort(d->files, d->file_count, sizeof(FsDupeFile), cmp_file);
+
+    char path[1024];
+    uint32_t kept = 0;
+    for (uint32_t i = 0, end; i < d->file_count; i = end) {
+        for (end = i + 1; end < d->file_count && d->files[end].size == d->files[i].size; ++end) {}
+        if (end - i < 2) continue;
+        for (uint32_t j = i; j < end; ++j) {
+            FsDupeFile f = d->files[j];
+            if (fs_tree_path(&trees[f.part], f.node, path, sizeof(path)) < 0 || add_path(d, path, &f.path) < 0) return -1;
+            d->files[kept++] = f;
+            d->stats.candidate_bytes += f.size;
+        }
+    }
+    d->file_count = kept;
+    d->stats.candidates = kept;
+    return 0;
+}
+
+// ---- hashing ----------------------------------------------------------------
+
+static int read_fully(SceUID fd, uint8_t* buf, uint32_t n)
+{
+    uint32_t got = 0;
+    while (got < n) {
+        int r = fs_io_read(fd, buf + got, n - got);
+        if (r <= 0) break;
+        got += (uint32_t)r;
+    }
+    return (int)got;
+}
+
+static void report(FsDupes* d, FsDupeCtl* ctl)
+{
+    if (ctl && ctl->on_progress) ctl->on_progress(ctl, &d->stats);
+}
+
+// Head and tail, FS_DUPES_EDGE bytes each; a file of up to twice that is
+// read whole, which makes its hash final.
+static void hash_edges(FsDupes* d, FsDupeFile* f, uint8_t* buf)
+{
+    SceUID fd = fs_io_open(d->paths + f->path, SCE_O_RDONLY, 0);
+    if (fd < 0) { f->state = FS_DUPE_FAILED; d->stats.errors++; return; }
+    uint32_t head = f->size < FS_DUPES_EDGE ? (uint32_t)f->size : FS_DUPES_EDGE;
+    uint32_t got = (uint32_t)read_fully(fd, buf, head);
+    uint32_t want = head;
+    if (got == head && f->size > FS_DUPES_EDGE) {
+        uint64_t off = f->size > 2 * FS_DUPES_EDGE ? f->size - FS_DUPES_EDGE : FS_DUPES_EDGE;
+        want += (uint32_t)(f->size - off);
+        if (fs_io_lseek(fd, (SceOff)off, SCE_SEEK_SET) == (SceOff)off) got += (uint32_t)read_fully(fd, buf + head, want - head);
+    }
+    fs_io_close(fd);
+    d->stats.bytes_read += got;
+    if (got != want) { f->state = FS_DUPE_FAILED; d->stats.errors++; return; }
+    d->stats.partial_files++;
+    f->hash = fs_xxh64(buf, got, f->size);
+    f->state = f->size <= 2 * FS_DUPES_EDGE ? FS_DUPE_FULL : FS_DUPE_PARTIAL;
+}
+
+// Whole file in FS_DUPES_CHUNK reads. Returns -1 when cancelled.
+static int hash_full(FsDupes* d, FsDupeFile* f, uint8_t* buf, FsDupeCtl* ctl)
+{
+    SceUID fd = fs_io_open(d->paths + f->path, SCE_O_RDONLY, 0);
+    if (fd < 0) { f->state = FS_DUPE_FAILED; d->stats.errors++; return 0; }
+    FsXxh64 h;
+    fs_xxh64_init(&h, f->size);
+    uint64_t total = 0;
+    uint32_t chunks = 0;
+    int r;
+    while ((r = fs_io_read(fd, buf, FS_DUPES_CHUNK)) > 0) {
+        fs_xxh64_update(&h, buf, (size_t)r);
+        total += (uint32_t)r;
+        d->stats.bytes_read += (uint32_t)r;
+        if (++chunks % DUPES_REPORT_CHUNKS) continue;
+        report(d, ctl);
+        if (ctl && ctl->cancel) { fs_io_close(fd); return -1; }
+    }
+    fs_io_close(fd);
+    if (r < 0 || total != f->size) { f->state = FS_DUPE_FAILED; d->stats.errors++; return 0; }
+    d->stats.full_files++;
+    f->hash = fs_xxh64_digest(&h);
+    f->state = FS_DUPE_FULL;
+    return 0;
+}
+
+// After a sort, marks files whose (size, hash) nobody else has as unique.
+// Returns how many files still collide on a partial hash only.
+static uint32_t mark_unique(FsDupes* d)
+{
+    uint32_t partial = 0;
+    for (uint32_t i = 0, end; i < d->file_count; i = end) {
+        FsDupeFile* f = &d->files[i];
+        for (end = i + 1; end < d->file_count && d->files[end].size == f->size && d->files[end].hash == f->hash &&
+                          d->files[end].state == f->state; ++end) {}
+        if (f->state == FS_DUPE_FAILED) continue;
+        for (uint32_t j = i; j < end; ++j) {
+            if (end - i < 2) d->files[j].state = FS_DUPE_UNIQUE;
+            else if (d->files[j].state == FS_DUPE_PARTIAL) partial++;
+        }
+    }
+    return partial;
+}
+
+static int cmp_group(const void* a, const void* b)
+{
+    const FsDupeGroup* x = (const FsDupeGroup*)a;
+    const FsDupeGroup* y = (const FsDupeGroup*)b;
+    if (x->reclaim != y->reclaim) return x->reclaim > y->reclaim ? -1 : 1;
+    return x->first < y->first ? -1 : x->first > y->first;
+}
+
+// Keeps only the files of groups and ranks the groups by reclaimable bytes
+static int build_groups(FsDupes* d)
+{
+    uint32_t kept = 0, groups = 0;
+    for (uint32_t i = 0, end; i < d->file_count; i = end) {
+        const FsDupeFile* f = &d->files[i];
+        for (end = i + 1; end < d->file_count && d->files[end].size == f->size && d->files[end].hash == f->hash &&
+                          d->files[end].state == f->state; ++end) {}
+        if (f->state != FS_DUPE_FULL || end - i < 2) continue;
+        memmove(&d->files[kept], f, (end - i) * sizeof(FsDupeFile));
+        kept += end - i;
+        groups++;
+    }
+    d->file_count = kept;
+
+    free(d->groups);
+    d->groups = groups ? (FsDupeGroup*)malloc(groups * sizeof(FsDupeGroup)) : NULL;
+    if (groups && !d->groups) return -1;
+    d->group_count = 0;
+    for (uint32_t i = 0, end; i < d->file_count; i = end) {
+        for (end = i + 1; end < d->file_count && d->files[end].size == d->files[i].size &&
+                          d->files[end].hash == d->files[i].hash; ++end) {}
+        FsDupeGroup* g = &d->groups[d->group_count++];
+        g->size = d->files[i].size;
+        g->count = end - i;
+        g->first = i;
+        g->reclaim = g->size * (g->count - 1);
+        d->stats.reclaim_bytes += g->reclaim;
+    }
+    if (d->group_count) qsort(d->groups, d->group_count, sizeof(FsDupeGroup), cmp_group);
+    d->stats.groups = d->group_count;
+    return 0;
+}
+
+// Narrows the collected candidates down to groups of identical files:
+// head and tail hashes first, then full reads for whatever still collides.
+// Returns -1 when cancelled or out of memory.
+int fs_dupes_hash(FsDupes* d, FsDupeCtl* ctl)
+{
+    uint8_t* buf = (uint8_t*)malloc(FS_DUPES_CHUNK);
+    if (!buf) return -1;
+
+    d->stats.stage = 1;
+    for (uint32_t i = 0; i < d->file_count; ++i) {
+        hash_edges(d, &d->files[i], buf);
+        report(d, ctl);
+        if (ctl && ctl->cancel) { free(buf); return -1; }
+    }
+    if (d->file_count) qsort(d->files, d->file_count, sizeof(FsDupeFile), cmp_file);
+
+    if (mark_unique(d) > 0) {
+        d->stats.stage = 2;
+        for (uint32_t i = 0; i < d->file_count; ++i) {
+            if (d->files[i].state != FS_DUPE_PARTIAL) continue;
+            if (hash_full(d, &d->files[i], buf, ctl) < 0 || (ctl && ctl->cancel)) { free(buf); return -1; }
+            report(d, ctl);
+        }
+        qsort(d->files, d->file_count, sizeof(FsDupeFile), cmp_file);
+    }
+    free(buf);
+
+    if (build_groups(d) < 0) return -1;
+    d->stats.stage = 3;
+    report(d, ctl);
+    return 0;
+}
+
+// ---- worker -----------------------------------------------------------------
+
+static void publish(FsDupeCtl* ctl, const FsDupeStats* stats)
+{
+    FsDupeFinder* f = (FsDupeFinder*)ctl->user;
+    sceKernelLockMutex(f->lock, 1, NULL);
+    f->progress = *stats;
+    sceKernelUnlockMutex(f->lock, 1);
+}
+
+static int finder_thread(SceSize args, void* argp)
+{
+    (void)args;
+    FsDupeFinder* f = *(FsDupeFinder**)argp;
+    int res = fs_dupes_hash(&f->result, &f->ctl);
+    publish(&f->ctl, &f->result.stats);
+    f->state = res == 0 ? FS_DUPES_DONE : FS_DUPES_CANCELLED;
+    return 0;
+}
+
+static void join_worker(FsDupeFinder* f)
+{
+    if (f->thread < 0) return;
+    sceKernelWaitThreadEnd(f->thread, NULL, NULL);
+    sceKernelDeleteThread(f->thread);
+    f->thread = -1;
+}
+
+void fs_dupe_finder_init(FsDupeFinder* f)
+{
+    memset(f, 0, sizeof(*f));
+    f->thread = -1;
+    f->lock = sceKernelCreateMutex("fsa_dupes_lock", 0, 0, NULL);
+    fs_dupes_init(&f->result);
+}
+
+void fs_dupe_finder_deinit(FsDupeFinder* f)
+{
+    fs_dupe_finder_cancel(f);
+    fs_dupes_free(&f->result);
+    if (f->lock >= 0) sceKernelDeleteMutex(f->lock);
+    f->lock = -1;
+}
+
+// Collects the candidates from the trees on the calling thread, then hashes
+// them in the background; the trees may change as soon as this returns.
+int fs_dupe_finder_start(FsDupeFinder* f, const FsTree* trees, int tree_count, uint64_t min_size)
+{
+    fs_dupe_finder_cancel(f);
+    if (f->lock < 0 || fs_dupes_collect(&f->result, trees, tree_count, min_size) < 0) return -1;
+
+    f->progress = f->result.stats;
+    memset(&f->ctl, 0, sizeof(f->ctl));
+    f->ctl.on_progress = publish;
+    f->ctl.user = f;
+    f->state = FS_DUPES_RUNNING;
+    f->thread = sceKernelCreateThread("fsa_dupes", finder_thread, DUPES_THREAD_PRIORITY,
+                                      DUPES_THREAD_STACK, 0, SCE_KERNEL_CPU_MASK_USER_1, NULL);
+    FsDupeFinder* self = f;
+    if (f->thread < 0 || sceKernelStartThread(f->thread, sizeof(self), &self) < 0) {
+        if (f->thread >= 0) sceKernelDeleteThread(f->thread);
+        f->thread = -1;
+        f->state = FS_DUPES_IDLE;
+        return -1;
+    }
+    return 0;
+}
+
+void fs_dupe_finder_cancel(FsDupeFinder* f)
+{
+    if (f->thread < 0) return;
+    f->ctl.cancel = 1;
+    join_worker(f);
+}
+
+// Copies the progress and reports where the hunt stands
+FsDupeState fs_dupe_finder_poll(FsDupeFinder* f, FsDupeStats* out)
+{
+    if (out) {
+        sceKernelLockMutex(f->lock, 1, NULL);
+        *out = f->progress;
+        sceKernelUnlockMutex(f->lock, 1);
+    }
+    FsDupeState st = (FsDupeState)f->state;
+    if (st != FS_DUPES_RUNNING) join_worker(f);
+    return st;
+}
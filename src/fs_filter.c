@@ -0,0 +1,459 @@
+#include "fs_filter.h"
+#include "fs_io.h"
+#include "fs_hash.h"
+#include <psp2/io/fcntl.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define UNKNOWN         0xffffffffu
+#define GLOB_MAX        255
+#define FILE_MAX        (64 * 1024)
+#define PATH_MAX_LEN    1024
+
+// Glob positions. STAR, DEEP and DIRS may match nothing, so a set holding
+// one of them also holds the position after it.
+enum {
+    TOK_LIT = 0,   // arg: the byte, lower case
+    TOK_ANY,       // ?   one byte but '/'
+    TOK_STAR,      // *   any bytes but '/'
+    TOK_DEEP,      // **  any bytes
+    TOK_DIRS,      // **/ nothing, or any bytes ending in '/'
+    TOK_ACCEPT     // arg: the filter
+};
+
+// ---- patterns ---------------------------------------------------------------
+
+void fs_filter_init(FsFilterSet* s)
+{
+    memset(s, 0, sizeof(*s));
+}
+
+void fs_filter_free(FsFilterSet* s)
+{
+    free(s->kind);
+    free(s->arg);
+    free(s->sets);
+    free(s->hashes);
+    free(s->next);
+    free(s->accept);
+    free(s->table);
+    free(s->scratch);
+    fs_filter_init(s);
+}
+
+static int emit(FsFilterSet* s, uint8_t kind, uint8_t arg)
+{
+    if (s->pos_count == s->pos_cap) {
+        uint32_t cap = s->pos_cap ? s->pos_cap * 2 : 256;
+        uint8_t* k = (uint8_t*)realloc(s->kind, cap);
+        if (!k) return -1;
+        s->kind = k;
+        uint8_t* a = (uint8_t*)realloc(s->arg, cap);
+        if (!a) return -1;
+        s->arg = a;
+        s->pos_cap = cap;
+    }
+    s->kind[s->pos_count] = kind;
+    s->arg[s->pos_count] = arg;
+    s->pos_count++;
+    return 0;
+}
+
+// A glob starting at a partition ("ux0:/...") or at '/' is matched against
+// whole paths; any other glob may start at any folder.
+static int anchored(const char* glob)
+{
+    if (glob[0] == '/') return 1;
+    const char* slash = strchr(glob, '/');
+    const char* colon = strchr(glob, ':');
+    return colon && (!slash || colon < slash);
+}
+
+// Adds one glob to the filter called `label`, which is created on first use.
+// Takes effect at the next fs_filter_compile.
+int fs_filter_add(FsFilterSet* s, const char* label, const char* glob)
+{
+    size_t len = glob ? strlen(glob) : 0;
+    if (!label || !*label || len == 0 || len > GLOB_MAX || s->pattern_count >= FS_FILTER_PATTERNS) return -1;
+    uint32_t f = 0;
+    while (f < s->filter_count && strcmp(s->labels[f], label) != 0) f++;
+    if (f == FS_FILTER_MAX) return -1;
+
+    uint32_t undo = s->pos_count;
+    int err = !anchored(glob) && emit(s, TOK_DIRS, 0) < 0;
+    for (const char* p = glob; *p && !err; ++p) {
+        if (p[0] == '*' && p[1] == '*' && p[2] == '/') { err = emit(s, TOK_DIRS, 0) < 0; p += 2; }
+        else if (p[0] == '*' && p[1] == '*') { err = emit(s, TOK_DEEP, 0) < 0; p += 1; }
+        else if (p[0] == '*') err = emit(s, TOK_STAR, 0) < 0;
+        else if (p[0] == '?') err = emit(s, TOK_ANY, 0) < 0;
+        else {
+            if (p[0] == '\\' && p[1]) ++p;
+            err = emit(s, TOK_LIT, (uint8_t)tolower((unsigned char)*p)) < 0;
+        }
+    }
+    if (err || emit(s, TOK_ACCEPT, (uint8_t)f) < 0) { s->pos_count = undo; return -1; }
+
+    if (f == s->filter_count) {
+        snprintf(s->labels[f], FS_FILTER_LABEL, "%s", label);
+        s->filter_count++;
+    }
+    s->pattern_count++;
+    return 0;
+}
+
+// ---- automaton --------------------------------------------------------------
+
+// Adds position `i` and whatever it can skip to
+static void add_pos(const FsFilterSet* s, uint32_t* set, uint32_t i)
+{
+    for (;;) {
+        set[i >> 5] |= 1u << (i & 31);
+        uint8_t k = s->kind[i];
+        if (k != TOK_STAR && k != TOK_DEEP && k != TOK_DIRS) return;
+        ++i;
+    }
+}
+
+static int grow_states(FsFilterSet* s)
+{
+    if (s->state_cap >= FS_FILTER_STATES) return -1;
+    uint32_t cap = s->state_cap ? s->state_cap * 2 : 64;
+    if (cap > FS_FILTER_STATES) cap = FS_FILTER_STATES;
+    uint32_t* sets = (uint32_t*)realloc(s->sets, (size_t)cap * s->words * sizeof(uint32_t));
+    if (!sets) return -1;
+    s->sets = sets;
+    uint32_t* hashes = (uint32_t*)realloc(s->hashes, (size_t)cap * sizeof(uint32_t));
+    if (!hashes) return -1;
+    s->hashes = hashes;
+    uint32_t* next = (uint32_t*)realloc(s->next, (size_t)cap * s->class_count * sizeof(uint32_t));
+    if (!next) return -1;
+    s->next = next;
+    uint32_t* accept = (uint32_t*)realloc(s->accept, (size_t)cap * sizeof(uint32_t));
+    if (!accept) return -1;
+    s->accept = accept;
+    s->state_cap = cap;
+    return 0;
+}
+
+// Id of the state for `set`, added when new. The caller makes sure there
+// is room for one more.
+static uint32_t intern(FsFilterSet* s, const uint32_t* set)
+{
+    size_t bytes = (size_t)s->words * sizeof(uint32_t);
+    uint32_t h = (uint32_t)fs_xxh64(set, bytes, 0);
+    uint32_t mask = s->table_cap - 1;
+    uint32_t i = h & mask;
+    for (; s->table[i]; i = (i + 1) & mask) {
+        uint32_t id = s->table[i] - 1;
+        if (s->hashes[id] == h && !memcmp(&s->sets[(size_t)id * s->words], set, bytes)) return id;
+    }
+    uint32_t id = s->state_count++;
+    memcpy(&s->sets[(size_t)id * s->words], set, bytes);
+    s->hashes[id] = h;
+    memset(&s->next[(size_t)id * s->class_count], 0xff, (size_t)s->class_count * sizeof(uint32_t));
+    uint32_t acc = 0;
+    for (uint32_t w = 0; w < s->words; ++w) {
+        for (uint32_t bits = set[w]; bits; bits &= bits - 1) {
+            uint32_t p = w * 32 + (uint32_t)__builtin_ctz(bits);
+            if (s->kind[p] == TOK_ACCEPT) acc |= 1u << s->arg[p];
+        }
+    }
+    s->accept[id] = acc;
+    s->table[i] = id + 1;
+    return id;
+}
+
+// Drops every state but the dead and the start one
+static void flush(FsFilterSet* s)
+{
+    memset(s->table, 0, (size_t)s->table_cap * sizeof(uint32_t));
+    s->state_count = 0;
+    uint32_t* set = s->scratch;
+    memset(set, 0, (size_t)s->words * sizeof(uint32_t));
+    intern(s, set);
+    for (uint32_t i = 0; i < s->pos_count; ++i)
+        if (i == 0 || s->kind[i - 1] == TOK_ACCEPT) add_pos(s, set, i);
+    intern(s, set);
+    s->epoch++;
+    s->flushes++;
+}
+
+// Builds the byte classes and the start state from the patterns added so
+// far. Bytes no glob names literally behave the same, so they share a
+// class; upper and lower case share one too.
+int fs_filter_compile(FsFilterSet* s)
+{
+    free(s->sets); free(s->hashes); free(s->next); free(s->accept); free(s->table); free(s->scratch);
+    s->sets = s->hashes = s->next = s->accept = s->table = s->scratch = NULL;
+    s->state_count = s->state_cap = 0;
+    if (!s->pos_count) return 0;
+
+    memset(s->byte_class, 0, sizeof(s->byte_class));
+    s->byte_class['/'] = 1;
+    s->class_byte[0] = 0;
+    s->class_byte[1] = '/';
+    s->class_count = 2;
+    for (uint32_t i = 0; i < s->pos_count; ++i) {
+        uint8_t b = s->arg[i];
+        if (s->kind[i] != TOK_LIT || s->byte_class[b] || s->class_count == 256) continue;
+        s->byte_class[b] = (uint8_t)s->class_count;
+        s->byte_class[(uint8_t)toupper(b)] = (uint8_t)s->class_count;
+        s->class_byte[s->class_count++] = b;
+    }
+    // Class 0 needs a byte no glob names
+    for (int b = 1; b < 256; ++b)
+        if (!s->byte_class[b]) { s->class_byte[0] = (uint8_t)b; break; }
+
+    s->words = (s->pos_count + 31) / 32 + 1;
+    s->table_cap = FS_FILTER_STATES * 2;
+    s->table = (uint32_t*)calloc(s->table_cap, sizeof(uint32_t));
+    s->scratch = (uint32_t*)malloc((size_t)s->words * 2 * sizeof(uint32_t));
+    if (!s->table || !s->scratch || grow_states(s) < 0) return -1;
+    flush(s);
+    s->epoch = 0;
+    s->flushes = 0;
+    return 0;
+}
+
+// Works out where `state` goes on `cls` and remembers it. A full cache is
+// flushed first, keeping `state` alive under a new id.
+static uint32_t step(FsFilterSet* s, uint32_t state, uint8_t cls)
+{
+    uint32_t* to = s->scratch;
+    uint32_t* from = s->scratch + s->words;
+    memcpy(from, &s->sets[(size_t)state * s->words], (size_t)s->words * sizeof(uint32_t));
+    memset(to, 0, (size_t)s->words * sizeof(uint32_t));
+    uint8_t b = s->class_byte[cls];
+    for (uint32_t w = 0; w < s->words; ++w) {
+        for (uint32_t bits = from[w]; bits; bits &= bits - 1) {
+            uint32_t p = w * 32 + (uint32_t)__builtin_ctz(bits);
+            switch (s->kind[p]) {
+            case TOK_LIT:  if (b == s->arg[p]) add_pos(s, to, p + 1); break;
+            case TOK_ANY:  if (b != '/') add_pos(s, to, p + 1); break;
+            case TOK_STAR: if (b != '/') add_pos(s, to, p); break;
+            case TOK_DEEP: add_pos(s, to, p); break;
+            case TOK_DIRS: add_pos(s, to, p); if (b == '/') add_pos(s, to, p + 1); break;
+            default: break;
+            }
+        }
+    }
+
+    if (s->state_count == s->state_cap && grow_states(s) < 0) {
+        // flush() reuses the scratch sets, so both survive in a copy
+        size_t bytes = (size_t)s->words * sizeof(uint32_t);
+        uint32_t* keep = (uint32_t*)malloc(bytes * 2);
+        if (!keep) return FS_FILTER_DEAD;
+        memcpy(keep, from, bytes);
+        memcpy(keep + s->words, to, bytes);
+        flush(s);
+        state = intern(s, keep);
+        uint32_t id = intern(s, keep + s->words);
+        free(keep);
+        s->next[(size_t)state * s->class_count + cls] = id;
+        return id;
+    }
+    uint32_t id = intern(s, to);
+    s->next[(size_t)state * s->class_count + cls] = id;
+    return id;
+}
+
+// Feeds `str` to the automaton from `state`
+uint32_t fs_filter_run(FsFilterSet* s, uint32_t state, const char* str)
+{
+    if (!s->table) return FS_FILTER_DEAD;
+    for (const uint8_t* p = (const uint8_t*)str; *p && state != FS_FILTER_DEAD; ++p) {
+        uint8_t cls = s->byte_class[*p];
+        uint32_t n = s->next[(size_t)state * s->class_count + cls];
+        state = n != UNKNOWN ? n : step(s, state, cls);
+    }
+    return state;
+}
+
+// State at the end of `path` with a '/' after it, ready for the names below
+// it. `inherited` gets the filters matched by the path or a folder above it.
+static uint32_t run_dir(FsFilterSet* s, const char* path, uint32_t* inherited)
+{
+    uint32_t state = FS_FILTER_START, acc = 0;
+    char one[2] = { 0, 0 };
+    const char* p = path;
+    for (; *p; ++p) {
+        if (*p == '/' && p != path) acc |= s->accept[state];
+        one[0] = *p;
+        state = fs_filter_run(s, state, one);
+    }
+    if (p == path || p[-1] != '/') {
+        acc |= s->accept[state];
+        state = fs_filter_run(s, state, "/");
+    }
+    *inherited = acc;
+    return state;
+}
+
+// Filters `path` belongs to: those a glob matches it with, and those a glob
+// matches one of its folders with.
+uint32_t fs_filter_match(FsFilterSet* s, const char* path)
+{
+    if (!s->table) return 0;
+    uint32_t state = FS_FILTER_START, acc = 0;
+    char one[2] = { 0, 0 };
+    for (const char* p = path; *p; ++p) {
+        if (*p == '/' && p != path) acc |= s->accept[state];
+        one[0] = *p;
+        state = fs_filter_run(s, state, one);
+    }
+    return acc | s->accept[state];
+}
+
+// ---- config file ------------------------------------------------------------
+
+// One "Label = glob glob ..." per line; '#' starts a comment line. Lines
+// sharing a label add to the same filter. Compiles what parsed.
+int fs_filter_parse(FsFilterSet* s, const char* text, size_t len)
+{
+    char line[1024];
+    size_t i = 0;
+    while (i < len) {
+        size_t n = 0;
+        while (i < len && text[i] != '\n') {
+            if (n + 1 < sizeof(line)) line[n++] = text[i];
+            i++;
+        }
+        i++;
+        line[n] = '\0';
+
+        char* p = line;
+        while (isspace((unsigned char)*p)) p++;
+        if (!*p || *p == '#') continue;
+        char* eq = strchr(p, '=');
+        if (!eq) { s->skipped++; continue; }
+        char* end = eq;
+        while (end > p && isspace((unsigned char)end[-1])) end--;
+        *end = '\0';
+        if (!*p) { s->skipped++; continue; }
+
+        char* save = NULL;
+        for (char* g = strtok_r(eq + 1, " \t\r", &save); g; g = strtok_r(NULL, " \t\r", &save))
+            if (fs_filter_add(s, p, g) < 0) s->skipped++;
+    }
+    return fs_filter_compile(s);
+}
+
+int fs_filter_load(FsFilterSet* s, const char* file_path)
+{
+    SceUID fd = fs_io_open(file_path, SCE_O_RDONLY, 0);
+    if (fd < 0) return -1;
+    char* buf = (char*)malloc(FILE_MAX);
+    int len = 0, r = 0;
+    while (buf && len < FILE_MAX && (r = fs_io_read(fd, buf + len, (SceSize)(FILE_MAX - len))) > 0) len += r;
+    fs_io_close(fd);
+    int res = (buf && r >= 0) ? fs_filter_parse(s, buf, (size_t)len) : -1;
+    free(buf);
+    return res;
+}
+
+// ---- folder totals ----------------------------------------------------------
+
+void fs_filter_stats_init(FsFilterStats* st)
+{
+    memset(st, 0, sizeof(*st));
+}
+
+void fs_filter_stats_free(FsFilterStats* st)
+{
+    free(st->child_bytes);
+    fs_filter_stats_init(st);
+}
+
+typedef struct {
+    uint32_t node;
+    uint32_t row;
+    uint32_t state;     // after the folder's path and a '/'
+    uint32_t inherited;
+    uint32_t epoch;
+} DirJob;
+
+static void count(FsFilterStats* out, uint64_t* row, uint32_t mask, uint64_t size)
+{
+    for (; mask; mask &= mask - 1) {
+        int f = __builtin_ctz(mask);
+        out->bytes[f] += size;
+        row[f] += size;
+    }
+}
+
+// One pass over everything below `node`: each name is fed to the automaton
+// from its folder's state, so no path is ever built. Folders every filter
+// already matched are counted whole, and folders no glob can match inside
+// are skipped.
+int fs_filter_tree_stats(FsFilterSet* s, const FsTree* t, uint32_t node, FsFilterStats* out)
+{
+    if (!s || !s->table || !t || !out || node >= t->node_count) return -1;
+    const FsNode* top = &t->nodes[node];
+    uint32_t stride = s->filter_count ? s->filter_count : 1;
+    size_t cells = (size_t)top->child_count * stride;
+    if (cells > out->child_cap || !out->child_bytes) {
+        uint64_t* rows = (uint64_t*)realloc(out->child_bytes, (cells ? cells : 1) * sizeof(uint64_t));
+        if (!rows) return -1;
+        out->child_bytes = rows;
+        out->child_cap = (uint32_t)cells;
+    }
+    out->stride = stride;
+    out->child_count = top->child_count;
+    memset(out->bytes, 0, sizeof(out->bytes));
+    memset(out->child_bytes, 0, cells * sizeof(uint64_t));
+    uint32_t all = s->filter_count >= 32 ? 0xffffffffu : (1u << s->filter_count) - 1;
+
+    char path[PATH_MAX_LEN];
+    DirJob* stack = NULL;
+    uint32_t sp = 0, cap = 0;
+    if (fs_tree_path(t, node, path, sizeof(path)) < 0) return -1;
+    DirJob job = { node, UNKNOWN, 0, 0, s->epoch };
+    job.state = run_dir(s, path, &job.inherited);
+    int res = 0;
+    for (;;) {
+        const FsNode* d = &t->nodes[job.node];
+        for (uint32_t i = 0; i < d->child_count; ++i) {
+            uint32_t c = d->first_child + i;
+            const FsNode* n = &t->nodes[c];
+            uint64_t* row = &out->child_bytes[(size_t)(job.row == UNKNOWN ? i : job.row) * stride];
+            uint32_t state = fs_filter_run(s, job.state, t->names + n->name);
+            uint32_t mask = s->accept[state] | job.inherited;
+            if (!(n->flags & FS_NODE_DIR) || mask == all) {
+                count(out, row, mask, n->size_bytes);
+            } else {
+                DirJob sub = { c, job.row == UNKNOWN ? i : job.row, 0, mask, 0 };
+                sub.state = fs_filter_run(s, state, "/");
+                sub.epoch = s->epoch;
+                if (sub.state != FS_FILTER_DEAD || mask) {
+                    if (sp == cap) {
+                        uint32_t ncap = cap ? cap * 2 : 256;
+                        DirJob* grown = (DirJob*)realloc(stack, (size_t)ncap * sizeof(DirJob));
+                        if (!grown) { res = -1; break; }
+                        stack = grown;
+                        cap = ncap;
+                    }
+                    stack[sp++] = sub;
+                }
+            }
+            // The cache was flushed under us: the folder's state id is void
+            if (job.epoch != s->epoch) {
+                if (fs_tree_path(t, job.node, path, sizeof(path)) < 0) { res = -1; break; }
+                uint32_t inherited;
+                job.state = run_dir(s, path, &inherited);
+                job.epoch = s->epoch;
+            }
+        }
+        if (res < 0 || sp == 0) break;
+        job = stack[--sp];
+        if (job.epoch != s->epoch) {
+            uint32_t inherited;
+            if (fs_tree_path(t, job.node, path, sizeof(path)) < 0) { res = -1; break; }
+            job.state = run_dir(s, path, &inherited);
+            job.epoch = s->epoch;
+        }
+    }
+    free(stack);
+    return res;
+}
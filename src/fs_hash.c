@@ -0,0 +1,99 @@
+#include "fs_hash.h"
+#include <string.h>
+
+// XXH64 by Yann Collet: 32-byte stripes through four lanes, then a final
+// avalanche. Not cryptographic; fast on the Vita's 32-bit cores all the same.
+#define P1 0x9E3779B185EBCA87ULL
+#define P2 0xC2B2AE3D27D4EB4FULL
+#define P3 0x165667B19E3779F9ULL
+#define P4 0x85EBCA77C2B2AE63ULL
+#define P5 0x27D4EB2F165667C5ULL
+
+static inline uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+static inline uint64_t read64(const uint8_t* p) { uint64_t v; memcpy(&v, p, 8); return v; }
+
+static inline uint32_t read32(const uint8_t* p) { uint32_t v; memcpy(&v, p, 4); return v; }
+
+static inline uint64_t lane(uint64_t acc, uint64_t in)
+{
+    acc += in * P2;
+    return rotl(acc, 31) * P1;
+}
+
+static inline uint64_t merge(uint64_t h, uint64_t v)
+{
+    h ^= lane(0, v);
+    return h * P1 + P4;
+}
+
+static void stripe(uint64_t v[4], const uint8_t* p)
+{
+    v[0] = lane(v[0], read64(p));
+    v[1] = lane(v[1], read64(p + 8));
+    v[2] = lane(v[2], read64(p + 16));
+    v[3] = lane(v[3], read64(p + 24));
+}
+
+void fs_xxh64_init(FsXxh64* s, uint64_t seed)
+{
+    memset(s, 0, sizeof(*s));
+    s->seed = seed;
+    s->v[0] = seed + P1 + P2;
+    s->v[1] = seed + P2;
+    s->v[2] = seed;
+    s->v[3] = seed - P1;
+}
+
+void fs_xxh64_update(FsXxh64* s, const void* data, size_t len)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    s->total += len;
+    if (s->buf_len + len < 32) {
+        memcpy(s->buf + s->buf_len, p, len);
+        s->buf_len += (uint32_t)len;
+        return;
+    }
+    if (s->buf_len) {
+        size_t fill = 32 - s->buf_len;
+        memcpy(s->buf + s->buf_len, p, fill);
+        stripe(s->v, s->buf);
+        p += fill;
+        len -= fill;
+        s->buf_len = 0;
+    }
+    for (; len >= 32; p += 32, len -= 32) stripe(s->v, p);
+    memcpy(s->buf, p, len);
+    s->buf_len = (uint32_t)len;
+}
+
+uint64_t fs_xxh64_digest(const FsXxh64* s)
+{
+    uint64_t h;
+    if (s->total >= 32) {
+        h = rotl(s->v[0], 1) + rotl(s->v[1], 7) + rotl(s->v[2], 12) + rotl(s->v[3], 18);
+        for (int i = 0; i < 4; ++i) h = merge(h, s->v[i]);
+    } else {
+        h = s->seed + P5;
+    }
+    h += s->total;
+
+    const uint8_t* p = s->buf;
+    uint32_t n = s->buf_len;
+    for (; n >= 8; p += 8, n -= 8) h = rotl(h ^ lane(0, read64(p)), 27) * P1 + P4;
+    if (n >= 4) { h = rotl(h ^ (uint64_t)read32(p) * P1, 23) * P2 + P3; p += 4; n -= 4; }
+    for (; n > 0; ++p, --n) h = rotl(h ^ (uint64_t)*p * P5, 11) * P1;
+
+    h ^= h >> 33; h *= P2;
+    h ^= h >> 29; h *= P3;
+    h ^= h >> 32;
+    return h;
+}
+
+uint64_t fs_xxh64(const void* data, size_t len, uint64_t seed)
+{
+    FsXxh64 s;
+    fs_xxh64_init(&s, seed);
+    fs_xxh64_update(&s, data, len);
+    return fs_xxh64_digest(&s);
+}
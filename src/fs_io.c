@@ -0,0 +1,175 @@
+#include "fs_io.h"
+#include <psp2/io/fcntl.h>
+#include <psp2/io/devctl.h>
+#include <psp2/kernel/processmgr.h>
+#include <string.h>
+#include <stdio.h>
+
+static volatile int g_enabled;
+static FsIoStats g_stats;
+
+// ---- recording --------------------------------------------------------------
+
+static uint32_t bucket_of(uint64_t us)
+{
+    uint32_t b = 0;
+    while (us > 0 && b < FS_IO_BUCKETS - 1) { us >>= 1; b++; }
+    return b;
+}
+
+// Called from the UI, scanner and walker threads at once, so every counter
+// is bumped atomically.
+static void record(FsIoOp op, uint64_t t0, int failed)
+{
+    uint64_t us = sceKernelGetProcessTimeWide() - t0;
+    FsIoOpStats* s = &g_stats.op[op];
+    uint32_t us32 = us > 0xFFFFFFFFu ? 0xFFFFFFFFu : (uint32_t)us;
+    __atomic_fetch_add(&s->calls, 1, __ATOMIC_RELAXED);
+    if (failed) __atomic_fetch_add(&s->errors, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&s->total_us, us, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&s->hist[bucket_of(us)], 1, __ATOMIC_RELAXED);
+    uint32_t max = __atomic_load_n(&s->max_us, __ATOMIC_RELAXED);
+    while (us32 > max && !__atomic_compare_exchange_n(&s->max_us, &max, us32, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}
+}
+
+#define IO_TIMED(op, call, fail_if)                                   \
+    do {                                                              \
+        if (!g_enabled) return call;                                  \
+        uint64_t t0_ = sceKernelGetProcessTimeWide();                 \
+        int r_ = (int)(call);                                         \
+        record(op, t0_, fail_if);                                     \
+        return r_;                                                    \
+    } while (0)
+
+SceUID fs_io_dopen(const char* path)                 { IO_TIMED(FS_IO_DOPEN, sceIoDopen(path), r_ < 0); }
+int    fs_io_dread(SceUID fd, SceIoDirent* de)       { IO_TIMED(FS_IO_DREAD, sceIoDread(fd, de), r_ < 0); }
+int    fs_io_dclose(SceUID fd)                       { IO_TIMED(FS_IO_DCLOSE, sceIoDclose(fd), r_ < 0); }
+int    fs_io_getstat(const char* path, SceIoStat* st) { IO_TIMED(FS_IO_GETSTAT, sceIoGetstat(path, st), r_ < 0); }
+SceUID fs_io_open(const char* path, int flags, SceMode mode) { IO_TIMED(FS_IO_OPEN, sceIoOpen(path, flags, mode), r_ < 0); }
+int    fs_io_read(SceUID fd, void* buf, SceSize size) { IO_TIMED(FS_IO_READ, sceIoRead(fd, buf, size), r_ < 0); }
+// Offsets do not fit IO_TIMED's int
+SceOff fs_io_lseek(SceUID fd, SceOff offset, int whence)
+{
+    if (!g_enabled) return sceIoLseek(fd, offset, whence);
+    uint64_t t0 = sceKernelGetProcessTimeWide();
+    SceOff r = sceIoLseek(fd, offset, whence);
+    record(FS_IO_LSEEK, t0, r < 0);
+    return r;
+}
+
+int    fs_io_write(SceUID fd, const void* buf, SceSize size) { IO_TIMED(FS_IO_WRITE, sceIoWrite(fd, buf, size), r_ < 0); }
+int    fs_io_close(SceUID fd)                        { IO_TIMED(FS_IO_CLOSE, sceIoClose(fd), r_ < 0); }
+int    fs_io_remove(const char* path)                { IO_TIMED(FS_IO_REMOVE, sceIoRemove(path), r_ < 0); }
+int    fs_io_rmdir(const char* path)                 { IO_TIMED(FS_IO_RMDIR, sceIoRmdir(path), r_ < 0); }
+int    fs_io_rename(const char* from, const char* to) { IO_TIMED(FS_IO_RENAME, sceIoRename(from, to), r_ < 0); }
+int    fs_io_mkdir(const char* path, SceMode mode)   { IO_TIMED(FS_IO_MKDIR, sceIoMkdir(path, mode), r_ < 0); }
+
+int fs_io_devctl(const char* dev, unsigned int cmd, const void* in, int inlen, void* out, int outlen)
+{
+    IO_TIMED(FS_IO_DEVCTL, sceIoDevctl(dev, cmd, in, inlen, out, outlen), r_ < 0);
+}
+
+// ---- public API -------------------------------------------------------------
+
+void fs_io_enable(int on)
+{
+    g_enabled = on ? 1 : 0;
+}
+
+int fs_io_enabled(void)
+{
+    return g_enabled;
+}
+
+void fs_io_reset(void)
+{
+    memset(&g_stats, 0, sizeof(g_stats));
+}
+
+// A call finishing meanwhile may show up in some of its counters only.
+void fs_io_snapshot(FsIoStats* out)
+{
+    memcpy(out, &g_stats, sizeof(*out));
+}
+
+// What happened between two snapshots. The max is the later snapshot's,
+// which is an upper bound for the interval.
+void fs_io_diff(const FsIoStats* now, const FsIoStats* before, FsIoStats* out)
+{
+    for (int i = 0; i < FS_IO_OP_COUNT; ++i) {
+        const FsIoOpStats* a = &now->op[i];
+        const FsIoOpStats* b = &before->op[i];
+        FsIoOpStats* d = &out->op[i];
+        d->calls = a->calls - b->calls;
+        d->errors = a->errors - b->errors;
+        d->total_us = a->total_us - b->total_us;
+        d->max_us = d->calls ? a->max_us : 0;
+        for (int k = 0; k < FS_IO_BUCKETS; ++k) d->hist[k] = a->hist[k] - b->hist[k];
+    }
+}
+
+uint64_t fs_io_total_calls(const FsIoStats* s)
+{
+    uint64_t n = 0;
+    for (int i = 0; i < FS_IO_OP_COUNT; ++i) n += s->op[i].calls;
+    return n;
+}
+
+const char* fs_io_op_name(FsIoOp op)
+{
+    static const char* names[FS_IO_OP_COUNT] = {
+        "Dopen", "Dread", "Dclose", "Getstat", "Devctl", "Open", "Read", "Lseek", "Write", "Close",
+        "Remove", "Rmdir", "Rename", "Mkdir"
+    };
+    return ((unsigned)op < FS_IO_OP_COUNT) ? names[op] : "?";
+}
+
+// Upper bound of the histogram bucket holding the permille-th call.
+uint32_t fs_io_percentile_us(const FsIoOpStats* s, uint32_t permille)
+{
+    if (!s->calls) return 0;
+    uint64_t want = ((uint64_t)s->calls * permille + 999) / 1000;
+    uint64_t seen = 0;
+    for (uint32_t b = 0; b < FS_IO_BUCKETS; ++b) {
+        seen += s->hist[b];
+        if (seen >= want) return b ? (1u << b) : 1;
+    }
+    return s->max_us;
+}
+
+int fs_io_format(const FsIoOpStats* s, FsIoOp op, char* out, int outsz)
+{
+    return snprintf(out, outsz, "%-8s %8u calls %5u err  avg %5u us  p50 %6u  p99 %7u  max %7u us",
+                    fs_io_op_name(op), (unsigned)s->calls, (unsigned)s->errors,
+                    (unsigned)(s->calls ? s->total_us / s->calls : 0), (unsigned)fs_io_percentile_us(s, 500),
+                    (unsigned)fs_io_percentile_us(s, 990), (unsigned)s->max_us);
+}
+
+// Appends a table of every op that was called, each followed by its
+// histogram. Written with plain sceIo calls so the log does not count itself.
+int fs_io_write_log(const char* file_path, const char* title, const FsIoStats* s)
+{
+    SceUID fd = sceIoOpen(file_path, SCE_O_WRONLY | SCE_O_CREAT | SCE_O_APPEND, 0777);
+    if (fd < 0) return -1;
+    char line[512];
+    int res = 0;
+    int n = snprintf(line, sizeof(line), "== %s\n", title);
+    if (sceIoWrite(fd, line, n) != n) res = -1;
+    for (int i = 0; i < FS_IO_OP_COUNT && res == 0; ++i) {
+        const FsIoOpStats* o = &s->op[i];
+        if (!o->calls) continue;
+        n = fs_io_format(o, (FsIoOp)i, line, sizeof(line) - 1);
+        if (n > (int)sizeof(line) - 2) n = (int)sizeof(line) - 2;
+        line[n++] = '\n';
+        if (sceIoWrite(fd, line, n) != n) { res = -1; break; }
+
+        // "  hist <1:n 2:n 4:n ..." over the non-empty buckets
+        n = snprintf(line, sizeof(line), "  hist us");
+        for (int b = 0; b < FS_IO_BUCKETS && n < (int)sizeof(line) - 24; ++b)
+            if (o->hist[b]) n += snprintf(line + n, sizeof(line) - n, " <%u:%u", b ? 1u << b : 1u, (unsigned)o->hist[b]);
+        line[n++] = '\n';
+        if (sceIoWrite(fd, line, n) != n) res = -1;
+    }
+    sceIoClose(fd);
+    return res;
+}
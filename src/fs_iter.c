@@ -0,0 +1,164 @@
+#include "fs_iter.h"
+#include "fs_io.h"
+#include "fs_purge.h"
+#include <string.h>
+#include <stdlib.h>
+
+#define ITER_PATH_INITIAL  512
+#define ITER_STACK_INITIAL 16
+
+// ---- buffers ----------------------------------------------------------------
+
+static int grow(void** buf, uint32_t* cap, uint32_t need, uint32_t initial, size_t elem)
+{
+    if (need <= *cap) return 0;
+    uint32_t c = *cap ? *cap : initial;
+    while (c < need) c *= 2;
+    void* p = realloc(*buf, (size_t)c * elem);
+    if (!p) return -1;
+    *buf = p;
+    *cap = c;
+    return 0;
+}
+
+// Replaces whatever follows the directory at `dir_len` with `name`.
+static int set_child(FsIter* it, uint32_t dir_len, const char* name)
+{
+    uint32_t nl = (uint32_t)strlen(name);
+    uint32_t slash = (dir_len > 0 && it->path[dir_len-1] != '/');
+    if (grow((void**)&it->path, &it->path_cap, dir_len + slash + nl + 1, ITER_PATH_INITIAL, 1) < 0) return -1;
+    char* p = it->path + dir_len;
+    if (slash) *p++ = '/';
+    memcpy(p, name, nl + 1);
+    it->path_len = dir_len + slash + nl;
+    it->name = it->path + dir_len + slash;
+    return 0;
+}
+
+static int add_entry(void* user, const SceIoDirent* de)
+{
+    FsIter* it = (FsIter*)user;
+    uint32_t nl = (uint32_t)strlen(de->d_name) + 1;
+    if (grow((void**)&it->entries, &it->entry_cap, it->entry_count + 1, 256, sizeof(FsIterEntry)) < 0 ||
+        grow((void**)&it->names, &it->names_cap, it->names_len + nl, 4096, 1) < 0)
+        return -1;
+    FsIterEntry* e = &it->entries[it->entry_count++];
+    e->size = (uint64_t)de->d_stat.st_size;
+    e->mode = de->d_stat.st_mode;
+    e->name = it->names_len;
+    memcpy(it->names + it->names_len, de->d_name, nl);
+    it->names_len += nl;
+    return 0;
+}
+
+// Reads the directory currently in `path` onto the stack. The handle is
+// closed again right away; its entries wait in the shared pools.
+static int push_dir(FsIter* it)
+{
+    if (grow((void**)&it->stack, &it->stack_cap, it->depth + 1, ITER_STACK_INITIAL, sizeof(FsIterFrame)) < 0)
+        return -1;
+    FsIterFrame* f = &it->stack[it->depth];
+    f->next = it->entry_count;
+    f->names_len = it->names_len;
+    f->path_len = it->path_len;
+    f->name = (uint32_t)(it->name - it->path);
+    if (fs_iter_read_dir(it->path, it->depth == 0 ? it->flags : 0, &it->de, add_entry, it) != 0) {
+        it->entry_count = f->next;
+        it->names_len = f->names_len;
+        return -1;
+    }
+    f->end = it->entry_count;
+    it->depth++;
+    return 0;
+}
+
+// ---- public API -------------------------------------------------------------
+
+// Passes every entry of one directory but "." and ".." to `fn`, in a single
+// Dopen/Dread pass with `de` as the read buffer. With FS_ITER_SKIP_TRASH the
+// trash folder is left out too. Returns 0 once all were passed, -1 when the
+// directory cannot be opened, or the first non-zero result of `fn`, which
+// ends the read.
+int fs_iter_read_dir(const char* path, int flags, SceIoDirent* de, FsDirEntryFn fn, void* user)
+{
+    SceUID dfd = fs_io_dopen(path);
+    if (dfd < 0) return -1;
+    // Zeroed once: d_private must stay NULL, and Dread fills in the rest
+    memset(de, 0, sizeof(*de));
+    int res = 0;
+    while (res == 0 && fs_io_dread(dfd, de) > 0) {
+        const char* n = de->d_name;
+        if (n[0] == '.' && (n[1] == '\0' || (n[1] == '.' && n[2] == '\0'))) continue;
+        if ((flags & FS_ITER_SKIP_TRASH) && fs_is_trash(n)) continue;
+        res = fn(user, de);
+    }
+    fs_io_dclose(dfd);
+    return res;
+}
+
+// Starts a walk below `root`. Fails when root cannot be listed, e.g. because
+// it is a file. `flags` (FS_ITER_*) apply to the root's own entries.
+int fs_iter_open(FsIter* it, const char* root, int flags)
+{
+    memset(it, 0, sizeof(*it));
+    it->flags = flags;
+    if (set_child(it, 0, root) < 0 || push_dir(it) < 0) { fs_iter_close(it); return -1; }
+    return 0;
+}
+
+FsIterEvent fs_iter_next(FsIter* it)
+{
+    if (it->pending) {
+        it->pending = 0;
+        if (!it->descend) return FS_ITER_DIR_DONE;
+        if (push_dir(it) < 0) { it->errors++; return FS_ITER_DIR_DONE; }
+    }
+    while (it->depth > 0) {
+        FsIterFrame* f = &it->stack[it->depth - 1];
+        if (f->next < f->end) {
+            const FsIterEntry* e = &it->entries[f->next++];
+            if (set_child(it, f->path_len, it->names + e->name) < 0) { it->errors++; continue; }
+            it->size = e->size;
+            it->mode = e->mode;
+            if (SCE_S_ISDIR(e->mode)) {
+                it->pending = 1;
+                it->descend = 1;
+                return FS_ITER_DIR;
+            }
+            return FS_ITER_FILE;
+        }
+        it->depth--;
+        // A frame's entries start where its parent's end, so the pools
+        // shrink back to the parent's
+        it->entry_count = it->depth > 0 ? it->stack[it->depth - 1].end : 0;
+        it->names_len = f->names_len;
+        it->path_len = f->path_len;
+        it->path[it->path_len] = '\0';
+        it->name = it->path + f->name;
+        if (it->depth == 0) return FS_ITER_END;
+        return FS_ITER_DIR_DONE;
+    }
+    return FS_ITER_END;
+}
+
+// Called after FS_ITER_DIR: step over that directory instead of entering it.
+void fs_iter_skip(FsIter* it)
+{
+    it->descend = 0;
+}
+
+void fs_iter_close(FsIter* it)
+{
+    free(it->stack);
+    free(it->entries);
+    free(it->names);
+    free(it->path);
+    it->stack = NULL;
+    it->entries = NULL;
+    it->names = NULL;
+    it->path = NULL;
+    it->depth = it->stack_cap = 0;
+    it->entry_count = it->entry_cap = 0;
+    it->names_len = it->names_cap = 0;
+    it->path_len = it->path_cap = 0;
+}
@@ -0,0 +1,237 @@
+#include "fs_largest.h"
+#include "fs_iter.h"
+#include <psp2/kernel/threadmgr.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#define LARGEST_THREAD_PRIORITY (0x10000100 + 24)
+#define LARGEST_THREAD_STACK    (32 * 1024)
+#define LARGEST_REPORT_FILES    1024   // files between progress reports
+
+// ---- heap -------------------------------------------------------------------
+
+static void sift_down(FsLargestEntry* h, uint32_t n, uint32_t i)
+{
+    for (;;) {
+        uint32_t m = i, a = 2 * i + 1, b = a + 1;
+        if (a < n && h[a].size < h[m].size) m = a;
+        if (b < n && h[b].size < h[m].size) m = b;
+        if (m == i) return;
+        FsLargestEntry tmp = h[i]; h[i] = h[m]; h[m] = tmp;
+        i = m;
+    }
+}
+
+// Offers one file; returns the path slot it took, or -1 when it is smaller
+// than everything kept. A full heap hands the evicted minimum's slot on.
+static int offer(FsLargest* l, uint64_t size, uint32_t node)
+{
+    FsLargestEntry* h = l->items;
+    if (l->count < l->cap) {
+        // Slots are handed out in order while the heap fills up
+        uint32_t c = l->count++;
+        h[c].size = size;
+        h[c].node = node;
+        h[c].slot = c;
+        int slot = (int)c;
+        while (c > 0) {
+            uint32_t p = (c - 1) / 2;
+            if (h[p].size <= h[c].size) break;
+            FsLargestEntry tmp = h[p]; h[p] = h[c]; h[c] = tmp;
+            c = p;
+        }
+        return slot;
+    }
+    if (!l->cap || size <= h[0].size) return -1;
+    h[0].size = size;
+    h[0].node = node;
+    int slot = (int)h[0].slot;
+    sift_down(h, l->count, 0);
+    return slot;
+}
+
+// Pops the minimum to the back until the entries run largest first
+static void finish(FsLargest* l)
+{
+    for (uint32_t end = l->count; end > 1; --end) {
+        FsLargestEntry tmp = l->items[0]; l->items[0] = l->items[end - 1]; l->items[end - 1] = tmp;
+        sift_down(l->items, end - 1, 0);
+    }
+}
+
+// ---- public API -------------------------------------------------------------
+
+int fs_largest_init(FsLargest* l, uint32_t n)
+{
+    memset(l, 0, sizeof(*l));
+    l->items = (FsLargestEntry*)malloc((size_t)n * sizeof(FsLargestEntry));
+    l->paths = (char*)malloc((size_t)n * FS_LARGEST_PATH);
+    if (!l->items || !l->paths) { fs_largest_free(l); return -1; }
+    l->cap = n;
+    return 0;
+}
+
+void fs_largest_free(FsLargest* l)
+{
+    free(l->items);
+    free(l->paths);
+    memset(l, 0, sizeof(*l));
+}
+
+const char* fs_largest_path(const FsLargest* l, uint32_t i)
+{
+    return i < l->count ? l->paths + (size_t)l->items[i].slot * FS_LARGEST_PATH : "";
+}
+
+// One pass over the files below `node` from memory. Paths are only built
+// for the files that made it, once the pass is over.
+int fs_largest_from_tree(FsLargest* l, const FsTree* t, uint32_t node)
+{
+    if (!l->cap || !t || node >= t->node_count) return -1;
+    l->count = 0;
+    l->files = 0;
+    uint32_t* stack = (uint32_t*)malloc((size_t)t->node_count * sizeof(uint32_t));
+    if (!stack) return -1;
+    uint32_t sp = 0;
+    stack[sp++] = node;
+    while (sp > 0) {
+        uint32_t dir = stack[--sp];
+        const FsNode* d = &t->nodes[dir];
+        for (uint32_t c = d->first_child; c < d->first_child + d->child_count; ++c) {
+            const FsNode* n = &t->nodes[c];
+            if (!(n->flags & FS_NODE_DIR)) {
+                l->files++;
+                offer(l, n->size_bytes, c);
+            } else {
+                stack[sp++] = c;
+            }
+        }
+    }
+    free(stack);
+    finish(l);
+    for (uint32_t i = 0; i < l->count; ++i)
+        fs_tree_path(t, l->items[i].node, l->paths + (size_t)l->items[i].slot * FS_LARGEST_PATH, FS_LARGEST_PATH);
+    return 0;
+}
+
+// The same straight from the disk, for when there is no tree: one walk,
+// each winner's path copied into the slot it takes.
+int fs_largest_walk(FsLargest* l, const char* root, FsLargestCtl* ctl)
+{
+    if (!l->cap || !root) return -1;
+    l->count = 0;
+    l->files = 0;
+    FsIter it;
+    if (fs_iter_open(&it, root, FS_ITER_SKIP_TRASH) < 0) return -1;
+    FsIterEvent ev;
+    int res = 0;
+    while ((ev = fs_iter_next(&it)) != FS_ITER_END) {
+        if (ctl && ctl->cancel) { res = -1; break; }
+        if (ev != FS_ITER_FILE) continue;
+        int slot = offer(l, it.size, FS_TREE_NONE);
+        l->files++;
+        if (slot >= 0) snprintf(l->paths + (size_t)slot * FS_LARGEST_PATH, FS_LARGEST_PATH, "%s", it.path);
+        if (ctl && ctl->on_progress && l->files % LARGEST_REPORT_FILES == 0) ctl->on_progress(ctl, l->files);
+    }
+    fs_iter_close(&it);
+    finish(l);
+    return res;
+}
+
+// ---- worker -----------------------------------------------------------------
+
+static void publish(FsLargestCtl* ctl, uint64_t files)
+{
+    FsLargestWalker* w = (FsLargestWalker*)ctl->user;
+    sceKernelLockMutex(w->lock, 1, NULL);
+    w->files = files;
+    sceKernelUnlockMutex(w->lock, 1);
+}
+
+static int walker_thread(SceSize args, void* argp)
+{
+    (void)args;
+    FsLargestWalker* w = *(FsLargestWalker**)argp;
+    int res = fs_largest_walk(&w->result, w->root, &w->ctl);
+    publish(&w->ctl, w->result.files);
+    w->state = res == 0 ? FS_LARGEST_DONE : FS_LARGEST_FAILED;
+    return 0;
+}
+
+static void join_worker(FsLargestWalker* w)
+{
+    if (w->thread < 0) return;
+    sceKernelWaitThreadEnd(w->thread, NULL, NULL);
+    sceKernelDeleteThread(w->thread);
+    w->thread = -1;
+}
+
+void fs_largest_walker_init(FsLargestWalker* w, uint32_t n)
+{
+    memset(w, 0, sizeof(*w));
+    w->thread = -1;
+    w->n = n;
+    w->lock = sceKernelCreateMutex("fsa_largest_lock", 0, 0, NULL);
+}
+
+void fs_largest_walker_deinit(FsLargestWalker* w)
+{
+    fs_largest_walker_cancel(w);
+    fs_largest_free(&w->result);
+    if (w->lock >= 0) sceKernelDeleteMutex(w->lock);
+    w->lock = -1;
+}
+
+int fs_largest_walker_start(FsLargestWalker* w, const char* root)
+{
+    fs_largest_walker_cancel(w);
+    if (w->lock < 0 || (!w->result.cap && fs_largest_init(&w->result, w->n) < 0)) return -1;
+    if (snprintf(w->root, sizeof(w->root), "%s", root) >= (int)sizeof(w->root)) return -1;
+
+    w->files = 0;
+    memset(&w->ctl, 0, sizeof(w->ctl));
+    w->ctl.on_progress = publish;
+    w->ctl.user = w;
+    w->state = FS_LARGEST_RUNNING;
+    w->thread = sceKernelCreateThread("fsa_largest", walker_thread, LARGEST_THREAD_PRIORITY,
+                                      LARGEST_THREAD_STACK, 0, SCE_KERNEL_CPU_MASK_USER_1, NULL);
+    FsLargestWalker* self = w;
+    if (w->thread < 0 || sceKernelStartThread(w->thread, sizeof(self), &self) < 0) {
+        if (w->thread >= 0) sceKernelDeleteThread(w->thread);
+        w->thread = -1;
+        w->state = FS_LARGEST_IDLE;
+        return -1;
+    }
+    return 0;
+}
+
+void fs_largest_walker_cancel(FsLargestWalker* w)
+{
+    if (w->thread < 0) return;
+    w->ctl.cancel = 1;
+    join_worker(w);
+    w->state = FS_LARGEST_IDLE;
+}
+
+// Copies the file count and reports where the walk stands
+FsLargestState fs_largest_walker_poll(FsLargestWalker* w, uint64_t* files)
+{
+    if (files) {
+        sceKernelLockMutex(w->lock, 1, NULL);
+        *files = w->files;
+        sceKernelUnlockMutex(w->lock, 1);
+    }
+    FsLargestState st = (FsLargestState)w->state;
+    if (st != FS_LARGEST_RUNNING) join_worker(w);
+    return st;
+}
+
+// Hands a finished result over by swapping buffers with `out`
+void fs_largest_walker_take(FsLargestWalker* w, FsLargest* out)
+{
+    FsLargest tmp = *out;
+    *out = w->result;
+    w->result = tmp;
+    w->state = FS_LARGEST_IDLE;
+}
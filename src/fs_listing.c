@@ -0,0 +1,399 @@
+#include "fs_listing.h"
+#include "fs_tree.h"
+#include <string.h>
+#include <stdlib.h>
+
+// ---- storage ----------------------------------------------------------------
+
+static uint32_t g_gen;
+
+// Stamps an edited listing, so caches of its rows can tell it changed.
+// Listings are filled on scanner threads as well.
+static void touch(FsListing* l)
+{
+    l->gen = __atomic_add_fetch(&g_gen, 1, __ATOMIC_RELAXED);
+}
+
+void fs_listing_init(FsListing* l)
+{
+    memset(l, 0, sizeof(*l));
+}
+
+void fs_listing_free(FsListing* l)
+{
+    free(l->items);
+    free(l->names);
+    free(l->order);
+    fs_listing_init(l);
+}
+
+// Empties the listing but keeps its buffers for the next folder.
+void fs_listing_clear(FsListing* l)
+{
+    l->tree = NULL;
+    l->first = 0;
+    l->count = 0;
+    l->names_len = 0;
+    l->sort = FS_SORT_SIZE;
+    touch(l);
+}
+
+// Lists `node` straight out of the tree, whose child blocks are already
+// sorted. Stays valid until the tree is rebuilt or freed.
+void fs_listing_view(FsListing* l, const FsTree* t, uint32_t node)
+{
+    fs_listing_clear(l);
+    if (!t || node >= t->node_count) return;
+    l->tree = t;
+    l->first = t->nodes[node].first_child;
+    l->count = t->nodes[node].child_count;
+    touch(l);
+}
+
+int fs_listing_add(FsListing* l, const char* name, uint64_t size_bytes, uint32_t flags)
+{
+    if (l->tree) return -1;
+    uint32_t nl = (uint32_t)strlen(name) + 1;
+    if (l->count == l->cap) {
+        uint32_t cap = l->cap ? l->cap * 2 : 256;
+        FsListItem* items = (FsListItem*)realloc(l->items, (size_t)cap * sizeof(FsListItem));
+        if (!items) return -1;
+        l->items = items;
+        l->cap = cap;
+    }
+    if (l->names_len + nl > l->names_cap) {
+        uint32_t cap = l->names_cap ? l->names_cap : 4096;
+        while (l->names_len + nl > cap) cap *= 2;
+        char* p = (char*)realloc(l->names, cap);
+        if (!p) return -1;
+        l->names = p;
+        l->names_cap = cap;
+    }
+    FsListItem* it = &l->items[l->count++];
+    memcpy(l->names + l->names_len, name, nl);
+    it->name = l->names_len;
+    it->size_bytes = size_bytes;
+    it->flags = flags;
+    l->names_len += nl;
+    touch(l);
+    return 0;
+}
+
+static int cmp_item_desc(const void* a, const void* b)
+{
+    uint64_t x = ((const FsListItem*)a)->size_bytes;
+    uint64_t y = ((const FsListItem*)b)->size_bytes;
+    return (x < y) ? 1 : (x > y) ? -1 : 0;
+}
+
+void fs_listing_sort(FsListing* l)
+{
+    if (!l->tree && l->count > 1) qsort(l->items, l->count, sizeof(FsListItem), cmp_item_desc);
+    l->sort = FS_SORT_SIZE;
+    touch(l);
+}
+
+// ---- re-sorting -------------------------------------------------------------
+
+#define NAME_RUN_SMALL 16
+
+// Stable LSD radix sort of n (key, row) pairs by key ascending, a byte per
+// pass. A byte that is the same in every key is skipped, so keys that only
+// use their low 40 bits take five passes over the rows. Passes swap the
+// arrays with the scratch ones, so key and row end up at the sorted pairs.
+static void radix_sort(uint64_t** key, uint32_t** row, uint64_t** key_tmp, uint32_t** row_tmp, uint32_t n)
+{
+    if (n < 2) return;
+    uint32_t hist[8][256];
+    memset(hist, 0, sizeof(hist));
+    const uint64_t* k = *key;
+    for (uint32_t i = 0; i < n; ++i)
+        for (int b = 0; b < 8; ++b) hist[b][(k[i] >> (b * 8)) & 0xff]++;
+
+    for (int b = 0; b < 8; ++b) {
+        uint32_t* h = hist[b];
+        if (h[((*key)[0] >> (b * 8)) & 0xff] == n) continue;
+        uint32_t sum = 0;
+        for (int d = 0; d < 256; ++d) { uint32_t c = h[d]; h[d] = sum; sum += c; }
+        uint64_t* ks = *key; uint32_t* rs = *row;
+        uint64_t* kd = *key_tmp; uint32_t* rd = *row_tmp;
+        for (uint32_t i = 0; i < n; ++i) {
+            uint32_t at = h[(ks[i] >> (b * 8)) & 0xff]++;
+            kd[at] = ks[i];
+            rd[at] = rs[i];
+        }
+        *key_tmp = ks; *row_tmp = rs;
+        *key = kd; *row = rd;
+    }
+}
+
+static const char* row_name(const FsListing* l, uint32_t r)
+{
+    return l->tree ? fs_tree_name(l->tree, l->first + r) : l->names + l->items[r].name;
+}
+
+// Eight lowercased bytes of a name from `depth` on, first byte highest, zero
+// padded. Two names can only differ further on when the low byte is set.
+static uint64_t name_key(const char* s, uint32_t depth)
+{
+    uint64_t k = 0;
+    for (uint32_t i = 0; i < depth; ++i)
+        if (!s[i]) return 0;
+    s += depth;
+    for (int i = 0; i < 8; ++i) {
+        uint8_t c = (uint8_t)*s;
+        if (c) s++;
+        if (c >= 'A' && c <= 'Z') c = (uint8_t)(c - 'A' + 'a');
+        k = (k << 8) | c;
+    }
+    return k;
+}
+
+// Rows by name, eight bytes at a time: each run of rows that tie on their
+// first bytes is sorted on the next eight, so a folder of IMG_2023... names
+// costs one more pass over that run rather than a comparison sort.
+static int cmp_nocase(const char* a, const char* b)
+{
+    for (;; ++a, ++b) {
+        int x = (uint8_t)*a, y = (uint8_t)*b;
+        if (x >= 'A' && x <= 'Z') x += 'a' - 'A';
+        if (y >= 'A' && y <= 'Z') y += 'a' - 'A';
+        if (x != y || !x) return x - y;
+    }
+}
+
+static void sort_names(const FsListing* l, uint64_t* key, uint32_t* row, uint64_t* key_tmp, uint32_t* row_tmp,
+                       uint32_t n, uint32_t depth)
+{
+    if (n <= NAME_RUN_SMALL) {
+        // A handful of rows is quicker to insert than to bucket; stable as well
+        for (uint32_t i = 1; i < n; ++i) {
+            uint32_t r = row[i], j = i;
+            const char* s = row_name(l, r);
+            while (j > 0 && cmp_nocase(row_name(l, row[j-1]), s) > 0) { row[j] = row[j-1]; --j; }
+            row[j] = r;
+        }
+        return;
+    }
+    for (uint32_t i = 0; i < n; ++i) key[i] = name_key(row_name(l, row[i]), depth);
+    uint64_t* k = key; uint32_t* r = row;
+    uint64_t* kt = key_tmp; uint32_t* rt = row_tmp;
+    radix_sort(&k, &r, &kt, &rt, n);
+    if (r != row) {
+        memcpy(key, k, (size_t)n * sizeof(uint64_t));
+        memcpy(row, r, (size_t)n * sizeof(uint32_t));
+    }
+    for (uint32_t i = 0; i < n;) {
+        uint32_t j = i + 1;
+        while (j < n && key[j] == key[i]) ++j;
+        if (j - i > 1 && (key[i] & 0xff)) sort_names(l, key + i, row + i, key_tmp, row_tmp, j - i, depth + 8);
+        i = j;
+    }
+}
+
+static uint64_t row_key(const FsListing* l, uint32_t r, int key)
+{
+    if (!l->tree) return ~l->items[r].size_bytes;
+    const FsNode* n = &l->tree->nodes[l->first + r];
+    if (key == FS_SORT_COUNT) return 0xFFFFFFFFu - n->files;
+    if (key == FS_SORT_AGE) return n->newest ? n->newest : 0xFFFFFFFFu;
+    return ~n->size_bytes;
+}
+
+// Puts the rows in another order without another comparison sort: by size
+// or file count, largest first, by name, or oldest newest-file first with
+// unknown dates last. Ties keep their order by size. A view only reorders
+// row numbers, from the counts the walk aggregated; owned entries have no
+// counts or dates and only sort by size or name.
+int fs_listing_sort_by(FsListing* l, int key)
+{
+    if (key < 0 || key >= FS_SORT__COUNT) return -1;
+    if (!l->tree && (key == FS_SORT_COUNT || key == FS_SORT_AGE)) return -1;
+    if (l->tree && key == FS_SORT_SIZE) {
+        // The child block itself is in size order
+        l->sort = key;
+        touch(l);
+        return 0;
+    }
+    uint32_t n = l->count;
+    if (l->tree && n > l->order_cap) {
+        uint32_t* order = (uint32_t*)realloc(l->order, (size_t)n * sizeof(uint32_t));
+        if (!order) return -1;
+        l->order = order;
+        l->order_cap = n;
+    }
+    uint64_t* keys = (uint64_t*)malloc((size_t)n * 2 * sizeof(uint64_t) + 1);
+    uint32_t* rows = (uint32_t*)malloc((size_t)n * 2 * sizeof(uint32_t) + 1);
+    FsListItem* items = l->tree ? NULL : (FsListItem*)malloc((size_t)n * sizeof(FsListItem) + 1);
+    if (!keys || !rows || (!l->tree && !items)) { free(keys); free(rows); free(items); return -1; }
+
+    // Views start from the size order, so equal keys stay largest first
+    for (uint32_t i = 0; i < n; ++i) rows[i] = i;
+    uint64_t* k = keys; uint32_t* r = rows;
+    if (key == FS_SORT_NAME) {
+        sort_names(l, keys, rows, keys + n, rows + n, n, 0);
+    } else {
+        for (uint32_t i = 0; i < n; ++i) keys[i] = row_key(l, i, key);
+        uint64_t* kt = keys + n; uint32_t* rt = rows + n;
+        radix_sort(&k, &r, &kt, &rt, n);
+    }
+    if (l->tree) {
+        if (n) memcpy(l->order, r, (size_t)n * sizeof(uint32_t));
+    } else {
+        for (uint32_t i = 0; i < n; ++i) items[i] = l->items[r[i]];
+        if (n) memcpy(l->items, items, (size_t)n * sizeof(FsListItem));
+    }
+    free(keys);
+    free(rows);
+    free(items);
+    l->sort = key;
+    touch(l);
+    return 0;
+}
+
+const char* fs_sort_name(int key)
+{
+    static const char* names[FS_SORT__COUNT] = { "size", "files", "name", "age" };
+    return (key >= 0 && key < FS_SORT__COUNT) ? names[key] : "";
+}
+
+// Deep copy; a view is copied as a view.
+int fs_listing_copy(FsListing* dst, const FsListing* src)
+{
+    fs_listing_clear(dst);
+    if (src->tree) {
+        if (src->sort != FS_SORT_SIZE && src->count > dst->order_cap) {
+            uint32_t* order = (uint32_t*)realloc(dst->order, (size_t)src->count * sizeof(uint32_t));
+            if (!order) return -1;
+            dst->order = order;
+            dst->order_cap = src->count;
+        }
+        if (src->sort != FS_SORT_SIZE && src->count)
+            memcpy(dst->order, src->order, (size_t)src->count * sizeof(uint32_t));
+        dst->tree = src->tree;
+        dst->first = src->first;
+        dst->count = src->count;
+        dst->sort = src->sort;
+        touch(dst);
+        return 0;
+    }
+    if (src->count > dst->cap) {
+        FsListItem* items = (FsListItem*)realloc(dst->items, (size_t)src->count * sizeof(FsListItem));
+        if (!items) return -1;
+        dst->items = items;
+        dst->cap = src->count;
+    }
+    if (src->names_len > dst->names_cap) {
+        char* p = (char*)realloc(dst->names, src->names_len);
+        if (!p) return -1;
+        dst->names = p;
+        dst->names_cap = src->names_len;
+    }
+    if (src->count) memcpy(dst->items, src->items, (size_t)src->count * sizeof(FsListItem));
+    if (src->names_len) memcpy(dst->names, src->names, src->names_len);
+    dst->count = src->count;
+    dst->names_len = src->names_len;
+    dst->sort = src->sort;
+    touch(dst);
+    return 0;
+}
+
+// ---- rows -------------------------------------------------------------------
+
+// Tree node of row i of a view
+static uint32_t view_node(const FsListing* l, uint32_t i)
+{
+    return l->first + (l->sort != FS_SORT_SIZE ? l->order[i] : i);
+}
+
+const char* fs_listing_name(const FsListing* l, uint32_t i)
+{
+    if (i >= l->count) return "";
+    if (l->tree) return fs_tree_name(l->tree, view_node(l, i));
+    return l->names + l->items[i].name;
+}
+
+uint64_t fs_listing_size(const FsListing* l, uint32_t i)
+{
+    if (i >= l->count) return 0;
+    if (l->tree) return l->tree->nodes[view_node(l, i)].size_bytes;
+    return l->items[i].size_bytes;
+}
+
+int fs_listing_is_dir(const FsListing* l, uint32_t i)
+{
+    if (i >= l->count) return 0;
+    if (l->tree) return (l->tree->nodes[view_node(l, i)].flags & FS_NODE_DIR) != 0;
+    return (l->items[i].flags & FS_ENTRY_DIR) != 0;
+}
+
+// Tree node behind row i, FS_TREE_NONE for owned entries
+uint32_t fs_listing_node(const FsListing* l, uint32_t i)
+{
+    return (l->tree && i < l->count) ? view_node(l, i) : FS_TREE_NONE;
+}
+
+// Files below row i; owned entries only know whether they are one
+uint32_t fs_listing_files(const FsListing* l, uint32_t i)
+{
+    if (i >= l->count) return 0;
+    if (l->tree) return l->tree->nodes[view_node(l, i)].files;
+    return (l->items[i].flags & FS_ENTRY_DIR) ? 0 : 1;
+}
+
+// Latest file mtime below row i, 0 if unknown
+uint32_t fs_listing_newest(const FsListing* l, uint32_t i)
+{
+    if (i >= l->count || !l->tree) return 0;
+    return l->tree->nodes[view_node(l, i)].newest;
+}
+
+// ---- top-K selection --------------------------------------------------------
+
+#define TOPK_KEY(i) (*(const uint64_t*)((const char*)keys + (size_t)(i) * stride))
+
+static void heap_sift_down(const uint64_t* keys, size_t stride, uint32_t* heap, uint32_t n, uint32_t i)
+{
+    for (;;) {
+        uint32_t l = 2 * i + 1, r = l + 1, m = i;
+        if (l < n && TOPK_KEY(heap[l]) < TOPK_KEY(heap[m])) m = l;
+        if (r < n && TOPK_KEY(heap[r]) < TOPK_KEY(heap[m])) m = r;
+        if (m == i) return;
+        uint32_t tmp = heap[i]; heap[i] = heap[m]; heap[m] = tmp;
+        i = m;
+    }
+}
+
+// Writes the indices of the k largest of n strided uint64_t keys to out,
+// largest first, in O(n log k). `keys` points at the first element's key, so
+// any array of structs with a size field can be ranked in place.
+uint32_t fs_top_k(const uint64_t* keys, size_t stride, uint32_t n, uint32_t k, uint32_t* out)
+{
+    if (k > n) k = n;
+    if (k == 0) return 0;
+
+    // Min-heap of the best k seen so far; the root is the one to beat
+    uint32_t h = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+        if (h < k) {
+            uint32_t c = h++;
+            out[c] = i;
+            while (c > 0) {
+                uint32_t p = (c - 1) / 2;
+                if (TOPK_KEY(out[p]) <= TOPK_KEY(out[c])) break;
+                uint32_t tmp = out[p]; out[p] = out[c]; out[c] = tmp;
+                c = p;
+            }
+        } else if (TOPK_KEY(i) > TOPK_KEY(out[0])) {
+            out[0] = i;
+            heap_sift_down(keys, stride, out, h, 0);
+        }
+    }
+
+    // Pop the minimum to the back until the array runs largest first
+    for (uint32_t end = h; end > 1; --end) {
+        uint32_t tmp = out[0]; out[0] = out[end-1]; out[end-1] = tmp;
+        heap_sift_down(keys, stride, out, end - 1, 0);
+    }
+    return h;
+}
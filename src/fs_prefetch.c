@@ -0,0 +1,199 @@
+#include "fs_prefetch.h"
+#include <psp2/kernel/threadmgr.h>
+#include <string.h>
+
+#define PREFETCH_THREAD_PRIORITY (0x10000100 + 30)
+#define PREFETCH_THREAD_STACK    (32 * 1024)
+
+// ---- cache ------------------------------------------------------------------
+
+static size_t stats_bytes(const FsTypeStats* s)
+{
+    return (size_t)s->ext_cap * sizeof(FsExtStat) + (size_t)s->child_cap * FS_CAT_COUNT * sizeof(uint64_t);
+}
+
+// Under lock
+static FsStatsEntry* find(FsPrefetcher* p, const FsTree* t, uint32_t gen, uint32_t node)
+{
+    for (int i = 0; i < FS_PREFETCH_SLOTS; ++i) {
+        FsStatsEntry* e = &p->entries[i];
+        if (e->valid && e->tree == t && e->gen == gen && e->node == node) return e;
+    }
+    return NULL;
+}
+
+// Least recently used entry that is not on screen, empty ones first
+static FsStatsEntry* victim(FsPrefetcher* p, const FsStatsEntry* keep)
+{
+    FsStatsEntry* v = NULL;
+    for (int i = 0; i < FS_PREFETCH_SLOTS; ++i) {
+        FsStatsEntry* e = &p->entries[i];
+        if (e->pinned || e == keep) continue;
+        if (!e->valid) return e;
+        if (!v || e->used < v->used) v = e;
+    }
+    return v;
+}
+
+// Under lock. Swaps a computed breakdown into the cache, so the scratch
+// gets the evicted entry's buffers to reuse, then frees the least recently
+// used entries until the cache fits its budget again.
+static FsStatsEntry* insert(FsPrefetcher* p, const FsTree* t, uint32_t gen, uint32_t node, FsTypeStats* s)
+{
+    // Computed twice: the entry may be on screen, so it stays as it is
+    FsStatsEntry* e = find(p, t, gen, node);
+    if (e) return e;
+    e = victim(p, NULL);
+    if (!e) return NULL;
+    if (e->valid) p->bytes -= stats_bytes(&e->stats);
+    FsTypeStats tmp = e->stats; e->stats = *s; *s = tmp;
+    e->tree = t;
+    e->gen = gen;
+    e->node = node;
+    e->valid = 1;
+    e->used = ++p->clock;
+    p->bytes += stats_bytes(&e->stats);
+
+    FsStatsEntry* v;
+    while (p->bytes > FS_PREFETCH_BUDGET && (v = victim(p, e)) && v->valid) {
+        p->bytes -= stats_bytes(&v->stats);
+        fs_type_stats_free(&v->stats);
+        v->valid = 0;
+    }
+    return e;
+}
+
+// ---- worker -----------------------------------------------------------------
+
+// Breakdowns for the queued folders, next first, until the queue is empty
+// or on cancel, which also stops the folder being added up. Jobs whose tree
+// changed since the hint are dropped.
+static int prefetch_thread(SceSize args, void* argp)
+{
+    (void)args;
+    FsPrefetcher* p = *(FsPrefetcher**)argp;
+    for (;;) {
+        sceKernelLockMutex(p->lock, 1, NULL);
+        if (!p->queued || p->cancel) {
+            p->active = 0;
+            sceKernelUnlockMutex(p->lock, 1);
+            break;
+        }
+        FsPrefetchJob job = p->queue[0];
+        memmove(p->queue, p->queue + 1, --p->queued * sizeof(FsPrefetchJob));
+        int skip = job.tree->gen != job.gen || find(p, job.tree, job.gen, job.node) != NULL;
+        sceKernelUnlockMutex(p->lock, 1);
+        if (skip) continue;
+
+        if (fs_tree_type_stats(job.tree, job.node, &p->scratch[0], &p->cancel) < 0) continue;
+        sceKernelLockMutex(p->lock, 1, NULL);
+        if (insert(p, job.tree, job.gen, job.node, &p->scratch[0])) p->prefetched++;
+        sceKernelUnlockMutex(p->lock, 1);
+    }
+    return 0;
+}
+
+static void join_worker(FsPrefetcher* p)
+{
+    if (p->thread < 0) return;
+    sceKernelWaitThreadEnd(p->thread, NULL, NULL);
+    sceKernelDeleteThread(p->thread);
+    p->thread = -1;
+}
+
+static int start_worker(FsPrefetcher* p)
+{
+    join_worker(p);
+    p->cancel = 0;
+    p->thread = sceKernelCreateThread("fsa_prefetch", prefetch_thread, PREFETCH_THREAD_PRIORITY,
+                                      PREFETCH_THREAD_STACK, 0, SCE_KERNEL_CPU_MASK_USER_1, NULL);
+    FsPrefetcher* self = p;
+    if (p->thread < 0 || sceKernelStartThread(p->thread, sizeof(self), &self) < 0) {
+        if (p->thread >= 0) sceKernelDeleteThread(p->thread);
+        p->thread = -1;
+        p->active = 0;
+        return -1;
+    }
+    return 0;
+}
+
+// ---- public API -------------------------------------------------------------
+
+void fs_prefetcher_init(FsPrefetcher* p)
+{
+    memset(p, 0, sizeof(*p));
+    p->thread = -1;
+    p->lock = sceKernelCreateMutex("fsa_prefetch_lock", 0, 0, NULL);
+}
+
+void fs_prefetcher_deinit(FsPrefetcher* p)
+{
+    p->cancel = 1;
+    join_worker(p);
+    for (int i = 0; i < FS_PREFETCH_SLOTS; ++i) fs_type_stats_free(&p->entries[i].stats);
+    fs_type_stats_free(&p->scratch[0]);
+    fs_type_stats_free(&p->scratch[1]);
+    if (p->lock >= 0) sceKernelDeleteMutex(p->lock);
+    p->lock = -1;
+}
+
+// Replaces the queue with the folders most likely to be opened next, most
+// likely first. Folders already cached are left alone.
+void fs_prefetcher_hint(FsPrefetcher* p, const FsTree* t, const uint32_t* nodes, int count)
+{
+    if (!p || p->lock < 0 || !t) return;
+    sceKernelLockMutex(p->lock, 1, NULL);
+    p->queued = 0;
+    for (int i = 0; i < count && p->queued < FS_PREFETCH_QUEUE; ++i) {
+        if (nodes[i] >= t->node_count || find(p, t, t->gen, nodes[i])) continue;
+        p->queue[p->queued++] = (FsPrefetchJob){ t, t->gen, nodes[i] };
+    }
+    int start = p->queued && !p->active;
+    if (start) p->active = 1;
+    sceKernelUnlockMutex(p->lock, 1);
+    if (start) start_worker(p);
+}
+
+// Breakdown of `node` for the screen, from the cache or computed right here.
+// The result stays valid until the next acquire, which unpins it.
+const FsTypeStats* fs_prefetcher_acquire(FsPrefetcher* p, const FsTree* t, uint32_t node)
+{
+    if (!p || p->lock < 0 || !t || node >= t->node_count) return NULL;
+    sceKernelLockMutex(p->lock, 1, NULL);
+    for (int i = 0; i < FS_PREFETCH_SLOTS; ++i) p->entries[i].pinned = 0;
+    FsStatsEntry* e = find(p, t, t->gen, node);
+    if (e) {
+        e->pinned = 1;
+        e->used = ++p->clock;
+        p->hits++;
+        sceKernelUnlockMutex(p->lock, 1);
+        return &e->stats;
+    }
+    p->misses++;
+    sceKernelUnlockMutex(p->lock, 1);
+
+    if (fs_tree_type_stats(t, node, &p->scratch[1], NULL) < 0) return NULL;
+    sceKernelLockMutex(p->lock, 1, NULL);
+    e = insert(p, t, t->gen, node, &p->scratch[1]);
+    if (e) e->pinned = 1;
+    sceKernelUnlockMutex(p->lock, 1);
+    return e ? &e->stats : NULL;
+}
+
+// Stops the worker reading `t` and drops its queued folders; call before the
+// tree is changed or freed. Other trees' folders are picked up again.
+void fs_prefetcher_release(FsPrefetcher* p, const FsTree* t)
+{
+    if (!p || p->lock < 0) return;
+    p->cancel = 1;
+    join_worker(p);
+    p->active = 0;
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < p->queued; ++i)
+        if (p->queue[i].tree != t) p->queue[n++] = p->queue[i];
+    p->queued = n;
+    if (n) {
+        p->active = 1;
+        start_worker(p);
+    }
+}
@@ -0,0 +1,359 @@
+#include "fs_purge.h"
+#include "fs_iter.h"
+#include "fs_io.h"
+#include "fs_tree.h"
+#include <psp2/kernel/threadmgr.h>
+#include <psp2/kernel/processmgr.h>
+#include <string.h>
+#include <stdio.h>
+
+#define PURGE_THREAD_PRIORITY (0x10000100 + 20)
+#define PURGE_THREAD_STACK    (64 * 1024)
+#define PURGE_BATCH           64   // removals between progress updates and cancel checks
+#define PURGE_NAME_MAX        1024
+#define PURGE_RELEASE_WAIT_US 1000 // between checks for a cancelled cache write to stop
+
+// ---- worker -----------------------------------------------------------------
+
+// Adds a batch to the progress. Returns 1 when a cache write is waiting,
+// which the worker takes before going on with its job.
+static int publish(FsPurger* p, uint64_t* entries, uint64_t* bytes, uint32_t* errors)
+{
+    sceKernelLockMutex(p->lock, 1, NULL);
+    p->progress.entries += *entries;
+    p->progress.bytes += *bytes;
+    p->progress.errors += *errors;
+    int save = p->save_tree != NULL;
+    sceKernelUnlockMutex(p->lock, 1);
+    *entries = *bytes = 0;
+    *errors = 0;
+    return save;
+}
+
+// Removes one job folder bottom-up, or a single entry deleted in place. A
+// child that cannot be removed is counted and skipped rather than ending the
+// job; its folders then stay behind too. Returns 0 when the job stopped part
+// way, on cancel or for a cache write; what is left is picked up again later.
+static int purge_job(FsPurger* p, const char* job)
+{
+    uint64_t entries = 0, bytes = 0;
+    uint32_t errors = 0, batch = 0;
+
+    FsIter it;
+    if (fs_iter_open(&it, job, 0) < 0) {
+        if (fs_io_remove(job) < 0) errors++;
+        else entries++;
+        publish(p, &entries, &bytes, &errors);
+        return 1;
+    }
+
+    int stopped = 0;
+    FsIterEvent ev;
+    while ((ev = fs_iter_next(&it)) != FS_ITER_END) {
+        if (ev == FS_ITER_FILE) {
+            if (fs_io_remove(it.path) < 0) errors++;
+            else { entries++; bytes += it.size; }
+        } else if (ev == FS_ITER_DIR_DONE) {
+            if (fs_io_rmdir(it.path) < 0) errors++;
+            else entries++;
+        } else {
+            continue;
+        }
+        if (++batch < PURGE_BATCH) continue;
+        batch = 0;
+        if (publish(p, &entries, &bytes, &errors) || p->cancel) { stopped = 1; break; }
+    }
+    errors += it.errors;
+    fs_iter_close(&it);
+    if (!stopped && fs_io_rmdir(job) < 0) errors++;
+    publish(p, &entries, &bytes, &errors);
+    return !stopped;
+}
+
+// Writes the tree cache handed over by fs_purger_save. The tree stays the
+// UI's: fs_purger_release cancels the write before it changes.
+static void save_cache(FsPurger* p)
+{
+    const struct FsTree* tree = p->save_tree;
+    char path[FS_PURGE_PATH];
+    memcpy(path, p->save_path, sizeof(path));
+    p->save_tree = NULL;
+    p->saving = tree;
+    p->save_cancel = 0;
+    sceKernelUnlockMutex(p->lock, 1);
+
+    fs_tree_save(tree, path, &p->save_cancel);
+
+    sceKernelLockMutex(p->lock, 1, NULL);
+    p->saving = NULL;
+}
+
+// Works through the queue, head first; a job leaves the queue once it is
+// gone from the disk. A waiting cache write goes before the next job.
+// Exits when there is nothing left to do or on cancel.
+static int purge_thread(SceSize args, void* argp)
+{
+    (void)args;
+    FsPurger* p = *(FsPurger**)argp;
+    char job[FS_PURGE_PATH];
+    for (;;) {
+        sceKernelLockMutex(p->lock, 1, NULL);
+        while (p->save_tree && !p->cancel) save_cache(p);
+        if (!p->count || p->cancel) {
+            p->active = 0;
+            sceKernelUnlockMutex(p->lock, 1);
+            break;
+        }
+        memcpy(job, p->jobs[p->head], sizeof(job));
+        sceKernelUnlockMutex(p->lock, 1);
+
+        int done = purge_job(p, job);
+
+        sceKernelLockMutex(p->lock, 1, NULL);
+        if (done) {
+            p->head = (p->head + 1) % FS_PURGE_JOBS;
+            p->count--;
+            p->progress.jobs = p->count;
+        }
+        sceKernelUnlockMutex(p->lock, 1);
+    }
+    return 0;
+}
+
+static void join_worker(FsPurger* p)
+{
+    if (p->thread < 0) return;
+    sceKernelWaitThreadEnd(p->thread, NULL, NULL);
+    sceKernelDeleteThread(p->thread);
+    p->thread = -1;
+}
+
+static int start_worker(FsPurger* p)
+{
+    join_worker(p);
+    p->cancel = 0;
+    p->thread = sceKernelCreateThread("fsa_purge", purge_thread, PURGE_THREAD_PRIORITY,
+                                      PURGE_THREAD_STACK, 0, SCE_KERNEL_CPU_MASK_USER_1, NULL);
+    FsPurger* self = p;
+    if (p->thread < 0 || sceKernelStartThread(p->thread, sizeof(self), &self) < 0) {
+        if (p->thread >= 0) sceKernelDeleteThread(p->thread);
+        p->thread = -1;
+        p->active = 0;
+        return -1;
+    }
+    return 0;
+}
+
+// Adds a job folder to the queue and wakes the worker. Fails when the queue
+// is full or the worker cannot start; the job is then not queued, and a
+// folder already in the trash waits there for fs_purger_resume.
+static int queue_job(FsPurger* p, const char* job, uint64_t bytes)
+{
+    if (strlen(job) >= FS_PURGE_PATH) return -1;
+    sceKernelLockMutex(p->lock, 1, NULL);
+    if (p->count == FS_PURGE_JOBS) {
+        sceKernelUnlockMutex(p->lock, 1);
+        return -1;
+    }
+    if (!p->count) {
+        uint32_t errors = p->progress.errors;
+        memset(&p->progress, 0, sizeof(p->progress));
+        p->progress.errors = errors;
+    }
+    uint32_t slot = (p->head + p->count) % FS_PURGE_JOBS;
+    memcpy(p->jobs[slot], job, strlen(job) + 1);
+    p->count++;
+    p->progress.jobs = p->count;
+    p->progress.total_bytes += bytes;
+    int start = !p->active;
+    if (start) p->active = 1;
+    sceKernelUnlockMutex(p->lock, 1);
+    if (!start || start_worker(p) == 0) return 0;
+
+    // No worker is running, so the job is still the last one queued
+    sceKernelLockMutex(p->lock, 1, NULL);
+    p->count--;
+    p->progress.jobs = p->count;
+    p->progress.total_bytes -= bytes;
+    sceKernelUnlockMutex(p->lock, 1);
+    return -1;
+}
+
+static int queue_full(FsPurger* p)
+{
+    sceKernelLockMutex(p->lock, 1, NULL);
+    int full = p->count == FS_PURGE_JOBS;
+    sceKernelUnlockMutex(p->lock, 1);
+    return full;
+}
+
+static void trash_dir(const char* part_root, char* out, int outsz)
+{
+    size_t n = strlen(part_root);
+    snprintf(out, outsz, "%s%s%s", part_root, (n && part_root[n-1] == '/') ? "" : "/", FS_TRASH_DIR);
+}
+
+// Where entry i of a trash call goes inside its job folder. Fails when the
+// name does not fit.
+static int job_entry(const char* job, int i, const char* path, char* out, size_t outsz)
+{
+    const char* base = strrchr(path, '/');
+    base = base ? base + 1 : path;
+    int n = snprintf(out, outsz, "%s/%d_%s", job, i, base);
+    return (n < 0 || (size_t)n >= outsz) ? -1 : 0;
+}
+
+// ---- public API -------------------------------------------------------------
+
+int fs_is_trash(const char* name)
+{
+    return strcmp(name, FS_TRASH_DIR) == 0;
+}
+
+void fs_purger_init(FsPurger* p)
+{
+    memset(p, 0, sizeof(*p));
+    p->thread = -1;
+    p->lock = sceKernelCreateMutex("fsa_purge_lock", 0, 0, NULL);
+}
+
+void fs_purger_deinit(FsPurger* p)
+{
+    fs_purger_cancel(p);
+    if (p->lock >= 0) sceKernelDeleteMutex(p->lock);
+    p->lock = -1;
+}
+
+// Moves `count` entries of one partition into a new job folder of its trash
+// and queues the job. `moved[i]` tells whether entry i left its folder; an
+// entry that could not be renamed is left untouched. Returns how many moved,
+// or -1 when the job cannot be made or queued: the entries are then moved
+// back, and any that could not be stay in the trash for fs_purger_resume.
+int fs_purger_trash(FsPurger* p, const char* part_root, const char* const* paths, const uint64_t* sizes,
+                    int count, int* moved)
+{
+    if (!p || p->lock < 0 || !part_root || !paths || count <= 0) return -1;
+    if (moved) memset(moved, 0, (size_t)count * sizeof(*moved));
+    if (queue_full(p)) return -1;
+
+    char trash[FS_PURGE_PATH], job[FS_PURGE_PATH], dest[PURGE_NAME_MAX];
+    trash_dir(part_root, trash, sizeof(trash));
+    fs_io_mkdir(trash, 0777);
+    int jn = snprintf(job, sizeof(job), "%s/%08x%04x", trash, (unsigned)sceKernelGetProcessTimeWide(),
+                      p->serial++ & 0xFFFF);
+    if (jn < 0 || (size_t)jn >= sizeof(job) || fs_io_mkdir(job, 0777) < 0) return -1;
+
+    int n = 0;
+    uint64_t bytes = 0;
+    for (int i = 0; i < count; ++i) {
+        int ok = job_entry(job, i, paths[i], dest, sizeof(dest)) == 0 && fs_io_rename(paths[i], dest) >= 0;
+        if (moved) moved[i] = ok;
+        if (!ok) continue;
+        n++;
+        if (sizes) bytes += sizes[i];
+    }
+    if (n && queue_job(p, job, bytes) == 0) return n;
+
+    // Not queued: put everything back rather than leave it for the next launch
+    for (int i = 0; n && i < count; ++i) {
+        if (moved && !moved[i]) continue;
+        if (job_entry(job, i, paths[i], dest, sizeof(dest)) == 0 && fs_io_rename(dest, paths[i]) >= 0 && moved)
+            moved[i] = 0;
+    }
+    fs_io_rmdir(job);
+    return n ? -1 : 0;
+}
+
+// Queues whatever an earlier run left in the partition's trash.
+int fs_purger_resume(FsPurger* p, const char* part_root)
+{
+    if (!p || p->lock < 0 || !part_root) return -1;
+    char trash[FS_PURGE_PATH], job[FS_PURGE_PATH];
+    trash_dir(part_root, trash, sizeof(trash));
+    SceUID d = fs_io_dopen(trash);
+    if (d < 0) return 0;
+
+    int n = 0;
+    SceIoDirent de;
+    memset(&de, 0, sizeof(de));
+    while (fs_io_dread(d, &de) > 0) {
+        if (!strcmp(de.d_name, ".") || !strcmp(de.d_name, "..")) continue;
+        int jn = snprintf(job, sizeof(job), "%s/%s", trash, de.d_name);
+        if (jn < 0 || (size_t)jn >= sizeof(job)) continue;
+        if (queue_job(p, job, 0) < 0) break;
+        n++;
+    }
+    fs_io_dclose(d);
+    return n;
+}
+
+// Queues `path` to be removed where it is, for an entry that could not be
+// trashed. The job does not survive a cancel: fs_purger_resume only finds
+// what is in the trash. Fails when the queue is full.
+int fs_purger_delete(FsPurger* p, const char* path, uint64_t bytes)
+{
+    if (!p || p->lock < 0 || !path) return -1;
+    return queue_job(p, path, bytes);
+}
+
+// Writes `tree` to the cache file `path` on the worker, ahead of any queued
+// job. A newer write replaces one that has not started yet.
+int fs_purger_save(FsPurger* p, const struct FsTree* tree, const char* path)
+{
+    if (!p || p->lock < 0 || !tree || !path || strlen(path) >= FS_PURGE_PATH) return -1;
+    sceKernelLockMutex(p->lock, 1, NULL);
+    p->save_tree = tree;
+    memcpy(p->save_path, path, strlen(path) + 1);
+    int start = !p->active;
+    if (start) p->active = 1;
+    sceKernelUnlockMutex(p->lock, 1);
+    if (!start || start_worker(p) == 0) return 0;
+    sceKernelLockMutex(p->lock, 1, NULL);
+    p->save_tree = NULL;
+    sceKernelUnlockMutex(p->lock, 1);
+    return -1;
+}
+
+// Call before changing or freeing `tree`: drops a cache write of it that has
+// not started and cancels one that has, waiting until the worker lets go.
+void fs_purger_release(FsPurger* p, const struct FsTree* tree)
+{
+    if (!p || p->lock < 0) return;
+    sceKernelLockMutex(p->lock, 1, NULL);
+    if (p->save_tree == tree) p->save_tree = NULL;
+    int busy = p->saving == tree;
+    if (busy) p->save_cancel = 1;
+    sceKernelUnlockMutex(p->lock, 1);
+    while (busy) {
+        sceKernelDelayThread(PURGE_RELEASE_WAIT_US);
+        sceKernelLockMutex(p->lock, 1, NULL);
+        busy = p->saving == tree;
+        sceKernelUnlockMutex(p->lock, 1);
+    }
+}
+
+// Stops after the current batch; unfinished jobs stay in the trash, and a
+// cache write in progress is abandoned.
+void fs_purger_cancel(FsPurger* p)
+{
+    if (!p || p->thread < 0) return;
+    p->cancel = 1;
+    p->save_cancel = 1;
+    join_worker(p);
+    p->active = 0;
+    p->save_tree = NULL;
+}
+
+// Copies the progress; returns 1 while jobs are queued or running. A cache
+// write alone does not count.
+int fs_purger_poll(FsPurger* p, FsPurgeProgress* out)
+{
+    if (!p || p->lock < 0) return 0;
+    sceKernelLockMutex(p->lock, 1, NULL);
+    if (out) *out = p->progress;
+    int busy = p->count > 0;
+    int idle = !p->active;
+    sceKernelUnlockMutex(p->lock, 1);
+    if (idle) join_worker(p);
+    return busy;
+}
@@ -0,0 +1,410 @@
+#include "fs_report.h"
+#include "fs_io.h"
+#include <psp2/io/fcntl.h>
+#include <psp2/kernel/threadmgr.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#define REPORT_PATH_MAX       4096
+#define REPORT_CHUNK          512   // string bytes escaped per buffer check
+#define CANCEL_EVERY          4096  // rows between cancel checks
+#define EXPORT_THREAD_PRIORITY (0x10000100 + 30)
+#define EXPORT_THREAD_STACK   (32 * 1024)
+
+// ---- writer -----------------------------------------------------------------
+
+static void flush(FsReport* r)
+{
+    if (r->len && !r->err && fs_io_write(r->fd, r->buf, r->len) != (int)r->len) r->err = 1;
+    r->bytes += r->len;
+    r->len = 0;
+}
+
+static char* reserve(FsReport* r, uint32_t n)
+{
+    if (r->len + n > FS_REPORT_BUF) flush(r);
+    return r->buf + r->len;
+}
+
+static void put_raw(FsReport* r, const char* s, uint32_t n)
+{
+    memcpy(reserve(r, n), s, n);
+    r->len += n;
+}
+
+static void put_u64(FsReport* r, uint64_t v)
+{
+    char tmp[20];
+    uint32_t n = 0;
+    do { tmp[n++] = (char)('0' + v % 10); v /= 10; } while (v);
+    char* p = reserve(r, n);
+    for (uint32_t i = 0; i < n; ++i) p[i] = tmp[n - 1 - i];
+    r->len += n;
+}
+
+static const char HEX[] = "0123456789abcdef";
+
+// A JSON string body: quotes, backslashes and control bytes escaped, UTF-8
+// passed through
+static void put_json_str(FsReport* r, const char* s, size_t len)
+{
+    while (len > 0) {
+        uint32_t n = len < REPORT_CHUNK ? (uint32_t)len : REPORT_CHUNK;
+        char* p = reserve(r, n * 6);
+        char* o = p;
+        for (uint32_t i = 0; i < n; ++i) {
+            uint8_t c = (uint8_t)s[i];
+            if (c >= 0x20 && c != '"' && c != '\\') { *o++ = (char)c; continue; }
+            *o++ = '\\';
+            if (c == '"' || c == '\\') { *o++ = (char)c; continue; }
+            *o++ = 'u'; *o++ = '0'; *o++ = '0';
+            *o++ = HEX[c >> 4]; *o++ = HEX[c & 15];
+        }
+        r->len += (uint32_t)(o - p);
+        s += n;
+        len -= n;
+    }
+}
+
+// A CSV field, quoted only when it holds a separator, a quote or a line break
+static void put_csv_str(FsReport* r, const char* s, size_t len)
+{
+    if (!memchr(s, ',', len) && !memchr(s, '"', len) && !memchr(s, '\n', len) && !memchr(s, '\r', len)) {
+        while (len > 0) {
+            uint32_t n = len < REPORT_CHUNK ? (uint32_t)len : REPORT_CHUNK;
+            put_raw(r, s, n);
+            s += n;
+            len -= n;
+        }
+        return;
+    }
+    put_raw(r, "\"", 1);
+    while (len > 0) {
+        uint32_t n = len < REPORT_CHUNK ? (uint32_t)len : REPORT_CHUNK;
+        char* p = reserve(r, n * 2);
+        char* o = p;
+        for (uint32_t i = 0; i < n; ++i) {
+            if (s[i] == '"') *o++ = '"';
+            *o++ = s[i];
+        }
+        r->len += (uint32_t)(o - p);
+        s += n;
+        len -= n;
+    }
+    put_raw(r, "\"", 1);
+}
+
+// ---- rows -------------------------------------------------------------------
+
+// Field `i` of a row with the given JSON key
+static void key(FsReport* r, int i, const char* name)
+{
+    if (r->format == FS_REPORT_CSV) {
+        if (i) put_raw(r, ",", 1);
+        return;
+    }
+    char* p = reserve(r, 64);
+    uint32_t n = 0;
+    p[n++] = i ? ',' : '{';
+    p[n++] = '"';
+    for (const char* k = name; *k; ++k) p[n++] = *k;
+    p[n++] = '"';
+    p[n++] = ':';
+    r->len += n;
+}
+
+static void field_str(FsReport* r, int i, const char* name, const char* s, size_t len)
+{
+    key(r, i, name);
+    if (r->format == FS_REPORT_CSV) { put_csv_str(r, s, len); return; }
+    put_raw(r, "\"", 1);
+    put_json_str(r, s, len);
+    put_raw(r, "\"", 1);
+}
+
+static void field_u64(FsReport* r, int i, const char* name, uint64_t v)
+{
+    key(r, i, name);
+    put_u64(r, v);
+}
+
+static void end_row(FsReport* r)
+{
+    if (r->format == FS_REPORT_CSV) put_raw(r, "\n", 1);
+    else put_raw(r, "}\n", 2);
+    r->rows++;
+}
+
+static void header(FsReport* r, const char* line)
+{
+    if (r->format == FS_REPORT_CSV) put_raw(r, line, (uint32_t)strlen(line));
+}
+
+// One entry of a tree or an index
+static void entry_row(FsReport* r, const char* path, size_t len, int is_dir, uint64_t size, uint32_t mtime, uint32_t depth)
+{
+    field_str(r, 0, "path", path, len);
+    field_str(r, 1, "type", is_dir ? "dir" : "file", is_dir ? 3 : 4);
+    field_u64(r, 2, "size", size);
+    field_u64(r, 3, "mtime", mtime);
+    field_u64(r, 4, "depth", depth);
+    end_row(r);
+}
+
+#define ENTRY_HEADER "path,type,size,mtime,depth\n"
+
+// ---- public API -------------------------------------------------------------
+
+int fs_report_open(FsReport* r, SceUID fd, int format)
+{
+    memset(r, 0, sizeof(*r));
+    r->fd = fd;
+    r->format = format;
+    r->buf = (char*)malloc(FS_REPORT_BUF);
+    return r->buf ? 0 : -1;
+}
+
+// Writes out what is buffered. The file stays open.
+int fs_report_close(FsReport* r)
+{
+    if (r->buf) flush(r);
+    free(r->buf);
+    r->buf = NULL;
+    return r->err ? -1 : 0;
+}
+
+// Every entry below `node` and the node itself in pre-order, with its full
+// path. Nothing is collected: rows are formatted as the walk reaches them.
+int fs_report_tree(FsReport* r, const FsTree* t, uint32_t node, volatile int* cancel)
+{
+    if (!t || node >= t->node_count) return -1;
+    typedef struct { uint32_t node, next, path_len; } Frame;
+    char* path = (char*)malloc(REPORT_PATH_MAX);
+    uint32_t cap = 64, depth = 0;
+    Frame* stack = (Frame*)malloc(cap * sizeof(Frame));
+    if (!path || !stack || fs_tree_path(t, node, path, REPORT_PATH_MAX) < 0) { free(path); free(stack); return -1; }
+
+    header(r, ENTRY_HEADER);
+    uint32_t len = (uint32_t)strlen(path);
+    const FsNode* root = &t->nodes[node];
+    entry_row(r, path, len, (root->flags & FS_NODE_DIR) != 0, root->size_bytes, root->mtime, 0);
+    if (len > 0 && path[len - 1] == '/') len--;
+    stack[depth++] = (Frame){ node, root->first_child, len };
+    if (!(root->flags & FS_NODE_DIR)) depth = 0;
+
+    int res = 0;
+    uint64_t rows = 0;
+    while (depth > 0 && !r->err) {
+        Frame* f = &stack[depth - 1];
+        const FsNode* d = &t->nodes[f->node];
+        if (f->next == d->first_child + d->child_count) { depth--; continue; }
+        uint32_t c = f->next++;
+        const FsNode* n = &t->nodes[c];
+        const char* name = t->names + n->name;
+        size_t nl = strlen(name);
+        if (f->path_len + 1 + nl >= REPORT_PATH_MAX) continue;
+        path[f->path_len] = '/';
+        memcpy(path + f->path_len + 1, name, nl);
+        uint32_t pl = f->path_len + 1 + (uint32_t)nl;
+        entry_row(r, path, pl, (n->flags & FS_NODE_DIR) != 0, n->size_bytes, n->mtime, depth);
+        if (cancel && ++rows % CANCEL_EVERY == 0 && *cancel) { res = -1; break; }
+        if (!(n->flags & FS_NODE_DIR) || n->child_count == 0) continue;
+        if (depth == cap) {
+            Frame* grown = (Frame*)realloc(stack, cap * 2 * sizeof(Frame));
+            if (!grown) { res = -1; break; }
+            stack = grown;
+            cap *= 2;
+        }
+        stack[depth++] = (Frame){ c, n->first_child, pl };
+    }
+    free(stack);
+    free(path);
+    return (res < 0 || r->err) ? -1 : 0;
+}
+
+// Every entry of a path index in its order, under the index's root path.
+// Modification times are not kept there and come out as 0.
+int fs_report_index(FsReport* r, FsPathIndex* x, volatile int* cancel)
+{
+    char* path = (char*)malloc(REPORT_PATH_MAX);
+    if (!path || fs_path_index_rewind(x) < 0) { free(path); return -1; }
+    size_t rl = strlen(x->hdr.root_path);
+    while (rl > 0 && x->hdr.root_path[rl - 1] == '/') rl--;
+    memcpy(path, x->hdr.root_path, rl);
+    path[rl] = '/';
+
+    header(r, ENTRY_HEADER);
+    entry_row(r, x->hdr.root_path, strlen(x->hdr.root_path), 1, x->hdr.total_bytes, 0, 0);
+    const FsSpillRecord* rec;
+    uint64_t rows = 0;
+    int res = 0;
+    while (!r->err && (rec = fs_path_index_next(x)) != NULL) {
+        if (rl + 1 + rec->len >= REPORT_PATH_MAX) continue;
+        memcpy(path + rl + 1, rec->path, rec->len);
+        uint32_t depth = 1;
+        for (uint32_t i = 0; i < rec->len; ++i) depth += rec->path[i] == '/';
+        entry_row(r, path, rl + 1 + rec->len, (rec->flags & FS_SPILL_DIR) != 0, rec->size, 0, depth);
+        if (cancel && ++rows % CANCEL_EVERY == 0 && *cancel) { res = -1; break; }
+    }
+    free(path);
+    return (res < 0 || r->err) ? -1 : 0;
+}
+
+// The first `max_rows` entries of a listing, largest first when it is sorted
+int fs_report_listing(FsReport* r, const FsListing* l, uint32_t max_rows)
+{
+    header(r, "rank,name,type,size\n");
+    uint32_t n = l->count < max_rows ? l->count : max_rows;
+    for (uint32_t i = 0; i < n; ++i) {
+        const char* name = fs_listing_name(l, i);
+        int is_dir = fs_listing_is_dir(l, i);
+        field_u64(r, 0, "rank", i + 1);
+        field_str(r, 1, "name", name, strlen(name));
+        field_str(r, 2, "type", is_dir ? "dir" : "file", is_dir ? 3 : 4);
+        field_u64(r, 3, "size", fs_listing_size(l, i));
+        end_row(r);
+    }
+    return r->err ? -1 : 0;
+}
+
+static int cmp_ext_bytes(const void* a, const void* b)
+{
+    const FsExtStat* x = *(const FsExtStat* const*)a;
+    const FsExtStat* y = *(const FsExtStat* const*)b;
+    if (x->bytes != y->bytes) return x->bytes < y->bytes ? 1 : -1;
+    return strcmp(x->ext, y->ext);
+}
+
+// Extension without a leading dot, ignoring case
+static int ext_listed(const char* ext, const char* const* only, int only_count)
+{
+    for (int i = 0; i < only_count; ++i) {
+        const char* o = only[i];
+        if (*o == '.') o++;
+        if (!strcasecmp(o, ext)) return 1;
+    }
+    return 0;
+}
+
+// Space per extension, largest first; just the `only` ones when given
+int fs_report_exts(FsReport* r, const FsTypeStats* s, const char* const* only, int only_count)
+{
+    const FsExtStat** sorted = (const FsExtStat**)malloc((s->ext_used ? s->ext_used : 1) * sizeof(*sorted));
+    if (!sorted) return -1;
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < s->ext_cap && n < s->ext_used; ++i) {
+        const FsExtStat* e = &s->exts[i];
+        if (e->files && (!only_count || ext_listed(e->ext, only, only_count))) sorted[n++] = e;
+    }
+    qsort(sorted, n, sizeof(*sorted), cmp_ext_bytes);
+
+    header(r, "ext,category,files,bytes\n");
+    for (uint32_t i = 0; i < n; ++i) {
+        const FsExtStat* e = sorted[i];
+        const char* cat = fs_category_label(fs_ext_category(e));
+        field_str(r, 0, "ext", e->ext, strlen(e->ext));
+        field_str(r, 1, "category", cat, strlen(cat));
+        field_u64(r, 2, "files", e->files);
+        field_u64(r, 3, "bytes", e->bytes);
+        end_row(r);
+    }
+    free(sorted);
+    return r->err ? -1 : 0;
+}
+
+// "jsonl" or "csv"; -1 for anything else
+int fs_report_parse_format(const char* name)
+{
+    if (!strcmp(name, "jsonl") || !strcmp(name, "json")) return FS_REPORT_JSONL;
+    if (!strcmp(name, "csv")) return FS_REPORT_CSV;
+    return -1;
+}
+
+const char* fs_report_suffix(int format)
+{
+    return format == FS_REPORT_CSV ? "csv" : "jsonl";
+}
+
+// ---- export -----------------------------------------------------------------
+
+static int export_thread(SceSize args, void* argp)
+{
+    (void)args;
+    FsExporter* e = *(FsExporter**)argp;
+    FsReport r;
+    int res = -1;
+    SceUID fd = fs_io_open(e->path, SCE_O_WRONLY | SCE_O_CREAT | SCE_O_TRUNC, 0666);
+    if (fd >= 0 && fs_report_open(&r, fd, e->format) == 0) {
+        res = fs_report_tree(&r, e->tree, e->node, &e->cancel);
+        e->rows = r.rows;
+        if (fs_report_close(&r) < 0) res = -1;
+    }
+    if (fd >= 0) fs_io_close(fd);
+    if (res < 0) fs_io_remove(e->path);
+    e->state = res == 0 ? FS_EXPORT_DONE : FS_EXPORT_FAILED;
+    return 0;
+}
+
+static void join_worker(FsExporter* e)
+{
+    if (e->thread < 0) return;
+    sceKernelWaitThreadEnd(e->thread, NULL, NULL);
+    sceKernelDeleteThread(e->thread);
+    e->thread = -1;
+}
+
+void fs_exporter_init(FsExporter* e)
+{
+    memset(e, 0, sizeof(*e));
+    e->thread = -1;
+}
+
+void fs_exporter_deinit(FsExporter* e)
+{
+    e->cancel = 1;
+    join_worker(e);
+}
+
+// Starts writing the report of `node` to `file_path`; fails while another
+// export runs
+int fs_exporter_start(FsExporter* e, const FsTree* t, uint32_t node, const char* file_path, int format)
+{
+    if (!t || node >= t->node_count || e->state == FS_EXPORT_RUNNING) return -1;
+    join_worker(e);
+    e->tree = t;
+    e->node = node;
+    e->format = format;
+    e->rows = 0;
+    e->cancel = 0;
+    snprintf(e->path, sizeof(e->path), "%s", file_path);
+    e->state = FS_EXPORT_RUNNING;
+    e->thread = sceKernelCreateThread("fsa_export", export_thread, EXPORT_THREAD_PRIORITY,
+                                      EXPORT_THREAD_STACK, 0, SCE_KERNEL_CPU_MASK_USER_1, NULL);
+    FsExporter* self = e;
+    if (e->thread < 0 || sceKernelStartThread(e->thread, sizeof(self), &self) < 0) {
+        if (e->thread >= 0) sceKernelDeleteThread(e->thread);
+        e->thread = -1;
+        e->state = FS_EXPORT_FAILED;
+        return -1;
+    }
+    return 0;
+}
+
+FsExportState fs_exporter_poll(FsExporter* e, uint64_t* rows)
+{
+    if (rows) *rows = e->rows;
+    FsExportState st = (FsExportState)e->state;
+    if (st != FS_EXPORT_RUNNING) join_worker(e);
+    return st;
+}
+
+// Stops an export reading `t`, which then counts as failed; call before the
+// tree is changed or freed.
+void fs_exporter_release(FsExporter* e, const FsTree* t)
+{
+    if (e->thread < 0 || e->tree != t) return;
+    e->cancel = 1;
+    join_worker(e);
+}
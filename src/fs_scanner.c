@@ -0,0 +1,248 @@
+#include "fs_scanner.h"
+#include "fs_spill.h"
+#include <psp2/kernel/threadmgr.h>
+#include <psp2/kernel/processmgr.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SCAN_THREAD_PRIORITY (0x10000100 + 16)
+#define SCAN_THREAD_STACK    (256 * 1024)
+#define PUBLISH_INTERVAL_US  100000
+
+// ---- worker -----------------------------------------------------------------
+
+static void update_progress(FsScanner* s, uint64_t now)
+{
+    FsScanProgress* p = &s->progress;
+    p->files = s->ctl.files;
+    p->bytes = s->ctl.bytes;
+    p->elapsed_us = now - s->start_us;
+    if (p->elapsed_us > 0) {
+        p->files_per_sec = p->files * 1000000ULL / p->elapsed_us;
+        p->bytes_per_sec = (uint64_t)((double)p->bytes * 1000000.0 / (double)p->elapsed_us);
+    }
+    p->eta_sec = -1;
+    if (p->bytes_per_sec > 0 && p->expected_bytes > p->bytes)
+        p->eta_sec = (int)((p->expected_bytes - p->bytes) / p->bytes_per_sec);
+    else if (p->bytes_per_sec > 0)
+        p->eta_sec = 0;
+}
+
+// Runs on the worker with the tree still growing: copies the largest of the
+// focus folder's current children into the shared listing.
+static void publish(FsScanner* s, const FsTree* t, uint64_t now)
+{
+    sceKernelLockMutex(s->lock, 1, NULL);
+    s->focus_node = fs_tree_lookup(t, s->focus);
+    fs_listing_clear(&s->partial);
+    if (s->focus_node != FS_TREE_NONE && s->partial_top && t->nodes[s->focus_node].child_count > 0) {
+        const FsNode* d = &t->nodes[s->focus_node];
+        uint32_t n = fs_top_k(&t->nodes[d->first_child].size_bytes, sizeof(FsNode), d->child_count,
+                              FS_SCAN_MAX_PARTIAL, s->partial_top);
+        for (uint32_t i = 0; i < n; ++i) {
+            const FsNode* c = &t->nodes[d->first_child + s->partial_top[i]];
+            if (fs_listing_add(&s->partial, t->names + c->name, c->size_bytes,
+                               (c->flags & FS_NODE_DIR) ? FS_ENTRY_DIR : 0) < 0) break;
+        }
+    }
+    s->partial_gen++;
+    update_progress(s, now);
+    sceKernelUnlockMutex(s->lock, 1);
+    s->last_publish_us = now;
+}
+
+static void on_dir_done(FsScanCtl* ctl, const FsTree* t, uint32_t dir)
+{
+    FsScanner* s = (FsScanner*)ctl->user;
+    uint64_t now = sceKernelGetProcessTimeWide();
+    int focus_child = (s->focus_node != FS_TREE_NONE && t->nodes[dir].parent == s->focus_node);
+    if (!focus_child && !s->focus_dirty && now - s->last_publish_us < PUBLISH_INTERVAL_US) return;
+    s->focus_dirty = 0;
+    publish(s, t, now);
+}
+
+static int scan_thread(SceSize args, void* argp)
+{
+    (void)args;
+    FsScanner* s = *(FsScanner**)argp;
+
+    // Counters are process-wide: walks of other partitions running at the
+    // same time land in this scan's numbers too
+    FsIoStats io_before, io_after;
+    fs_io_snapshot(&io_before);
+
+    FsTree cached;
+    fs_tree_init(&cached);
+    // Every step polls the cancel flag: fs_scanner_cancel waits for this
+    // thread on the UI thread
+    if (s->cache_path[0]) fs_tree_load(&cached, s->cache_path, &s->ctl.cancel);
+    int res = fs_tree_build(&s->tree, s->root, &cached, &s->ctl);
+    fs_tree_free(&cached);
+    if (res == 0 && !s->ctl.cancel && s->cache_path[0]) fs_tree_save(&s->tree, s->cache_path, &s->ctl.cancel);
+    // Still on the worker, so a search is ready the moment the tree is; a
+    // failed index only means the UI builds one when it is first needed
+    fs_name_index_free(&s->names);
+    if (res == 0 && !s->ctl.cancel) fs_name_index_build(&s->names, &s->tree, &s->ctl.cancel);
+
+    // Too many entries to hold: walk again into a path index on disk, which
+    // needs the same budget whatever the number of files
+    if (res < 0 && s->ctl.over_budget && !s->ctl.cancel && s->index_path[0]) {
+        s->ctl.files = s->ctl.dirs = s->ctl.bytes = 0;
+        s->start_us = sceKernelGetProcessTimeWide();
+        res = fs_spill_scan(s->root, s->max_bytes, s->index_path, &s->ctl, NULL);
+        s->indexed = res == 0;
+    }
+
+    fs_io_snapshot(&io_after);
+    sceKernelLockMutex(s->lock, 1, NULL);
+    fs_io_diff(&io_after, &io_before, &s->io);
+    update_progress(s, sceKernelGetProcessTimeWide());
+    s->state = (res == 0) ? FS_SCAN_DONE : FS_SCAN_FAILED;
+    sceKernelUnlockMutex(s->lock, 1);
+    return 0;
+}
+
+static void join_worker(FsScanner* s)
+{
+    if (s->thread < 0) return;
+    sceKernelWaitThreadEnd(s->thread, NULL, NULL);
+    sceKernelDeleteThread(s->thread);
+    s->thread = -1;
+}
+
+// ---- public API -------------------------------------------------------------
+
+void fs_scanner_init(FsScanner* s)
+{
+    memset(s, 0, sizeof(*s));
+    s->thread = -1;
+    s->part = -1;
+    s->focus_node = FS_TREE_NONE;
+    s->lock = sceKernelCreateMutex("fsa_scan_lock", 0, 0, NULL);
+    fs_tree_init(&s->tree);
+    fs_name_index_init(&s->names);
+    fs_listing_init(&s->partial);
+    s->partial_top = (uint32_t*)malloc(FS_SCAN_MAX_PARTIAL * sizeof(uint32_t));
+}
+
+void fs_scanner_deinit(FsScanner* s)
+{
+    fs_scanner_cancel(s);
+    if (s->lock >= 0) sceKernelDeleteMutex(s->lock);
+    s->lock = -1;
+    fs_name_index_free(&s->names);
+    fs_listing_free(&s->partial);
+    free(s->partial_top);
+    s->partial_top = NULL;
+}
+
+int fs_scanner_start(FsScanner* s, int part, const char* root, const char* cache_path,
+                     uint64_t expected_bytes, const char* focus, int threads)
+{
+    if (!s || !root || s->lock < 0) return -1;
+    fs_scanner_cancel(s);
+
+    s->part = part;
+    snprintf(s->root, sizeof(s->root), "%s", root);
+    snprintf(s->cache_path, sizeof(s->cache_path), "%s", cache_path ? cache_path : "");
+    snprintf(s->focus, sizeof(s->focus), "%s", focus ? focus : root);
+    s->focus_node = FS_TREE_NONE;
+    s->focus_dirty = 1;
+    memset(&s->ctl, 0, sizeof(s->ctl));
+    s->ctl.threads = threads;
+    s->ctl.on_dir_done = on_dir_done;
+    s->ctl.user = s;
+    s->ctl.max_bytes = s->max_bytes;
+    s->indexed = 0;
+    memset(&s->progress, 0, sizeof(s->progress));
+    s->progress.expected_bytes = expected_bytes;
+    s->progress.eta_sec = -1;
+    fs_listing_clear(&s->partial);
+    s->partial_gen++;
+    s->start_us = s->last_publish_us = sceKernelGetProcessTimeWide();
+
+    s->thread = sceKernelCreateThread("fsa_scan", scan_thread, SCAN_THREAD_PRIORITY,
+                                      SCAN_THREAD_STACK, 0, SCE_KERNEL_CPU_MASK_USER_1, NULL);
+    if (s->thread < 0) return -1;
+    s->state = FS_SCAN_RUNNING;
+    FsScanner* self = s;
+    if (sceKernelStartThread(s->thread, sizeof(self), &self) < 0) {
+        sceKernelDeleteThread(s->thread);
+        s->thread = -1;
+        s->state = FS_SCAN_IDLE;
+        return -1;
+    }
+    return 0;
+}
+
+// Caps the tree of the following walks at `max_bytes`. A walk that goes over
+// writes a path index to `index_path` instead and leaves an empty tree.
+void fs_scanner_set_budget(FsScanner* s, size_t max_bytes, const char* index_path)
+{
+    if (!s) return;
+    s->max_bytes = max_bytes;
+    snprintf(s->index_path, sizeof(s->index_path), "%s", index_path ? index_path : "");
+}
+
+void fs_scanner_set_focus(FsScanner* s, const char* focus)
+{
+    if (!s || !focus || s->lock < 0) return;
+    sceKernelLockMutex(s->lock, 1, NULL);
+    snprintf(s->focus, sizeof(s->focus), "%s", focus);
+    fs_listing_clear(&s->partial);
+    s->partial_gen++;
+    sceKernelUnlockMutex(s->lock, 1);
+    s->focus_dirty = 1;
+}
+
+void fs_scanner_cancel(FsScanner* s)
+{
+    if (!s || s->thread < 0) return;
+    s->ctl.cancel = 1;
+    join_worker(s);
+    fs_tree_free(&s->tree);
+    fs_name_index_free(&s->names);
+    s->state = FS_SCAN_IDLE;
+    s->part = -1;
+}
+
+// Copies the latest partial listing if it changed since *gen, and the progress.
+FsScanState fs_scanner_poll(FsScanner* s, FsListing* out, int* gen, FsScanProgress* progress)
+{
+    if (!s || s->lock < 0) return FS_SCAN_IDLE;
+    sceKernelLockMutex(s->lock, 1, NULL);
+    FsScanState st = (FsScanState)s->state;
+    // The walk into a path index publishes no folders, only its counters
+    if (st == FS_SCAN_RUNNING && s->ctl.over_budget) update_progress(s, sceKernelGetProcessTimeWide());
+    if (out && gen && *gen != s->partial_gen && fs_listing_copy(out, &s->partial) == 0)
+        *gen = s->partial_gen;
+    if (progress) *progress = s->progress;
+    sceKernelUnlockMutex(s->lock, 1);
+    return st;
+}
+
+// Hands the finished tree to the caller and returns the scanner to idle.
+int fs_scanner_take(FsScanner* s, FsTree* out)
+{
+    if (!s || !out) return -1;
+    FsScanState st = (FsScanState)s->state;
+    if (st != FS_SCAN_DONE && st != FS_SCAN_FAILED) return -1;
+    join_worker(s);
+    s->state = FS_SCAN_IDLE;
+    s->part = -1;
+    if (st == FS_SCAN_FAILED) return -1;
+    fs_tree_free(out);
+    *out = s->tree;
+    fs_tree_init(&s->tree);
+    return 0;
+}
+
+// The name index of the tree just taken; empty when the walk built none.
+void fs_scanner_take_names(FsScanner* s, FsNameIndex* out)
+{
+    if (!s || !out) return;
+    fs_name_index_free(out);
+    *out = s->names;
+    fs_name_index_init(&s->names);
+}
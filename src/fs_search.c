@@ -0,0 +1,482 @@
+#include "fs_search.h"
+#include <psp2/kernel/threadmgr.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SHORT_QUERY 3   // fewer bytes than a trigram: every name is checked
+#define FEW_NAMES   64  // candidates left when further lists stop paying off
+#define CANCEL_EVERY 4096 // nodes or names between cancel checks
+
+#define INDEX_THREAD_PRIORITY (0x10000100 + 24)
+#define INDEX_THREAD_STACK    (32 * 1024)
+
+// ---- names ------------------------------------------------------------------
+
+static inline uint8_t lower(uint8_t c)
+{
+    return (c >= 'A' && c <= 'Z') ? (uint8_t)(c + ('a' - 'A')) : c;
+}
+
+// Case is folded for ASCII only; other bytes, UTF-8 included, match as is
+static uint32_t trigram_bucket(const char* p)
+{
+    uint32_t t = (uint32_t)lower((uint8_t)p[0]) << 16 | (uint32_t)lower((uint8_t)p[1]) << 8 | lower((uint8_t)p[2]);
+    return (t * 2654435761u) >> (32 - FS_SEARCH_BUCKET_BITS);
+}
+
+// `q` is lowercased already
+static int contains_nocase(const char* s, const char* q, size_t ql)
+{
+    for (; *s; ++s) {
+        size_t i = 0;
+        while (i < ql && s[i] && lower((uint8_t)s[i]) == (uint8_t)q[i]) i++;
+        if (i == ql) return 1;
+    }
+    return ql == 0;
+}
+
+static uint32_t varint_len(uint32_t v)
+{
+    uint32_t n = 1;
+    while (v >= 0x80) { v >>= 7; n++; }
+    return n;
+}
+
+static uint32_t put_varint(uint8_t* p, uint32_t v)
+{
+    uint32_t n = 0;
+    while (v >= 0x80) { p[n++] = (uint8_t)(v | 0x80); v >>= 7; }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+static const uint8_t* get_varint(const uint8_t* p, uint32_t* v)
+{
+    uint32_t r = 0;
+    int shift = 0;
+    do { r |= (uint32_t)(*p & 0x7f) << shift; shift += 7; } while (*p++ & 0x80);
+    *v = r;
+    return p;
+}
+
+// Id of the name at pool offset `off`, or FS_TREE_NONE
+static uint32_t name_id(const FsNameIndex* x, uint32_t off)
+{
+    uint32_t lo = 0, hi = x->name_count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (x->name_off[mid] < off) lo = mid + 1;
+        else hi = mid;
+    }
+    return (lo < x->name_count && x->name_off[lo] == off) ? lo : FS_TREE_NONE;
+}
+
+// ---- index ------------------------------------------------------------------
+
+void fs_name_index_init(FsNameIndex* x)
+{
+    memset(x, 0, sizeof(*x));
+}
+
+void fs_name_index_free(FsNameIndex* x)
+{
+    if (!x) return;
+    free(x->name_off);
+    free(x->node_first);
+    free(x->nodes);
+    free(x->name_max);
+    free(x->post_off);
+    free(x->post);
+    fs_name_index_init(x);
+}
+
+// Groups the live nodes by name: the ones reachable from the root, since
+// refreshed and removed blocks stay in the node array until the next build
+static int cancelled(volatile int* cancel, uint32_t i)
+{
+    return cancel && i % CANCEL_EVERY == 0 && *cancel;
+}
+
+static int group_nodes(FsNameIndex* x, const FsTree* t, volatile int* cancel)
+{
+    uint32_t* live = (uint32_t*)malloc((size_t)t->node_count * sizeof(uint32_t));
+    uint32_t* ids = (uint32_t*)malloc((size_t)t->node_count * sizeof(uint32_t));
+    if (!live || !ids) { free(live); free(ids); return -1; }
+
+    uint32_t n = 0;
+    live[n++] = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+        if (cancelled(cancel, i)) { free(live); free(ids); return -1; }
+        const FsNode* d = &t->nodes[live[i]];
+        for (uint32_t c = d->first_child; c < d->first_child + d->child_count && n < t->node_count; ++c) live[n++] = c;
+    }
+
+    // Counts per name, then each count turned into the end of its group;
+    // filling backwards leaves node_first at the starts
+    uint32_t total = 0;
+    for (uint32_t i = 1; i < n; ++i) {
+        ids[i] = name_id(x, t->nodes[live[i]].name);
+        if (ids[i] == FS_TREE_NONE) continue;
+        x->node_first[ids[i]]++;
+        total++;
+    }
+    uint32_t sum = 0;
+    for (uint32_t id = 0; id < x->name_count; ++id) { sum += x->node_first[id]; x->node_first[id] = sum; }
+    x->node_first[x->name_count] = total;
+
+    x->nodes = (uint32_t*)malloc((size_t)(total ? total : 1) * sizeof(uint32_t));
+    x->name_max = (uint64_t*)calloc(x->name_count ? x->name_count : 1, sizeof(uint64_t));
+    if (x->nodes && x->name_max) {
+        for (uint32_t i = n; i-- > 1;)
+            if (ids[i] != FS_TREE_NONE) x->nodes[--x->node_first[ids[i]]] = live[i];
+        x->node_count = total;
+        for (uint32_t i = 1; i < n; ++i)
+            if (ids[i] != FS_TREE_NONE && t->nodes[live[i]].size_bytes > x->name_max[ids[i]])
+                x->name_max[ids[i]] = t->nodes[live[i]].size_bytes;
+    }
+    free(live);
+    free(ids);
+    return x->nodes && x->name_max ? 0 : -1;
+}
+
+// Two passes over the names with a live node: list sizes, then the lists.
+// A trigram seen twice in one name goes in once.
+static int build_postings(FsNameIndex* x, const FsTree* t, volatile int* cancel)
+{
+    uint32_t* last = (uint32_t*)calloc(FS_SEARCH_BUCKETS, sizeof(uint32_t)); // id + 1, 0 for none yet
+    uint32_t* pos = (uint32_t*)malloc(FS_SEARCH_BUCKETS * sizeof(uint32_t));
+    x->post_off = (uint32_t*)calloc(FS_SEARCH_BUCKETS + 1, sizeof(uint32_t));
+    if (!last || !pos || !x->post_off) { free(last); free(pos); return -1; }
+
+    for (int pass = 0; pass < 2; ++pass) {
+        for (uint32_t id = 0; id < x->name_count; ++id) {
+            if (cancelled(cancel, id)) { free(last); free(pos); return -1; }
+            if (x->node_first[id] == x->node_first[id + 1]) continue;
+            const char* s = t->names + x->name_off[id];
+            size_t len = strlen(s);
+            for (size_t i = 0; i + 3 <= len; ++i) {
+                uint32_t b = trigram_bucket(s + i);
+                if (last[b] == id + 1) continue;
+                uint32_t gap = id + 1 - last[b];
+                last[b] = id + 1;
+                if (pass == 0) x->post_off[b + 1] += varint_len(gap);
+                else pos[b] += put_varint(x->post + pos[b], gap);
+            }
+        }
+        if (pass == 1) break;
+
+        for (uint32_t b = 0; b < FS_SEARCH_BUCKETS; ++b) x->post_off[b + 1] += x->post_off[b];
+        uint32_t total = x->post_off[FS_SEARCH_BUCKETS];
+        x->post = (uint8_t*)malloc(total ? total : 1);
+        if (!x->post) break;
+        memcpy(pos, x->post_off, FS_SEARCH_BUCKETS * sizeof(uint32_t));
+        memset(last, 0, FS_SEARCH_BUCKETS * sizeof(uint32_t));
+    }
+    free(last);
+    free(pos);
+    return x->post ? 0 : -1;
+}
+
+// Indexes the names of the live nodes of `t`, root excluded. Gives up with
+// -1 soon after *cancel is set, when it is given.
+int fs_name_index_build(FsNameIndex* x, const FsTree* t, volatile int* cancel)
+{
+    if (!x || !t || t->node_count == 0) return -1;
+    fs_name_index_free(x);
+
+    uint32_t count = 0;
+    for (uint32_t off = 0; off < t->names_len; off += (uint32_t)strlen(t->names + off) + 1) count++;
+    x->name_off = (uint32_t*)malloc((size_t)(count ? count : 1) * sizeof(uint32_t));
+    x->node_first = (uint32_t*)calloc((size_t)count + 1, sizeof(uint32_t));
+    if (!x->name_off || !x->node_first) goto fail;
+    for (uint32_t off = 0; off < t->names_len; off += (uint32_t)strlen(t->names + off) + 1)
+        x->name_off[x->name_count++] = off;
+
+    if (group_nodes(x, t, cancel) < 0 || build_postings(x, t, cancel) < 0) goto fail;
+
+    x->bytes = ((size_t)x->name_count * 2 + 1 + x->node_count + FS_SEARCH_BUCKETS + 1) * sizeof(uint32_t) +
+               (size_t)x->name_count * sizeof(uint64_t) + x->post_off[FS_SEARCH_BUCKETS];
+    x->gen = t->gen;
+    return 0;
+
+fail:
+    fs_name_index_free(x);
+    return -1;
+}
+
+// ---- queries ----------------------------------------------------------------
+
+void fs_search_init(FsSearch* s)
+{
+    memset(s, 0, sizeof(*s));
+}
+
+void fs_search_free(FsSearch* s)
+{
+    if (!s) return;
+    free(s->names);
+    fs_search_init(s);
+}
+
+static void heap_push(FsSearchHit* heap, uint32_t* n, FsSearchHit hit)
+{
+    uint32_t c = (*n)++;
+    heap[c] = hit;
+    while (c > 0) {
+        uint32_t p = (c - 1) / 2;
+        if (heap[p].size_bytes <= heap[c].size_bytes) break;
+        FsSearchHit tmp = heap[p]; heap[p] = heap[c]; heap[c] = tmp;
+        c = p;
+    }
+}
+
+// Puts `hit` in place of the smallest
+static void heap_replace(FsSearchHit* heap, uint32_t n, FsSearchHit hit)
+{
+    heap[0] = hit;
+    for (uint32_t i = 0;;) {
+        uint32_t l = 2 * i + 1, r = l + 1, m = i;
+        if (l < n && heap[l].size_bytes < heap[m].size_bytes) m = l;
+        if (r < n && heap[r].size_bytes < heap[m].size_bytes) m = r;
+        if (m == i) return;
+        FsSearchHit tmp = heap[i]; heap[i] = heap[m]; heap[m] = tmp;
+        i = m;
+    }
+}
+
+static int cmp_hit_desc(const void* a, const void* b)
+{
+    uint64_t x = ((const FsSearchHit*)a)->size_bytes, y = ((const FsSearchHit*)b)->size_bytes;
+    return (x < y) - (x > y);
+}
+
+static uint32_t list_bytes(const FsNameIndex* x, uint32_t b)
+{
+    return x->post_off[b + 1] - x->post_off[b];
+}
+
+// Keeps the candidates that are also in bucket b's list
+static void intersect(FsSearch* s, const FsNameIndex* x, uint32_t b)
+{
+    const uint8_t* p = x->post + x->post_off[b];
+    const uint8_t* end = x->post + x->post_off[b + 1];
+    uint32_t cur = 0, keep = 0, i = 0;
+    while (p < end && i < s->name_count) {
+        uint32_t gap;
+        p = get_varint(p, &gap);
+        cur += gap;
+        while (i < s->name_count && s->names[i] < cur - 1) i++;
+        if (i < s->name_count && s->names[i] == cur - 1) s->names[keep++] = s->names[i++];
+    }
+    s->name_count = keep;
+}
+
+// Candidates from the shortest lists of the query's trigrams, rarest first
+static void from_postings(FsSearch* s, const FsNameIndex* x, const char* q, size_t ql)
+{
+    uint32_t buckets[FS_SEARCH_QUERY];
+    uint32_t n = 0;
+    for (size_t i = 0; i + 3 <= ql; ++i) {
+        uint32_t b = trigram_bucket(q + i), j = 0;
+        while (j < n && buckets[j] != b) j++;
+        if (j < n) continue;
+        // Insertion by list length
+        for (j = n++; j > 0 && list_bytes(x, buckets[j - 1]) > list_bytes(x, b); --j) buckets[j] = buckets[j - 1];
+        buckets[j] = b;
+    }
+
+    s->name_count = 0;
+    const uint8_t* p = x->post + x->post_off[buckets[0]];
+    const uint8_t* end = x->post + x->post_off[buckets[0] + 1];
+    uint32_t cur = 0;
+    while (p < end) {
+        uint32_t gap;
+        p = get_varint(p, &gap);
+        cur += gap;
+        s->names[s->name_count++] = cur - 1;
+    }
+    for (uint32_t j = 1; j < n && s->name_count > FEW_NAMES; ++j) intersect(s, x, buckets[j]);
+}
+
+// Queries shorter than a trigram, matched against the name pool itself:
+// each place holding the query's first byte in either case is checked in
+// place, and a name goes in once
+static void from_pool(FsSearch* s, const FsNameIndex* x, const FsTree* t, const char* q, size_t ql)
+{
+    uint8_t lo = (uint8_t)q[0];
+    uint8_t up = (lo >= 'a' && lo <= 'z') ? (uint8_t)(lo - ('a' - 'A')) : lo;
+    const char* pool = t->names;
+    const char* end = pool + t->names_len;
+    const char* a = (const char*)memchr(pool, lo, t->names_len);
+    const char* b = up != lo ? (const char*)memchr(pool, up, t->names_len) : NULL;
+    s->name_count = 0;
+    uint32_t id = 0;
+    while (a || b) {
+        const char* p = (!b || (a && a < b)) ? a : b;
+        // Places come in pool order, so the name holding one is found by
+        // walking the name offsets forward
+        while (id + 1 < x->name_count && x->name_off[id + 1] <= (uint32_t)(p - pool)) id++;
+        const char* next = id + 1 < x->name_count ? pool + x->name_off[id + 1] : end;
+        size_t i = 1;
+        while (i < ql && lower((uint8_t)p[i]) == (uint8_t)q[i]) i++;
+        const char* from = p + 1;
+        if (i == ql) {
+            s->names[s->name_count++] = id;
+            from = next;
+        }
+        if (a && a < from) a = (const char*)memchr(from, lo, (size_t)(end - from));
+        if (b && b < from) b = (const char*)memchr(from, up, (size_t)(end - from));
+    }
+    s->checked = x->name_count;
+}
+
+// Drops the candidates whose name does not hold the query
+static void verify(FsSearch* s, const FsNameIndex* x, const FsTree* t, const char* q, size_t ql)
+{
+    uint32_t keep = 0;
+    for (uint32_t i = 0; i < s->name_count; ++i)
+        if (contains_nocase(t->names + x->name_off[s->names[i]], q, ql)) s->names[keep++] = s->names[i];
+    s->checked = s->name_count;
+    s->name_count = keep;
+}
+
+// Finds the live nodes whose name contains `query`, ignoring ASCII case, and
+// keeps the FS_SEARCH_MAX_HITS largest in s->hits. The index must be built
+// from the tree as it is now. Returns the number of hits, -1 on error.
+int fs_search_run(FsSearch* s, const FsNameIndex* x, const FsTree* t, const char* query)
+{
+    if (!s || !x || !t || !query || !x->gen || x->gen != t->gen) return -1;
+
+    char q[FS_SEARCH_QUERY];
+    size_t ql = 0;
+    for (; query[ql] && ql < sizeof(q) - 1; ++ql) q[ql] = (char)lower((uint8_t)query[ql]);
+    q[ql] = '\0';
+    s->hit_count = s->match_count = s->checked = 0;
+    if (ql == 0 || x->node_count == 0) {
+        s->query[0] = '\0';
+        s->name_count = 0;
+        s->gen = 0;
+        return 0;
+    }
+
+    if (s->name_cap < x->name_count) {
+        uint32_t* p = (uint32_t*)realloc(s->names, (size_t)x->name_count * sizeof(uint32_t));
+        if (!p) return -1;
+        s->names = p;
+        s->name_cap = x->name_count;
+    }
+
+    // Typing on narrows the last query down, since only its matches can
+    // match. Queries without a trigram match too many names for that to pay.
+    if (ql < SHORT_QUERY) {
+        from_pool(s, x, t, q, ql);
+    } else {
+        if (s->gen != x->gen || strlen(s->query) < SHORT_QUERY || !strstr(q, s->query)) from_postings(s, x, q, ql);
+        verify(s, x, t, q, ql);
+    }
+    memcpy(s->query, q, ql + 1);
+    s->gen = x->gen;
+
+    // Min-heap of the largest nodes so far. A name whose largest node would
+    // not make it is counted without touching the tree.
+    uint32_t h = 0;
+    for (uint32_t i = 0; i < s->name_count; ++i) {
+        uint32_t id = s->names[i];
+        s->match_count += x->node_first[id + 1] - x->node_first[id];
+        if (h == FS_SEARCH_MAX_HITS && x->name_max[id] <= s->top[0].size_bytes) continue;
+        for (uint32_t j = x->node_first[id]; j < x->node_first[id + 1]; ++j) {
+            FsSearchHit hit = { t->nodes[x->nodes[j]].size_bytes, x->nodes[j] };
+            if (h < FS_SEARCH_MAX_HITS) heap_push(s->top, &h, hit);
+            else if (hit.size_bytes > s->top[0].size_bytes) heap_replace(s->top, h, hit);
+        }
+    }
+    qsort(s->top, h, sizeof(FsSearchHit), cmp_hit_desc);
+    for (uint32_t i = 0; i < h; ++i) s->hits[i] = s->top[i].node;
+    s->hit_count = h;
+    return (int)s->hit_count;
+}
+
+// ---- worker -----------------------------------------------------------------
+
+static int indexer_thread(SceSize args, void* argp)
+{
+    (void)args;
+    FsNameIndexer* ix = *(FsNameIndexer**)argp;
+    int res = fs_name_index_build(&ix->result, ix->tree, &ix->cancel);
+    ix->state = res == 0 ? FS_INDEX_DONE : FS_INDEX_FAILED;
+    return 0;
+}
+
+static void join_worker(FsNameIndexer* ix)
+{
+    if (ix->thread < 0) return;
+    sceKernelWaitThreadEnd(ix->thread, NULL, NULL);
+    sceKernelDeleteThread(ix->thread);
+    ix->thread = -1;
+}
+
+void fs_name_indexer_init(FsNameIndexer* ix)
+{
+    memset(ix, 0, sizeof(*ix));
+    ix->thread = -1;
+    fs_name_index_init(&ix->result);
+}
+
+void fs_name_indexer_deinit(FsNameIndexer* ix)
+{
+    ix->cancel = 1;
+    join_worker(ix);
+    fs_name_index_free(&ix->result);
+    ix->tree = NULL;
+    ix->state = FS_INDEX_IDLE;
+}
+
+// The tree is only read, and must stay as it is until poll stops reporting
+// FS_INDEX_RUNNING or release is called
+int fs_name_indexer_start(FsNameIndexer* ix, const FsTree* t)
+{
+    ix->cancel = 1;
+    join_worker(ix);
+    ix->cancel = 0;
+    ix->tree = t;
+    ix->state = FS_INDEX_RUNNING;
+    ix->thread = sceKernelCreateThread("fsa_index", indexer_thread, INDEX_THREAD_PRIORITY,
+                                       INDEX_THREAD_STACK, 0, SCE_KERNEL_CPU_MASK_USER_1, NULL);
+    FsNameIndexer* self = ix;
+    if (ix->thread < 0 || sceKernelStartThread(ix->thread, sizeof(self), &self) < 0) {
+        if (ix->thread >= 0) sceKernelDeleteThread(ix->thread);
+        ix->thread = -1;
+        ix->tree = NULL;
+        ix->state = FS_INDEX_IDLE;
+        return -1;
+    }
+    return 0;
+}
+
+// Stops a build reading `t`; call before the tree is changed or freed
+void fs_name_indexer_release(FsNameIndexer* ix, const FsTree* t)
+{
+    if (ix->tree != t) return;
+    ix->cancel = 1;
+    join_worker(ix);
+    fs_name_index_free(&ix->result);
+    ix->tree = NULL;
+    ix->state = FS_INDEX_IDLE;
+}
+
+FsIndexState fs_name_indexer_poll(FsNameIndexer* ix)
+{
+    FsIndexState st = (FsIndexState)ix->state;
+    if (st != FS_INDEX_RUNNING) join_worker(ix);
+    return st;
+}
+
+// Hands a finished index over; `out` gets it and its old arrays are freed
+void fs_name_indexer_take(FsNameIndexer* ix, FsNameIndex* out)
+{
+    fs_name_index_free(out);
+    *out = ix->result;
+    fs_name_index_init(&ix->result);
+    ix->tree = NULL;
+    ix->state = FS_INDEX_IDLE;
+}
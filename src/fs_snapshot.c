@@ -0,0 +1,374 @@
+#include "fs_snapshot.h"
+#include "fs_hash.h"
+#include "fs_io.h"
+#include <psp2/io/stat.h>
+#include <psp2/io/fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#define SNAP_VARINT_MAX 10
+
+// ---- writing ----------------------------------------------------------------
+
+static uint32_t put_varint(uint8_t* p, uint64_t v)
+{
+    uint32_t n = 0;
+    while (v >= 0x80) { p[n++] = (uint8_t)(v | 0x80); v >>= 7; }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+typedef struct {
+    uint32_t node;   // in the tree
+    uint32_t snap;   // its index in the snapshot
+    uint32_t child;  // next child to visit
+} BuildFrame;
+
+// Lays the tree out as a snapshot in one buffer: nodes in pre-order with
+// the end of their subtree, the tree's name pool as is, and the sizes as
+// varints. The partition's trash is left out.
+int fs_snapshot_build(FsSnapshot* s, const FsTree* t, uint64_t taken)
+{
+    memset(s, 0, sizeof(*s));
+    if (!t || !t->node_count) return -1;
+
+    // Room for every node; the names and sizes move down once the count is known
+    size_t nodes_max = (size_t)t->node_count * sizeof(FsSnapNode);
+    size_t cap = sizeof(FsSnapHeader) + nodes_max + t->names_len + (size_t)t->node_count * SNAP_VARINT_MAX;
+    uint8_t* buf = (uint8_t*)malloc(cap);
+    uint32_t stack_cap = 64, sp = 0;
+    BuildFrame* stack = (BuildFrame*)malloc(stack_cap * sizeof(BuildFrame));
+    if (!buf || !stack) { free(buf); free(stack); return -1; }
+
+    FsSnapNode* nodes = (FsSnapNode*)(buf + sizeof(FsSnapHeader));
+    uint8_t* sizes = buf + sizeof(FsSnapHeader) + nodes_max + t->names_len;
+    uint32_t count = 0, sizes_len = 0;
+
+    nodes[0].name = t->nodes[0].name | FS_SNAP_DIR;
+    nodes[0].size_off = 0;
+    sizes_len += put_varint(sizes, t->nodes[0].size_bytes);
+    count = 1;
+    stack[sp++] = (BuildFrame){ 0, 0, 0 };
+    while (sp) {
+        BuildFrame* f = &stack[sp - 1];
+        const FsNode* dir = &t->nodes[f->node];
+        if (f->child == dir->child_count) {
+            nodes[f->snap].next = count;
+            sp--;
+            continue;
+        }
+        uint32_t c = dir->first_child + f->child++;
+        const FsNode* n = &t->nodes[c];
+        FsSnapNode* out = &nodes[count];
+        out->name = n->name | ((n->flags & FS_NODE_DIR) ? FS_SNAP_DIR : 0);
+        out->next = count + 1;
+        out->size_off = sizes_len;
+        sizes_len += put_varint(sizes + sizes_len, n->size_bytes);
+        if ((n->flags & FS_NODE_DIR) && n->child_count) {
+            if (sp == stack_cap) {
+                BuildFrame* p = (BuildFrame*)realloc(stack, stack_cap * 2 * sizeof(BuildFrame));
+                if (!p) { free(stack); free(buf); return -1; }
+                stack = p;
+                stack_cap *= 2;
+            }
+            stack[sp++] = (BuildFrame){ c, count, 0 };
+        }
+        count++;
+    }
+    free(stack);
+
+    uint8_t* names = buf + sizeof(FsSnapHeader) + (size_t)count * sizeof(FsSnapNode);
+    memcpy(names, t->names, t->names_len);
+    memmove(names + t->names_len, sizes, sizes_len);
+
+    FsSnapHeader* hdr = (FsSnapHeader*)buf;
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->magic = FS_SNAP_MAGIC;
+    hdr->version = FS_SNAP_VERSION;
+    hdr->node_count = count;
+    hdr->names_len = t->names_len;
+    hdr->sizes_len = sizes_len;
+    hdr->taken = taken;
+    hdr->total_bytes = t->nodes[0].size_bytes;
+    snprintf(hdr->root_path, sizeof(hdr->root_path), "%s", t->root_path);
+
+    size_t size = (size_t)(names + t->names_len + sizes_len - buf);
+    uint8_t* shrunk = (uint8_t*)realloc(buf, size);
+    if (shrunk) buf = shrunk;
+    if (fs_snapshot_attach(s, buf, size) < 0) { free(buf); return -1; }
+    s->owned = buf;
+    return 0;
+}
+
+int fs_snapshot_save(const FsSnapshot* s, const char* file_path)
+{
+    if (!s || !s->hdr || !file_path) return -1;
+    char tmp_path[FS_SNAP_PATH + 8];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", file_path);
+    SceUID fd = fs_io_open(tmp_path, SCE_O_WRONLY | SCE_O_CREAT | SCE_O_TRUNC, 0777);
+    if (fd < 0) return -1;
+    const uint8_t* p = (const uint8_t*)s->hdr;
+    size_t done = 0;
+    while (done < s->size) {
+        int w = fs_io_write(fd, p + done, (SceSize)(s->size - done));
+        if (w <= 0) break;
+        done += (size_t)w;
+    }
+    fs_io_close(fd);
+    if (done != s->size) { fs_io_remove(tmp_path); return -1; }
+    fs_io_remove(file_path);
+    return fs_io_rename(tmp_path, file_path) < 0 ? -1 : 0;
+}
+
+// ---- reading ----------------------------------------------------------------
+
+// Points the snapshot at a file image in memory, such as a mapped file,
+// after checking only the header and that the name pool ends in a NUL:
+// nothing is parsed or copied. Out of range offsets in the nodes are caught
+// by the accessors instead.
+int fs_snapshot_attach(FsSnapshot* s, const void* data, size_t size)
+{
+    memset(s, 0, sizeof(*s));
+    if (!data || size < sizeof(FsSnapHeader)) return -1;
+    const FsSnapHeader* hdr = (const FsSnapHeader*)data;
+    if (hdr->magic != FS_SNAP_MAGIC || hdr->version != FS_SNAP_VERSION || !hdr->node_count) return -1;
+    uint64_t want = sizeof(FsSnapHeader) + (uint64_t)hdr->node_count * sizeof(FsSnapNode) +
+                    hdr->names_len + hdr->sizes_len;
+    if (want != size || !hdr->names_len) return -1;
+    const uint8_t* base = (const uint8_t*)data;
+    if (base[sizeof(FsSnapHeader) + (size_t)hdr->node_count * sizeof(FsSnapNode) + hdr->names_len - 1]) return -1;
+
+    s->hdr = hdr;
+    s->nodes = (const FsSnapNode*)(base + sizeof(FsSnapHeader));
+    s->names = (const char*)(s->nodes + hdr->node_count);
+    s->sizes = (const uint8_t*)s->names + hdr->names_len;
+    s->node_count = hdr->node_count;
+    s->size = size;
+    return 0;
+}
+
+// One sequential read of the whole file
+int fs_snapshot_load(FsSnapshot* s, const char* file_path)
+{
+    memset(s, 0, sizeof(*s));
+    SceIoStat st; memset(&st, 0, sizeof(st));
+    if (!file_path || fs_io_getstat(file_path, &st) < 0 || st.st_size < (SceOff)sizeof(FsSnapHeader)) return -1;
+    SceUID fd = fs_io_open(file_path, SCE_O_RDONLY, 0);
+    if (fd < 0) return -1;
+
+    size_t size = (size_t)st.st_size;
+    uint8_t* buf = (uint8_t*)malloc(size);
+    size_t got = 0;
+    while (buf && got < size) {
+        int r = fs_io_read(fd, buf + got, (SceSize)(size - got));
+        if (r <= 0) break;
+        got += (size_t)r;
+    }
+    fs_io_close(fd);
+    if (!buf || got != size || fs_snapshot_attach(s, buf, size) < 0) { free(buf); return -1; }
+    s->owned = buf;
+    return 0;
+}
+
+// Reads just the header, to tell when a snapshot was taken
+int fs_snapshot_peek(const char* file_path, FsSnapHeader* out)
+{
+    SceUID fd = fs_io_open(file_path, SCE_O_RDONLY, 0);
+    if (fd < 0) return -1;
+    int r = fs_io_read(fd, out, sizeof(*out));
+    fs_io_close(fd);
+    if (r != (int)sizeof(*out) || out->magic != FS_SNAP_MAGIC || out->version != FS_SNAP_VERSION) return -1;
+    return 0;
+}
+
+void fs_snapshot_free(FsSnapshot* s)
+{
+    free(s->owned);
+    memset(s, 0, sizeof(*s));
+}
+
+const char* fs_snapshot_name(const FsSnapshot* s, uint32_t node)
+{
+    if (node >= s->node_count) return "";
+    uint32_t off = s->nodes[node].name & ~FS_SNAP_DIR;
+    return off < s->hdr->names_len ? s->names + off : "";
+}
+
+uint64_t fs_snapshot_size(const FsSnapshot* s, uint32_t node)
+{
+    if (node >= s->node_count) return 0;
+    uint32_t off = s->nodes[node].size_off, end = s->hdr->sizes_len;
+    uint64_t v = 0;
+    for (int shift = 0; off < end && shift < 64; shift += 7) {
+        uint8_t b = s->sizes[off++];
+        v |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) return v;
+    }
+    return 0;
+}
+
+// ---- diff -------------------------------------------------------------------
+
+typedef struct {
+    uint32_t end;    // first node past the folder's subtree
+    uint32_t len;    // of its path
+    uint64_t hash;   // of its path
+} WalkFrame;
+
+// Pre-order walk over the folders of a snapshot that keeps each folder's
+// path below the root and a hash of it chained from the parent's
+typedef struct {
+    const FsSnapshot* s;
+    WalkFrame* stack;
+    uint32_t   depth, cap;
+    uint32_t   i;
+    char       path[FS_SNAP_PATH];
+    uint64_t   hash;
+} SnapWalk;
+
+static int walk_init(SnapWalk* w, const FsSnapshot* s)
+{
+    memset(w, 0, sizeof(*w));
+    w->s = s;
+    w->cap = 64;
+    w->stack = (WalkFrame*)malloc(w->cap * sizeof(WalkFrame));
+    if (!w->stack) return -1;
+    w->stack[w->depth++] = (WalkFrame){ s->node_count, 0, 0 };
+    return 0;
+}
+
+// Next folder below the root, or FS_TREE_NONE once the walk is done
+static uint32_t walk_next(SnapWalk* w)
+{
+    const FsSnapshot* s = w->s;
+    while (++w->i < s->node_count) {
+        uint32_t i = w->i;
+        if (!(s->nodes[i].name & FS_SNAP_DIR)) continue;
+        while (w->depth > 1 && w->stack[w->depth - 1].end <= i) w->depth--;
+        const WalkFrame* p = &w->stack[w->depth - 1];
+
+        const char* name = fs_snapshot_name(s, i);
+        size_t nl = strlen(name);
+        uint32_t len = p->len;
+        if (len && len + 1 < FS_SNAP_PATH) w->path[len++] = '/';
+        size_t room = FS_SNAP_PATH - 1 - len;
+        memcpy(w->path + len, name, nl < room ? nl : room);
+        len += (uint32_t)(nl < room ? nl : room);
+        w->path[len] = '\0';
+        w->hash = fs_xxh64(name, nl, p->hash);
+
+        // A subtree never ends past its parent's
+        uint32_t end = s->nodes[i].next;
+        if (end <= i) end = i + 1;
+        if (end > p->end) end = p->end;
+        if (w->depth == w->cap) {
+            WalkFrame* st = (WalkFrame*)realloc(w->stack, w->cap * 2 * sizeof(WalkFrame));
+            if (!st) return FS_TREE_NONE;
+            w->stack = st;
+            w->cap *= 2;
+        }
+        w->stack[w->depth++] = (WalkFrame){ end, len, w->hash };
+        return i;
+    }
+    return FS_TREE_NONE;
+}
+
+static void offer(FsSnapChange* list, uint32_t* n, int64_t rank, int64_t delta, uint64_t before,
+                  uint64_t after, const char* path)
+{
+    uint32_t slot = *n;
+    if (*n == FS_DIFF_TOP) {
+        slot = 0;
+        for (uint32_t i = 1; i < FS_DIFF_TOP; ++i)
+            if (llabs(list[i].delta) < llabs(list[slot].delta)) slot = i;
+        if (llabs(list[slot].delta) >= rank) return;
+    } else {
+        (*n)++;
+    }
+    FsSnapChange* c = &list[slot];
+    c->delta = delta;
+    c->before = before;
+    c->after = after;
+    snprintf(c->path, sizeof(c->path), "%s", path);
+}
+
+static int cmp_change(const void* a, const void* b)
+{
+    int64_t x = llabs(((const FsSnapChange*)a)->delta), y = llabs(((const FsSnapChange*)b)->delta);
+    return x < y ? 1 : x > y ? -1 : 0;
+}
+
+static uint32_t slot_for(const uint64_t* keys, uint32_t mask, uint64_t key)
+{
+    uint32_t h = (uint32_t)(key ^ (key >> 32)) & mask;
+    while (keys[h] && keys[h] != key) h = (h + 1) & mask;
+    return h;
+}
+
+// Folders matched by path between two snapshots, ranked by how much they
+// grew or shrank. Folders only in `after` count as grown from nothing and
+// folders only in `before` as shrunk to nothing. Three linear walks: the
+// folders of `before` go into a table keyed by path hash, `after` is looked
+// up in it, and what was never looked up is what went away.
+int fs_snapshot_diff(const FsSnapshot* before, const FsSnapshot* after, FsSnapDiff* out)
+{
+    memset(out, 0, sizeof(*out));
+    if (!before || !before->hdr || !after || !after->hdr) return -1;
+
+    uint32_t folders = 0;
+    for (uint32_t i = 0; i < before->node_count; ++i) folders += (before->nodes[i].name & FS_SNAP_DIR) != 0;
+    uint32_t cap = 64;
+    while (cap < folders * 2) cap *= 2;
+    uint64_t* keys = (uint64_t*)calloc(cap, sizeof(uint64_t));
+    uint64_t* sizes = (uint64_t*)malloc((size_t)cap * sizeof(uint64_t));
+    uint8_t* seen = (uint8_t*)calloc(cap, 1);
+    SnapWalk w;
+    memset(&w, 0, sizeof(w));
+    int res = -1;
+    if (!keys || !sizes || !seen || walk_init(&w, before) < 0) goto done;
+
+    uint32_t i;
+    while ((i = walk_next(&w)) != FS_TREE_NONE) {
+        uint64_t key = w.hash ? w.hash : 1;
+        uint32_t h = slot_for(keys, cap - 1, key);
+        keys[h] = key;
+        sizes[h] = fs_snapshot_size(before, i);
+    }
+
+    free(w.stack);
+    if (walk_init(&w, after) < 0) goto done;
+    while ((i = walk_next(&w)) != FS_TREE_NONE) {
+        uint64_t key = w.hash ? w.hash : 1;
+        uint32_t h = slot_for(keys, cap - 1, key);
+        uint64_t was = 0, now = fs_snapshot_size(after, i);
+        if (keys[h]) { was = sizes[h]; seen[h] = 1; out->folders_compared++; }
+        else out->folders_added++;
+        int64_t delta = (int64_t)(now - was);
+        if (delta > 0) offer(out->grew, &out->grew_count, delta, delta, was, now, w.path);
+        else if (delta < 0) offer(out->shrank, &out->shrank_count, -delta, delta, was, now, w.path);
+    }
+
+    free(w.stack);
+    if (walk_init(&w, before) < 0) goto done;
+    while ((i = walk_next(&w)) != FS_TREE_NONE) {
+        uint32_t h = slot_for(keys, cap - 1, w.hash ? w.hash : 1);
+        if (seen[h]) continue;
+        seen[h] = 1;
+        out->folders_removed++;
+        uint64_t was = sizes[h];
+        if (was) offer(out->shrank, &out->shrank_count, (int64_t)was, -(int64_t)was, was, 0, w.path);
+    }
+
+    qsort(out->grew, out->grew_count, sizeof(FsSnapChange), cmp_change);
+    qsort(out->shrank, out->shrank_count, sizeof(FsSnapChange), cmp_change);
+    out->total_delta = (int64_t)(fs_snapshot_size(after, 0) - fs_snapshot_size(before, 0));
+    res = 0;
+
+done:
+    free(w.stack);
+    free(keys);
+    free(sizes);
+    free(seen);
+    return res;
+}
@@ -0,0 +1,759 @@
+#include "fs_spill.h"
+#include "fs_io.h"
+#include "fs_iter.h"
+#include <psp2/io/fcntl.h>
+#include <psp2/io/stat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define OUT_BUF   (64 * 1024)
+#define RUN_BUF   (16 * 1024)
+#define REC_MAX   (10 + FS_SPILL_PATH + 10 + 1)
+
+// ---- order ------------------------------------------------------------------
+
+static uint32_t put_varint(uint8_t* p, uint64_t v)
+{
+    uint32_t n = 0;
+    while (v >= 0x80) { p[n++] = (uint8_t)(v | 0x80); v >>= 7; }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+static const uint8_t* get_varint(const uint8_t* p, uint64_t* v)
+{
+    uint64_t r = 0;
+    int shift = 0;
+    do { r |= (uint64_t)(*p & 0x7f) << shift; shift += 7; } while (*p++ & 0x80);
+    *v = r;
+    return p;
+}
+
+// Byte order with '/' below every other byte, so that "a", "a/b" and "a-c"
+// sort in that order and a folder's subtree follows it without a gap
+int fs_path_compare(const char* a, size_t al, const char* b, size_t bl)
+{
+    size_t n = al < bl ? al : bl;
+    for (size_t i = 0; i < n; ++i) {
+        uint8_t ca = (uint8_t)a[i], cb = (uint8_t)b[i];
+        if (ca == cb) continue;
+        if (ca == '/') ca = 1;
+        if (cb == '/') cb = 1;
+        return (int)ca - (int)cb;
+    }
+    return (al > bl) - (al < bl);
+}
+
+static uint32_t common_prefix(const char* a, uint32_t al, const char* b, uint32_t bl)
+{
+    uint32_t n = al < bl ? al : bl, i = 0;
+    while (i < n && a[i] == b[i]) i++;
+    return i;
+}
+
+// Buffered records start with their path length
+static int cmp_buffered(const void* x, const void* y)
+{
+    uint64_t la, lb;
+    const uint8_t* a = get_varint(*(const uint8_t* const*)x, &la);
+    const uint8_t* b = get_varint(*(const uint8_t* const*)y, &lb);
+    return fs_path_compare((const char*)a, (size_t)la, (const char*)b, (size_t)lb);
+}
+
+// ---- memory -----------------------------------------------------------------
+
+static void* hold(FsSpill* s, size_t n)
+{
+    void* p = malloc(n);
+    if (!p) return NULL;
+    s->held += n;
+    if (s->held > s->stats.peak_bytes) s->stats.peak_bytes = s->held;
+    return p;
+}
+
+static void release(FsSpill* s, void* p, size_t n)
+{
+    if (!p) return;
+    free(p);
+    s->held -= n;
+}
+
+// ---- files ------------------------------------------------------------------
+
+typedef struct {
+    SceUID   fd;
+    uint8_t* buf;
+    uint32_t len;
+    uint32_t flushed;   // file offset of buf[0]
+    int      err;
+} Out;
+
+static int out_open(Out* o, const char* path, uint8_t* buf)
+{
+    o->fd = fs_io_open(path, SCE_O_WRONLY | SCE_O_CREAT | SCE_O_TRUNC, 0666);
+    o->buf = buf;
+    o->len = 0;
+    o->flushed = 0;
+    o->err = o->fd < 0;
+    return o->fd < 0 ? -1 : 0;
+}
+
+static void out_flush(Out* o)
+{
+    if (o->len && !o->err && fs_io_write(o->fd, o->buf, o->len) != (int)o->len) o->err = 1;
+    if ((uint64_t)o->flushed + o->len > 0xffffffffu) o->err = 1;
+    o->flushed += o->len;
+    o->len = 0;
+}
+
+static void out_put(Out* o, const void* data, uint32_t n)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    while (n > 0) {
+        if (o->len == OUT_BUF) out_flush(o);
+        uint32_t k = OUT_BUF - o->len < n ? OUT_BUF - o->len : n;
+        memcpy(o->buf + o->len, p, k);
+        o->len += k;
+        p += k;
+        n -= k;
+    }
+}
+
+static void out_varint(Out* o, uint64_t v)
+{
+    uint8_t tmp[10];
+    out_put(o, tmp, put_varint(tmp, v));
+}
+
+static uint32_t out_pos(const Out* o)
+{
+    return o->flushed + o->len;
+}
+
+// Overwrites a u32 already written, in the buffer or on disk
+static void out_patch(Out* o, uint32_t off, const void* data, uint32_t n)
+{
+    if (off >= o->flushed) { memcpy(o->buf + (off - o->flushed), data, n); return; }
+    if (fs_io_lseek(o->fd, off, SCE_SEEK_SET) < 0 || fs_io_write(o->fd, data, n) != (int)n ||
+        fs_io_lseek(o->fd, o->flushed, SCE_SEEK_SET) < 0) o->err = 1;
+}
+
+static int out_close(Out* o)
+{
+    out_flush(o);
+    if (o->fd >= 0) fs_io_close(o->fd);
+    o->fd = -1;
+    return o->err ? -1 : 0;
+}
+
+static int in_open(FsSpillReader* in, const char* path, uint8_t* buf, uint32_t cap)
+{
+    memset(in, 0, sizeof(*in));
+    in->fd = fs_io_open(path, SCE_O_RDONLY, 0);
+    in->buf = buf;
+    in->cap = cap;
+    return in->fd < 0 ? -1 : 0;
+}
+
+static void in_close(FsSpillReader* in)
+{
+    if (in->fd >= 0) fs_io_close(in->fd);
+    in->fd = -1;
+}
+
+static int in_fill(FsSpillReader* in)
+{
+    in->off += in->len;
+    in->pos = 0;
+    int r = fs_io_read(in->fd, in->buf, in->cap);
+    in->len = r > 0 ? (uint32_t)r : 0;
+    return r > 0 ? 0 : -1;
+}
+
+static int in_byte(FsSpillReader* in)
+{
+    if (in->pos == in->len && in_fill(in) < 0) return -1;
+    return in->buf[in->pos++];
+}
+
+static int in_read(FsSpillReader* in, void* dst, uint32_t n)
+{
+    uint8_t* d = (uint8_t*)dst;
+    while (n > 0) {
+        if (in->pos == in->len && in_fill(in) < 0) return -1;
+        uint32_t k = in->len - in->pos < n ? in->len - in->pos : n;
+        memcpy(d, in->buf + in->pos, k);
+        in->pos += k;
+        d += k;
+        n -= k;
+    }
+    return 0;
+}
+
+static int in_varint(FsSpillReader* in, uint64_t* v)
+{
+    uint64_t r = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int b = in_byte(in);
+        if (b < 0) return -1;
+        r |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) { *v = r; return 0; }
+    }
+    return -1;
+}
+
+static uint32_t in_tell(const FsSpillReader* in)
+{
+    return in->off + in->pos;
+}
+
+static int in_seek(FsSpillReader* in, uint32_t off)
+{
+    if (off >= in->off && off <= in->off + in->len) { in->pos = off - in->off; return 0; }
+    if (fs_io_lseek(in->fd, off, SCE_SEEK_SET) < 0) return -1;
+    in->off = off;
+    in->len = in->pos = 0;
+    return 0;
+}
+
+// Next record after `r`, whose path supplies the shared bytes. Returns 0 at
+// the end of the file, -1 on a broken record.
+static int read_record(FsSpillReader* in, FsSpillRecord* r, int with_end)
+{
+    uint64_t shared, rest;
+    if (in_varint(in, &shared) < 0) return 0;
+    if (in_varint(in, &rest) < 0 || shared > r->len || shared + rest >= FS_SPILL_PATH) return -1;
+    if (in_read(in, r->path + shared, (uint32_t)rest) < 0 || in_varint(in, &r->size) < 0) return -1;
+    r->len = (uint32_t)(shared + rest);
+    r->path[r->len] = '\0';
+    int flags = in_byte(in);
+    if (flags < 0) return -1;
+    r->flags = (uint32_t)flags;
+    r->end = 0;
+    if (with_end && (r->flags & FS_SPILL_DIR)) {
+        uint8_t e[4];
+        if (in_read(in, e, 4) < 0) return -1;
+        r->end = (uint32_t)e[0] | (uint32_t)e[1] << 8 | (uint32_t)e[2] << 16 | (uint32_t)e[3] << 24;
+    }
+    return 1;
+}
+
+static void run_path(const FsSpill* s, uint32_t id, char* out, size_t outsz)
+{
+    snprintf(out, outsz, "%s/run_%05u.tmp", s->tmp_dir, (unsigned)id);
+}
+
+// ---- runs -------------------------------------------------------------------
+
+typedef struct {
+    Out      out;
+    char     prev[FS_SPILL_PATH];
+    uint32_t prev_len;
+} RunWriter;
+
+static void run_put(RunWriter* w, const char* path, uint32_t len, uint64_t size, uint32_t flags)
+{
+    uint32_t shared = common_prefix(w->prev, w->prev_len, path, len);
+    out_varint(&w->out, shared);
+    out_varint(&w->out, len - shared);
+    out_put(&w->out, path + shared, len - shared);
+    out_varint(&w->out, size);
+    uint8_t f = (uint8_t)flags;
+    out_put(&w->out, &f, 1);
+    memcpy(w->prev + shared, path + shared, len - shared);
+    w->prev_len = len;
+}
+
+static int push_run(FsSpill* s, uint32_t id)
+{
+    if (s->run_count == s->run_cap) {
+        uint32_t cap = s->run_cap ? s->run_cap * 2 : 64;
+        uint32_t* runs = (uint32_t*)realloc(s->runs, cap * sizeof(uint32_t));
+        if (!runs) return -1;
+        s->runs = runs;
+        s->run_cap = cap;
+    }
+    s->runs[s->run_count++] = id;
+    return 0;
+}
+
+// Sorts the buffer and writes it out as the next run
+static int spill_run(FsSpill* s)
+{
+    if (!s->count) return 0;
+    if (!s->tmp_made) {
+        fs_io_mkdir(s->tmp_dir, 0777);
+        s->tmp_made = 1;
+    }
+    qsort(s->recs, s->count, sizeof(*s->recs), cmp_buffered);
+    char path[512];
+    uint32_t id = s->next_run++;
+    run_path(s, id, path, sizeof(path));
+    RunWriter* w = (RunWriter*)hold(s, sizeof(RunWriter));
+    if (!w || out_open(&w->out, path, s->out_buf) < 0) { release(s, w, sizeof(RunWriter)); return -1; }
+    w->prev_len = 0;
+    for (uint32_t i = 0; i < s->count; ++i) {
+        uint64_t len, size;
+        const uint8_t* p = get_varint(s->recs[i], &len);
+        const char* name = (const char*)p;
+        p = get_varint(p + len, &size);
+        run_put(w, name, (uint32_t)len, size, *p);
+    }
+    uint32_t bytes = out_pos(&w->out);
+    int res = out_close(&w->out);
+    release(s, w, sizeof(RunWriter));
+    if (res < 0 || push_run(s, id) < 0) { fs_io_remove(path); return -1; }
+    s->stats.runs++;
+    s->stats.spilled_bytes += bytes;
+    s->count = 0;
+    s->buf_len = 0;
+    return 0;
+}
+
+// ---- index ------------------------------------------------------------------
+
+typedef struct {
+    Out               out;
+    char              prev[FS_SPILL_PATH];
+    uint32_t          prev_len;
+    uint32_t          open_off[FS_SPILL_DEPTH];  // end fields of the folders still open
+    uint32_t          open_len[FS_SPILL_DEPTH];
+    uint32_t          depth;
+    uint32_t          last_restart;
+    uint32_t*         restarts;
+    uint32_t          restart_count, restart_cap;
+    FsPathIndexHeader hdr;
+} IndexWriter;
+
+static void put_u32(uint8_t* p, uint32_t v)
+{
+    p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); p[2] = (uint8_t)(v >> 16); p[3] = (uint8_t)(v >> 24);
+}
+
+// Folders whose subtree `path` is not part of end here
+static void close_folders(IndexWriter* w, const char* path, uint32_t len, uint32_t lcp)
+{
+    uint8_t end[4];
+    put_u32(end, out_pos(&w->out));
+    while (w->depth > 0) {
+        uint32_t dl = w->open_len[w->depth - 1];
+        if (path && lcp >= dl && len > dl && path[dl] == '/') break;
+        out_patch(&w->out, w->open_off[--w->depth], end, 4);
+    }
+}
+
+static void index_put(FsSpill* s, IndexWriter* w, const FsSpillRecord* r)
+{
+    uint32_t lcp = common_prefix(w->prev, w->prev_len, r->path, r->len);
+    close_folders(w, r->path, r->len, lcp);
+
+    // Never share more than the parent's path, so a reader that hopped over
+    // a sibling's subtree still holds every shared byte
+    const char* slash = strrchr(r->path, '/');
+    uint32_t parent = slash ? (uint32_t)(slash - r->path) + 1 : 0;
+    uint32_t shared = lcp < parent ? lcp : parent;
+    uint32_t pos = out_pos(&w->out);
+    if (w->restart_count == 0 || pos - w->last_restart >= FS_SPILL_BLOCK) {
+        if (w->restart_count == w->restart_cap) {
+            uint32_t cap = w->restart_cap ? w->restart_cap * 2 : 256;
+            uint32_t* grown = (uint32_t*)hold(s, cap * sizeof(uint32_t));
+            if (!grown) { s->err = 1; return; }
+            if (w->restarts) memcpy(grown, w->restarts, w->restart_count * sizeof(uint32_t));
+            release(s, w->restarts, w->restart_cap * sizeof(uint32_t));
+            w->restarts = grown;
+            w->restart_cap = cap;
+        }
+        w->restarts[w->restart_count++] = pos;
+        w->last_restart = pos;
+        shared = 0;
+    }
+    out_varint(&w->out, shared);
+    out_varint(&w->out, r->len - shared);
+    out_put(&w->out, r->path + shared, r->len - shared);
+    out_varint(&w->out, r->size);
+    uint8_t f = (uint8_t)r->flags;
+    out_put(&w->out, &f, 1);
+    if (r->flags & FS_SPILL_DIR) {
+        if (w->depth == FS_SPILL_DEPTH) { s->err = 1; return; }
+        w->open_off[w->depth] = out_pos(&w->out);
+        w->open_len[w->depth++] = r->len;
+        uint8_t zero[4] = { 0, 0, 0, 0 };
+        out_put(&w->out, zero, 4);
+        w->hdr.dirs++;
+    }
+    w->hdr.records++;
+    if (!slash) w->hdr.total_bytes += r->size;
+    memcpy(w->prev, r->path, r->len);
+    w->prev_len = r->len;
+}
+
+// ---- merge ------------------------------------------------------------------
+
+typedef struct {
+    FsSpillReader  in;
+    const uint8_t* const* mem;   // the sorted buffer instead of a run file
+    uint32_t       mem_i, mem_n;
+    FsSpillRecord  rec;
+} Cursor;
+
+static int cursor_next(Cursor* c)
+{
+    if (!c->mem) return read_record(&c->in, &c->rec, 0);
+    if (c->mem_i == c->mem_n) return 0;
+    uint64_t len, size;
+    const uint8_t* p = get_varint(c->mem[c->mem_i++], &len);
+    memcpy(c->rec.path, p, len);
+    c->rec.path[len] = '\0';
+    c->rec.len = (uint32_t)len;
+    p = get_varint(p + len, &size);
+    c->rec.size = size;
+    c->rec.flags = *p;
+    return 1;
+}
+
+static int cursor_less(const Cursor* a, const Cursor* b)
+{
+    return fs_path_compare(a->rec.path, a->rec.len, b->rec.path, b->rec.len) < 0;
+}
+
+static void sift_down(Cursor** heap, uint32_t n, uint32_t i)
+{
+    for (;;) {
+        uint32_t l = 2 * i + 1, m = i;
+        if (l < n && cursor_less(heap[l], heap[m])) m = l;
+        if (l + 1 < n && cursor_less(heap[l + 1], heap[m])) m = l + 1;
+        if (m == i) return;
+        Cursor* t = heap[i]; heap[i] = heap[m]; heap[m] = t;
+        i = m;
+    }
+}
+
+// Merges the first `n` runs, or the sorted buffer when n is 0, into a new
+// run, or into the index when `iw` is set
+static int merge(FsSpill* s, uint32_t n, RunWriter* rw, IndexWriter* iw)
+{
+    uint32_t sources = n ? n : 1;
+    size_t bytes = sources * (sizeof(Cursor) + sizeof(Cursor*) + (n ? RUN_BUF : 0));
+    uint8_t* mem = (uint8_t*)hold(s, bytes);
+    if (!mem) return -1;
+    Cursor* cur = (Cursor*)mem;
+    Cursor** heap = (Cursor**)(cur + sources);
+    uint8_t* bufs = (uint8_t*)(heap + sources);
+
+    int res = 0;
+    uint32_t live = 0;
+    for (uint32_t i = 0; i < sources; ++i) {
+        Cursor* c = &cur[i];
+        memset(c, 0, sizeof(*c));
+        c->in.fd = -1;
+        if (n) {
+            char path[512];
+            run_path(s, s->runs[i], path, sizeof(path));
+            if (in_open(&c->in, path, bufs + (size_t)i * RUN_BUF, RUN_BUF) < 0) { res = -1; continue; }
+        } else {
+            c->mem = s->recs;
+            c->mem_n = s->count;
+        }
+        int r = cursor_next(c);
+        if (r < 0) res = -1;
+        if (r > 0) heap[live++] = c;
+    }
+    for (uint32_t i = live / 2; i-- > 0;) sift_down(heap, live, i);
+
+    while (live > 0 && res == 0 && !s->err) {
+        Cursor* c = heap[0];
+        if (iw) index_put(s, iw, &c->rec);
+        else run_put(rw, c->rec.path, c->rec.len, c->rec.size, c->rec.flags);
+        int r = cursor_next(c);
+        if (r < 0) res = -1;
+        if (r <= 0) heap[0] = heap[--live];
+        sift_down(heap, live, 0);
+    }
+    for (uint32_t i = 0; i < sources; ++i) in_close(&cur[i].in);
+    release(s, mem, bytes);
+    return (res < 0 || s->err) ? -1 : 0;
+}
+
+// Drops the first `n` runs, files included
+static void drop_runs(FsSpill* s, uint32_t n)
+{
+    char path[512];
+    for (uint32_t i = 0; i < n; ++i) {
+        run_path(s, s->runs[i], path, sizeof(path));
+        fs_io_remove(path);
+    }
+    memmove(s->runs, s->runs + n, (s->run_count - n) * sizeof(uint32_t));
+    s->run_count -= n;
+}
+
+// ---- public API -------------------------------------------------------------
+
+// The buffer takes the budget but for one output buffer, with a sixth of
+// it going to the record pointers that get sorted
+int fs_spill_init(FsSpill* s, size_t budget, const char* tmp_dir, const char* root_path)
+{
+    memset(s, 0, sizeof(*s));
+    s->budget = budget < FS_SPILL_MIN ? FS_SPILL_MIN : budget;
+    snprintf(s->tmp_dir, sizeof(s->tmp_dir), "%s", tmp_dir);
+    snprintf(s->root_path, sizeof(s->root_path), "%s", root_path);
+    size_t avail = s->budget - OUT_BUF - sizeof(FsSpill);
+    s->rec_cap = (uint32_t)(avail / 6 / sizeof(*s->recs));
+    s->buf_cap = avail - (size_t)s->rec_cap * sizeof(*s->recs);
+    s->out_buf = (uint8_t*)hold(s, OUT_BUF);
+    s->recs = (const uint8_t**)hold(s, (size_t)s->rec_cap * sizeof(*s->recs));
+    s->buf = (uint8_t*)hold(s, s->buf_cap);
+    if (!s->out_buf || !s->recs || !s->buf) { fs_spill_free(s); return -1; }
+    return 0;
+}
+
+// Adds one entry, `path` below the root without a leading '/'
+int fs_spill_add(FsSpill* s, const char* path, uint64_t size, uint32_t flags)
+{
+    size_t len = strlen(path);
+    if (s->err || len == 0 || len >= FS_SPILL_PATH) return -1;
+    if ((s->count == s->rec_cap || s->buf_len + REC_MAX > s->buf_cap) && spill_run(s) < 0) { s->err = 1; return -1; }
+    uint8_t* p = s->buf + s->buf_len;
+    s->recs[s->count++] = p;
+    p += put_varint(p, len);
+    memcpy(p, path, len);
+    p += len;
+    p += put_varint(p, size);
+    *p++ = (uint8_t)flags;
+    s->buf_len = (size_t)(p - s->buf);
+    s->stats.records++;
+    return 0;
+}
+
+// Writes the index: straight from the buffer when nothing was spilled,
+// otherwise after merging the runs FS_SPILL_FANIN at a time until one pass
+// is left. The buffer is freed before any merge.
+int fs_spill_finish(FsSpill* s, const char* index_path)
+{
+    if (s->err) return -1;
+    int res = 0;
+    if (s->run_count > 0) {
+        if (spill_run(s) < 0) return -1;
+        release(s, s->buf, s->buf_cap);
+        release(s, s->recs, (size_t)s->rec_cap * sizeof(*s->recs));
+        s->buf = NULL;
+        s->recs = NULL;
+        s->buf_cap = s->buf_len = 0;
+        s->rec_cap = s->count = 0;
+    } else {
+        qsort(s->recs, s->count, sizeof(*s->recs), cmp_buffered);
+    }
+
+    while (res == 0 && s->run_count > FS_SPILL_FANIN) {
+        char path[512];
+        uint32_t id = s->next_run++;
+        run_path(s, id, path, sizeof(path));
+        RunWriter* w = (RunWriter*)hold(s, sizeof(RunWriter));
+        if (!w || out_open(&w->out, path, s->out_buf) < 0) { release(s, w, sizeof(RunWriter)); return -1; }
+        w->prev_len = 0;
+        res = merge(s, FS_SPILL_FANIN, w, NULL);
+        uint32_t bytes = out_pos(&w->out);
+        if (out_close(&w->out) < 0) res = -1;
+        release(s, w, sizeof(RunWriter));
+        if (res == 0) {
+            drop_runs(s, FS_SPILL_FANIN);
+            res = push_run(s, id);
+            s->stats.spilled_bytes += bytes;
+            s->stats.merge_passes++;
+        } else {
+            fs_io_remove(path);
+        }
+    }
+    if (res < 0) return -1;
+
+    IndexWriter* w = (IndexWriter*)hold(s, sizeof(IndexWriter));
+    if (!w) return -1;
+    memset(w, 0, sizeof(*w));
+    w->hdr.magic = FS_SPILL_MAGIC;
+    w->hdr.version = FS_SPILL_VERSION;
+    snprintf(w->hdr.root_path, sizeof(w->hdr.root_path), "%s", s->root_path);
+    if (out_open(&w->out, index_path, s->out_buf) < 0) { release(s, w, sizeof(IndexWriter)); return -1; }
+    out_put(&w->out, &w->hdr, sizeof(w->hdr));
+    w->hdr.data_off = out_pos(&w->out);
+    res = merge(s, s->run_count, NULL, w);
+    close_folders(w, NULL, 0, 0);
+    w->hdr.data_end = out_pos(&w->out);
+    w->hdr.restarts = w->restart_count;
+    for (uint32_t i = 0; i < w->restart_count; ++i) {
+        uint8_t b[4];
+        put_u32(b, w->restarts[i]);
+        out_put(&w->out, b, 4);
+    }
+    s->stats.index_bytes = out_pos(&w->out);
+    out_flush(&w->out);
+    out_patch(&w->out, 0, &w->hdr, sizeof(w->hdr));
+    if (out_close(&w->out) < 0) res = -1;
+    release(s, w->restarts, w->restart_cap * sizeof(uint32_t));
+    release(s, w, sizeof(IndexWriter));
+    drop_runs(s, s->run_count);
+    if (res < 0) fs_io_remove(index_path);
+    return res;
+}
+
+void fs_spill_free(FsSpill* s)
+{
+    if (s->runs) drop_runs(s, s->run_count);
+    if (s->tmp_made) fs_io_rmdir(s->tmp_dir);
+    free(s->runs);
+    free(s->out_buf);
+    free(s->recs);
+    free(s->buf);
+    s->runs = NULL;
+    s->out_buf = NULL;
+    s->recs = NULL;
+    s->buf = NULL;
+    s->run_count = s->run_cap = 0;
+    s->tmp_made = 0;
+}
+
+// Walks `root` into a path index within `budget` bytes, runs going to a
+// hidden folder on the same partition. Folders carry the size of their
+// subtree, summed on the way back up. The directory listings the walk
+// holds are on top of the budget.
+int fs_spill_scan(const char* root, size_t budget, const char* index_path, FsScanCtl* ctl, FsSpillStats* stats)
+{
+    char tmp[256];
+    size_t root_len = strlen(root);
+    snprintf(tmp, sizeof(tmp), "%s%s%s", root, (root_len && root[root_len - 1] == '/') ? "" : "/", FS_SPILL_TMP_NAME);
+    FsSpill s;
+    if (fs_spill_init(&s, budget, tmp, root) < 0) return -1;
+    FsIter it;
+    if (fs_iter_open(&it, root, FS_ITER_SKIP_TRASH) < 0) { fs_spill_free(&s); return -1; }
+
+    // sums[d] is the size so far of the folder whose entries sit at depth d
+    uint64_t* sums = NULL;
+    uint32_t sums_cap = 0;
+    int res = 0;
+    for (;;) {
+        FsIterEvent ev = fs_iter_next(&it);
+        if (ev == FS_ITER_END) break;
+        if (ctl && ctl->cancel) { res = -1; break; }
+        if (it.depth + 2 > sums_cap) {
+            uint32_t cap = sums_cap ? sums_cap * 2 : 64;
+            uint64_t* grown = (uint64_t*)realloc(sums, cap * sizeof(uint64_t));
+            if (!grown) { res = -1; break; }
+            if (!sums_cap) grown[1] = 0;
+            sums = grown;
+            sums_cap = cap;
+        }
+        const char* rel = it.path + root_len;
+        if (*rel == '/') rel++;
+        int ours = it.depth == 1 && !strcmp(it.name, FS_SPILL_TMP_NAME);
+        if (ev == FS_ITER_FILE) {
+            sums[it.depth] += it.size;
+            if (fs_spill_add(&s, rel, it.size, 0) < 0) { res = -1; break; }
+            if (ctl) { ctl->files++; ctl->bytes += it.size; }
+        } else if (ev == FS_ITER_DIR) {
+            if (ours) fs_iter_skip(&it);
+            else if (ctl) ctl->dirs++;
+            sums[it.depth + 1] = 0;
+        } else if (!ours) {
+            uint64_t total = sums[it.depth + 1];
+            sums[it.depth] += total;
+            if (fs_spill_add(&s, rel, total, FS_SPILL_DIR) < 0) { res = -1; break; }
+        }
+    }
+    free(sums);
+    fs_iter_close(&it);
+    if (res == 0) res = fs_spill_finish(&s, index_path);
+    if (stats) *stats = s.stats;
+    fs_spill_free(&s);
+    return res;
+}
+
+// ---- reading ----------------------------------------------------------------
+
+int fs_path_index_open(FsPathIndex* x, const char* file_path)
+{
+    memset(x, 0, sizeof(*x));
+    x->in.fd = -1;
+    uint8_t* buf = (uint8_t*)malloc(RUN_BUF);
+    if (!buf || in_open(&x->in, file_path, buf, RUN_BUF) < 0) { free(buf); return -1; }
+    FsPathIndexHeader* h = &x->hdr;
+    if (in_read(&x->in, h, sizeof(*h)) < 0 || h->magic != FS_SPILL_MAGIC || h->version != FS_SPILL_VERSION ||
+        h->data_off != sizeof(*h) || h->data_end < h->data_off) { fs_path_index_close(x); return -1; }
+    h->root_path[sizeof(h->root_path) - 1] = '\0';
+    x->restarts = (uint32_t*)malloc((h->restarts ? h->restarts : 1) * sizeof(uint32_t));
+    uint8_t b[4];
+    int ok = x->restarts && in_seek(&x->in, h->data_end) == 0;
+    for (uint32_t i = 0; ok && i < h->restarts; ++i) {
+        ok = in_read(&x->in, b, 4) == 0;
+        x->restarts[i] = (uint32_t)b[0] | (uint32_t)b[1] << 8 | (uint32_t)b[2] << 16 | (uint32_t)b[3] << 24;
+        ok = ok && x->restarts[i] >= h->data_off && x->restarts[i] < h->data_end;
+    }
+    if (!ok) { fs_path_index_close(x); return -1; }
+    return fs_path_index_rewind(x);
+}
+
+void fs_path_index_close(FsPathIndex* x)
+{
+    in_close(&x->in);
+    free(x->in.buf);
+    free(x->restarts);
+    x->in.buf = NULL;
+    x->restarts = NULL;
+}
+
+int fs_path_index_rewind(FsPathIndex* x)
+{
+    x->rec.len = 0;
+    return in_seek(&x->in, x->hdr.data_off);
+}
+
+// Every record in path order; NULL at the end
+const FsSpillRecord* fs_path_index_next(FsPathIndex* x)
+{
+    if (in_tell(&x->in) >= x->hdr.data_end) return NULL;
+    return read_record(&x->in, &x->rec, 1) > 0 ? &x->rec : NULL;
+}
+
+// Lists the entries right below `dir` ("" for the root), hopping over the
+// subtree of every subfolder. The folder itself is found from the last
+// restart point that does not sort after it.
+int fs_path_index_list(FsPathIndex* x, const char* dir, FsListing* out)
+{
+    fs_listing_clear(out);
+    size_t dl = strlen(dir);
+    uint32_t pos = x->hdr.data_off, end = x->hdr.data_end;
+    if (dl > 0) {
+        uint32_t lo = 0, hi = x->hdr.restarts;
+        while (lo < hi) {
+            uint32_t mid = (lo + hi) / 2;
+            x->rec.len = 0;
+            if (in_seek(&x->in, x->restarts[mid]) < 0 || read_record(&x->in, &x->rec, 1) <= 0) return -1;
+            if (fs_path_compare(x->rec.path, x->rec.len, dir, dl) <= 0) lo = mid + 1;
+            else hi = mid;
+        }
+        if (lo == 0) return -1;
+        x->rec.len = 0;
+        if (in_seek(&x->in, x->restarts[lo - 1]) < 0) return -1;
+        for (;;) {
+            if (in_tell(&x->in) >= x->hdr.data_end || read_record(&x->in, &x->rec, 1) <= 0) return -1;
+            int c = fs_path_compare(x->rec.path, x->rec.len, dir, dl);
+            if (c == 0) break;
+            if (c > 0) return -1;
+        }
+        if (!(x->rec.flags & FS_SPILL_DIR)) return -1;
+        pos = in_tell(&x->in);
+        end = x->rec.end;
+    } else {
+        x->rec.len = 0;
+    }
+
+    uint32_t skip = dl ? (uint32_t)dl + 1 : 0;
+    while (pos < end) {
+        if (in_seek(&x->in, pos) < 0 || read_record(&x->in, &x->rec, 1) <= 0 || x->rec.len <= skip) return -1;
+        int is_dir = (x->rec.flags & FS_SPILL_DIR) != 0;
+        if (fs_listing_add(out, x->rec.path + skip, x->rec.size, is_dir ? FS_ENTRY_DIR : 0) < 0) return -1;
+        uint32_t next = is_dir ? x->rec.end : in_tell(&x->in);
+        if (next <= pos || next > end) return -1;
+        pos = next;
+    }
+    fs_listing_sort(out);
+    return 0;
+}
@@ -0,0 +1,847 @@
+#include "fs_tree.h"
+#include "fs_walker.h"
+#include "fs_iter.h"
+#include "fs_io.h"
+#include <psp2/io/stat.h>
+#include <psp2/io/fcntl.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TREE_PATH_MAX 1024
+
+#define CACHE_MAGIC   0x49415346u // "FSAI"
+#define CACHE_VERSION 2 // 2: the root's trash folder is left out
+#define CANCEL_EVERY  4096 // nodes written or read between cancel checks
+#define LOAD_CHUNK    (256 * 1024) // cache bytes read between cancel checks
+
+// ---- arena / interning ------------------------------------------------------
+
+static uint32_t hash_name(const char* s, size_t len)
+{
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; ++i) { h ^= (uint8_t)s[i]; h *= 16777619u; }
+    return h;
+}
+
+// Whether the tree may take `extra` more bytes under ctl->max_bytes
+static int may_grow(FsTree* t, size_t extra)
+{
+    if (!t->ctl || !t->ctl->max_bytes) return 1;
+    size_t held = (size_t)t->node_cap * sizeof(FsNode) + t->names_cap + (size_t)t->intern_cap * sizeof(uint32_t);
+    if (held + extra <= t->ctl->max_bytes) return 1;
+    t->ctl->over_budget = 1;
+    return 0;
+}
+
+static uint32_t push_node(FsTree* t)
+{
+    if (t->node_count == t->node_cap) {
+        uint32_t cap = t->node_cap ? t->node_cap * 2 : 4096;
+        if (!may_grow(t, (size_t)(cap - t->node_cap) * sizeof(FsNode))) return FS_TREE_NONE;
+        FsNode* n = (FsNode*)realloc(t->nodes, (size_t)cap * sizeof(FsNode));
+        if (!n) return FS_TREE_NONE;
+        t->nodes = n;
+        t->node_cap = cap;
+    }
+    FsNode* n = &t->nodes[t->node_count];
+    memset(n, 0, sizeof(*n));
+    n->parent = FS_TREE_NONE;
+    return t->node_count++;
+}
+
+static int intern_grow(FsTree* t)
+{
+    uint32_t cap = t->intern_cap ? t->intern_cap * 2 : 4096;
+    if (!may_grow(t, (size_t)cap * sizeof(uint32_t))) return -1;
+    uint32_t* slots = (uint32_t*)calloc(cap, sizeof(uint32_t));
+    if (!slots) return -1;
+    for (uint32_t i = 0; i < t->intern_cap; ++i) {
+        uint32_t v = t->intern[i];
+        if (!v) continue;
+        const char* s = t->names + (v - 1);
+        uint32_t h = hash_name(s, strlen(s)) & (cap - 1);
+        while (slots[h]) h = (h + 1) & (cap - 1);
+        slots[h] = v;
+    }
+    free(t->intern);
+    t->intern = slots;
+    t->intern_cap = cap;
+    return 0;
+}
+
+static uint32_t intern_name(FsTree* t, const char* s)
+{
+    if ((t->intern_used + 1) * 10 >= t->intern_cap * 7 && intern_grow(t) < 0) return FS_TREE_NONE;
+
+    size_t len = strlen(s);
+    uint32_t h = hash_name(s, len) & (t->intern_cap - 1);
+    while (t->intern[h]) {
+        const char* cur = t->names + (t->intern[h] - 1);
+        if (!strcmp(cur, s)) return t->intern[h] - 1;
+        h = (h + 1) & (t->intern_cap - 1);
+    }
+
+    if (t->names_len + len + 1 > t->names_cap) {
+        uint32_t cap = t->names_cap ? t->names_cap : 65536;
+        while (t->names_len + len + 1 > cap) cap *= 2;
+        if (!may_grow(t, cap - t->names_cap)) return FS_TREE_NONE;
+        char* p = (char*)realloc(t->names, cap);
+        if (!p) return FS_TREE_NONE;
+        t->names = p;
+        t->names_cap = cap;
+    }
+    uint32_t off = t->names_len;
+    memcpy(t->names + off, s, len + 1);
+    t->names_len += (uint32_t)len + 1;
+    t->intern[h] = off + 1;
+    t->intern_used++;
+    return off;
+}
+
+// ---- building ---------------------------------------------------------------
+
+static int cmp_size_desc(const void* a, const void* b)
+{
+    const FsNode* x = (const FsNode*)a;
+    const FsNode* y = (const FsNode*)b;
+    if (x->size_bytes != y->size_bytes) return (x->size_bytes < y->size_bytes) ? 1 : -1;
+    return 0;
+}
+
+// Sorts a directory's children and repoints grandchildren at their moved parents.
+static void sort_children(FsTree* t, uint32_t dir)
+{
+    FsNode* d = &t->nodes[dir];
+    if (d->child_count < 2) return;
+    qsort(&t->nodes[d->first_child], d->child_count, sizeof(FsNode), cmp_size_desc);
+    for (uint32_t i = d->first_child; i < d->first_child + d->child_count; ++i) {
+        const FsNode* c = &t->nodes[i];
+        for (uint32_t j = c->first_child; j < c->first_child + c->child_count; ++j)
+            t->nodes[j].parent = i;
+    }
+}
+
+// Sets a directory's file and folder counts and newest mtime from its
+// children, whose own counts are already final
+static void count_children(FsTree* t, uint32_t dir)
+{
+    FsNode* d = &t->nodes[dir];
+    uint32_t files = 0, dirs = 0, newest = 0;
+    for (uint32_t i = d->first_child; i < d->first_child + d->child_count; ++i) {
+        const FsNode* c = &t->nodes[i];
+        files += c->files;
+        dirs += c->dirs + ((c->flags & FS_NODE_DIR) ? 1 : 0);
+        if (c->newest > newest) newest = c->newest;
+    }
+    d->files = files;
+    d->dirs = dirs;
+    d->newest = newest;
+}
+
+static void count_file_node(FsNode* n)
+{
+    n->files = 1;
+    n->dirs = 0;
+    n->newest = n->mtime;
+}
+
+static size_t append_component(char* path, size_t len, size_t cap, const char* name)
+{
+    size_t nl = strlen(name);
+    int slash = (len > 0 && path[len-1] != '/');
+    if (len + slash + nl + 1 > cap) return 0;
+    if (slash) path[len++] = '/';
+    memcpy(path + len, name, nl + 1);
+    return len + nl;
+}
+
+typedef struct {
+    const char* name;
+    uint32_t    index;
+} NameRef;
+
+static int cmp_name_ref(const void* a, const void* b)
+{
+    return strcmp(((const NameRef*)a)->name, ((const NameRef*)b)->name);
+}
+
+static void count_file(FsScanCtl* ctl, const FsNode* n)
+{
+    if (n->flags & FS_NODE_DIR) return;
+    ctl->files++;
+    ctl->bytes += n->size_bytes;
+}
+
+// One directory on the build stack: its child block is filled in, and its
+// children from `next` on are still to be walked. A reused block mirrors
+// prev_dir's children one to one; a freshly listed one is matched through
+// the name-sorted refs.
+typedef struct {
+    uint32_t dir;
+    uint32_t prev_dir;   // counterpart in the previous tree, or FS_TREE_NONE
+    uint32_t next;
+    uint32_t path_len;
+    int      reused;
+    NameRef* refs;
+    uint32_t ref_count;
+} BuildFrame;
+
+// Unchanged directory: copies the cached child block instead of listing it.
+// Subdirectories are still stat'ed, since their contents may have changed.
+static int reuse_children(FsTree* t, uint32_t dir, const char* path, const FsTree* prev, uint32_t prev_dir)
+{
+    const FsNode* pd = &prev->nodes[prev_dir];
+    uint32_t first = t->node_count;
+    fs_walker_reuse(t->walker, path);
+    for (uint32_t j = pd->first_child; j < pd->first_child + pd->child_count; ++j) {
+        const FsNode* src = &prev->nodes[j];
+        uint32_t name = intern_name(t, prev->names + src->name);
+        uint32_t idx = (name == FS_TREE_NONE) ? FS_TREE_NONE : push_node(t);
+        if (idx == FS_TREE_NONE) return -1;
+        FsNode* n = &t->nodes[idx];
+        n->name = name;
+        n->parent = dir;
+        n->flags = src->flags;
+        n->mtime = src->mtime;
+        if (!(src->flags & FS_NODE_DIR)) n->size_bytes = src->size_bytes;
+        if (t->ctl) count_file(t->ctl, n);
+    }
+    t->nodes[dir].first_child = first;
+    t->nodes[dir].child_count = t->node_count - first;
+    t->dirs_reused++;
+    return 0;
+}
+
+// Fills the child block of f->dir, from the previous tree when its mtime did
+// not change and from the disk otherwise. Returns 1 for an unreadable
+// directory, which keeps the block it had, and -1 when memory runs out.
+static int open_dir(FsTree* t, BuildFrame* f, const char* path, const FsTree* prev)
+{
+    uint32_t dir = f->dir, prev_dir = f->prev_dir;
+    f->next = 0;
+    f->refs = NULL;
+    f->ref_count = 0;
+    f->reused = prev && prev_dir != FS_TREE_NONE && t->nodes[dir].mtime != 0 &&
+                prev->nodes[prev_dir].mtime == t->nodes[dir].mtime;
+    if (f->reused) return reuse_children(t, dir, path, prev, prev_dir);
+
+    FsWalkListing* l = NULL;
+    if (fs_walker_list(t->walker, path, prev_dir, dir == 0 ? FS_ITER_SKIP_TRASH : 0, &l) < 0) return -1;
+    if (!l) return 1;
+
+    uint32_t first = t->node_count;
+    for (uint32_t k = 0; k < l->count; ++k) {
+        const FsWalkEntry* e = &l->entries[k];
+        uint32_t name = intern_name(t, l->names + e->name);
+        uint32_t idx = (name == FS_TREE_NONE) ? FS_TREE_NONE : push_node(t);
+        if (idx == FS_TREE_NONE) { fs_walker_free_listing(l); return -1; }
+
+        FsNode* n = &t->nodes[idx];
+        n->name = name;
+        n->parent = dir;
+        n->mtime = e->mtime;
+        if (e->is_dir) n->flags = FS_NODE_DIR;
+        else n->size_bytes = e->size;
+        if (t->ctl) {
+            count_file(t->ctl, n);
+            if (t->ctl->cancel) { fs_walker_free_listing(l); return -1; }
+        }
+    }
+    fs_walker_free_listing(l);
+
+    t->nodes[dir].first_child = first;
+    t->nodes[dir].child_count = t->node_count - first;
+    t->dirs_read++;
+
+    // Changed directory: match subdirectories against the cache by name
+    if (prev && prev_dir != FS_TREE_NONE && prev->nodes[prev_dir].child_count > 0) {
+        const FsNode* pd = &prev->nodes[prev_dir];
+        f->refs = (NameRef*)malloc(pd->child_count * sizeof(NameRef));
+        if (f->refs) {
+            for (uint32_t j = 0; j < pd->child_count; ++j) {
+                f->refs[j].name = prev->names + prev->nodes[pd->first_child + j].name;
+                f->refs[j].index = pd->first_child + j;
+            }
+            f->ref_count = pd->child_count;
+            qsort(f->refs, f->ref_count, sizeof(NameRef), cmp_name_ref);
+        }
+    }
+    return 0;
+}
+
+// Everything below `dir` is in place: aggregates its size, file and folder
+// counts and newest mtime, and sorts its children.
+static void close_dir(FsTree* t, uint32_t dir)
+{
+    const FsNode* d = &t->nodes[dir];
+    uint64_t total = 0;
+    for (uint32_t i = d->first_child; i < d->first_child + d->child_count; ++i) total += t->nodes[i].size_bytes;
+    t->nodes[dir].size_bytes = total;
+    count_children(t, dir);
+    sort_children(t, dir);
+    if (t->ctl) {
+        t->ctl->dirs++;
+        if (t->ctl->on_dir_done) t->ctl->on_dir_done(t->ctl, t, dir);
+    }
+}
+
+// Reads `top` and everything below it depth first, with an explicit stack
+// like FsIter, so depth only costs memory. Returns -1 only when memory runs
+// out or on cancel; unreadable directories count as empty and paths longer
+// than TREE_PATH_MAX are skipped. With a previous tree, directories whose
+// mtime did not change are reused.
+static int read_tree(FsTree* t, uint32_t top, char* path, size_t len, const FsTree* prev, uint32_t prev_top)
+{
+    uint32_t depth = 0, cap = 16;
+    BuildFrame* stack = (BuildFrame*)malloc(cap * sizeof(BuildFrame));
+    if (!stack) return -1;
+    stack[0].dir = top;
+    stack[0].prev_dir = prev_top;
+    stack[0].path_len = (uint32_t)len;
+    int res = open_dir(t, &stack[0], path, prev);
+    if (res == 0) depth = 1;
+
+    while (res == 0 && depth > 0) {
+        if (t->ctl && t->ctl->cancel) { res = -1; break; }
+        BuildFrame* f = &stack[depth - 1];
+        uint32_t first = t->nodes[f->dir].first_child;
+        uint32_t count = t->nodes[f->dir].child_count;
+
+        // Files are final as listed; stop at the next subdirectory
+        uint32_t child = FS_TREE_NONE;
+        size_t nl = 0;
+        while (f->next < count && child == FS_TREE_NONE) {
+            uint32_t i = first + f->next++;
+            if (!(t->nodes[i].flags & FS_NODE_DIR)) { count_file_node(&t->nodes[i]); continue; }
+            nl = append_component(path, f->path_len, TREE_PATH_MAX, t->names + t->nodes[i].name);
+            if (nl > 0) child = i;
+        }
+        if (child == FS_TREE_NONE) {
+            close_dir(t, f->dir);
+            free(f->refs);
+            depth--;
+            continue;
+        }
+
+        uint32_t pc = FS_TREE_NONE;
+        if (f->reused) {
+            pc = prev->nodes[f->prev_dir].first_child + (child - first);
+            t->nodes[child].mtime = fs_walker_mtime(t->walker, path);
+        } else if (f->refs) {
+            NameRef key = { t->names + t->nodes[child].name, 0 };
+            const NameRef* hit = (const NameRef*)bsearch(&key, f->refs, f->ref_count, sizeof(NameRef), cmp_name_ref);
+            if (hit && (prev->nodes[hit->index].flags & FS_NODE_DIR)) pc = hit->index;
+        }
+        if (depth == cap) {
+            BuildFrame* s = (BuildFrame*)realloc(stack, (size_t)cap * 2 * sizeof(BuildFrame));
+            if (!s) { res = -1; break; }
+            stack = s;
+            cap *= 2;
+        }
+        BuildFrame* c = &stack[depth];
+        c->dir = child;
+        c->prev_dir = pc;
+        c->path_len = (uint32_t)nl;
+        res = open_dir(t, c, path, prev);
+        if (res == 0) depth++;
+        else if (res > 0) res = 0; // unreadable: stays an empty folder
+    }
+    for (uint32_t d = 0; d < depth; ++d) free(stack[d].refs);
+    free(stack);
+    return res < 0 ? -1 : 0;
+}
+
+static uint32_t g_gen;
+
+// Stamps a tree whose sizes or layout changed, so caches built from it can
+// tell. Trees are built on scanner threads as well.
+static void touch(FsTree* t)
+{
+    t->gen = __atomic_add_fetch(&g_gen, 1, __ATOMIC_RELAXED);
+}
+
+// ---- public API -------------------------------------------------------------
+
+void fs_tree_init(FsTree* t)
+{
+    memset(t, 0, sizeof(*t));
+}
+
+void fs_tree_free(FsTree* t)
+{
+    free(t->nodes);
+    free(t->names);
+    free(t->intern);
+    fs_tree_init(t);
+}
+
+// Walks root_path into t. If prev holds an earlier tree of the same root
+// (e.g. loaded from the on-disk cache), only changed directories are listed.
+// With ctl->threads > 1, worker threads list directories ahead of the walk.
+int fs_tree_build(FsTree* t, const char* root_path, const FsTree* prev, FsScanCtl* ctl)
+{
+    if (!t || !root_path) return -1;
+    fs_tree_free(t);
+    snprintf(t->root_path, sizeof(t->root_path), "%s", root_path);
+    if (prev && (prev->node_count == 0 || strcmp(prev->root_path, root_path) != 0)) prev = NULL;
+
+    uint32_t root = push_node(t);
+    uint32_t name = (root == FS_TREE_NONE) ? FS_TREE_NONE : intern_name(t, "");
+    if (name == FS_TREE_NONE) { fs_tree_free(t); return -1; }
+    t->nodes[root].name = name;
+    t->nodes[root].flags = FS_NODE_DIR;
+
+    t->nodes[root].mtime = fs_walker_mtime(NULL, root_path);
+
+    char path[TREE_PATH_MAX];
+    snprintf(path, sizeof(path), "%s", root_path);
+    t->ctl = ctl;
+    t->walker = (ctl && ctl->threads > 1) ? fs_walker_create(ctl->threads - 1, prev) : NULL;
+    int res = read_tree(t, root, path, strlen(path), prev, prev ? 0 : FS_TREE_NONE);
+    fs_walker_destroy(t->walker);
+    t->walker = NULL;
+    t->ctl = NULL;
+    if (res < 0) { fs_tree_free(t); return -1; }
+    touch(t);
+    return 0;
+}
+
+// Re-walks one directory after it changed on disk and carries the size delta
+// up to the root. The old child block is left behind until the next build.
+int fs_tree_refresh(FsTree* t, uint32_t node)
+{
+    if (!t || node >= t->node_count || !(t->nodes[node].flags & FS_NODE_DIR)) return -1;
+
+    char path[TREE_PATH_MAX];
+    if (fs_tree_path(t, node, path, sizeof(path)) < 0) return -1;
+
+    uint64_t old_size = t->nodes[node].size_bytes;
+    if (read_tree(t, node, path, strlen(path), NULL, FS_TREE_NONE) < 0) return -1;
+    uint64_t delta = t->nodes[node].size_bytes - old_size;
+
+    for (uint32_t p = t->nodes[node].parent; p != FS_TREE_NONE; p = t->nodes[p].parent) {
+        t->nodes[p].size_bytes += delta;
+        sort_children(t, p);
+        count_children(t, p);
+    }
+    touch(t);
+    return 0;
+}
+
+// Points the children of the node at `slot` back at it after it moved
+static void relink_children(FsTree* t, uint32_t slot)
+{
+    const FsNode* n = &t->nodes[slot];
+    for (uint32_t j = n->first_child; j < n->first_child + n->child_count; ++j) t->nodes[j].parent = slot;
+}
+
+// Drops `node` from its parent after it left the disk and takes its size off
+// every ancestor, without reading anything. The node is swapped to the end
+// of the child block and cut off; its subtree stays behind until the next
+// build, like a refreshed-away block.
+int fs_tree_remove(FsTree* t, uint32_t node)
+{
+    if (!t || node == 0 || node >= t->node_count) return -1;
+    uint32_t dir = t->nodes[node].parent;
+    if (dir == FS_TREE_NONE) return -1;
+    FsNode* d = &t->nodes[dir];
+    if (node < d->first_child || node >= d->first_child + d->child_count) return -1;
+
+    uint64_t size = t->nodes[node].size_bytes;
+    uint32_t last = d->first_child + d->child_count - 1;
+    if (node != last) {
+        FsNode tmp = t->nodes[node];
+        t->nodes[node] = t->nodes[last];
+        t->nodes[last] = tmp;
+        relink_children(t, node);
+        relink_children(t, last);
+    }
+    d->child_count--;
+
+    for (uint32_t p = dir; p != FS_TREE_NONE; p = t->nodes[p].parent) {
+        t->nodes[p].size_bytes -= size;
+        sort_children(t, p);
+        count_children(t, p);
+    }
+    touch(t);
+    return 0;
+}
+
+uint32_t fs_tree_lookup(const FsTree* t, const char* path)
+{
+    if (!t || !path || t->node_count == 0) return FS_TREE_NONE;
+    size_t rl = strlen(t->root_path);
+    while (rl > 0 && t->root_path[rl-1] == '/') rl--;
+    if (strncmp(path, t->root_path, rl) != 0) return FS_TREE_NONE;
+
+    uint32_t node = 0;
+    const char* p = path + rl;
+    while (*p) {
+        while (*p == '/') p++;
+        if (!*p) break;
+        const char* end = strchr(p, '/');
+        size_t cl = end ? (size_t)(end - p) : strlen(p);
+
+        const FsNode* d = &t->nodes[node];
+        uint32_t found = FS_TREE_NONE;
+        for (uint32_t i = d->first_child; i < d->first_child + d->child_count; ++i) {
+            const char* nm = t->names + t->nodes[i].name;
+            if (!strncmp(nm, p, cl) && nm[cl] == '\0') { found = i; break; }
+        }
+        if (found == FS_TREE_NONE) return FS_TREE_NONE;
+        node = found;
+        p += cl;
+    }
+    return node;
+}
+
+const char* fs_tree_name(const FsTree* t, uint32_t node)
+{
+    if (!t || node >= t->node_count) return "";
+    return t->names + t->nodes[node].name;
+}
+
+int fs_tree_path(const FsTree* t, uint32_t node, char* out, int outsz)
+{
+    if (!t || !out || outsz <= 0 || node >= t->node_count) return -1;
+    if (node == 0 || t->nodes[node].parent == FS_TREE_NONE) {
+        snprintf(out, outsz, "%s", t->root_path);
+        return 0;
+    }
+    if (fs_tree_path(t, t->nodes[node].parent, out, outsz) < 0) return -1;
+    if (append_component(out, strlen(out), (size_t)outsz, fs_tree_name(t, node)) == 0) return -1;
+    return 0;
+}
+
+// Sums the files below `node` that match one of the extensions, from memory.
+uint64_t fs_tree_size_by_extension(const FsTree* t, uint32_t node, const char** extensions, int ext_count)
+{
+    if (!t || node >= t->node_count) return 0;
+    if (!extensions || ext_count <= 0) return t->nodes[node].size_bytes;
+
+    uint32_t* stack = (uint32_t*)malloc((size_t)t->node_count * sizeof(uint32_t));
+    if (!stack) return 0;
+    uint32_t sp = 0;
+    uint64_t total = 0;
+    stack[sp++] = node;
+    while (sp > 0) {
+        const FsNode* d = &t->nodes[stack[--sp]];
+        for (uint32_t c = d->first_child; c < d->first_child + d->child_count; ++c) {
+            const FsNode* n = &t->nodes[c];
+            if (n->flags & FS_NODE_DIR) stack[sp++] = c;
+            else if (fs_match_extension(t->names + n->name, extensions, ext_count)) total += n->size_bytes;
+        }
+    }
+    free(stack);
+    return total;
+}
+
+// One pass over everything below `node`, filling all category and extension
+// totals at once, plus each direct child's share of every category so a
+// filtered folder can be listed child by child. `cancel` is looked at once
+// per folder; a cancelled pass returns -1.
+int fs_tree_type_stats(const FsTree* t, uint32_t node, FsTypeStats* out, volatile int* cancel)
+{
+    if (!t || !out || node >= t->node_count) return -1;
+    fs_type_stats_clear(out);
+    const FsNode* top = &t->nodes[node];
+    if (fs_type_stats_set_children(out, top->child_count) < 0) return -1;
+
+    // (directory, row of the direct child it sits under) pairs
+    uint32_t* stack = (uint32_t*)malloc((size_t)t->node_count * 2 * sizeof(uint32_t));
+    if (!stack) return -1;
+    uint32_t sp = 0;
+    int res = 0;
+    for (uint32_t i = 0; i < top->child_count && res >= 0; ++i) {
+        const FsNode* n = &t->nodes[top->first_child + i];
+        if (n->flags & FS_NODE_DIR) {
+            stack[sp++] = top->first_child + i;
+            stack[sp++] = i;
+        } else if ((res = fs_type_stats_add(out, t->names + n->name, n->size_bytes)) >= 0) {
+            out->child_bytes[(size_t)i * FS_CAT_COUNT + res] += n->size_bytes;
+        }
+    }
+    while (sp > 0 && res >= 0) {
+        if (cancel && *cancel) { res = -1; break; }
+        uint32_t row = stack[--sp];
+        const FsNode* d = &t->nodes[stack[--sp]];
+        uint64_t* bytes = &out->child_bytes[(size_t)row * FS_CAT_COUNT];
+        for (uint32_t c = d->first_child; c < d->first_child + d->child_count && res >= 0; ++c) {
+            const FsNode* n = &t->nodes[c];
+            if (n->flags & FS_NODE_DIR) {
+                stack[sp++] = c;
+                stack[sp++] = row;
+            } else if ((res = fs_type_stats_add(out, t->names + n->name, n->size_bytes)) >= 0) {
+                bytes[res] += n->size_bytes;
+            }
+        }
+    }
+    free(stack);
+    return res < 0 ? -1 : 0;
+}
+
+// Bucket of a file size: 0 for empty files, else one past the top bit
+int fs_size_bucket(uint64_t size_bytes)
+{
+    int b = 0;
+    while (size_bytes && b < FS_SIZE_BUCKETS - 1) { size_bytes >>= 1; b++; }
+    return b;
+}
+
+static int age_bucket(uint32_t mtime, uint32_t now)
+{
+    if (mtime == 0) return FS_AGE_UNKNOWN;
+    uint32_t age = (now > mtime) ? now - mtime : 0;
+    if (age < 30u * 86400u) return FS_AGE_MONTH;
+    if (age < 365u * 86400u) return FS_AGE_YEAR;
+    if (age < 3u * 365u * 86400u) return FS_AGE_3_YEARS;
+    return FS_AGE_OLDER;
+}
+
+static void add_file_stats(FsFolderStats* out, const FsNode* n, uint32_t now)
+{
+    int b = fs_size_bucket(n->size_bytes), a = age_bucket(n->mtime, now);
+    uint32_t tail = (uint32_t)(n->size_bytes % FS_CLUSTER_BYTES);
+    out->size_files[b]++;
+    out->size_bytes[b] += n->size_bytes;
+    out->age_files[a]++;
+    out->age_bytes[a] += n->size_bytes;
+    if (tail) out->slack_bytes += FS_CLUSTER_BYTES - tail;
+}
+
+// Size histogram, age buckets and cluster slack of the files below `node`,
+// from the sizes and mtimes the walk already keeps. Ages are relative to
+// `now`, in seconds since 1970.
+int fs_tree_folder_stats(const FsTree* t, uint32_t node, uint32_t now, FsFolderStats* out)
+{
+    if (!t || !out || node >= t->node_count) return -1;
+    memset(out, 0, sizeof(*out));
+    const FsNode* top = &t->nodes[node];
+    out->files = top->files;
+    out->dirs = top->dirs;
+    out->newest = top->newest;
+    if (!(top->flags & FS_NODE_DIR)) { add_file_stats(out, top, now); return 0; }
+
+    // Every directory is pushed once
+    uint32_t* stack = (uint32_t*)malloc(((size_t)top->dirs + 1) * sizeof(uint32_t));
+    if (!stack) return -1;
+    uint32_t sp = 0;
+    stack[sp++] = node;
+    while (sp > 0) {
+        const FsNode* d = &t->nodes[stack[--sp]];
+        for (uint32_t c = d->first_child; c < d->first_child + d->child_count; ++c) {
+            if (t->nodes[c].flags & FS_NODE_DIR) stack[sp++] = c;
+            else add_file_stats(out, &t->nodes[c], now);
+        }
+    }
+    free(stack);
+    return 0;
+}
+
+// ---- on-disk cache ----------------------------------------------------------
+//
+// Layout: header, raw name pool, then one varint record per node in
+// breadth-first order, so every directory's children stay contiguous and
+// first_child can be recomputed while loading.
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t node_count;
+    uint32_t names_len;
+    char     root_path[256];
+} CacheHeader;
+
+typedef struct {
+    SceUID  fd;
+    uint8_t buf[65536];
+    int     len;
+    int     err;
+} CacheWriter;
+
+static void cw_flush(CacheWriter* w)
+{
+    if (w->len > 0 && !w->err && fs_io_write(w->fd, w->buf, w->len) != w->len) w->err = 1;
+    w->len = 0;
+}
+
+static void cw_bytes(CacheWriter* w, const void* data, uint32_t n)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    while (n > 0) {
+        if (w->len == (int)sizeof(w->buf)) cw_flush(w);
+        uint32_t chunk = (uint32_t)sizeof(w->buf) - (uint32_t)w->len;
+        if (chunk > n) chunk = n;
+        memcpy(w->buf + w->len, p, chunk);
+        w->len += (int)chunk; p += chunk; n -= chunk;
+    }
+}
+
+static void cw_varint(CacheWriter* w, uint64_t v)
+{
+    uint8_t tmp[10]; int n = 0;
+    do { uint8_t b = v & 0x7F; v >>= 7; tmp[n++] = b | (v ? 0x80 : 0); } while (v);
+    cw_bytes(w, tmp, n);
+}
+
+static int read_varint(const uint8_t** p, const uint8_t* end, uint64_t* out)
+{
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64 && *p < end; shift += 7) {
+        uint8_t b = *(*p)++;
+        v |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) { *out = v; return 0; }
+    }
+    return -1;
+}
+
+// Writes the cache next to file_path and swaps it in. Setting *cancel, when
+// given, stops the write and leaves the old cache in place.
+int fs_tree_save(const FsTree* t, const char* file_path, volatile int* cancel)
+{
+    if (!t || !file_path || t->node_count == 0) return -1;
+
+    // Breadth-first order over reachable nodes; refreshed-away blocks are dropped
+    uint32_t* order = (uint32_t*)malloc((size_t)t->node_count * sizeof(uint32_t));
+    if (!order) return -1;
+    uint32_t qn = 0;
+    order[qn++] = 0;
+    for (uint32_t qi = 0; qi < qn; ++qi) {
+        const FsNode* n = &t->nodes[order[qi]];
+        if (!(n->flags & FS_NODE_DIR)) continue;
+        for (uint32_t c = n->first_child; c < n->first_child + n->child_count; ++c) order[qn++] = c;
+    }
+
+    char tmp_path[TREE_PATH_MAX];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", file_path);
+    CacheWriter* w = (CacheWriter*)malloc(sizeof(CacheWriter));
+    if (!w) { free(order); return -1; }
+    w->fd = fs_io_open(tmp_path, SCE_O_WRONLY | SCE_O_CREAT | SCE_O_TRUNC, 0777);
+    w->len = 0;
+    w->err = 0;
+    if (w->fd < 0) { free(w); free(order); return -1; }
+
+    CacheHeader hdr; memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = CACHE_MAGIC;
+    hdr.version = CACHE_VERSION;
+    hdr.node_count = qn;
+    hdr.names_len = t->names_len;
+    snprintf(hdr.root_path, sizeof(hdr.root_path), "%s", t->root_path);
+    cw_bytes(w, &hdr, sizeof(hdr));
+    cw_bytes(w, t->names, t->names_len);
+
+    for (uint32_t qi = 0; qi < qn && !w->err; ++qi) {
+        if (cancel && qi % CANCEL_EVERY == 0 && *cancel) { w->err = 1; break; }
+        const FsNode* n = &t->nodes[order[qi]];
+        cw_varint(w, n->name);
+        cw_varint(w, n->flags);
+        cw_varint(w, n->size_bytes);
+        cw_varint(w, n->mtime);
+        if (n->flags & FS_NODE_DIR) cw_varint(w, n->child_count);
+    }
+    cw_flush(w);
+    int err = w->err;
+    fs_io_close(w->fd);
+    free(w);
+    free(order);
+
+    if (err) { fs_io_remove(tmp_path); return -1; }
+    fs_io_remove(file_path);
+    return fs_io_rename(tmp_path, file_path) < 0 ? -1 : 0;
+}
+
+// Reads a cache written by fs_tree_save. Setting *cancel, when given, stops
+// the load part way and leaves t empty.
+int fs_tree_load(FsTree* t, const char* file_path, volatile int* cancel)
+{
+    if (!t || !file_path) return -1;
+    fs_tree_free(t);
+
+    SceIoStat st; memset(&st, 0, sizeof(st));
+    if (fs_io_getstat(file_path, &st) < 0 || st.st_size < (SceOff)sizeof(CacheHeader)) return -1;
+    SceUID fd = fs_io_open(file_path, SCE_O_RDONLY, 0);
+    if (fd < 0) return -1;
+
+    size_t size = (size_t)st.st_size;
+    uint8_t* buf = (uint8_t*)malloc(size);
+    size_t got = 0;
+    while (buf && got < size && !(cancel && *cancel)) {
+        size_t chunk = size - got < LOAD_CHUNK ? size - got : LOAD_CHUNK;
+        int r = fs_io_read(fd, buf + got, (SceSize)chunk);
+        if (r <= 0) break;
+        got += (size_t)r;
+    }
+    fs_io_close(fd);
+    if (!buf || got != size) { free(buf); return -1; }
+
+    CacheHeader hdr;
+    memcpy(&hdr, buf, sizeof(hdr));
+    if (hdr.magic != CACHE_MAGIC || hdr.version != CACHE_VERSION || hdr.node_count == 0 ||
+        hdr.names_len == 0 || sizeof(hdr) + hdr.names_len > size) { free(buf); return -1; }
+
+    const uint8_t* p = buf + sizeof(hdr);
+    const uint8_t* end = buf + size;
+    t->names = (char*)malloc(hdr.names_len);
+    t->nodes = (FsNode*)calloc(hdr.node_count, sizeof(FsNode));
+    if (!t->names || !t->nodes) goto fail;
+    memcpy(t->names, p, hdr.names_len);
+    t->names[hdr.names_len - 1] = '\0';
+    t->names_len = t->names_cap = hdr.names_len;
+    t->node_cap = hdr.node_count;
+    snprintf(t->root_path, sizeof(t->root_path), "%.*s", (int)sizeof(hdr.root_path) - 1, hdr.root_path);
+    p += hdr.names_len;
+
+    uint32_t next_block = 1;
+    for (uint32_t i = 0; i < hdr.node_count; ++i) {
+        if (cancel && i % CANCEL_EVERY == 0 && *cancel) goto fail;
+        FsNode* n = &t->nodes[i];
+        uint64_t name, flags, size_bytes, mtime, count = 0;
+        if (read_varint(&p, end, &name) < 0 || read_varint(&p, end, &flags) < 0 ||
+            read_varint(&p, end, &size_bytes) < 0 || read_varint(&p, end, &mtime) < 0) goto fail;
+        if ((flags & FS_NODE_DIR) && read_varint(&p, end, &count) < 0) goto fail;
+        // Every node has been counted as someone's child before it is read,
+        // so a block that does not start past the node is a corrupt file,
+        // and one that would loop back makes every walk spin
+        if (name >= hdr.names_len || next_block <= i || next_block > hdr.node_count ||
+            count > hdr.node_count - next_block) goto fail;
+        n->name = (uint32_t)name;
+        n->flags = (uint32_t)flags;
+        n->size_bytes = size_bytes;
+        n->mtime = (uint32_t)mtime;
+        n->parent = FS_TREE_NONE;
+        n->first_child = next_block;
+        n->child_count = (uint32_t)count;
+        next_block += (uint32_t)count;
+        t->node_count++;
+    }
+    if (next_block != t->node_count) goto fail;
+    for (uint32_t i = 0; i < t->node_count; ++i) {
+        const FsNode* n = &t->nodes[i];
+        for (uint32_t c = n->first_child; c < n->first_child + n->child_count; ++c) t->nodes[c].parent = i;
+    }
+    // Counts are not cached: children always come after their parent
+    for (uint32_t i = t->node_count; i-- > 0;) {
+        if (t->nodes[i].flags & FS_NODE_DIR) count_children(t, i);
+        else count_file_node(&t->nodes[i]);
+    }
+
+    // Rebuild the intern table so rescans keep sharing names with the cache
+    for (uint32_t off = 0; off < t->names_len; off += (uint32_t)strlen(t->names + off) + 1) {
+        if ((t->intern_used + 1) * 10 >= t->intern_cap * 7 && intern_grow(t) < 0) goto fail;
+        const char* s = t->names + off;
+        uint32_t h = hash_name(s, strlen(s)) & (t->intern_cap - 1);
+        while (t->intern[h]) h = (h + 1) & (t->intern_cap - 1);
+        t->intern[h] = off + 1;
+        t->intern_used++;
+    }
+
+    free(buf);
+    touch(t);
+    return 0;
+
+fail:
+    free(buf);
+    fs_tree_free(t);
+    return -1;
+}
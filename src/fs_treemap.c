@@ -0,0 +1,284 @@
+#include "fs_treemap.h"
+#include <psp2/kernel/threadmgr.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TREEMAP_THREAD_PRIORITY (0x10000100 + 28)
+#define TREEMAP_THREAD_STACK    (32 * 1024)
+
+// ---- layout -----------------------------------------------------------------
+
+// Worst aspect ratio of a row of areas summing to `sum` laid along a side of
+// length `side`
+static double worst(double sum, double amin, double amax, double side)
+{
+    double s2 = side * side, sum2 = sum * sum;
+    double a = s2 * amax / sum2, b = sum2 / (s2 * amin);
+    return a > b ? a : b;
+}
+
+// Places tiles[first .. first+n-1], whose sizes are set, into the rectangle
+// with the squarified algorithm: each row along the shorter side takes items
+// for as long as that makes its worst aspect ratio better.
+static void squarify(FsTile* tiles, uint32_t n, double scale, float x, float y, float w, float h)
+{
+    uint32_t i = 0;
+    while (i < n) {
+        double side = w < h ? w : h;
+        double a = (double)tiles[i].size * scale;
+        double sum = a, amin = a, amax = a;
+        double best = worst(sum, amin, amax, side);
+        uint32_t j = i + 1;
+        for (; j < n; ++j) {
+            a = (double)tiles[j].size * scale;
+            double nmin = a < amin ? a : amin, nmax = a > amax ? a : amax;
+            double r = worst(sum + a, nmin, nmax, side);
+            if (r > best) break;
+            sum += a; amin = nmin; amax = nmax; best = r;
+        }
+
+        // The last row takes whatever is left, so rounding leaves no gap
+        int vertical = w >= h;
+        float thick = (float)(sum / side);
+        if (j == n || thick > (vertical ? w : h)) thick = vertical ? w : h;
+        float pos = vertical ? y : x, end = vertical ? y + h : x + w;
+        for (uint32_t k = i; k < j; ++k) {
+            float len = (float)((double)tiles[k].size * scale / thick);
+            if (k + 1 == j || pos + len > end) len = end - pos;
+            FsTile* tl = &tiles[k];
+            if (vertical) { tl->x = x; tl->y = pos; tl->w = thick; tl->h = len; }
+            else          { tl->x = pos; tl->y = y; tl->w = len; tl->h = thick; }
+            pos += len;
+        }
+        if (vertical) { x += thick; w -= thick; }
+        else          { y += thick; h -= thick; }
+        i = j;
+    }
+}
+
+// Appends one tile per child of `parent` that covers at least the minimum
+// area, plus an "other" tile for the rest, and lays them out in the
+// rectangle. Children come sorted by size, so the kept ones are a prefix.
+static void lay_children(FsTreemap* m, const FsTree* t, uint32_t parent, float x, float y, float w, float h,
+                         uint16_t depth)
+{
+    const FsNode* p = &t->nodes[parent];
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < p->child_count; ++i) {
+        uint32_t c = p->first_child + i;
+        if (!t->nodes[c].size_bytes) break;
+        total += t->nodes[c].size_bytes;
+    }
+    if (!total || w < 1.0f || h < 1.0f) return;
+
+    double scale = (double)w * h / (double)total;
+    uint32_t budget = m->cap - m->count;
+    FsTile* tiles = m->tiles + m->count;
+    uint32_t n = 0, rest_count = 0, rest_node = FS_TREE_NONE;
+    uint64_t rest = 0;
+    for (uint32_t i = 0; i < p->child_count; ++i) {
+        uint32_t c = p->first_child + i;
+        uint64_t size = t->nodes[c].size_bytes;
+        if (!size) break;
+        // One tile is held back for the rest
+        if (!rest_count && (double)size * scale >= FS_TREEMAP_MIN_AREA && n + 1 < budget) {
+            FsTile* tl = &tiles[n++];
+            memset(tl, 0, sizeof(*tl));
+            tl->size = size;
+            tl->node = c;
+            tl->depth = depth;
+            tl->flags = (t->nodes[c].flags & FS_NODE_DIR) ? FS_TILE_DIR : 0;
+        } else {
+            rest += size;
+            rest_count++;
+            rest_node = c;
+        }
+    }
+    if (rest_count) {
+        FsTile* tl = &tiles[n++];
+        memset(tl, 0, sizeof(*tl));
+        tl->size = rest;
+        tl->depth = depth;
+        if (rest_count == 1) {
+            tl->node = rest_node;
+            tl->flags = (t->nodes[rest_node].flags & FS_NODE_DIR) ? FS_TILE_DIR : 0;
+        } else {
+            tl->node = FS_TREE_NONE;
+            tl->merged = rest_count;
+            tl->flags = FS_TILE_OTHER;
+        }
+    }
+    squarify(tiles, n, scale, x, y, w, h);
+    m->count += n;
+}
+
+// ---- public API -------------------------------------------------------------
+
+int fs_treemap_init(FsTreemap* m, uint32_t max_tiles)
+{
+    memset(m, 0, sizeof(*m));
+    m->tiles = (FsTile*)malloc((size_t)max_tiles * sizeof(FsTile));
+    if (!m->tiles) return -1;
+    m->cap = max_tiles;
+    m->node = FS_TREE_NONE;
+    return 0;
+}
+
+void fs_treemap_free(FsTreemap* m)
+{
+    free(m->tiles);
+    memset(m, 0, sizeof(*m));
+    m->node = FS_TREE_NONE;
+}
+
+// Lays `node`'s children out in a w x h rectangle, then each folder tile's
+// children inside it, breadth first, so the tile budget goes to the largest
+// levels first. Folders too small to hold children stay single tiles.
+// Tiles are in parent-before-child order and the whole layout is in pixels.
+int fs_treemap_layout(FsTreemap* m, const FsTree* t, uint32_t node, float w, float h, volatile int* cancel)
+{
+    if (!m->tiles || !t || node >= t->node_count) return -1;
+    m->tree = t;
+    m->tree_gen = t->gen;
+    m->node = node;
+    m->w = w;
+    m->h = h;
+    m->count = 0;
+    m->unexpanded = 0;
+
+    lay_children(m, t, node, 0, 0, w, h, 0);
+    for (uint32_t i = 0; i < m->count; ++i) {
+        if (cancel && *cancel) return -1;
+        FsTile tl = m->tiles[i];
+        if (!(tl.flags & FS_TILE_DIR) || !t->nodes[tl.node].child_count) continue;
+        float top = FS_TREEMAP_INSET;
+        if (tl.depth == 0 && tl.h >= 3 * FS_TREEMAP_TITLE) top = FS_TREEMAP_TITLE;
+        float iw = tl.w - 2 * FS_TREEMAP_INSET, ih = tl.h - top - FS_TREEMAP_INSET;
+        if (iw < 4 || ih < 4 || iw * ih < 4 * FS_TREEMAP_MIN_AREA) continue;
+        if (m->count == m->cap) { m->unexpanded++; continue; }
+        lay_children(m, t, tl.node, tl.x + FS_TREEMAP_INSET, tl.y + top, iw, ih, (uint16_t)(tl.depth + 1));
+    }
+    return 0;
+}
+
+// ---- worker -----------------------------------------------------------------
+
+static int layout_thread(SceSize args, void* argp)
+{
+    (void)args;
+    FsTreemapper* tm = *(FsTreemapper**)argp;
+    FsTreemap* m = &tm->cache[tm->job];
+    tm->job_result = fs_treemap_layout(m, m->tree, m->node, m->w, m->h, &tm->cancel);
+    tm->busy = 0;
+    return 0;
+}
+
+static void join_worker(FsTreemapper* tm)
+{
+    if (tm->thread < 0) return;
+    sceKernelWaitThreadEnd(tm->thread, NULL, NULL);
+    sceKernelDeleteThread(tm->thread);
+    tm->thread = -1;
+}
+
+// Takes a finished layout into the cache
+static void finish_job(FsTreemapper* tm)
+{
+    if (tm->job < 0 || tm->busy) return;
+    join_worker(tm);
+    if (tm->job_result == 0) {
+        tm->valid[tm->job] = 1;
+        tm->used[tm->job] = ++tm->clock;
+        tm->layouts++;
+    }
+    tm->job = -1;
+}
+
+static void cancel_job(FsTreemapper* tm)
+{
+    if (tm->job < 0) return;
+    tm->cancel = 1;
+    join_worker(tm);
+    tm->busy = 0;
+    tm->job = -1;
+}
+
+static int matches(const FsTreemap* m, const FsTree* t, uint32_t node, float w, float h)
+{
+    return m->tree == t && m->tree_gen == t->gen && m->node == node && m->w == w && m->h == h;
+}
+
+int fs_treemapper_init(FsTreemapper* tm)
+{
+    memset(tm, 0, sizeof(*tm));
+    tm->thread = -1;
+    tm->job = -1;
+    for (int i = 0; i < FS_TREEMAP_CACHE; ++i) {
+        if (fs_treemap_init(&tm->cache[i], FS_TREEMAP_MAX_TILES) < 0) {
+            fs_treemapper_deinit(tm);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void fs_treemapper_deinit(FsTreemapper* tm)
+{
+    cancel_job(tm);
+    for (int i = 0; i < FS_TREEMAP_CACHE; ++i) fs_treemap_free(&tm->cache[i]);
+    memset(tm->valid, 0, sizeof(tm->valid));
+}
+
+// The layout of `node` at w x h as of the tree's current generation, or NULL
+// while it is being computed. A request for another folder or size drops the
+// running job; the least recently shown layout makes room for the new one.
+const FsTreemap* fs_treemapper_get(FsTreemapper* tm, const FsTree* t, uint32_t node, float w, float h)
+{
+    if (!t || node >= t->node_count || !tm->cache[0].tiles) return NULL;
+    finish_job(tm);
+    for (int i = 0; i < FS_TREEMAP_CACHE; ++i) {
+        if (!tm->valid[i] || !matches(&tm->cache[i], t, node, w, h)) continue;
+        tm->used[i] = ++tm->clock;
+        return &tm->cache[i];
+    }
+    if (tm->job >= 0) {
+        if (matches(&tm->cache[tm->job], t, node, w, h)) return NULL;
+        cancel_job(tm);
+    }
+
+    int slot = 0;
+    for (int i = 0; i < FS_TREEMAP_CACHE; ++i) {
+        if (!tm->valid[i]) { slot = i; break; }
+        if (tm->used[i] < tm->used[slot]) slot = i;
+    }
+    FsTreemap* m = &tm->cache[slot];
+    tm->valid[slot] = 0;
+    m->tree = t;
+    m->tree_gen = t->gen;
+    m->node = node;
+    m->w = w;
+    m->h = h;
+    tm->job = slot;
+    tm->busy = 1;
+    tm->cancel = 0;
+
+    tm->thread = sceKernelCreateThread("fsa_treemap", layout_thread, TREEMAP_THREAD_PRIORITY,
+                                       TREEMAP_THREAD_STACK, 0, SCE_KERNEL_CPU_MASK_USER_1, NULL);
+    FsTreemapper* self = tm;
+    if (tm->thread < 0 || sceKernelStartThread(tm->thread, sizeof(self), &self) < 0) {
+        // No thread to spare: lay it out right here
+        if (tm->thread >= 0) sceKernelDeleteThread(tm->thread);
+        tm->thread = -1;
+        tm->job_result = fs_treemap_layout(m, t, node, w, h, NULL);
+        tm->busy = 0;
+        finish_job(tm);
+        return tm->valid[slot] ? m : NULL;
+    }
+    return NULL;
+}
+
+// Stops a job reading `t`; call before the tree is changed or freed.
+void fs_treemapper_release(FsTreemapper* tm, const FsTree* t)
+{
+    if (tm->job >= 0 && tm->cache[tm->job].tree == t) cancel_job(tm);
+}
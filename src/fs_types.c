@@ -0,0 +1,175 @@
+#include "fs_types.h"
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+// ---- extension classification -----------------------------------------------
+
+#define EXT_MULT      0x45397c7fu
+#define EXT_SLOT_BITS 6
+
+typedef struct {
+    const char* ext;
+    uint8_t     cat;
+} ExtSlot;
+
+// Perfect hash over the known extensions: slot = (fnv1a(ext) * EXT_MULT) >> 26.
+// EXT_MULT was searched so that no two of them share a slot; adding an
+// extension means searching again and regenerating the table.
+static const ExtSlot EXT_TABLE[1 << EXT_SLOT_BITS] = {
+    [ 1] = { "mkv",   FS_CAT_VIDEO },
+    [ 2] = { "suprx", FS_CAT_HOMEBREW },
+    [ 3] = { "mp3",   FS_CAT_MP3 },
+    [ 4] = { "skprx", FS_CAT_HOMEBREW },
+    [ 6] = { "pbp",   FS_CAT_GAMES },
+    [ 7] = { "png",   FS_CAT_PHOTO },
+    [11] = { "jpeg",  FS_CAT_PHOTO },
+    [13] = { "txt",   FS_CAT_DOCS },
+    [14] = { "dat",   FS_CAT_SAVEDATA },
+    [15] = { "jpg",   FS_CAT_PHOTO },
+    [16] = { "gz",    FS_CAT_ARCHIVES },
+    [21] = { "bmp",   FS_CAT_PHOTO },
+    [22] = { "pdf",   FS_CAT_DOCS },
+    [24] = { "avi",   FS_CAT_VIDEO },
+    [26] = { "self",  FS_CAT_HOMEBREW },
+    [27] = { "doc",   FS_CAT_DOCS },
+    [33] = { "mp4",   FS_CAT_VIDEO },
+    [35] = { "zip",   FS_CAT_ARCHIVES },
+    [38] = { "cso",   FS_CAT_GAMES },
+    [40] = { "rtf",   FS_CAT_DOCS },
+    [41] = { "sav",   FS_CAT_SAVEDATA },
+    [43] = { "iso",   FS_CAT_GAMES },
+    [46] = { "gif",   FS_CAT_PHOTO },
+    [48] = { "bin",   FS_CAT_GAMES },
+    [50] = { "vpk",   FS_CAT_HOMEBREW },
+    [54] = { "7z",    FS_CAT_ARCHIVES },
+    [55] = { "rar",   FS_CAT_ARCHIVES },
+    [56] = { "docx",  FS_CAT_DOCS },
+    [57] = { "mov",   FS_CAT_VIDEO },
+    [59] = { "tar",   FS_CAT_ARCHIVES },
+    [62] = { "save",  FS_CAT_SAVEDATA },
+    [63] = { "ogg",   FS_CAT_OGG },
+};
+
+// Lower-cases the extension of `name` into `out` (FS_EXT_MAX bytes) and
+// returns its FNV-1a hash, which serves both lookup tables.
+static uint32_t split_ext(const char* name, char* out)
+{
+    const char* dot = strrchr(name, '.');
+    size_t len = dot ? strlen(dot + 1) : 0;
+    if (len >= FS_EXT_MAX) len = 0;
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; ++i) {
+        char c = (char)tolower((unsigned char)dot[1 + i]);
+        out[i] = c;
+        h ^= (uint8_t)c; h *= 16777619u;
+    }
+    out[len] = '\0';
+    return h;
+}
+
+static FsCategory lookup_category(const char* ext, uint32_t hash)
+{
+    if (!*ext) return FS_CAT_OTHER;
+    const ExtSlot* slot = &EXT_TABLE[(uint32_t)(hash * EXT_MULT) >> (32 - EXT_SLOT_BITS)];
+    return (slot->ext && !strcmp(slot->ext, ext)) ? (FsCategory)slot->cat : FS_CAT_OTHER;
+}
+
+FsCategory fs_classify(const char* name)
+{
+    char ext[FS_EXT_MAX];
+    uint32_t h = split_ext(name, ext);
+    return lookup_category(ext, h);
+}
+
+FsCategory fs_ext_category(const FsExtStat* e)
+{
+    return lookup_category(e->ext, e->hash);
+}
+
+const char* fs_category_label(FsCategory cat)
+{
+    static const char* labels[FS_CAT_COUNT] = {
+        "Games", "MP3", "OGG", "Photo", "Video", "Docs", "Archives", "Homebrew", "SaveData", "Other"
+    };
+    return ((unsigned)cat < FS_CAT_COUNT) ? labels[cat] : "Other";
+}
+
+// ---- histogram --------------------------------------------------------------
+
+void fs_type_stats_init(FsTypeStats* s)
+{
+    memset(s, 0, sizeof(*s));
+}
+
+void fs_type_stats_free(FsTypeStats* s)
+{
+    free(s->exts);
+    free(s->child_bytes);
+    fs_type_stats_init(s);
+}
+
+void fs_type_stats_clear(FsTypeStats* s)
+{
+    memset(s->cat_bytes, 0, sizeof(s->cat_bytes));
+    memset(s->cat_files, 0, sizeof(s->cat_files));
+    if (s->exts) memset(s->exts, 0, (size_t)s->ext_cap * sizeof(FsExtStat));
+    s->ext_used = 0;
+    s->child_count = 0;
+}
+
+// Sizes the per-child rows for a folder of `count` entries and zeroes them.
+int fs_type_stats_set_children(FsTypeStats* s, uint32_t count)
+{
+    if (count > s->child_cap) {
+        uint64_t* rows = (uint64_t*)realloc(s->child_bytes, (size_t)count * FS_CAT_COUNT * sizeof(uint64_t));
+        if (!rows) return -1;
+        s->child_bytes = rows;
+        s->child_cap = count;
+    }
+    if (count) memset(s->child_bytes, 0, (size_t)count * FS_CAT_COUNT * sizeof(uint64_t));
+    s->child_count = count;
+    return 0;
+}
+
+static int ext_grow(FsTypeStats* s)
+{
+    uint32_t cap = s->ext_cap ? s->ext_cap * 2 : 64;
+    FsExtStat* slots = (FsExtStat*)calloc(cap, sizeof(FsExtStat));
+    if (!slots) return -1;
+    for (uint32_t i = 0; i < s->ext_cap; ++i) {
+        if (!s->exts[i].files) continue;
+        uint32_t h = s->exts[i].hash & (cap - 1);
+        while (slots[h].files) h = (h + 1) & (cap - 1);
+        slots[h] = s->exts[i];
+    }
+    free(s->exts);
+    s->exts = slots;
+    s->ext_cap = cap;
+    return 0;
+}
+
+// Counts one file in its category and in its extension's bucket. Returns the
+// category, or -1 when the extension table cannot grow.
+int fs_type_stats_add(FsTypeStats* s, const char* name, uint64_t size_bytes)
+{
+    char ext[FS_EXT_MAX];
+    uint32_t hash = split_ext(name, ext);
+    FsCategory cat = lookup_category(ext, hash);
+    s->cat_bytes[cat] += size_bytes;
+    s->cat_files[cat]++;
+
+    if ((s->ext_used + 1) * 10 >= s->ext_cap * 7 && ext_grow(s) < 0) return -1;
+    uint32_t i = hash & (s->ext_cap - 1);
+    while (s->exts[i].files && (s->exts[i].hash != hash || strcmp(s->exts[i].ext, ext) != 0))
+        i = (i + 1) & (s->ext_cap - 1);
+    FsExtStat* e = &s->exts[i];
+    if (!e->files) {
+        strcpy(e->ext, ext);
+        e->hash = hash;
+        s->ext_used++;
+    }
+    e->files++;
+    e->bytes += size_bytes;
+    return (int)cat;
+}
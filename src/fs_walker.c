@@ -0,0 +1,628 @@
+#include "fs_walker.h"
+#include "fs_tree.h"
+#include "fs_io.h"
+#include "fs_iter.h"
+#include <psp2/io/dirent.h>
+#include <psp2/io/stat.h>
+#include <psp2/kernel/threadmgr.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define WALK_THREAD_PRIORITY (0x10000100 + 16)
+#define WALK_THREAD_STACK    (64 * 1024)
+#define WALK_THREAD_CPUS     (SCE_KERNEL_CPU_MASK_USER_1 | SCE_KERNEL_CPU_MASK_USER_2)
+#define WALK_PATH_MAX        1024
+#define WALK_BUCKETS         16384
+#define WALK_MAX_PENDING     (256 * 1024) // listed entries the builder has not taken yet
+#define WALK_LOCKS           64           // stripes of the slot table
+#define WALK_SLOT_MIN        64           // path bytes of the smallest slot
+#define WALK_SLOT_CLASSES    5            // WALK_SLOT_MIN << class reaches WALK_PATH_MAX
+#define WALK_IDLE_DELAY_US   200
+#define WALK_WAIT_DELAY_US   50
+
+// ---- directory reads --------------------------------------------------------
+
+static uint32_t datetime_to_epoch(const SceDateTime* dt)
+{
+    if (dt->year < 1970 || dt->month < 1 || dt->month > 12) return 0;
+    // days-from-civil, valid for the Gregorian calendar
+    int y = dt->year - (dt->month <= 2);
+    int era = y / 400;
+    int yoe = y - era * 400;
+    int mp = (dt->month + 9) % 12;
+    int doy = (153 * mp + 2) / 5 + dt->day - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    int64_t days = (int64_t)era * 146097 + doe - 719468;
+    return (uint32_t)(days * 86400 + dt->hour * 3600 + dt->minute * 60 + dt->second);
+}
+
+static uint32_t stat_mtime(const char* path)
+{
+    SceIoStat st; memset(&st, 0, sizeof(st));
+    return (fs_io_getstat(path, &st) >= 0) ? datetime_to_epoch(&st.st_mtime) : 0;
+}
+
+typedef struct {
+    FsWalkListing* l;
+    uint32_t       cap;
+    uint32_t       names_len;
+    uint32_t       names_cap;
+    int            oom;
+} ReadCtx;
+
+static int add_entry(void* user, const SceIoDirent* de)
+{
+    ReadCtx* c = (ReadCtx*)user;
+    FsWalkListing* l = c->l;
+    uint32_t nl = (uint32_t)strlen(de->d_name) + 1;
+    if (l->count == c->cap) {
+        uint32_t cap = c->cap ? c->cap * 2 : 64;
+        FsWalkEntry* e = (FsWalkEntry*)realloc(l->entries, cap * sizeof(FsWalkEntry));
+        if (!e) { c->oom = 1; return -1; }
+        l->entries = e;
+        c->cap = cap;
+    }
+    if (c->names_len + nl > c->names_cap) {
+        uint32_t cap = c->names_cap ? c->names_cap : 1024;
+        while (c->names_len + nl > cap) cap *= 2;
+        char* p = (char*)realloc(l->names, cap);
+        if (!p) { c->oom = 1; return -1; }
+        l->names = p;
+        c->names_cap = cap;
+    }
+    FsWalkEntry* e = &l->entries[l->count++];
+    memcpy(l->names + c->names_len, de->d_name, nl);
+    e->name = c->names_len;
+    e->mtime = datetime_to_epoch(&de->d_stat.st_mtime);
+    e->is_dir = SCE_S_ISDIR(de->d_stat.st_mode) ? 1 : 0;
+    e->size = e->is_dir ? 0 : (uint64_t)de->d_stat.st_size;
+    c->names_len += nl;
+    return 0;
+}
+
+// Lists one directory through the iterator's reader. Unreadable directories
+// yield *out == NULL and 0; -1 means memory ran out.
+static int read_dir(const char* path, int flags, FsWalkListing** out)
+{
+    *out = NULL;
+    ReadCtx c = { (FsWalkListing*)calloc(1, sizeof(FsWalkListing)), 0, 0, 0, 0 };
+    if (!c.l) return -1;
+    SceIoDirent de;
+    if (fs_iter_read_dir(path, flags, &de, add_entry, &c) == 0) { *out = c.l; return 0; }
+    fs_walker_free_listing(c.l);
+    return c.oom ? -1 : 0;
+}
+
+// ---- slots ------------------------------------------------------------------
+
+enum { SLOT_QUEUED = 0, SLOT_RUNNING, SLOT_DONE, SLOT_DROPPED };
+
+// One directory handed to the workers, keyed by path in the slot table while
+// the builder may still ask for it. A slot is also the task on a deque: the
+// builder unlinks a queued slot it no longer wants and marks it dropped, and
+// the worker that pops it returns it. `mtime` is filled in when the parent
+// was reused from the cache and the worker had to stat it.
+typedef struct WalkSlot {
+    struct WalkSlot* next;      // bucket chain, or free list
+    uint32_t         hash;
+    int              state;
+    int              has_mtime;
+    uint32_t         mtime;
+    uint32_t         prev_dir;
+    int              creator;   // free list the slot goes back to
+    int              size_class;
+    FsWalkListing*   listing;
+    char             path[];
+} WalkSlot;
+
+// Returned slots, by path capacity (WALK_SLOT_MIN << class), of one thread
+typedef struct {
+    SceUID    lock;
+    WalkSlot* slots[WALK_SLOT_CLASSES];
+} WalkFreeList;
+
+// ---- work-stealing deques ---------------------------------------------------
+
+// The owner pushes and pops at the tail without locking, thieves take from
+// the head under the lock (the THE protocol). The owner only takes the lock
+// when a thief may be after its last task, or to move the ring.
+typedef struct {
+    SceUID             lock;
+    WalkSlot**         items;
+    volatile uint32_t  head, tail;
+    uint32_t           cap;
+} WalkDeque;
+
+// Owner only
+static int deque_push(WalkDeque* d, WalkSlot* slot)
+{
+    uint32_t t = d->tail;
+    if (t == d->cap) {
+        sceKernelLockMutex(d->lock, 1, NULL);
+        uint32_t h = d->head;
+        memmove(d->items, d->items + h, (t - h) * sizeof(WalkSlot*));
+        t -= h;
+        d->head = 0;
+        d->tail = t;
+        if (t == d->cap) {
+            uint32_t cap = d->cap ? d->cap * 2 : 256;
+            WalkSlot** items = (WalkSlot**)realloc(d->items, cap * sizeof(WalkSlot*));
+            if (!items) { sceKernelUnlockMutex(d->lock, 1); return -1; }
+            d->items = items;
+            d->cap = cap;
+        }
+        sceKernelUnlockMutex(d->lock, 1);
+    }
+    d->items[t] = slot;
+    __atomic_store_n(&d->tail, t + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+// Owner only: its newest task
+static WalkSlot* deque_pop(WalkDeque* d)
+{
+    uint32_t t = d->tail;
+    if (t == __atomic_load_n(&d->head, __ATOMIC_ACQUIRE)) return NULL;
+    t--;
+    __atomic_store_n(&d->tail, t, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&d->head, __ATOMIC_SEQ_CST) > t) {
+        // A thief may have the same task: settle it under the lock
+        __atomic_store_n(&d->tail, t + 1, __ATOMIC_SEQ_CST);
+        sceKernelLockMutex(d->lock, 1, NULL);
+        t = d->tail - 1;
+        __atomic_store_n(&d->tail, t, __ATOMIC_SEQ_CST);
+        int lost = d->head > t;
+        if (lost) __atomic_store_n(&d->tail, t + 1, __ATOMIC_SEQ_CST);
+        sceKernelUnlockMutex(d->lock, 1);
+        if (lost) return NULL;
+    }
+    return d->items[t];
+}
+
+// Another worker's oldest task
+static WalkSlot* deque_steal(WalkDeque* d)
+{
+    if (__atomic_load_n(&d->head, __ATOMIC_ACQUIRE) >= __atomic_load_n(&d->tail, __ATOMIC_ACQUIRE)) return NULL;
+    WalkSlot* slot = NULL;
+    sceKernelLockMutex(d->lock, 1, NULL);
+    uint32_t h = d->head;
+    __atomic_store_n(&d->head, h + 1, __ATOMIC_SEQ_CST);
+    if (h + 1 > __atomic_load_n(&d->tail, __ATOMIC_SEQ_CST)) __atomic_store_n(&d->head, h, __ATOMIC_SEQ_CST);
+    else slot = d->items[h];
+    sceKernelUnlockMutex(d->lock, 1);
+    return slot;
+}
+
+// The builder's own spawns have no owning worker: they wait in an inbox
+// every worker takes from, newest first, under its lock
+static int inbox_push(WalkDeque* d, WalkSlot* slot)
+{
+    sceKernelLockMutex(d->lock, 1, NULL);
+    if (d->tail == d->cap) {
+        uint32_t cap = d->cap ? d->cap * 2 : 256;
+        WalkSlot** items = (WalkSlot**)realloc(d->items, cap * sizeof(WalkSlot*));
+        if (!items) { sceKernelUnlockMutex(d->lock, 1); return -1; }
+        d->items = items;
+        d->cap = cap;
+    }
+    d->items[d->tail++] = slot;
+    sceKernelUnlockMutex(d->lock, 1);
+    return 0;
+}
+
+static WalkSlot* inbox_pop(WalkDeque* d)
+{
+    if (__atomic_load_n(&d->tail, __ATOMIC_ACQUIRE) == 0) return NULL;
+    WalkSlot* slot = NULL;
+    sceKernelLockMutex(d->lock, 1, NULL);
+    if (d->tail > 0) slot = d->items[--d->tail];
+    sceKernelUnlockMutex(d->lock, 1);
+    return slot;
+}
+
+// ---- results ----------------------------------------------------------------
+
+struct FsWalker {
+    const FsTree*     prev;
+    int               workers;
+    volatile int      stop;
+    WalkSlot**        slots;
+    SceUID            locks[WALK_LOCKS];     // one per stripe of buckets
+    volatile uint32_t pending;
+    SceUID            threads[FS_WALK_MAX_THREADS];
+    WalkDeque         deques[FS_WALK_MAX_THREADS];
+    WalkDeque         inbox;
+    WalkFreeList      free[FS_WALK_MAX_THREADS + 1]; // per worker, then the builder's
+};
+
+typedef struct {
+    FsWalker* w;
+    int       id;
+} WalkWorkerArg;
+
+static uint32_t hash_path(const char* s)
+{
+    uint32_t h = 2166136261u;
+    while (*s) { h ^= (uint8_t)*s++; h *= 16777619u; }
+    return h;
+}
+
+// WALK_LOCKS divides WALK_BUCKETS, so every bucket sits under one stripe
+static SceUID stripe(const FsWalker* w, uint32_t hash)
+{
+    return w->locks[hash & (WALK_LOCKS - 1)];
+}
+
+// Under the stripe lock of `hash`
+static WalkSlot** find_slot(FsWalker* w, const char* path, uint32_t hash)
+{
+    WalkSlot** link = &w->slots[hash & (WALK_BUCKETS - 1)];
+    while (*link && ((*link)->hash != hash || strcmp((*link)->path, path) != 0)) link = &(*link)->next;
+    return link;
+}
+
+static WalkSlot* alloc_slot(FsWalker* w, int creator, size_t path_len)
+{
+    int c = 0;
+    while ((size_t)WALK_SLOT_MIN << c < path_len) c++;
+    WalkFreeList* f = &w->free[creator];
+    sceKernelLockMutex(f->lock, 1, NULL);
+    WalkSlot* slot = f->slots[c];
+    if (slot) f->slots[c] = slot->next;
+    sceKernelUnlockMutex(f->lock, 1);
+    if (!slot) slot = (WalkSlot*)malloc(sizeof(WalkSlot) + ((size_t)WALK_SLOT_MIN << c));
+    if (!slot) return NULL;
+    memset(slot, 0, sizeof(*slot));
+    slot->creator = creator;
+    slot->size_class = c;
+    return slot;
+}
+
+// Hands a slot the builder is done with, or a dropped one, back to the free
+// list of the thread that made it
+static void release_slot(FsWalker* w, WalkSlot* slot)
+{
+    if (slot->listing) {
+        __atomic_sub_fetch(&w->pending, slot->listing->count, __ATOMIC_RELAXED);
+        fs_walker_free_listing(slot->listing);
+        slot->listing = NULL;
+    }
+    WalkFreeList* f = &w->free[slot->creator];
+    sceKernelLockMutex(f->lock, 1, NULL);
+    slot->next = f->slots[slot->size_class];
+    f->slots[slot->size_class] = slot;
+    sceKernelUnlockMutex(f->lock, 1);
+}
+
+// Under the stripe lock. A queued slot is still on a deque, so it is only
+// marked; the worker that pops it releases it.
+static void drop_slot(FsWalker* w, WalkSlot** link)
+{
+    WalkSlot* slot = *link;
+    *link = slot->next;
+    if (slot->state == SLOT_QUEUED) slot->state = SLOT_DROPPED;
+    else release_slot(w, slot);
+}
+
+// Under the stripe lock: waits for a worker to finish the slot at *link
+static WalkSlot** wait_slot(FsWalker* w, SceUID lock, const char* path, uint32_t hash)
+{
+    WalkSlot** link = find_slot(w, path, hash);
+    while (*link && (*link)->state == SLOT_RUNNING) {
+        sceKernelUnlockMutex(lock, 1);
+        sceKernelDelayThread(WALK_WAIT_DELAY_US);
+        sceKernelLockMutex(lock, 1, NULL);
+        link = find_slot(w, path, hash);
+    }
+    return link;
+}
+
+// Queues `path` on the deque of worker `creator`, or in the inbox when the
+// builder (creator == w->workers) found it.
+static void spawn(FsWalker* w, int creator, const char* path, uint32_t prev_dir, uint32_t mtime,
+                  int has_mtime)
+{
+    size_t pl = strlen(path) + 1;
+    WalkSlot* slot = alloc_slot(w, creator, pl);
+    if (!slot) return;
+    slot->hash = hash_path(path);
+    slot->state = SLOT_QUEUED;
+    slot->has_mtime = has_mtime;
+    slot->mtime = mtime;
+    slot->prev_dir = prev_dir;
+    memcpy(slot->path, path, pl);
+
+    SceUID lock = stripe(w, slot->hash);
+    sceKernelLockMutex(lock, 1, NULL);
+    WalkSlot** link = find_slot(w, path, slot->hash);
+    int taken = *link != NULL;
+    if (!taken) *link = slot;
+    sceKernelUnlockMutex(lock, 1);
+    if (taken) { release_slot(w, slot); return; }
+
+    int res = creator == w->workers ? inbox_push(&w->inbox, slot) : deque_push(&w->deques[creator], slot);
+    if (res == 0) return;
+    // Prefetch only: without a deque the builder reads it itself
+    sceKernelLockMutex(lock, 1, NULL);
+    link = find_slot(w, path, slot->hash);
+    if (*link == slot) *link = slot->next;
+    sceKernelUnlockMutex(lock, 1);
+    release_slot(w, slot);
+}
+
+typedef struct {
+    const char* name;
+    uint32_t    index;
+} PrevRef;
+
+static int cmp_prev_ref(const void* a, const void* b)
+{
+    return strcmp(((const PrevRef*)a)->name, ((const PrevRef*)b)->name);
+}
+
+// Queues the subdirectories of a freshly listed directory, last one first so
+// that the owner pops them in listing order. The builder keeps the first
+// one, since it descends into it right away.
+static void spawn_children(FsWalker* w, int creator, const char* path, uint32_t prev_dir,
+                           const FsWalkListing* l)
+{
+    const FsTree* prev = w->prev;
+    PrevRef* refs = NULL;
+    uint32_t ref_count = 0;
+    if (prev && prev_dir != FS_TREE_NONE && prev->nodes[prev_dir].child_count > 0) {
+        const FsNode* pd = &prev->nodes[prev_dir];
+        refs = (PrevRef*)malloc(pd->child_count * sizeof(PrevRef));
+        if (refs) {
+            for (uint32_t j = 0; j < pd->child_count; ++j) {
+                refs[j].name = prev->names + prev->nodes[pd->first_child + j].name;
+                refs[j].index = pd->first_child + j;
+            }
+            ref_count = pd->child_count;
+            qsort(refs, ref_count, sizeof(PrevRef), cmp_prev_ref);
+        }
+    }
+
+    char child[WALK_PATH_MAX];
+    size_t len = strlen(path);
+    int slash = (len > 0 && path[len-1] != '/');
+    int builder = creator == w->workers;
+    uint32_t first_dir = 0;
+    while (builder && first_dir < l->count && !l->entries[first_dir].is_dir) first_dir++;
+    for (uint32_t i = l->count; i-- > 0 && !w->stop; ) {
+        const FsWalkEntry* e = &l->entries[i];
+        if (!e->is_dir || (builder && i == first_dir)) continue;
+        const char* name = l->names + e->name;
+        // The builder does not descend past WALK_PATH_MAX either
+        int n = snprintf(child, sizeof(child), "%s%s%s", path, slash ? "/" : "", name);
+        if (n < 0 || (size_t)n >= sizeof(child)) continue;
+        uint32_t pc = FS_TREE_NONE;
+        if (refs) {
+            PrevRef key = { name, 0 };
+            const PrevRef* hit = (const PrevRef*)bsearch(&key, refs, ref_count, sizeof(PrevRef), cmp_prev_ref);
+            if (hit && (prev->nodes[hit->index].flags & FS_NODE_DIR)) pc = hit->index;
+        }
+        spawn(w, creator, child, pc, e->mtime, 0);
+    }
+    free(refs);
+}
+
+// Unchanged directory: the builder copies its cached block, but still needs
+// the current mtime of every subdirectory, so stat those ahead of it.
+static void stat_children(FsWalker* w, int creator, const WalkSlot* task)
+{
+    const FsNode* pd = &w->prev->nodes[task->prev_dir];
+    char child[WALK_PATH_MAX];
+    size_t len = strlen(task->path);
+    int slash = (len > 0 && task->path[len-1] != '/');
+    for (uint32_t j = pd->first_child + pd->child_count; j-- > pd->first_child && !w->stop; ) {
+        const FsNode* c = &w->prev->nodes[j];
+        if (!(c->flags & FS_NODE_DIR)) continue;
+        int n = snprintf(child, sizeof(child), "%s%s%s", task->path, slash ? "/" : "", w->prev->names + c->name);
+        if (n < 0 || (size_t)n >= sizeof(child)) continue;
+        spawn(w, creator, child, j, stat_mtime(child), 1);
+    }
+}
+
+static int is_reusable(const FsWalker* w, uint32_t prev_dir, uint32_t mtime)
+{
+    return w->prev && prev_dir != FS_TREE_NONE && mtime != 0 && w->prev->nodes[prev_dir].mtime == mtime;
+}
+
+static void run_task(FsWalker* w, int id, WalkSlot* slot)
+{
+    SceUID lock = stripe(w, slot->hash);
+    sceKernelLockMutex(lock, 1, NULL);
+    int claimed = slot->state == SLOT_QUEUED;
+    if (claimed) slot->state = SLOT_RUNNING;
+    sceKernelUnlockMutex(lock, 1);
+    if (!claimed) { release_slot(w, slot); return; } // the builder got there first
+
+    FsWalkListing* l = NULL;
+    if (is_reusable(w, slot->prev_dir, slot->mtime)) stat_children(w, id, slot);
+    else if (read_dir(slot->path, 0, &l) == 0 && l) spawn_children(w, id, slot->path, slot->prev_dir, l);
+
+    // The slot stays linked while RUNNING, so it is still ours to complete
+    sceKernelLockMutex(lock, 1, NULL);
+    slot->listing = l;
+    if (l) __atomic_add_fetch(&w->pending, l->count, __ATOMIC_RELAXED);
+    slot->state = SLOT_DONE;
+    sceKernelUnlockMutex(lock, 1);
+}
+
+static int walk_thread(SceSize args, void* argp)
+{
+    (void)args;
+    WalkWorkerArg me = *(WalkWorkerArg*)argp;
+    FsWalker* w = me.w;
+    while (!w->stop) {
+        WalkSlot* task = NULL;
+        if (__atomic_load_n(&w->pending, __ATOMIC_RELAXED) < WALK_MAX_PENDING) {
+            task = deque_pop(&w->deques[me.id]);
+            if (!task) task = inbox_pop(&w->inbox);
+            for (int i = 1; !task && i < w->workers; ++i) task = deque_steal(&w->deques[(me.id + i) % w->workers]);
+        }
+        if (!task) { sceKernelDelayThread(WALK_IDLE_DELAY_US); continue; }
+        run_task(w, me.id, task);
+    }
+    return 0;
+}
+
+// ---- public API -------------------------------------------------------------
+
+FsWalker* fs_walker_create(int workers, const FsTree* prev)
+{
+    if (workers < 1) return NULL;
+    if (workers > FS_WALK_MAX_THREADS) workers = FS_WALK_MAX_THREADS;
+
+    FsWalker* w = (FsWalker*)calloc(1, sizeof(FsWalker));
+    if (!w) return NULL;
+    w->prev = prev;
+    w->slots = (WalkSlot**)calloc(WALK_BUCKETS, sizeof(WalkSlot*));
+    for (int i = 0; i < FS_WALK_MAX_THREADS; ++i) { w->threads[i] = -1; w->deques[i].lock = -1; }
+    for (int i = 0; i <= FS_WALK_MAX_THREADS; ++i) w->free[i].lock = -1;
+    int ok = w->slots != NULL;
+    for (int i = 0; i < WALK_LOCKS; ++i) {
+        w->locks[i] = sceKernelCreateMutex("fsa_walk_lock", 0, 0, NULL);
+        ok = ok && w->locks[i] >= 0;
+    }
+    w->inbox.lock = sceKernelCreateMutex("fsa_walk_inbox", 0, 0, NULL);
+    if (!ok || w->inbox.lock < 0) { fs_walker_destroy(w); return NULL; }
+
+    for (int i = 0; i < workers; ++i) {
+        w->deques[i].lock = sceKernelCreateMutex("fsa_walk_deque", 0, 0, NULL);
+        if (w->deques[i].lock < 0) break;
+        w->workers = i + 1;
+    }
+    // One free list per worker, then the builder's at index `workers`
+    for (int i = 0; i <= w->workers; ++i) {
+        w->free[i].lock = sceKernelCreateMutex("fsa_walk_free", 0, 0, NULL);
+        if (w->free[i].lock < 0) { fs_walker_destroy(w); return NULL; }
+    }
+    for (int i = 0; i < w->workers; ++i) {
+        w->threads[i] = sceKernelCreateThread("fsa_walk", walk_thread, WALK_THREAD_PRIORITY,
+                                              WALK_THREAD_STACK, 0, WALK_THREAD_CPUS, NULL);
+        WalkWorkerArg arg = { w, i };
+        if (w->threads[i] >= 0 && sceKernelStartThread(w->threads[i], sizeof(arg), &arg) < 0) {
+            sceKernelDeleteThread(w->threads[i]);
+            w->threads[i] = -1;
+        }
+    }
+    // Tasks parked on a deque without a thread are still stolen by the others
+    int running = 0;
+    for (int i = 0; i < w->workers; ++i) running += (w->threads[i] >= 0);
+    if (!running) { fs_walker_destroy(w); return NULL; }
+    return w;
+}
+
+// Frees the dropped slots still on a deque; queued ones are in the table
+static void free_deque(WalkDeque* d)
+{
+    for (uint32_t j = d->head; j < d->tail; ++j)
+        if (d->items[j]->state == SLOT_DROPPED) free(d->items[j]);
+    free(d->items);
+    if (d->lock >= 0) sceKernelDeleteMutex(d->lock);
+}
+
+void fs_walker_destroy(FsWalker* w)
+{
+    if (!w) return;
+    w->stop = 1;
+    for (int i = 0; i < FS_WALK_MAX_THREADS; ++i) {
+        if (w->threads[i] < 0) continue;
+        sceKernelWaitThreadEnd(w->threads[i], NULL, NULL);
+        sceKernelDeleteThread(w->threads[i]);
+    }
+    for (int i = 0; i < FS_WALK_MAX_THREADS; ++i) free_deque(&w->deques[i]);
+    free_deque(&w->inbox);
+    if (w->slots) {
+        for (uint32_t b = 0; b < WALK_BUCKETS; ++b) {
+            while (w->slots[b]) {
+                WalkSlot* slot = w->slots[b];
+                w->slots[b] = slot->next;
+                fs_walker_free_listing(slot->listing);
+                free(slot);
+            }
+        }
+        free(w->slots);
+    }
+    for (int i = 0; i <= FS_WALK_MAX_THREADS; ++i) {
+        WalkFreeList* f = &w->free[i];
+        for (int c = 0; c < WALK_SLOT_CLASSES; ++c) {
+            while (f->slots[c]) {
+                WalkSlot* slot = f->slots[c];
+                f->slots[c] = slot->next;
+                free(slot);
+            }
+        }
+        if (f->lock >= 0) sceKernelDeleteMutex(f->lock);
+    }
+    for (int i = 0; i < WALK_LOCKS; ++i) if (w->locks[i] >= 0) sceKernelDeleteMutex(w->locks[i]);
+    free(w);
+}
+
+// Returns the listing of `path`, prefetched by a worker when possible. If no
+// worker has started on it, the directory is read on the calling thread and
+// its subdirectories are handed to the workers. `flags` (FS_ITER_*) only
+// apply to a directory the caller reads itself, such as the root, since no
+// worker prefetches that one. `w` may be NULL.
+int fs_walker_list(FsWalker* w, const char* path, uint32_t prev_dir, int flags, FsWalkListing** out)
+{
+    *out = NULL;
+    if (!w) return read_dir(path, flags, out);
+
+    uint32_t hash = hash_path(path);
+    SceUID lock = stripe(w, hash);
+    sceKernelLockMutex(lock, 1, NULL);
+    WalkSlot** link = wait_slot(w, lock, path, hash);
+    if (*link && (*link)->listing) {
+        *out = (*link)->listing;
+        (*link)->listing = NULL;
+        __atomic_sub_fetch(&w->pending, (*out)->count, __ATOMIC_RELAXED);
+    }
+    if (*link) drop_slot(w, link); // still queued: the worker will skip it
+    sceKernelUnlockMutex(lock, 1);
+    if (*out) return 0;
+
+    if (read_dir(path, flags, out) < 0) return -1;
+    if (*out) spawn_children(w, w->workers, path, prev_dir, *out);
+    return 0;
+}
+
+// The builder copies `path` from the cache instead of listing it. Waits for
+// a worker that is stat'ing its subdirectories, so none of them turns up
+// after the builder has gone past, and releases its slot. `w` may be NULL.
+void fs_walker_reuse(FsWalker* w, const char* path)
+{
+    if (!w) return;
+    uint32_t hash = hash_path(path);
+    SceUID lock = stripe(w, hash);
+    sceKernelLockMutex(lock, 1, NULL);
+    WalkSlot** link = wait_slot(w, lock, path, hash);
+    if (*link) drop_slot(w, link);
+    sceKernelUnlockMutex(lock, 1);
+}
+
+// Current mtime of a directory whose parent was copied from the cache.
+uint32_t fs_walker_mtime(FsWalker* w, const char* path)
+{
+    if (w) {
+        uint32_t hash = hash_path(path);
+        SceUID lock = stripe(w, hash);
+        sceKernelLockMutex(lock, 1, NULL);
+        WalkSlot* slot = *find_slot(w, path, hash);
+        int hit = (slot && slot->has_mtime);
+        uint32_t mtime = hit ? slot->mtime : 0;
+        sceKernelUnlockMutex(lock, 1);
+        if (hit) return mtime;
+    }
+    return stat_mtime(path);
+}
+
+void fs_walker_free_listing(FsWalkListing* l)
+{
+    if (!l) return;
+    free(l->entries);
+    free(l->names);
+    free(l);
+}
@@ -1,291 +1,1343 @@
-#include <psp2/kernel/processmgr.h>
-#include <psp2/ctrl.h>
-#include <psp2/power.h>
-#include <psp2/rtc.h>
-#include <psp2/io/stat.h>
-#include <psp2/io/dirent.h>
-#include <vita2d.h>
-#include <stdio.h>
-#include <string.h>
-#include "fs_analyzer.h"
-#include "ui.h"
-
-#define STICK_THRESHOLD 80
-#define MOVE_DELAY 10
-#define CALCULATING_DELAY_MS 300
-#define MAX_PATH_LEN 512
-
-typedef struct {
-    char paths[16][MAX_PATH_LEN];
-    int depth;
-} Breadcrumb;
-
-typedef enum { F_ALL=0, F_GAMES, F_MP3, F_OGG, F_PHOTO, F_VIDEO, F_DOCS, F_ARCHIVES, F_HOMEBREW, F_SAVEDATA, F__COUNT } Filter;
-
-static const char* EXT_ALL[]      = { NULL };
-static const char* EXT_GAMES[]    = { ".iso",".cso",".pbp",".bin",NULL };
-static const char* EXT_MP3[]      = { ".mp3", NULL };
-static const char* EXT_OGG[]      = { ".ogg", NULL };
-static const char* EXT_PHOTO[]    = { ".jpg",".jpeg",".png",".bmp",".gif",NULL };
-static const char* EXT_VIDEO[]    = { ".mp4",".avi",".mkv",".mov",NULL };
-static const char* EXT_DOCS[]     = { ".txt",".pdf",".doc",".docx",".rtf",NULL };
-static const char* EXT_ARCHIVES[] = { ".zip",".rar",".7z",".tar",".gz",NULL };
-static const char* EXT_HOMEBREW[] = { ".vpk",".self",".suprx",".skprx",NULL };
-static const char* EXT_SAVEDATA[] = { ".sav",".dat",".save",NULL };
-
-static const char** filter_to_ext(Filter f) {
-    switch(f){
-        case F_GAMES: return EXT_GAMES;
-        case F_MP3: return EXT_MP3;
-        case F_OGG: return EXT_OGG;
-        case F_PHOTO: return EXT_PHOTO;
-        case F_VIDEO: return EXT_VIDEO;
-        case F_DOCS: return EXT_DOCS;
-        case F_ARCHIVES: return EXT_ARCHIVES;
-        case F_HOMEBREW: return EXT_HOMEBREW;
-        case F_SAVEDATA: return EXT_SAVEDATA;
-        default: return EXT_ALL;
-    }
-}
-
-static const char* filter_to_label(Filter f) {
-    switch(f){
-        case F_GAMES: return "Games";
-        case F_MP3: return "MP3";
-        case F_OGG: return "OGG";
-        case F_PHOTO: return "Photo";
-        case F_VIDEO: return "Video";
-        case F_DOCS: return "Docs";
-        case F_ARCHIVES: return "Archives";
-        case F_HOMEBREW: return "Homebrew";
-        case F_SAVEDATA: return "SaveData";
-        default: return "All";
-    }
-}
-
-static int ext_array_count(const char** arr){ int n=0; while(arr&&arr[n])++n; return n; }
-
-static int breadcrumb_init(Breadcrumb* bc, const char* initial_path) {
-    if (!bc) return -1;
-    bc->depth = 0;
-    if (initial_path) {
-        strncpy(bc->paths[0], initial_path, MAX_PATH_LEN - 1);
-        bc->paths[0][MAX_PATH_LEN - 1] = '\0';
-        bc->depth = 1;
-    }
-    return 0;
-}
-
-static int breadcrumb_push(Breadcrumb* bc, const char* path) {
-    if (!bc || !path || bc->depth >= 15) return -1;
-    strncpy(bc->paths[bc->depth], path, MAX_PATH_LEN - 1);
-    bc->paths[bc->depth][MAX_PATH_LEN - 1] = '\0';
-    bc->depth++;
-    return 0;
-}
-
-static int breadcrumb_pop(Breadcrumb* bc) {
-    if (!bc || bc->depth <= 1) return -1;
-    bc->depth--;
-    return 0;
-}
-
-static const char* breadcrumb_current(Breadcrumb* bc) {
-    if (!bc || bc->depth <= 0) return "ux0:/";
-    return bc->paths[bc->depth - 1];
-}
-
-static uint64_t prev_time = 0;
-static float fps_val = 0.0f;
-
-static void update_fps() {
-    uint64_t now = sceKernelGetProcessTimeWide();
-    if (prev_time != 0) {
-        uint64_t delta = now - prev_time;
-        if (delta > 0) fps_val = 1000000.0f / (float)delta;
-    }
-    prev_time = now;
-}
-
-static int get_fps() { return (int)fps_val; }
-
-int main(int argc, char* argv[]) {
-    sceCtrlSetSamplingMode(SCE_CTRL_MODE_ANALOG);
-    scePowerSetArmClockFrequency(444);
-    scePowerSetBusClockFrequency(222);
-    scePowerSetGpuClockFrequency(222);
-    scePowerSetGpuXbarClockFrequency(166);
-
-    ui_init();
-
-    PartitionInfo parts[8]; int parts_count=0;
-    FolderUsage top[128]; int top_count=0;
-
-    ui_draw(NULL, 0, 0, NULL, 0, 0, 0, 0.0f, 0, 0, 0, NULL, 0, 0, NULL, 1);
-
-    fs_detect_partitions(parts, &parts_count);
-
-    int current_part = 0;
-    int current_folder = 0;
-
-    Breadcrumb breadcrumb;
-    memset(&breadcrumb, 0, sizeof(breadcrumb));
-
-    if(parts_count > 0) {
-        breadcrumb_init(&breadcrumb, parts[current_part].path);
-        const char* current_path = breadcrumb_current(&breadcrumb);
-        top_count = fs_scan_directory(current_path, top, 128);
-        if(top_count<0) top_count=0;
-    } else {
-        breadcrumb_init(&breadcrumb, "ux0:/");
-    }
-
-    int running = 1, move_delay = 0, calculating = 0;
-    int overlay_active = 0, overlay_sel = 0;
-    int delete_confirm_active = 0;
-    char delete_confirm_name[256] = "";
-
-    const char* overlay_labels[F__COUNT] = { "All", "Games", "MP3", "OGG", "Photo", "Video", "Docs", "Archives", "Homebrew", "SaveData" };
-
-    SceCtrlData pad, old_pad={0};
-    SceRtcTick last_switch_time;
-    sceRtcGetCurrentTick(&last_switch_time);
-
-    Filter cur_filter = F_ALL;
-    ui_set_filter_label(filter_to_label(cur_filter));
-
-    while(running){
-        update_fps();
-
-        sceCtrlPeekBufferPositive(0,&pad,1);
-        unsigned int pressed = pad.buttons & ~old_pad.buttons;
-
-        if (pressed & SCE_CTRL_SQUARE) overlay_active = !overlay_active;
-
-        if(overlay_active){
-            if(pressed & SCE_CTRL_UP)   overlay_sel = (overlay_sel - 1 + F__COUNT) % F__COUNT;
-            if(pressed & SCE_CTRL_DOWN) overlay_sel = (overlay_sel + 1) % F__COUNT;
-
-            if(pressed & SCE_CTRL_CROSS){
-                cur_filter = (Filter)overlay_sel;
-                ui_set_filter_label(filter_to_label(cur_filter));
-                calculating = 1;
-                sceRtcGetCurrentTick(&last_switch_time);
-                overlay_active = 0;
-            }
-
-            if(pressed & SCE_CTRL_CIRCLE){
-                overlay_active = 0;
-            }
-        } else if(delete_confirm_active) {
-            if(pressed & SCE_CTRL_CROSS) {
-                char full_path[MAX_PATH_LEN];
-                fs_build_path(breadcrumb_current(&breadcrumb), delete_confirm_name, full_path, sizeof(full_path));
-                if (fs_delete_entry(full_path) == 0) {
-                    calculating = 1;
-                    sceRtcGetCurrentTick(&last_switch_time);
-                }
-                delete_confirm_active = 0;
-            } else if(pressed & SCE_CTRL_CIRCLE) {
-                delete_confirm_active = 0;
-            }
-        } else {
-            if(move_delay>0) move_delay--;
-
-            const char* current_path = breadcrumb_current(&breadcrumb);
-
-            if(move_delay==0){
-                if(pad.ly<128-STICK_THRESHOLD){
-                    current_part=(current_part-1+parts_count)%parts_count;
-                    move_delay=MOVE_DELAY;
-                    calculating=1;
-                    sceRtcGetCurrentTick(&last_switch_time);
-                    current_folder=0;
-                    breadcrumb_init(&breadcrumb, parts[current_part].path);
-                }
-                if(pad.ly>128+STICK_THRESHOLD){
-                    current_part=(current_part+1)%parts_count;
-                    move_delay=MOVE_DELAY;
-                    calculating=1;
-                    sceRtcGetCurrentTick(&last_switch_time);
-                    current_folder=0;
-                    breadcrumb_init(&breadcrumb, parts[current_part].path);
-                }
-            }
-
-            if(pressed & SCE_CTRL_UP){ if(current_folder>0) current_folder--; }
-            if(pressed & SCE_CTRL_DOWN){ if(current_folder<top_count-1) current_folder++; }
-
-            if(pressed & SCE_CTRL_CROSS && current_folder < top_count) {
-                const char* entry_name = top[current_folder].name;
-                char new_path[MAX_PATH_LEN];
-                fs_build_path(current_path, entry_name, new_path, sizeof(new_path));
-
-                int is_dir = (entry_name[strlen(entry_name)-1] == '/') || fs_is_directory(new_path);
-
-                if (is_dir) {
-                    breadcrumb_push(&breadcrumb, new_path);
-                    calculating = 1;
-                    sceRtcGetCurrentTick(&last_switch_time);
-                    current_folder = 0;
-                }
-            }
-
-            if(pressed & SCE_CTRL_CIRCLE) {
-                if (breadcrumb.depth > 1) {
-                    breadcrumb_pop(&breadcrumb);
-                    calculating = 1;
-                    sceRtcGetCurrentTick(&last_switch_time);
-                    current_folder = 0;
-                }
-            }
-
-            if(pressed & SCE_CTRL_TRIANGLE) running = 0;
-
-            if(pressed & SCE_CTRL_RTRIGGER && current_folder < top_count && !delete_confirm_active) {
-                const char* entry_name = top[current_folder].name;
-                delete_confirm_active = 1;
-                strncpy(delete_confirm_name, entry_name, sizeof(delete_confirm_name) - 1);
-                delete_confirm_name[sizeof(delete_confirm_name) - 1] = '\0';
-            }
-
-        }
-
-        int battery = scePowerGetBatteryLifePercent();
-        if(battery<0) battery=0; if(battery>100) battery=100;
-
-        SceRtcTick now;
-        sceRtcGetCurrentTick(&now);
-        uint64_t ms_diff = (now.tick - last_switch_time.tick)/1000ULL;
-        if(calculating && ms_diff>=CALCULATING_DELAY_MS){
-            const char* current_path = breadcrumb_current(&breadcrumb);
-            if(cur_filter==F_ALL){
-                top_count = fs_scan_directory(current_path, top, 128);
-                if(top_count<0) top_count=0;
-            } else {
-                const char** exts=filter_to_ext(cur_filter);
-                uint64_t filtered_size = fs_size_by_extension(current_path, exts, ext_array_count(exts));
-                snprintf(top[0].name,sizeof(top[0].name),"%s total",filter_to_label(cur_filter));
-                top[0].size_bytes=filtered_size;
-                top_count=1;
-            }
-            calculating=0;
-        }
-
-        // Only draw UI if not exiting
-        if (running) {
-            ui_draw(parts, parts_count, current_part, top, top_count,
-                    battery, get_fps(), calculating?1.0f:0.0f,
-                    current_folder, overlay_active, overlay_sel, overlay_labels, F__COUNT,
-                    delete_confirm_active, delete_confirm_name, 0);
-        }
-
-        old_pad = pad;
-    }
-
-    // Small delay to allow GPU to finish processing
-    sceKernelDelayThread(100000); 
-    ui_deinit();
-    sceKernelExitProcess(0);
-    return 0;
-}
+#include <psp2/kernel/processmgr.h>
+#include <psp2/kernel/threadmgr.h>
+#include <psp2/ctrl.h>
+#include <psp2/display.h>
+#include <psp2/power.h>
+#include <psp2/rtc.h>
+#include <psp2/io/stat.h>
+#include <psp2/io/dirent.h>
+#include <psp2/io/fcntl.h>
+#include <vita2d.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fs_analyzer.h"
+#include "fs_tree.h"
+#include "fs_scanner.h"
+#include "fs_purge.h"
+#include "fs_dupes.h"
+#include "fs_largest.h"
+#include "fs_treemap.h"
+#include "fs_snapshot.h"
+#include "fs_prefetch.h"
+#include "fs_filter.h"
+#include "fs_spill.h"
+#include "fs_report.h"
+#include "fs_search.h"
+#include "frame_prof.h"
+#include "ui.h"
+#include "ui_text.h"
+
+#define STICK_THRESHOLD 80
+#define MOVE_DELAY 10
+#define CALCULATING_DELAY_MS 300
+#define MAX_PATH_LEN 512
+#define CACHE_DIR "ux0:data/FreeSpaceAnalyzer"
+#define SCAN_THREADS 3
+#define SCAN_MEMORY_BUDGET (48 * 1024 * 1024) // tree bytes before a walk spills to disk instead
+#define IO_LOG_PATH CACHE_DIR "/io_log.txt"
+#define FRAME_TRACE_PATH CACHE_DIR "/frame_trace.json"
+#define FILTERS_PATH CACHE_DIR "/filters.txt"
+#define IDLE_REDRAW_US 1000000
+#define SNAPSHOT_MAX_AGE (7 * 24 * 3600)     // seconds a Changes baseline is kept
+#define RTC_UNIX_EPOCH 62135596800ULL         // seconds from year 1 to 1970
+#define PREFETCH_ROWS 3                       // largest folders of a list sized ahead
+#define NOTICE_US 5000000                     // how long an export result stays in the header
+
+#define BREADCRUMB_DEPTH (MAX_PATH_LEN / 2)   // deepest a path can nest: each level adds "/x"
+
+// Folders from the partition root down, with the cursor row each one was
+// left at, so going back lands where the user came from. Each level is a
+// prefix of the current folder's path.
+typedef struct {
+    char path[MAX_PATH_LEN];
+    uint16_t ends[BREADCRUMB_DEPTH];   // length of each level's path
+    int cursor[BREADCRUMB_DEPTH];
+    int depth;
+} Breadcrumb;
+
+// START cycles through the debug panels
+typedef enum { PANEL_NONE=0, PANEL_IO, PANEL_FRAMES, PANEL__COUNT } DebugPanel;
+
+// Square-menu entries: All, one per engine category in FsCategory order, the
+// per-extension breakdown, the duplicate files of every partition, the
+// largest files of the current one, its folders that changed since the
+// last snapshot and a search of its names, then one per filters.txt filter
+// from F__COUNT on. Entries before F_TYPES and the filters.txt ones list
+// real folder entries.
+typedef enum { F_ALL=0, F_GAMES, F_MP3, F_OGG, F_PHOTO, F_VIDEO, F_DOCS, F_ARCHIVES, F_HOMEBREW, F_SAVEDATA, F_TYPES, F_DUPES, F_LARGEST, F_CHANGES, F_SEARCH, F__COUNT } Filter;
+
+static FsFilterSet user_filters;
+
+static const char DEFAULT_FILTERS[] =
+    "# Free Space Analyzer filters, listed in the Square menu after the built-in\n"
+    "# ones: one \"Label = glob glob ...\" per line. Lines with the same label add\n"
+    "# to one filter. Globs ignore case:\n"
+    "#   *  any characters but '/'        ?   one character but '/'\n"
+    "#   ** any characters, '/' too       **/ zero or more folders\n"
+    "# A glob starting with a partition (ux0:/...) matches whole paths from there;\n"
+    "# any other glob matches at any folder depth. A folder that matches brings\n"
+    "# everything inside it along.\n"
+    "PSP games = ux0:/pspemu/**/*.iso ux0:/pspemu/**/*.cso ux0:/pspemu/psp/game/*\n"
+    "Save data = */savedata/*\n"
+    "Logs and dumps = *.log *.psp2dmp *.spsp2dmp\n";
+
+static FsCategory filter_to_category(Filter f) { return (FsCategory)(f - F_GAMES); }
+
+static int filter_lists_entries(Filter f) { return f < F_TYPES || f >= F__COUNT; }
+
+static const char* filter_to_label(Filter f) {
+    if(f >= F__COUNT) return user_filters.labels[f - F__COUNT];
+    if(f == F_ALL) return "All";
+    if(f == F_TYPES) return "By type";
+    if(f == F_DUPES) return "Duplicates";
+    if(f == F_LARGEST) return "Largest files";
+    if(f == F_CHANGES) return "Changes";
+    if(f == F_SEARCH) return "Search";
+    return fs_category_label(filter_to_category(f));
+}
+
+static int breadcrumb_init(Breadcrumb* bc, const char* initial_path) {
+    if (!bc) return -1;
+    bc->depth = 0;
+    bc->path[0] = '\0';
+    if (initial_path) {
+        strncpy(bc->path, initial_path, MAX_PATH_LEN - 1);
+        bc->path[MAX_PATH_LEN - 1] = '\0';
+        bc->ends[0] = (uint16_t)strlen(bc->path);
+        bc->cursor[0] = 0;
+        bc->depth = 1;
+    }
+    return 0;
+}
+
+// `path` has to lie below the current folder
+static int breadcrumb_push(Breadcrumb* bc, const char* path) {
+    if (!bc || !path || bc->depth <= 0 || bc->depth >= BREADCRUMB_DEPTH) return -1;
+    size_t cur = bc->ends[bc->depth - 1], n = strlen(path);
+    if (n <= cur || n >= MAX_PATH_LEN || strncmp(path, bc->path, cur) != 0) return -1;
+    memcpy(bc->path, path, n + 1);
+    bc->ends[bc->depth] = (uint16_t)n;
+    bc->cursor[bc->depth] = 0;
+    bc->depth++;
+    return 0;
+}
+
+// Crumbs from `root` down to the folder that holds `file`
+static void breadcrumb_open_parent(Breadcrumb* bc, const char* root, const char* file) {
+    breadcrumb_init(bc, root);
+    size_t rlen = strlen(root);
+    const char* end = strrchr(file, '/');
+    if (!end || strncmp(file, root, rlen) != 0) return;
+    char prefix[MAX_PATH_LEN];
+    for (const char* p = file + rlen; p <= end; ++p) {
+        size_t n = (size_t)(p - file);
+        if (*p != '/' || n <= rlen || n >= sizeof(prefix)) continue;
+        memcpy(prefix, file, n);
+        prefix[n] = '\0';
+        if (breadcrumb_push(bc, prefix) < 0) return;
+    }
+}
+
+static int breadcrumb_pop(Breadcrumb* bc) {
+    if (!bc || bc->depth <= 1) return -1;
+    bc->depth--;
+    bc->path[bc->ends[bc->depth - 1]] = '\0';
+    return 0;
+}
+
+static const char* breadcrumb_current(Breadcrumb* bc) {
+    if (!bc || bc->depth <= 0) return "ux0:/";
+    return bc->path;
+}
+
+static FsTree part_trees[MAX_PARTITIONS];
+static PartitionInfo* part_info = NULL;
+
+static void cache_path(int part, char* out, int outsz) {
+    snprintf(out, outsz, "%s/index_%s.bin", CACHE_DIR, part_info[part].label);
+}
+
+static int tree_ready(int part) { return part_trees[part].node_count > 0; }
+
+// Partitions too big for a tree in SCAN_MEMORY_BUDGET are browsed from a
+// path index on disk, one folder listing at a time
+static FsPathIndex part_index[MAX_PARTITIONS];
+static int part_indexed[MAX_PARTITIONS];
+
+static void path_index_path(int part, char* out, int outsz) {
+    snprintf(out, outsz, "%s/pathindex_%s.fsap", CACHE_DIR, part_info[part].label);
+}
+
+static int index_ready(int part) { return part_indexed[part]; }
+
+static void drop_index(int part) {
+    if(part_indexed[part]) fs_path_index_close(&part_index[part]);
+    part_indexed[part] = 0;
+}
+
+// Entries of `path` from the partition's index; only the All view has them
+static void list_indexed(int part, const char* path, Filter f, FsListing* out) {
+    fs_listing_clear(out);
+    if(f != F_ALL) return;
+    const char* root = part_info[part].path;
+    size_t rl = strlen(root);
+    while(rl > 0 && root[rl-1] == '/') rl--;
+    if(strncmp(path, root, rl) != 0) return;
+    const char* p = path + rl;
+    while(*p == '/') p++;
+    char rel[MAX_PATH_LEN];
+    snprintf(rel, sizeof(rel), "%s", p);
+    size_t n = strlen(rel);
+    while(n > 0 && rel[n-1] == '/') rel[--n] = '\0';
+    if(fs_path_index_list(&part_index[part], rel, out) < 0) fs_listing_clear(out);
+}
+
+static void snapshot_path(int part, char* out, int outsz) {
+    snprintf(out, outsz, "%s/snapshot_%s.fsas", CACHE_DIR, part_info[part].label);
+}
+
+static uint64_t unix_now(void) {
+    SceRtcTick now;
+    sceRtcGetCurrentTick(&now);
+    return now.tick / 1000000ULL - RTC_UNIX_EPOCH;
+}
+
+// The baseline of the Changes view: taken after a walk when there is none
+// yet or the last one is more than a week old.
+static void keep_snapshot(int part) {
+    char path[MAX_PATH_LEN];
+    snapshot_path(part, path, sizeof(path));
+    FsSnapHeader hdr;
+    uint64_t now = unix_now();
+    if(fs_snapshot_peek(path, &hdr) == 0 && hdr.taken <= now && now - hdr.taken < SNAPSHOT_MAX_AGE) return;
+    FsSnapshot snap;
+    if(fs_snapshot_build(&snap, &part_trees[part], now) < 0) return;
+    fs_snapshot_save(&snap, path);
+    fs_snapshot_free(&snap);
+}
+
+static FsScanner scanners[MAX_PARTITIONS];
+static int scan_tried[MAX_PARTITIONS];
+
+static int scan_running(int part) { return scanners[part].part >= 0; }
+
+// A running walk of another partition on the same physical medium, or -1.
+static int medium_owner(int part, int parts_count) {
+    for(int q=0;q<parts_count;q++)
+        if(q != part && scan_running(q) && part_info[q].medium == part_info[part].medium) return q;
+    return -1;
+}
+
+static void start_scan(int part, const char* focus) {
+    char cpath[MAX_PATH_LEN];
+    cache_path(part, cpath, sizeof(cpath));
+    uint64_t used = part_info[part].total_bytes - part_info[part].free_bytes;
+    scan_tried[part] = 1;
+    char ipath[MAX_PATH_LEN];
+    path_index_path(part, ipath, sizeof(ipath));
+    fs_scanner_set_budget(&scanners[part], SCAN_MEMORY_BUDGET, ipath);
+    fs_scanner_start(&scanners[part], part, part_info[part].path, cpath, used, focus, SCAN_THREADS);
+}
+
+// Walks every partition in the background, one walk per medium at a time, so
+// the memory card and an SD2Vita are read side by side.
+static void schedule_scans(int parts_count) {
+    for(int p=0;p<parts_count;p++) {
+        if(scan_tried[p] || tree_ready(p) || scan_running(p) || medium_owner(p, parts_count) >= 0) continue;
+        start_scan(p, part_info[p].path);
+    }
+}
+
+// The partition on screen gets its medium: a background walk sharing it is
+// dropped and picked up again later.
+static void scan_current(int part, int parts_count, const char* focus) {
+    int owner = medium_owner(part, parts_count);
+    if(owner >= 0) {
+        fs_scanner_cancel(&scanners[owner]);
+        scan_tried[owner] = 0;
+    }
+    start_scan(part, focus);
+}
+
+// While the I/O panel is open every finished walk appends its per-call
+// profile to the log.
+static void log_scan_io(int part, const FsScanner* s) {
+    if(!fs_io_enabled() || fs_io_total_calls(&s->io) == 0) return;
+    char title[128];
+    snprintf(title, sizeof(title), "scan %s: %llu files in %llu ms", part_info[part].path,
+             (unsigned long long)s->progress.files, (unsigned long long)(s->progress.elapsed_us / 1000));
+    fs_io_write_log(IO_LOG_PATH, title, &s->io);
+}
+
+// Deletes rename into the partition's trash right away; this empties it
+static FsPurger purger;
+
+// L marks rows of the current listing for one delete. The marks belong to
+// one listing generation and are dropped as soon as the listing changes.
+static uint8_t* selected = NULL;
+static uint32_t selected_cap = 0, selected_gen = 0;
+static int selected_count = 0;
+
+static void selection_sync(const FsListing* l) {
+    if(selected_gen == l->gen && selected_cap >= l->count) return;
+    if(selected_cap < l->count) {
+        uint32_t cap = l->count < 64 ? 64 : l->count;
+        uint8_t* p = (uint8_t*)realloc(selected, cap);
+        if(!p) { selected_count = 0; return; }
+        selected = p;
+        selected_cap = cap;
+    }
+    if(selected) memset(selected, 0, selected_cap);
+    selected_count = 0;
+    selected_gen = l->gen;
+}
+
+static void selection_toggle(const FsListing* l, int row) {
+    selection_sync(l);
+    if(row < 0 || (uint32_t)row >= l->count || (uint32_t)row >= selected_cap) return;
+    selected[row] = !selected[row];
+    selected_count += selected[row] ? 1 : -1;
+}
+
+// Partitions with entries queued to be deleted in place: the tree drops
+// them up front, so if any cannot be removed the partition is walked again
+static uint32_t purge_in_place;
+static uint32_t purge_errors_seen;
+
+// Trashes the marked rows, or `name` when nothing is marked, and takes
+// their sizes off the tree. An entry that cannot be renamed into the trash
+// is queued on the purger to be deleted in place. Returns how many entries
+// could not even be queued and were left alone, or -1 when the tree no
+// longer matches the disk.
+static int delete_entries(int part, const char* dir_path, const FsListing* l, const char* name) {
+    FsTree* tree = &part_trees[part];
+    selection_sync(l);
+    int count = selected_count > 0 ? selected_count : 1;
+    char (*paths)[MAX_PATH_LEN] = malloc((size_t)count * MAX_PATH_LEN);
+    const char** ptrs = malloc((size_t)count * sizeof(*ptrs));
+    uint64_t* sizes = malloc((size_t)count * sizeof(*sizes));
+    int* moved = malloc((size_t)count * sizeof(*moved));
+    if(!paths || !ptrs || !sizes || !moved) { free(paths); free(ptrs); free(sizes); free(moved); return -1; }
+
+    int n = 0;
+    if(selected_count > 0) {
+        for(uint32_t i=0; i<l->count && i<selected_cap && n<count; i++)
+            if(selected[i]) fs_build_path(dir_path, fs_listing_name(l, i), paths[n++], MAX_PATH_LEN);
+    } else {
+        fs_build_path(dir_path, name, paths[n++], MAX_PATH_LEN);
+    }
+    for(int i=0;i<n;i++) {
+        uint32_t node = fs_tree_lookup(tree, paths[i]);
+        sizes[i] = node != FS_TREE_NONE ? tree->nodes[node].size_bytes : 0;
+        ptrs[i] = paths[i];
+    }
+    // Entries left where they were are deleted in place instead
+    if(n > 0) fs_purger_trash(&purger, part_info[part].path, ptrs, sizes, n, moved);
+
+    int left = 0, stale = 0;
+    for(int i=0;i<n;i++) {
+        if(!moved[i]) {
+            if(fs_purger_delete(&purger, paths[i], sizes[i]) < 0) { left++; continue; }
+            purge_in_place |= 1u << part;
+        }
+        if(fs_tree_remove(tree, fs_tree_lookup(tree, paths[i])) < 0) stale = 1;
+    }
+
+    free(paths); free(ptrs); free(sizes); free(moved);
+    if(selected) memset(selected, 0, selected_cap);
+    selected_count = 0;
+    return stale ? -1 : left;
+}
+
+// Duplicate hunt over the trees of every partition. Deletes and finished
+// scans make the result stale; the Duplicates view then starts a new one.
+static FsDupeFinder dupes;
+static FsDupeState dupes_state = FS_DUPES_IDLE;
+static int dupes_stale = 1;
+static int dupes_group = -1; // group whose copies are listed, -1 for the groups
+
+static int all_trees_ready(int parts_count) {
+    for(int i=0;i<parts_count;i++) if(!tree_ready(i) || scan_running(i)) return 0;
+    return parts_count > 0;
+}
+
+// Groups by reclaimable bytes, each named after its first copy, or the
+// copies of the open group by full path
+static void list_dupes(FsListing* out) {
+    fs_listing_clear(out);
+    if(dupes_state != FS_DUPES_DONE) return;
+    const FsDupes* d = &dupes.result;
+    if(dupes_group >= 0 && (uint32_t)dupes_group < d->group_count) {
+        const FsDupeGroup* g = &d->groups[dupes_group];
+        for(uint32_t i=g->first;i<g->first+g->count;i++) fs_listing_add(out, fs_dupes_path(d, i), g->size, 0);
+        return;
+    }
+    char label[160];
+    for(uint32_t i=0;i<d->group_count;i++) {
+        const FsDupeGroup* g = &d->groups[i];
+        const char* path = fs_dupes_path(d, g->first);
+        const char* base = strrchr(path, '/');
+        snprintf(label, sizeof(label), "%s  (%u copies)", base ? base + 1 : path, (unsigned)g->count);
+        fs_listing_add(out, label, g->reclaim, FS_ENTRY_DIR);
+    }
+}
+
+// Largest files of one partition, kept until its tree changes
+static FsLargest largest;
+static int largest_part = -1;
+
+// Without a tree the disk is walked in the background; the rows show up
+// once the walk is over
+static FsLargestWalker largest_walker;
+static int largest_walk_part = -1;
+static uint64_t largest_walk_files;
+
+// From the partition's tree, or straight from the disk when its walk failed.
+// Rows show the path below the partition root.
+static void list_largest(int part, FsListing* out) {
+    fs_listing_clear(out);
+    if(largest_part != part) {
+        if(!tree_ready(part)) {
+            if(!scan_running(part) && largest_walk_part != part &&
+               fs_largest_walker_start(&largest_walker, part_info[part].path) == 0) {
+                largest_walk_part = part;
+                largest_walk_files = UINT64_MAX;
+            }
+            return;
+        }
+        if(largest_walk_part == part) {
+            fs_largest_walker_cancel(&largest_walker);
+            largest_walk_part = -1;
+            ui_set_notice(NULL);
+        }
+        if(!largest.cap && fs_largest_init(&largest, FS_LARGEST_COUNT) < 0) return;
+        fs_largest_from_tree(&largest, &part_trees[part], 0);
+        largest_part = part;
+    }
+    size_t root_len = strlen(part_info[part].path);
+    for(uint32_t i=0;i<largest.count;i++) {
+        const char* path = fs_largest_path(&largest, i);
+        fs_listing_add(out, strncmp(path, part_info[part].path, root_len) ? path : path + root_len, largest.items[i].size, 0);
+    }
+}
+
+// SELECT swaps the All view's rows for a treemap of the folder, laid out
+// in the background and cached per folder until its tree changes
+static FsTreemapper treemapper;
+
+// Folders of one partition that grew or shrank the most since its snapshot:
+// growers first, then shrinkers
+static FsSnapDiff changes;
+
+static void list_changes(int part, FsListing* out) {
+    fs_listing_clear(out);
+    memset(&changes, 0, sizeof(changes));
+    if(!tree_ready(part)) return;
+    char path[MAX_PATH_LEN];
+    snapshot_path(part, path, sizeof(path));
+    FsSnapshot base, now;
+    if(fs_snapshot_load(&base, path) < 0) return;
+    if(fs_snapshot_build(&now, &part_trees[part], unix_now()) == 0) {
+        fs_snapshot_diff(&base, &now, &changes);
+        fs_snapshot_free(&now);
+    }
+    fs_snapshot_free(&base);
+
+    char label[FS_SNAP_PATH + 16];
+    for(uint32_t i=0;i<changes.grew_count;i++) {
+        const FsSnapChange* c = &changes.grew[i];
+        snprintf(label, sizeof(label), "+ %s%s", c->path, c->before ? "" : "  (new)");
+        fs_listing_add(out, label, (uint64_t)c->delta, 0);
+    }
+    for(uint32_t i=0;i<changes.shrank_count;i++) {
+        const FsSnapChange* c = &changes.shrank[i];
+        snprintf(label, sizeof(label), "- %s%s", c->path, c->after ? "" : "  (gone)");
+        fs_listing_add(out, label, (uint64_t)-c->delta, 0);
+    }
+}
+
+static const char* change_path(int row) {
+    if(row < 0) return NULL;
+    if((uint32_t)row < changes.grew_count) return changes.grew[row].path;
+    row -= (int)changes.grew_count;
+    return (uint32_t)row < changes.shrank_count ? changes.shrank[row].path : NULL;
+}
+
+// Name search over one partition. Each walk hands over an index of its
+// tree; one that deletes made stale is built again in the background on the
+// next query, and the results come once it is done.
+static FsNameIndex part_names[MAX_PARTITIONS];
+static FsNameIndexer indexer;
+static int index_part = -1, index_shown = 0;
+static FsSearch search;
+static char search_query[FS_SEARCH_QUERY];
+static int search_key = 0, search_on_results = 0;
+
+// The largest entries whose name holds the query, by path below the
+// partition root
+static void list_search(int part, FsListing* out) {
+    fs_listing_clear(out);
+    if(!tree_ready(part)) return;
+    FsTree* tree = &part_trees[part];
+    if(part_names[part].gen != tree->gen) {
+        if(indexer.tree != tree && fs_name_indexer_start(&indexer, tree) == 0) {
+            index_part = part;
+            index_shown = 0;
+        }
+        return;
+    }
+    if(fs_search_run(&search, &part_names[part], tree, search_query) < 0) return;
+    size_t root_len = strlen(part_info[part].path);
+    char path[MAX_PATH_LEN];
+    for(uint32_t i=0;i<search.hit_count;i++) {
+        const FsNode* n = &tree->nodes[search.hits[i]];
+        if(fs_tree_path(tree, search.hits[i], path, sizeof(path)) < 0) continue;
+        fs_listing_add(out, strncmp(path, part_info[part].path, root_len) ? path : path + root_len, n->size_bytes,
+                       (n->flags & FS_NODE_DIR) ? FS_ENTRY_DIR : 0);
+    }
+}
+
+// Full path of a search result row, or NULL once the tree moved on
+static const char* search_hit_path(int part, int row, char* out, int outsz) {
+    const FsTree* tree = &part_trees[part];
+    if(row < 0 || (uint32_t)row >= search.hit_count || search.gen != tree->gen) return NULL;
+    return fs_tree_path(tree, search.hits[row], out, outsz) == 0 ? out : NULL;
+}
+
+// Category and extension totals of recently seen folders, each filled by one
+// pass over its subtree. While a filter is on, the worker fills in the
+// folder under the cursor and the largest ones next to it ahead of time.
+static FsPrefetcher prefetch;
+
+// Report of a whole partition, written in the background as JSON Lines in
+// the same format as fsa-cli's scan
+static FsExporter exporter;
+static int export_part = -1;
+static uint64_t notice_until_us;
+
+static void show_notice(const char* text) {
+    ui_set_notice(text);
+    notice_until_us = sceKernelGetProcessTimeWide() + NOTICE_US;
+}
+
+static void start_export(int part) {
+    char path[MAX_PATH_LEN];
+    snprintf(path, sizeof(path), "%s/report_%s.%s", CACHE_DIR, part_info[part].label, fs_report_suffix(FS_REPORT_JSONL));
+    if(!tree_ready(part)) { show_notice("Export needs a finished scan"); return; }
+    if(fs_exporter_start(&exporter, &part_trees[part], 0, path, FS_REPORT_JSONL) < 0) return;
+    export_part = part;
+    ui_set_notice("Exporting report...");
+    notice_until_us = 0;
+}
+
+// Puts the result of a finished export in the header; 1 when it changed
+static int poll_export(void) {
+    if(export_part < 0) {
+        if(notice_until_us && sceKernelGetProcessTimeWide() >= notice_until_us) {
+            notice_until_us = 0;
+            ui_set_notice(NULL);
+            return 1;
+        }
+        return 0;
+    }
+    uint64_t rows = 0;
+    FsExportState st = fs_exporter_poll(&exporter, &rows);
+    if(st == FS_EXPORT_RUNNING) return 0;
+    char line[96];
+    if(st == FS_EXPORT_DONE)
+        snprintf(line, sizeof(line), "Saved report_%s.jsonl (%llu rows)", part_info[export_part].label, (unsigned long long)rows);
+    else
+        snprintf(line, sizeof(line), "Report export failed");
+    export_part = -1;
+    show_notice(line);
+    return 1;
+}
+
+// Shows how far the disk walk for the Largest view got; 1 when it changed
+static int poll_largest(void) {
+    if(largest_walk_part < 0) return 0;
+    uint64_t files = 0;
+    FsLargestState st = fs_largest_walker_poll(&largest_walker, &files);
+    char line[64];
+    if(st == FS_LARGEST_RUNNING) {
+        if(files == largest_walk_files) return 0;
+        largest_walk_files = files;
+        snprintf(line, sizeof(line), "Looking for the largest files: %llu seen", (unsigned long long)files);
+        ui_set_notice(line);
+        notice_until_us = 0;
+        return 1;
+    }
+    if(st == FS_LARGEST_DONE) {
+        fs_largest_walker_take(&largest_walker, &largest);
+        largest_part = largest_walk_part;
+        ui_set_notice(NULL);
+    } else {
+        show_notice("Looking for the largest files failed");
+    }
+    largest_walk_part = -1;
+    return 1;
+}
+
+// Puts "Indexing names..." up while a stale index is built again and swaps
+// the new one in. A build that failed or was released is started over by
+// the next query. 1 when it changed.
+static int poll_index(void) {
+    if(index_part < 0) return 0;
+    FsIndexState st = fs_name_indexer_poll(&indexer);
+    if(st == FS_INDEX_RUNNING) {
+        if(index_shown) return 0;
+        index_shown = 1;
+        ui_set_notice("Indexing names...");
+        notice_until_us = 0;
+        return 1;
+    }
+    int part = index_part;
+    index_part = -1;
+    if(st == FS_INDEX_DONE && indexer.result.gen == part_trees[part].gen) fs_name_indexer_take(&indexer, &part_names[part]);
+    else fs_name_indexer_release(&indexer, indexer.tree);
+    if(st == FS_INDEX_FAILED) show_notice("Indexing names failed");
+    else if(index_shown) ui_set_notice(NULL);
+    return 1;
+}
+
+static const FsTypeStats* folder_type_stats(int part, uint32_t node) {
+    return fs_prefetcher_acquire(&prefetch, &part_trees[part], node);
+}
+
+// filters.txt, written with the examples above when there is none yet
+static void load_filters(void) {
+    fs_filter_init(&user_filters);
+    if(fs_filter_load(&user_filters, FILTERS_PATH) == 0) return;
+    SceUID fd = fs_io_open(FILTERS_PATH, SCE_O_WRONLY | SCE_O_CREAT | SCE_O_TRUNC, 0666);
+    if(fd >= 0) {
+        fs_io_write(fd, DEFAULT_FILTERS, sizeof(DEFAULT_FILTERS) - 1);
+        fs_io_close(fd);
+    }
+    fs_filter_parse(&user_filters, DEFAULT_FILTERS, sizeof(DEFAULT_FILTERS) - 1);
+}
+
+// filters.txt totals of the last folder listed with one of its filters
+static FsFilterStats user_stats;
+static const FsTree* user_stats_tree = NULL;
+static uint32_t user_stats_gen, user_stats_node;
+
+static const FsFilterStats* folder_filter_stats(int part, uint32_t node) {
+    const FsTree* tree = &part_trees[part];
+    if(user_stats_tree == tree && user_stats_gen == tree->gen && user_stats_node == node) return &user_stats;
+    user_stats_tree = NULL;
+    if(fs_filter_tree_stats(&user_filters, tree, node, &user_stats) < 0) return NULL;
+    user_stats_tree = tree;
+    user_stats_gen = tree->gen;
+    user_stats_node = node;
+    return &user_stats;
+}
+
+// The folder under the cursor first, then the largest folders of the list
+static void prefetch_rows(int part, const char* dir_path, const FsListing* l, int cursor) {
+    if(!tree_ready(part) || scan_running(part)) return;
+    FsTree* tree = &part_trees[part];
+    uint32_t nodes[PREFETCH_ROWS + 1];
+    int n = 0;
+    char path[MAX_PATH_LEN];
+    for(int i=-1; i<(int)l->count && n<PREFETCH_ROWS + 1; i++) {
+        int row = i < 0 ? cursor : i;
+        if(row < 0 || row >= (int)l->count || (i >= 0 && row == cursor) || !fs_listing_is_dir(l, row)) continue;
+        fs_build_path(dir_path, fs_listing_name(l, row), path, sizeof(path));
+        uint32_t node = fs_tree_lookup(tree, path);
+        if(node != FS_TREE_NONE) nodes[n++] = node;
+    }
+    fs_prefetcher_hint(&prefetch, tree, nodes, n);
+}
+
+// Each partition's folder and cursor, restored when coming back to it
+static Breadcrumb part_crumbs[MAX_PARTITIONS];
+static int part_cursor[MAX_PARTITIONS];
+
+static void leave_partition(int part, const Breadcrumb* bc, int cursor) {
+    part_crumbs[part] = *bc;
+    part_cursor[part] = cursor;
+}
+
+static void enter_partition(int part, Breadcrumb* bc, int* cursor) {
+    if(part_crumbs[part].depth > 0) {
+        *bc = part_crumbs[part];
+        *cursor = part_cursor[part];
+    } else {
+        breadcrumb_init(bc, part_info[part].path);
+        *cursor = 0;
+    }
+}
+
+// Order of the All view, cycled with the D-pad; kept across folders
+static int sort_key = FS_SORT_SIZE;
+
+// Size and age profile of the last folder listed from a tree
+static const FsTree* detail_tree = NULL;
+static uint32_t detail_gen, detail_node;
+static char folder_detail[160];
+static int detail_shown = 0;
+
+static void describe_folder(int part, uint32_t node) {
+    const FsTree* tree = &part_trees[part];
+    detail_shown = 1;
+    if(detail_tree == tree && detail_gen == tree->gen && detail_node == node) return;
+    FsFolderStats st;
+    folder_detail[0] = '\0';
+    detail_tree = NULL;
+    if(fs_tree_folder_stats(tree, node, (uint32_t)unix_now(), &st) < 0) return;
+    detail_tree = tree;
+    detail_gen = tree->gen;
+    detail_node = node;
+
+    // Files that leave most of a cluster empty, and bytes nobody wrote in a year
+    uint32_t small = 0;
+    for(int b=0;b<=fs_size_bucket(FS_CLUSTER_BYTES - 1);b++) small += st.size_files[b];
+    uint64_t stale = st.age_bytes[FS_AGE_3_YEARS] + st.age_bytes[FS_AGE_OLDER];
+    char slack[32], old[32], newest[16];
+    ui_text_format_bytes(st.slack_bytes, slack, sizeof(slack));
+    ui_text_format_bytes(stale, old, sizeof(old));
+    ui_text_format_date(st.newest, newest, sizeof(newest));
+    snprintf(folder_detail, sizeof(folder_detail),
+             "%u files in %u folders  |  %u%% under %u KB, %s slack  |  %s untouched for a year  |  newest %s",
+             (unsigned)st.files, (unsigned)st.dirs, st.files ? (unsigned)((uint64_t)small * 100 / st.files) : 0,
+             (unsigned)(FS_CLUSTER_BYTES / 1024), slack, old, newest);
+}
+
+// Lists a folder from the partition's size tree; no disk access. The All view
+// is the tree's own child block in the current sort order, a category or
+// filters.txt filter lists the children that hold any of it. Leaves `out`
+// empty while the partition has not been walked yet.
+static void list_folder(int part, const char* path, Filter f, FsListing* out) {
+    detail_shown = 0;
+    if(f == F_DUPES) { list_dupes(out); return; }
+    if(f == F_LARGEST) { list_largest(part, out); return; }
+    if(f == F_CHANGES) { list_changes(part, out); return; }
+    if(f == F_SEARCH) { list_search(part, out); return; }
+    if(!tree_ready(part) && index_ready(part)) {
+        // Index rows only carry sizes; the count and age orders stay by size
+        list_indexed(part, path, f, out);
+        if(f == F_ALL) fs_listing_sort_by(out, sort_key);
+        return;
+    }
+    FsTree* tree = &part_trees[part];
+    fs_listing_clear(out);
+    uint32_t node = fs_tree_lookup(tree, path);
+    if(node == FS_TREE_NONE) return;
+    describe_folder(part, node);
+    if(f == F_ALL) {
+        fs_listing_view(out, tree, node);
+        fs_listing_sort_by(out, sort_key);
+        return;
+    }
+
+    const uint64_t* rows = NULL;
+    uint32_t row_count = 0, stride = 0, col = 0;
+    const FsTypeStats* ts = NULL;
+    if(f >= F__COUNT) {
+        const FsFilterStats* us = folder_filter_stats(part, node);
+        if(!us) return;
+        rows = us->child_bytes; row_count = us->child_count; stride = us->stride; col = f - F__COUNT;
+    } else {
+        ts = folder_type_stats(part, node);
+        if(!ts) return;
+        rows = ts->child_bytes; row_count = ts->child_count; stride = FS_CAT_COUNT; col = filter_to_category(f);
+    }
+    if(f != F_TYPES) {
+        // Every child that holds some of the category, by its share of it
+        const FsNode* dir = &tree->nodes[node];
+        for(uint32_t i=0;i<row_count;i++) {
+            uint64_t bytes = rows[(size_t)i * stride + col];
+            if(!bytes) continue;
+            uint32_t c = dir->first_child + i;
+            fs_listing_add(out, fs_tree_name(tree, c), bytes, (tree->nodes[c].flags & FS_NODE_DIR) ? FS_ENTRY_DIR : 0);
+        }
+        fs_listing_sort(out);
+        return;
+    }
+    char label[96];
+    for(uint32_t i=0;i<ts->ext_cap;i++) {
+        const FsExtStat* e = &ts->exts[i];
+        if(!e->files) continue;
+        snprintf(label, sizeof(label), "%s%s  [%s, %u files]", e->ext[0] ? "." : "(no extension)", e->ext,
+                 fs_category_label(fs_ext_category(e)), (unsigned)e->files);
+        fs_listing_add(out, label, e->bytes, 0);
+    }
+    fs_listing_sort(out);
+}
+
+int main(int argc, char* argv[]) {
+    sceCtrlSetSamplingMode(SCE_CTRL_MODE_ANALOG);
+    scePowerSetArmClockFrequency(444);
+    scePowerSetBusClockFrequency(222);
+    scePowerSetGpuClockFrequency(222);
+    scePowerSetGpuXbarClockFrequency(166);
+
+    ui_init();
+
+    PartitionInfo parts[MAX_PARTITIONS]; int parts_count=0;
+    FsListing listing;
+    fs_listing_init(&listing);
+
+    UiFrame frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.startup_active = 1;
+    ui_draw(&frame);
+
+    fs_detect_partitions(parts, &parts_count);
+    part_info = parts;
+    for(int i=0;i<MAX_PARTITIONS;i++) fs_tree_init(&part_trees[i]);
+    fs_io_mkdir(CACHE_DIR, 0777);
+    load_filters();
+    for(int i=0;i<MAX_PARTITIONS;i++) fs_scanner_init(&scanners[i]);
+    fs_purger_init(&purger);
+    fs_dupe_finder_init(&dupes);
+    fs_treemapper_init(&treemapper);
+    fs_prefetcher_init(&prefetch);
+    fs_exporter_init(&exporter);
+    fs_largest_walker_init(&largest_walker, FS_LARGEST_COUNT);
+    fs_name_indexer_init(&indexer);
+    for(int i=0;i<parts_count;i++) fs_purger_resume(&purger, parts[i].path);
+
+    int current_part = 0;
+    int current_folder = 0;
+
+    Breadcrumb breadcrumb;
+    memset(&breadcrumb, 0, sizeof(breadcrumb));
+
+    if(parts_count > 0) {
+        breadcrumb_init(&breadcrumb, parts[current_part].path);
+        start_scan(current_part, breadcrumb_current(&breadcrumb));
+        schedule_scans(parts_count);
+    } else {
+        breadcrumb_init(&breadcrumb, "ux0:/");
+    }
+
+    int running = 1, move_delay = 0, calculating = 0;
+    int overlay_active = 0, overlay_sel = 0;
+    int delete_confirm_active = 0;
+    char delete_confirm_name[256] = "";
+
+    const char* overlay_labels[F__COUNT + FS_FILTER_MAX];
+    int overlay_count = F__COUNT + (int)user_filters.filter_count;
+    for(int i=0;i<overlay_count;i++) overlay_labels[i] = filter_to_label((Filter)i);
+
+    SceCtrlData pad, old_pad={0};
+    SceRtcTick last_switch_time;
+    sceRtcGetCurrentTick(&last_switch_time);
+
+    Filter cur_filter = F_ALL;
+    ui_set_filter_label(filter_to_label(cur_filter));
+
+    int scan_gen = -1;
+    FsScanProgress scan_progress;
+    memset(&scan_progress, 0, sizeof(scan_progress));
+
+    FsPurgeProgress purge_progress;
+    memset(&purge_progress, 0, sizeof(purge_progress));
+    int purging = 0;
+    FsDupeStats dupes_progress;
+    memset(&dupes_progress, 0, sizeof(dupes_progress));
+
+    DebugPanel panel = PANEL_NONE;
+    FsIoStats io_view;
+    int treemap_view = 0;
+    int hinted_row = -1;
+    uint32_t hinted_gen = 0;
+    const FsTreemap* treemap = NULL;
+
+    // The screen is only redrawn when something on it changed, and at least
+    // once every IDLE_REDRAW_US; in between the loop just waits for vblank.
+    int dirty = 1, last_battery = -1, last_calculating = 0;
+    uint64_t last_draw_us = 0;
+
+    while(running){
+        frame_prof_begin();
+
+        sceCtrlPeekBufferPositive(0,&pad,1);
+        unsigned int pressed = pad.buttons & ~old_pad.buttons;
+        if(pad.buttons != old_pad.buttons || pad.ly < 128-STICK_THRESHOLD || pad.ly > 128+STICK_THRESHOLD) dirty = 1;
+
+        if (pressed & SCE_CTRL_SQUARE) overlay_active = !overlay_active;
+
+        // I/O calls are only timed while their panel is up
+        if (pressed & SCE_CTRL_START) {
+            panel = (DebugPanel)((panel + 1) % PANEL__COUNT);
+            fs_io_enable(panel == PANEL_IO);
+        }
+        if (panel == PANEL_IO && (pressed & SCE_CTRL_SELECT)) {
+            fs_io_snapshot(&io_view);
+            fs_io_write_log(IO_LOG_PATH, "since last reset", &io_view);
+            fs_io_reset();
+        }
+        if (panel == PANEL_FRAMES && (pressed & SCE_CTRL_SELECT)) frame_prof_write_trace(FRAME_TRACE_PATH);
+        if (panel == PANEL_NONE && (pressed & SCE_CTRL_SELECT)) {
+            if (overlay_active) start_export(current_part);
+            else treemap_view = !treemap_view;
+        }
+
+        if(overlay_active){
+            if(pressed & SCE_CTRL_UP)   overlay_sel = (overlay_sel - 1 + overlay_count) % overlay_count;
+            if(pressed & SCE_CTRL_DOWN) overlay_sel = (overlay_sel + 1) % overlay_count;
+
+            if(pressed & SCE_CTRL_CROSS){
+                cur_filter = (Filter)overlay_sel;
+                ui_set_filter_label(filter_to_label(cur_filter));
+                calculating = 1;
+                sceRtcGetCurrentTick(&last_switch_time);
+                overlay_active = 0;
+                current_folder = 0;
+                scan_gen = -1;
+                search_on_results = 0;
+                if(!tree_ready(current_part)) fs_listing_clear(&listing);
+            }
+
+            if(pressed & SCE_CTRL_CIRCLE){
+                overlay_active = 0;
+            }
+        } else if(delete_confirm_active) {
+            if(pressed & SCE_CTRL_CROSS) {
+                frame_prof_mark(FRAME_INPUT);
+                FsTree* tree = &part_trees[current_part];
+                fs_treemapper_release(&treemapper, tree);
+                fs_prefetcher_release(&prefetch, tree);
+                fs_exporter_release(&exporter, tree);
+                fs_purger_release(&purger, tree);
+                fs_name_indexer_release(&indexer, tree);
+                dupes_stale = 1;
+                largest_part = -1;
+                int left = delete_entries(current_part, breadcrumb_current(&breadcrumb), &listing, delete_confirm_name);
+                if(left >= 0) {
+                    char cpath[MAX_PATH_LEN];
+                    cache_path(current_part, cpath, sizeof(cpath));
+                    fs_purger_save(&purger, tree, cpath);
+                    list_folder(current_part, breadcrumb_current(&breadcrumb), cur_filter, &listing);
+                    if(left > 0) {
+                        char line[64];
+                        snprintf(line, sizeof(line), "%d entries were not deleted: the queue is full", left);
+                        show_notice(line);
+                    }
+                } else {
+                    fs_listing_clear(&listing);
+                    fs_tree_free(tree);
+                    scan_current(current_part, parts_count, breadcrumb_current(&breadcrumb));
+                    calculating = 1;
+                    sceRtcGetCurrentTick(&last_switch_time);
+                }
+                frame_prof_mark(FRAME_SCAN);
+                delete_confirm_active = 0;
+            } else if(pressed & SCE_CTRL_CIRCLE) {
+                delete_confirm_active = 0;
+            }
+        } else {
+            if(move_delay>0) move_delay--;
+
+            const char* current_path = breadcrumb_current(&breadcrumb);
+
+            int nav_changed = 0;
+
+            if(move_delay==0){
+                if(pad.ly<128-STICK_THRESHOLD){
+                    leave_partition(current_part, &breadcrumb, current_folder);
+                    current_part=(current_part-1+parts_count)%parts_count;
+                    move_delay=MOVE_DELAY;
+                    calculating=1;
+                    sceRtcGetCurrentTick(&last_switch_time);
+                    enter_partition(current_part, &breadcrumb, &current_folder);
+                    nav_changed=1;
+                }
+                if(pad.ly>128+STICK_THRESHOLD){
+                    leave_partition(current_part, &breadcrumb, current_folder);
+                    current_part=(current_part+1)%parts_count;
+                    move_delay=MOVE_DELAY;
+                    calculating=1;
+                    sceRtcGetCurrentTick(&last_switch_time);
+                    enter_partition(current_part, &breadcrumb, &current_folder);
+                    nav_changed=1;
+                }
+            }
+
+            int typing = cur_filter == F_SEARCH && !search_on_results;
+            if(pressed & SCE_CTRL_UP && !typing){ if(current_folder>0) current_folder--; }
+            if(pressed & SCE_CTRL_DOWN && !typing){ if(current_folder<(int)listing.count-1) current_folder++; }
+
+            // Duplicates: X opens a group, then the folder of one of its
+            // copies with the cursor on it; O goes back to the groups.
+            // Largest files: X opens the folder of the file.
+            // Changes: X opens the changed folder's parent with the cursor on it.
+            // Search: the D-pad and X type on the keyboard, O erases, L
+            // moves between it and the results; X on a result opens its folder.
+            const char* jump_path = NULL;
+            char change_buf[MAX_PATH_LEN];
+            const char* jump_name = NULL;
+            int jump_part = current_part;
+            if(cur_filter == F_DUPES) {
+                if(pressed & SCE_CTRL_CROSS && current_folder < (int)listing.count && dupes_group < 0) {
+                    dupes_group = current_folder;
+                    list_folder(current_part, current_path, cur_filter, &listing);
+                    current_folder = 0;
+                } else if(pressed & SCE_CTRL_CROSS && current_folder < (int)listing.count) {
+                    const FsDupes* d = &dupes.result;
+                    uint32_t file = d->groups[dupes_group].first + (uint32_t)current_folder;
+                    jump_path = fs_dupes_path(d, file);
+                    jump_part = d->files[file].part;
+                }
+                if(pressed & SCE_CTRL_CIRCLE && dupes_group >= 0) {
+                    current_folder = dupes_group;
+                    dupes_group = -1;
+                    list_folder(current_part, current_path, cur_filter, &listing);
+                }
+            } else if(cur_filter == F_LARGEST) {
+                if(pressed & SCE_CTRL_CROSS && current_folder < (int)largest.count && largest_part == current_part)
+                    jump_path = fs_largest_path(&largest, (uint32_t)current_folder);
+            } else if(cur_filter == F_CHANGES) {
+                const char* rel = change_path(current_folder);
+                if(pressed & SCE_CTRL_CROSS && rel) {
+                    fs_build_path(parts[current_part].path, rel, change_buf, sizeof(change_buf));
+                    jump_path = change_buf;
+                }
+            } else if(cur_filter == F_SEARCH) {
+                if(pressed & SCE_CTRL_LTRIGGER) search_on_results = !search_on_results;
+                else if(search_on_results && pressed & SCE_CTRL_CROSS)
+                    jump_path = search_hit_path(current_part, current_folder, change_buf, sizeof(change_buf));
+                else if(!search_on_results) {
+                    int col = search_key % UI_SEARCH_COLS, row = search_key / UI_SEARCH_COLS;
+                    if(pressed & SCE_CTRL_LEFT)  col = (col + UI_SEARCH_COLS - 1) % UI_SEARCH_COLS;
+                    if(pressed & SCE_CTRL_RIGHT) col = (col + 1) % UI_SEARCH_COLS;
+                    if(pressed & SCE_CTRL_UP)    row = (row + UI_SEARCH_ROWS - 1) % UI_SEARCH_ROWS;
+                    if(pressed & SCE_CTRL_DOWN)  row = (row + 1) % UI_SEARCH_ROWS;
+                    search_key = row * UI_SEARCH_COLS + col;
+
+                    // Every key asks the index again; there is no wait to type out
+                    size_t len = strlen(search_query);
+                    int edited = 0;
+                    if(pressed & SCE_CTRL_CROSS && len + 1 < sizeof(search_query)) {
+                        search_query[len] = ui_search_key(search_key);
+                        search_query[len + 1] = '\0';
+                        edited = 1;
+                    } else if(pressed & SCE_CTRL_CIRCLE && len > 0) {
+                        search_query[len - 1] = '\0';
+                        edited = 1;
+                    }
+                    if(edited) {
+                        frame_prof_mark(FRAME_INPUT);
+                        list_folder(current_part, current_path, cur_filter, &listing);
+                        current_folder = 0;
+                        frame_prof_mark(FRAME_SCAN);
+                    }
+                }
+            } else {
+                // All: the D-pad switches between size, file count, name and
+                // age order, keeping the cursor on the same entry
+                if(cur_filter == F_ALL && pressed & (SCE_CTRL_LEFT | SCE_CTRL_RIGHT)) {
+                    sort_key = (sort_key + ((pressed & SCE_CTRL_RIGHT) ? 1 : FS_SORT__COUNT - 1)) % FS_SORT__COUNT;
+                    uint32_t at = fs_listing_node(&listing, (uint32_t)current_folder);
+                    fs_listing_sort_by(&listing, sort_key);
+                    for(uint32_t i=0; at != FS_TREE_NONE && i<listing.count; i++)
+                        if(fs_listing_node(&listing, i) == at) { current_folder = (int)i; break; }
+                }
+
+                if(pressed & SCE_CTRL_CROSS && current_folder < (int)listing.count) {
+                    char new_path[MAX_PATH_LEN];
+                    fs_build_path(current_path, fs_listing_name(&listing, current_folder), new_path, sizeof(new_path));
+
+                    breadcrumb.cursor[breadcrumb.depth - 1] = current_folder;
+                    if (fs_listing_is_dir(&listing, current_folder) && breadcrumb_push(&breadcrumb, new_path) == 0) {
+                        calculating = 1;
+                        sceRtcGetCurrentTick(&last_switch_time);
+                        current_folder = 0;
+                        nav_changed = 1;
+                    }
+                }
+
+                if(pressed & SCE_CTRL_CIRCLE) {
+                    if (breadcrumb.depth > 1) {
+                        breadcrumb_pop(&breadcrumb);
+                        calculating = 1;
+                        sceRtcGetCurrentTick(&last_switch_time);
+                        current_folder = breadcrumb.cursor[breadcrumb.depth - 1];
+                        nav_changed = 1;
+                    }
+                }
+            }
+
+            if(jump_path) {
+                if(jump_part != current_part) leave_partition(current_part, &breadcrumb, current_folder);
+                current_part = jump_part;
+                breadcrumb_open_parent(&breadcrumb, parts[current_part].path, jump_path);
+                jump_name = strrchr(jump_path, '/') ? strrchr(jump_path, '/') + 1 : jump_path;
+                cur_filter = F_ALL;
+                ui_set_filter_label(filter_to_label(cur_filter));
+                dupes_group = -1;
+                current_folder = 0;
+                nav_changed = 1;
+            }
+
+            // Already-walked partitions answer navigation from memory right away;
+            // a running walk of this partition just streams the new folder instead
+            if(nav_changed){
+                frame_prof_mark(FRAME_INPUT);
+                if(tree_ready(current_part) || index_ready(current_part)){
+                    list_folder(current_part, breadcrumb_current(&breadcrumb), cur_filter, &listing);
+                    calculating = 0;
+                } else {
+                    fs_listing_clear(&listing);
+                    scan_gen = -1;
+                    if(scan_running(current_part)) {
+                        fs_scanner_set_focus(&scanners[current_part], breadcrumb_current(&breadcrumb));
+                        calculating = 0;
+                    }
+                }
+                for(uint32_t i=0; jump_name && i<listing.count; i++)
+                    if(!strcmp(fs_listing_name(&listing, i), jump_name)) { current_folder = (int)i; break; }
+                if(current_folder >= (int)listing.count) current_folder = listing.count > 0 ? (int)listing.count-1 : 0;
+                frame_prof_mark(FRAME_SCAN);
+            }
+
+            if(pressed & SCE_CTRL_TRIANGLE) running = 0;
+
+            // The trash folder is the purger's: deleting it would race the worker emptying it
+            int can_delete = current_folder < (int)listing.count && tree_ready(current_part) && filter_lists_entries(cur_filter) &&
+                             !(breadcrumb.depth == 1 && fs_is_trash(fs_listing_name(&listing, current_folder)));
+            if(pressed & SCE_CTRL_LTRIGGER && can_delete) selection_toggle(&listing, current_folder);
+
+            if(pressed & SCE_CTRL_RTRIGGER && can_delete && !delete_confirm_active) {
+                selection_sync(&listing);
+                delete_confirm_active = 1;
+                if(selected_count > 0) {
+                    // The dialog names the marked rows by count and their tree size
+                    FsTree* tree = &part_trees[current_part];
+                    uint64_t bytes = 0;
+                    char path[MAX_PATH_LEN], size_buf[32];
+                    for(uint32_t i=0;i<listing.count && i<selected_cap;i++) {
+                        if(!selected[i]) continue;
+                        fs_build_path(breadcrumb_current(&breadcrumb), fs_listing_name(&listing, i), path, sizeof(path));
+                        uint32_t node = fs_tree_lookup(tree, path);
+                        if(node != FS_TREE_NONE) bytes += tree->nodes[node].size_bytes;
+                    }
+                    ui_text_format_bytes(bytes, size_buf, sizeof(size_buf));
+                    snprintf(delete_confirm_name, sizeof(delete_confirm_name), "%d selected item%s, %s",
+                             selected_count, selected_count == 1 ? "" : "s", size_buf);
+                } else {
+                    const char* entry_name = fs_listing_name(&listing, current_folder);
+                    strncpy(delete_confirm_name, entry_name, sizeof(delete_confirm_name) - 1);
+                    delete_confirm_name[sizeof(delete_confirm_name) - 1] = '\0';
+                }
+            }
+
+        }
+
+        int battery = scePowerGetBatteryLifePercent();
+        if(battery<0) battery=0; if(battery>100) battery=100;
+        if(battery != last_battery) { last_battery = battery; dirty = 1; }
+        frame_prof_mark(FRAME_INPUT);
+
+        SceRtcTick now;
+        sceRtcGetCurrentTick(&now);
+        uint64_t ms_diff = (now.tick - last_switch_time.tick)/1000ULL;
+        if(calculating && ms_diff>=CALCULATING_DELAY_MS && parts_count > 0){
+            const char* current_path = breadcrumb_current(&breadcrumb);
+            if(tree_ready(current_part)){
+                list_folder(current_part, current_path, cur_filter, &listing);
+            } else if(!scan_running(current_part)){
+                scan_current(current_part, parts_count, current_path);
+                scan_gen = -1;
+            }
+            calculating=0;
+        }
+
+        int scanning = 0;
+        int seen_gen = scan_gen;
+        uint64_t seen_files = scan_progress.files;
+        for(int p=0;p<parts_count;p++){
+            if(!scan_running(p)) continue;
+            int show = (p == current_part && cur_filter == F_ALL);
+            FsScanState st = fs_scanner_poll(&scanners[p], show ? &listing : NULL, &scan_gen,
+                                             p == current_part ? &scan_progress : NULL);
+            if(st == FS_SCAN_RUNNING) {
+                scanning |= (p == current_part);
+            } else if(st == FS_SCAN_DONE || st == FS_SCAN_FAILED) {
+                if(p == current_part) fs_listing_clear(&listing);
+                dupes_stale = 1;
+                if(p == largest_part) largest_part = -1;
+                dirty = 1;
+                fs_treemapper_release(&treemapper, &part_trees[p]);
+                fs_prefetcher_release(&prefetch, &part_trees[p]);
+                fs_exporter_release(&exporter, &part_trees[p]);
+                fs_purger_release(&purger, &part_trees[p]);
+                fs_name_indexer_release(&indexer, &part_trees[p]);
+                int ok = fs_scanner_take(&scanners[p], &part_trees[p]) == 0;
+                fs_scanner_take_names(&scanners[p], &part_names[p]);
+                drop_index(p);
+                if(ok && scanners[p].indexed) {
+                    char ipath[MAX_PATH_LEN];
+                    path_index_path(p, ipath, sizeof(ipath));
+                    part_indexed[p] = fs_path_index_open(&part_index[p], ipath) == 0;
+                }
+                if(ok && tree_ready(p)) keep_snapshot(p);
+                log_scan_io(p, &scanners[p]);
+                if(p == current_part){
+                    const char* current_path = breadcrumb_current(&breadcrumb);
+                    if(ok) list_folder(current_part, current_path, cur_filter, &listing);
+                    else if(fs_scan_directory(current_path, &listing) < 0) fs_listing_clear(&listing);
+                }
+                schedule_scans(parts_count);
+            }
+            if(current_folder >= (int)listing.count) current_folder = listing.count > 0 ? (int)listing.count-1 : 0;
+        }
+
+        if(poll_export()) dirty = 1;
+        if(poll_index()) {
+            dirty = 1;
+            if(cur_filter == F_SEARCH && index_part < 0 && part_names[current_part].gen == part_trees[current_part].gen)
+                list_folder(current_part, breadcrumb_current(&breadcrumb), cur_filter, &listing);
+        }
+        if(poll_largest()) {
+            dirty = 1;
+            if(cur_filter == F_LARGEST && largest_walk_part < 0 && largest_part == current_part)
+                list_folder(current_part, breadcrumb_current(&breadcrumb), cur_filter, &listing);
+        }
+
+        // Free space is read again once the trash is empty
+        uint64_t seen_purged = purge_progress.entries;
+        int was_purging = purging;
+        purging = fs_purger_poll(&purger, &purge_progress);
+        if(purging != was_purging || purge_progress.entries != seen_purged) dirty = 1;
+        if(was_purging && !purging) {
+            fs_detect_partitions(parts, &parts_count);
+            if(purge_progress.errors != purge_errors_seen) {
+                char line[64];
+                snprintf(line, sizeof(line), "%u entries could not be deleted", purge_progress.errors - purge_errors_seen);
+                show_notice(line);
+                purge_errors_seen = purge_progress.errors;
+                // Leftovers of in-place deletes are missing from the tree and its
+                // cache alike, so those partitions are walked again from scratch
+                for(int p=0;p<parts_count;p++) {
+                    if(!(purge_in_place & (1u << p)) || scan_running(p)) continue;
+                    fs_treemapper_release(&treemapper, &part_trees[p]);
+                    fs_prefetcher_release(&prefetch, &part_trees[p]);
+                    fs_exporter_release(&exporter, &part_trees[p]);
+                    fs_purger_release(&purger, &part_trees[p]);
+                    fs_name_indexer_release(&indexer, &part_trees[p]);
+                    char cpath[MAX_PATH_LEN];
+                    cache_path(p, cpath, sizeof(cpath));
+                    sceIoRemove(cpath);
+                    fs_tree_free(&part_trees[p]);
+                    scan_tried[p] = 0;
+                    dupes_stale = 1;
+                    if(p == largest_part) largest_part = -1;
+                    if(p == current_part) {
+                        fs_listing_clear(&listing);
+                        scan_current(p, parts_count, breadcrumb_current(&breadcrumb));
+                        calculating = 1;
+                        sceRtcGetCurrentTick(&last_switch_time);
+                    }
+                }
+                schedule_scans(parts_count);
+            }
+            purge_in_place = 0;
+        }
+
+        // The Duplicates view hunts again once every partition is walked
+        if(cur_filter == F_DUPES && dupes_stale && all_trees_ready(parts_count) &&
+           fs_dupe_finder_start(&dupes, part_trees, parts_count, FS_DUPES_MIN_SIZE) == 0) {
+            dupes_stale = 0;
+            dupes_state = FS_DUPES_RUNNING;
+            dupes_group = -1;
+            current_folder = 0;
+            fs_listing_clear(&listing);
+        }
+        uint64_t seen_dupes = dupes_progress.partial_files + dupes_progress.bytes_read;
+        FsDupeState was_dupes = dupes_state;
+        dupes_state = fs_dupe_finder_poll(&dupes, &dupes_progress);
+        if(dupes_state != was_dupes || dupes_progress.partial_files + dupes_progress.bytes_read != seen_dupes) dirty = 1;
+        if(dupes_state == FS_DUPES_DONE && was_dupes == FS_DUPES_RUNNING && cur_filter == F_DUPES)
+            list_folder(current_part, breadcrumb_current(&breadcrumb), cur_filter, &listing);
+
+        // Filtered folders are sized ahead around the cursor
+        if(cur_filter > F_ALL && cur_filter < F_TYPES && (current_folder != hinted_row || listing.gen != hinted_gen)) {
+            prefetch_rows(current_part, breadcrumb_current(&breadcrumb), &listing, current_folder);
+            hinted_row = current_folder;
+            hinted_gen = listing.gen;
+        }
+
+        // The treemap shows up as soon as its layout is done
+        const FsTreemap* seen_treemap = treemap;
+        int show_treemap = treemap_view && cur_filter == F_ALL && tree_ready(current_part);
+        treemap = NULL;
+        if(show_treemap) {
+            FsTree* tree = &part_trees[current_part];
+            treemap = fs_treemapper_get(&treemapper, tree, fs_tree_lookup(tree, breadcrumb_current(&breadcrumb)),
+                                        UI_TREEMAP_W, UI_TREEMAP_H);
+        }
+        if(treemap != seen_treemap) dirty = 1;
+
+        if(scan_gen != seen_gen || scan_progress.files != seen_files) dirty = 1;
+        if(calculating != last_calculating) { last_calculating = calculating; dirty = 1; }
+        if(panel != PANEL_NONE || ui_animating()) dirty = 1;
+        frame_prof_mark(FRAME_SCAN);
+
+        // Only draw UI if not exiting, and only when something changed
+        uint64_t now_us = sceKernelGetProcessTimeWide();
+        if (running && (dirty || now_us - last_draw_us >= IDLE_REDRAW_US)) {
+            dirty = 0;
+            last_draw_us = now_us;
+            if (panel == PANEL_IO) fs_io_snapshot(&io_view);
+            char detail[200];
+            snprintf(detail, sizeof(detail), "%s%s%s%s", cur_filter == F_ALL ? "Sort: " : "",
+                     cur_filter == F_ALL ? fs_sort_name(sort_key) : "",
+                     cur_filter == F_ALL && detail_shown ? "  |  " : "", detail_shown ? folder_detail : "");
+            ui_set_detail(detail);
+            ui_set_search(cur_filter == F_SEARCH ? search_query : NULL, search_key, search_on_results);
+            frame.parts = parts;
+            frame.parts_count = parts_count;
+            frame.current_part_index = current_part;
+            frame.folders = &listing;
+            frame.current_folder_index = current_folder;
+            frame.selected = selected_count > 0 ? selected : NULL;
+            frame.battery_percent = battery;
+            frame.calc_alpha = calculating ? 1.0f : 0.0f;
+            frame.scan = scanning ? &scan_progress : NULL;
+            frame.purge = purging ? &purge_progress : NULL;
+            frame.dupes = dupes_state == FS_DUPES_RUNNING ? &dupes_progress : NULL;
+            frame.treemap_view = show_treemap;
+            frame.treemap = treemap;
+            frame.overlay_active = overlay_active;
+            frame.overlay_sel = overlay_sel;
+            frame.overlay_labels = overlay_labels;
+            frame.overlay_count = overlay_count;
+            frame.delete_confirm_active = delete_confirm_active;
+            frame.delete_confirm_name = delete_confirm_name;
+            frame.io_panel = panel == PANEL_IO ? &io_view : NULL;
+            frame.frame_panel = panel == PANEL_FRAMES;
+            frame.startup_active = 0;
+            ui_draw(&frame);
+        } else if (running) {
+            sceDisplayWaitVblankStart();
+            frame_prof_skip();
+        }
+
+        old_pad = pad;
+    }
+
+    for(int i=0;i<MAX_PARTITIONS;i++) fs_scanner_deinit(&scanners[i]);
+    for(int i=0;i<MAX_PARTITIONS;i++) drop_index(i);
+    fs_purger_deinit(&purger);
+    fs_dupe_finder_deinit(&dupes);
+    fs_treemapper_deinit(&treemapper);
+    fs_prefetcher_deinit(&prefetch);
+    fs_exporter_deinit(&exporter);
+    fs_largest_walker_deinit(&largest_walker);
+    fs_name_indexer_deinit(&indexer);
+    fs_filter_stats_free(&user_stats);
+    fs_filter_free(&user_filters);
+    fs_largest_free(&largest);
+    free(selected);
+    fs_listing_free(&listing);
+
+    // Small delay to allow GPU to finish processing
+    sceKernelDelayThread(100000); 
+    ui_deinit();
+    sceKernelExitProcess(0);
+    return 0;
+}
@@ -1,328 +1,602 @@
-#include "ui.h"
-#include "fs_analyzer.h"
-#include <vita2d.h>
-#include <psp2/power.h>
-#include <psp2/kernel/threadmgr.h>
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <ctype.h>
-#include <math.h>
-
-static vita2d_pgf* g_font = NULL;
-static char g_filter_label[64] = "All";
-
-// Scroll & display state
-static int g_scroll_offset = 0;
-static int g_max_visible = 10;
-
-// Overlay animation state
-static float overlay_offset_x = 960.0f; 
-static int overlay_target = 0;           
-static const float overlay_speed = 15.0f;
-
-// FPS real
-static uint64_t g_last_time = 0;
-static float g_fps_real = 0.0f;
-static const float FPS_SMOOTH_FACTOR = 0.1f;
-
-static inline uint32_t COL(uint8_t r, uint8_t g, uint8_t b, uint8_t a) { return RGBA8(r, g, b, a); }
-
-// Color helpers for different filter types
-static uint32_t color_for_filter_label(void) {
-    if (strcasecmp(g_filter_label, "Games") == 0)    return COL(230, 90, 90, 255);
-    if (strcasecmp(g_filter_label, "MP3") == 0)      return COL(90, 220, 120, 255);
-    if (strcasecmp(g_filter_label, "OGG") == 0)      return COL(120, 220, 255, 255);
-    if (strcasecmp(g_filter_label, "Photo") == 0)    return COL(255, 170, 90, 255);
-    if (strcasecmp(g_filter_label, "Video") == 0)    return COL(200, 120, 255, 255);
-    if (strcasecmp(g_filter_label, "Docs") == 0)     return COL(255, 220, 120, 255);
-    if (strcasecmp(g_filter_label, "Archives") == 0) return COL(180, 130, 255, 255);
-    if (strcasecmp(g_filter_label, "Homebrew") == 0) return COL(255, 100, 180, 255);
-    if (strcasecmp(g_filter_label, "SaveData") == 0) return COL(100, 180, 255, 255);
-    return COL(90, 190, 90, 255);
-}
-
-static uint32_t color_for_usage(float fill01) {
-    if (fill01 < 0.5f) return COL(90, 220, 90, 255);
-    if (fill01 < 0.8f) return COL(220, 220, 90, 255);
-    return COL(220, 90, 90, 255);
-}
-
-static void ui_format_bytes(uint64_t bytes, char* out, int outsz) {
-    const char* units[] = {"B","KB","MB","GB","TB"};
-    int unit = 0;
-    double b = (double)bytes;
-    while(b >= 1024.0 && unit < 4){ b /= 1024.0; unit++; }
-    snprintf(out, outsz, "%.2f %s", b, units[unit]);
-}
-
-void ui_set_filter_label(const char* label) {
-    if (!label || !*label) { snprintf(g_filter_label, sizeof(g_filter_label), "All"); return; }
-    snprintf(g_filter_label, sizeof(g_filter_label), "%s", label);
-}
-
-void ui_init() {
-    vita2d_init();
-    g_font = vita2d_load_default_pgf();
-    g_last_time = sceKernelGetSystemTimeWide();
-}
-
-void ui_deinit() {
-    if (g_font)     { vita2d_free_pgf(g_font);         g_font = NULL;     }
-    vita2d_fini();
-}
-
-static void draw_bar(float x, float y, float w, float h, float fill01, uint32_t fill_color) {
-    if (fill01 < 0) fill01 = 0;
-    if (fill01 > 1) fill01 = 1;
-
-    vita2d_draw_rectangle(x + 1, y + 1, w, h, COL(20, 20, 20, 120));
-    vita2d_draw_rectangle(x, y, w, h, COL(60, 60, 60, 200));
-    vita2d_draw_rectangle(x + 1, y + 1, w - 2, h - 2, COL(40, 40, 40, 255));
-
-    if (fill01 > 0) {
-        for(int i = 0; i < w * fill01; i++) {
-            float alpha = (float)i / (float)(w * fill01);
-            uint32_t grad_color = COL(
-                (uint8_t)((fill_color >> 16 & 0xFF) * (0.7f + alpha * 0.3f)),
-                (uint8_t)((fill_color >> 8 & 0xFF) * (0.7f + alpha * 0.3f)),
-                (uint8_t)((fill_color & 0xFF) * (0.7f + alpha * 0.3f)),
-                255
-            );
-            vita2d_draw_rectangle(x + 1 + i, y + 1, 1, h - 2, grad_color);
-        }
-    }
-}
-
-void ui_update_fps() {
-    uint64_t now = sceKernelGetSystemTimeWide();
-    if (g_last_time != 0) {
-        float dt = (now - g_last_time) / 1000000.0f;
-        if (dt > 0.0f) {
-            float fps_current = 1.0f / dt;
-            g_fps_real = g_fps_real * (1.0f - FPS_SMOOTH_FACTOR) + fps_current * FPS_SMOOTH_FACTOR;
-        }
-    }
-    g_last_time = now;
-}
-
-
-// ---- Draw full UI ----
-void ui_draw(const PartitionInfo* parts, int parts_count, int current_part_index,
-             const FolderUsage* folders, int folders_count,
-             int battery_percent, int fps_unused, float calc_alpha, int current_folder_index,
-             int overlay_active, int overlay_sel,
-             const char* overlay_labels[], int overlay_count,
-             int delete_confirm_active, const char* delete_confirm_name,
-             int startup_active) {
-
-    ui_update_fps();
-
-    overlay_target = overlay_active ? 1 : 0;
-    const float target_x = 960 - 220 - 20;
-    if(overlay_target){
-        if(overlay_offset_x > target_x) overlay_offset_x -= overlay_speed;
-        if(overlay_offset_x < target_x) overlay_offset_x = target_x;
-    } else {
-        if(overlay_offset_x < 960) overlay_offset_x += overlay_speed;
-        if(overlay_offset_x > 960) overlay_offset_x = 960;
-    }
-
-    vita2d_start_drawing();
-    vita2d_clear_screen();
-
-    // Completely solid black background - no gradients or effects
-    vita2d_draw_rectangle(0, 0, 960, 544, COL(0, 0, 0, 255));
-
-    // Draw header with nice color for "Free Space Analyzer" title
-    vita2d_draw_rectangle(0, 0, 960, 50, COL(40, 60, 100, 255));
-    // Add subtle border around header
-    vita2d_draw_rectangle(0, 0, 960, 1, COL(80, 120, 180, 255));
-    vita2d_draw_rectangle(0, 49, 960, 1, COL(80, 120, 180, 255));
-
-    // Section separators - black to blend with background
-    vita2d_draw_rectangle(0, 55, 960, 2, COL(0, 0, 0, 255));
-    vita2d_draw_rectangle(0, 195, 960, 2, COL(0, 0, 0, 255));
-    vita2d_draw_rectangle(0, 235, 960, 2, COL(0, 0, 0, 255));
-    vita2d_draw_rectangle(0, 255, 960, 2, COL(0, 0, 0, 255));
-
-    if(startup_active) {
-        vita2d_draw_rectangle(0, 0, 960, 544, COL(0, 0, 0, 255));
-        vita2d_pgf_draw_text(g_font, 480 - vita2d_pgf_text_width(g_font, 1.5f, "Checking space of various partitions...")/2.0f,
-                           272 - 20, COL(255,255,255,255), 1.5f, "Checking space of various partitions...");
-        vita2d_end_drawing();
-        vita2d_swap_buffers();
-        return;
-    }
-
-    char hdr[128];
-    snprintf(hdr, sizeof(hdr), "Free Space Analyzer | Battery: %d%% | FPS: %.1f", battery_percent, g_fps_real);
-    vita2d_pgf_draw_text(g_font, 24, 36, COL(255,255,255,255), 1.0f, hdr);
-
-    if(calc_alpha>0.0f){
-        uint8_t alpha = (uint8_t)(255.0f * calc_alpha);
-        float msg_width = vita2d_pgf_text_width(g_font, 1.4f, "Updating... Please wait");
-        float msg_x = 480 - msg_width/2.0f;
-        float msg_y = 85;
-
-        vita2d_draw_rectangle(msg_x - 20, msg_y - 25, msg_width + 40, 35, COL(20, 40, 60, (uint8_t)(alpha * 0.8f)));
-        vita2d_draw_rectangle(msg_x - 18, msg_y - 23, msg_width + 36, 31, COL(40, 80, 120, (uint8_t)(alpha * 0.6f)));
-        vita2d_draw_rectangle(msg_x - 22, msg_y - 27, msg_width + 44, 39, COL(60, 120, 180, (uint8_t)(alpha * 0.3f)));
-
-        vita2d_pgf_draw_text(g_font, msg_x, msg_y, COL(150,255,150,alpha), 1.4f, "Updating... Please wait");
-    }
-
-    // Move partitions lower and make them look nicer
-    float px = 24, py = 120; 
-    for(int i=0;i<parts_count;i++){
-        const PartitionInfo* p = &parts[i];
-        char tbuf[64], fbuf[64], line[256];
-        ui_format_bytes(p->total_bytes, tbuf, sizeof(tbuf));
-        ui_format_bytes(p->free_bytes, fbuf, sizeof(fbuf));
-        snprintf(line,sizeof(line),"%s:/  %s free / %s total", p->label,fbuf,tbuf);
-        uint32_t color = (i==current_part_index)?COL(120,255,120,255):COL(200,220,240,255);
-
-        // Add even longer background highlight for current partition
-        if(i==current_part_index) {
-            vita2d_draw_rectangle(px - 24, py + i*32 - 24, 700, 28,
-                COL(60, 100, 140, 150));
-            vita2d_draw_rectangle(px - 26, py + i*32 - 26, 704, 32,
-                COL(100, 150, 200, 200));
-        }
-
-        if(i==current_part_index) vita2d_pgf_draw_text(g_font, px-20, py+i*32, COL(255,255,100,255),1.2f,">");
-        vita2d_pgf_draw_text(g_font, px, py+i*32, color,1.1f,line);
-    }
-
-    if(parts_count>0 && current_part_index>=0 && current_part_index<parts_count){
-        const PartitionInfo* p = &parts[current_part_index];
-        char info_buf[128], tbuf[64], fbuf[64];
-        ui_format_bytes(p->total_bytes, tbuf,sizeof(tbuf));
-        ui_format_bytes(p->free_bytes, fbuf,sizeof(fbuf));
-        snprintf(info_buf,sizeof(info_buf),
-                 "Partition: %s  |  Free: %s / %s  |  Items: %d",
-                 p->label, fbuf, tbuf, folders_count);
-        vita2d_pgf_draw_text(g_font,24,180,COL(255,255,200,255),1.0f,info_buf);
-
-        float usage = (float)(p->total_bytes - p->free_bytes) / (float)p->total_bytes;
-        int usage_label_x=24, usage_label_y=200;
-        vita2d_pgf_draw_text(g_font, usage_label_x, usage_label_y, COL(255,255,255,255),1.0f,"Usage:");
-        int usage_label_width=vita2d_pgf_text_width(g_font,1.0f,"Usage:")+8;
-        draw_bar(usage_label_x+usage_label_width, usage_label_y-12,900,12,usage,color_for_usage(usage));
-    }
-
-    float fx=24, fy=270;
-    int row_height=28;
-    const int bar_width = 900;
-
-    if(folders_count <= g_max_visible) g_scroll_offset=0;
-    else {
-        if(current_folder_index<g_scroll_offset) g_scroll_offset=current_folder_index;
-        if(current_folder_index>=g_scroll_offset+g_max_visible) g_scroll_offset=current_folder_index-g_max_visible+1;
-    }
-    int start=g_scroll_offset;
-    int end=(folders_count<g_scroll_offset+g_max_visible)?folders_count:g_scroll_offset+g_max_visible;
-
-    for(int i=start;i<end;i++){
-        char name_buf[128], size_buf[64];
-        int is_dir = (strchr(folders[i].name, '/') != NULL);
-
-        snprintf(name_buf,sizeof(name_buf),"%2d. %s",i+1,folders[i].name);
-        int name_pixel_width = vita2d_pgf_text_width(g_font, 1.0f, name_buf);
-
-        ui_format_bytes(folders[i].size_bytes, size_buf, sizeof(size_buf));
-
-        int text_x = fx, text_y = fy + (i - start) * row_height;
-        int visible_index = i - start;
-
-        if(i == current_folder_index) {
-            vita2d_draw_rectangle(text_x - 8, text_y - 24,
-                950, row_height + 8,
-                COL(80, 80, 120, 120));
-            vita2d_draw_rectangle(text_x - 10, text_y - 26,
-                970, row_height + 12,
-                COL(120, 140, 180, 180));
-        }
-
-        uint32_t name_color = is_dir ? COL(120, 200, 255, 255) : COL(255, 255, 255, 255);
-        vita2d_pgf_draw_text(g_font, text_x, text_y, name_color, 1.0f, name_buf);
-
-        int size_x = 800;
-        int size_text_width = vita2d_pgf_text_width(g_font, 1.0f, size_buf);
-        vita2d_pgf_draw_text(g_font, size_x - size_text_width, text_y, COL(180, 255, 180, 255), 1.0f, size_buf);
-
-        float bar_x = size_x + 20;
-        float bar_fill = 0;
-        if(parts_count > 0 && current_part_index >= 0 && current_part_index < parts_count){
-            uint64_t part_total = parts[current_part_index].total_bytes;
-            if(part_total > 0) bar_fill = (float)folders[i].size_bytes / (float)part_total;
-        }
-        draw_bar(bar_x, text_y - 20, bar_width, 18, bar_fill, color_for_filter_label());
-    }
-
-    if(overlay_labels && overlay_count>0 && overlay_offset_x < 960){
-        float ox = overlay_offset_x;
-        float oy = 100;
-        vita2d_draw_rectangle(ox-10, oy-30, 220, overlay_count*26 + 40, COL(0,0,0,160));
-        vita2d_pgf_draw_text(g_font, ox, oy-20, COL(255,255,255,255), 1.0f, "Choose a filter");
-        for(int i=0;i<overlay_count;i++){
-            uint32_t col = (i==overlay_sel)?COL(255,255,0,255):COL(255,255,255,255);
-            if(strcasecmp(overlay_labels[i],g_filter_label)==0) col = COL(0,255,0,255);
-            vita2d_pgf_draw_text(g_font, ox, oy+i*26, col, 1.0f, overlay_labels[i]);
-        }
-    }
-
-    if(delete_confirm_active && delete_confirm_name) {
-        float dialog_x = 480 - 250, dialog_y = 272 - 50;
-        float dialog_w = 500, dialog_h = 100;
-        float dialog_center_x = dialog_x + dialog_w / 2.0f;
-        const int max_filename_width = 460;
-
-        for(int dy = 0; dy < dialog_h; dy++) {
-            float alpha = (float)dy / (float)dialog_h;
-            uint32_t bg_color = COL(
-                (uint8_t)(30 + alpha * 40),
-                (uint8_t)(30 + alpha * 40),
-                (uint8_t)(50 + alpha * 30),
-                250
-            );
-            vita2d_draw_rectangle(dialog_x, dialog_y + dy, dialog_w, 1, bg_color);
-        }
-
-        vita2d_draw_rectangle(dialog_x-3, dialog_y-3, dialog_w+6, dialog_h+6, COL(255,100,100,200));
-        vita2d_draw_rectangle(dialog_x-2, dialog_y-2, dialog_w+4, dialog_h+4, COL(255,150,150,255));
-        vita2d_draw_rectangle(dialog_x-1, dialog_y-1, dialog_w+2, dialog_h+2, COL(255,200,200,255));
-
-        float title_width = vita2d_pgf_text_width(g_font, 1.2f, "Delete this file/folder?");
-        vita2d_pgf_draw_text(g_font, dialog_center_x - title_width/2.0f, dialog_y + 20, COL(255,100,100,255), 1.2f, "Delete this file/folder?");
-
-        char display_filename[256];
-        float filename_width = vita2d_pgf_text_width(g_font, 1.0f, delete_confirm_name);
-        if(filename_width > max_filename_width) {
-            strcpy(display_filename, delete_confirm_name);
-            int len = strlen(display_filename);
-            while(len > 3 && vita2d_pgf_text_width(g_font, 1.0f, display_filename) > max_filename_width - 24) {
-                display_filename[--len] = '\0';
-            }
-            if(len > 3) {
-                strcpy(display_filename + len - 3, "...");
-            } else {
-                strcpy(display_filename, "...");
-            }
-        } else {
-            strcpy(display_filename, delete_confirm_name);
-        }
-
-        filename_width = vita2d_pgf_text_width(g_font, 1.0f, display_filename);
-        vita2d_pgf_draw_text(g_font, dialog_center_x - filename_width/2.0f, dialog_y + 45, COL(255,255,200,255), 1.0f, display_filename);
-
-        float buttons_width = vita2d_pgf_text_width(g_font, 1.0f, "X: Yes     O: Cancel");
-        vita2d_pgf_draw_text(g_font, dialog_center_x - buttons_width/2.0f, dialog_y + 75, COL(150,255,150,255), 1.0f, "X: Yes");
-        vita2d_pgf_draw_text(g_font, dialog_center_x - buttons_width/2.0f + vita2d_pgf_text_width(g_font, 1.0f, "X: Yes     "), dialog_y + 75, COL(255,150,150,255), 1.0f, "O: Cancel");
-    }
-
-
-
-    vita2d_end_drawing();
-    vita2d_swap_buffers();
-}
+#include "ui.h"
+#include "fs_analyzer.h"
+#include "frame_prof.h"
+#include "ui_batch.h"
+#include "ui_text.h"
+#include <vita2d.h>
+#include <psp2/kernel/threadmgr.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+
+static vita2d_pgf* g_font = NULL;
+static char g_filter_label[64] = "All";
+static char g_notice[96] = "";
+static char g_detail[160] = "";
+
+// Name search: the query and an on-screen keyboard take the place of the
+// partition lines. The last key types a space.
+static const char g_search_keys[UI_SEARCH_ROWS * UI_SEARCH_COLS + 1] =
+    "1234567890" "qwertyuiop" "asdfghjkl-" "zxcvbnm_. ";
+static int g_search_on = 0, g_search_key = 0, g_search_results = 0;
+static char g_search_query[64];
+
+// Scroll & display state
+static int g_scroll_offset = 0;
+static int g_max_visible = 10;
+
+// Partition and info lines, rebuilt only when their numbers change
+static UiTextLine g_part_lines[MAX_PARTITIONS];
+static UiTextLine g_info_line;
+
+// Overlay animation state
+static float overlay_offset_x = 960.0f; 
+static int overlay_target = 0;           
+static const float overlay_speed = 15.0f;
+#define OVERLAY_ROWS 16                  // filter menu rows on screen at once
+
+static inline uint32_t COL(uint8_t r, uint8_t g, uint8_t b, uint8_t a) { return RGBA8(r, g, b, a); }
+
+// `c` with its color channels scaled by k, alpha kept
+static uint32_t shade(uint32_t c, float k) {
+    return COL((uint8_t)((c & 0xFF) * k), (uint8_t)((c >> 8 & 0xFF) * k), (uint8_t)((c >> 16 & 0xFF) * k), c >> 24);
+}
+
+// Text goes straight to vita2d, so the rectangles queued under it go first
+static void draw_text(float x, float y, uint32_t color, float scale, const char* text) {
+    ui_batch_flush();
+    vita2d_pgf_draw_text(g_font, (int)x, (int)y, color, scale, text);
+}
+
+// Color helpers for different filter types
+static uint32_t color_for_filter_label(void) {
+    if (strcasecmp(g_filter_label, "Games") == 0)    return COL(230, 90, 90, 255);
+    if (strcasecmp(g_filter_label, "MP3") == 0)      return COL(90, 220, 120, 255);
+    if (strcasecmp(g_filter_label, "OGG") == 0)      return COL(120, 220, 255, 255);
+    if (strcasecmp(g_filter_label, "Photo") == 0)    return COL(255, 170, 90, 255);
+    if (strcasecmp(g_filter_label, "Video") == 0)    return COL(200, 120, 255, 255);
+    if (strcasecmp(g_filter_label, "Docs") == 0)     return COL(255, 220, 120, 255);
+    if (strcasecmp(g_filter_label, "Archives") == 0) return COL(180, 130, 255, 255);
+    if (strcasecmp(g_filter_label, "Homebrew") == 0) return COL(255, 100, 180, 255);
+    if (strcasecmp(g_filter_label, "SaveData") == 0) return COL(100, 180, 255, 255);
+    return COL(90, 190, 90, 255);
+}
+
+static uint32_t color_for_usage(float fill01) {
+    if (fill01 < 0.5f) return COL(90, 220, 90, 255);
+    if (fill01 < 0.8f) return COL(220, 220, 90, 255);
+    return COL(220, 90, 90, 255);
+}
+
+void ui_set_filter_label(const char* label) {
+    if (!label || !*label) { snprintf(g_filter_label, sizeof(g_filter_label), "All"); return; }
+    snprintf(g_filter_label, sizeof(g_filter_label), "%s", label);
+}
+
+// One line at the right of the header while nothing is being freed; NULL clears it
+void ui_set_notice(const char* text) {
+    snprintf(g_notice, sizeof(g_notice), "%s", text ? text : "");
+}
+
+// One line under the usage bar about the folder on screen; NULL clears it
+void ui_set_detail(const char* text) {
+    snprintf(g_detail, sizeof(g_detail), "%s", text ? text : "");
+}
+
+// Shows the search panel with `key` under the keyboard cursor, or the
+// results as the focus; NULL hides it
+void ui_set_search(const char* query, int key, int on_results) {
+    g_search_on = query != NULL;
+    snprintf(g_search_query, sizeof(g_search_query), "%s", query ? query : "");
+    g_search_key = key;
+    g_search_results = on_results;
+}
+
+char ui_search_key(int key) {
+    return (key >= 0 && key < UI_SEARCH_ROWS * UI_SEARCH_COLS) ? g_search_keys[key] : '\0';
+}
+
+void ui_init() {
+    vita2d_init();
+    g_font = vita2d_load_default_pgf();
+    ui_text_init(g_font);
+}
+
+void ui_deinit() {
+    if (g_font)     { vita2d_free_pgf(g_font);         g_font = NULL;     }
+    vita2d_fini();
+}
+
+static void draw_bar(float x, float y, float w, float h, float fill01, uint32_t fill_color) {
+    if (fill01 < 0) fill01 = 0;
+    if (fill01 > 1) fill01 = 1;
+
+    ui_batch_rect(x + 1, y + 1, w, h, COL(20, 20, 20, 120));
+    ui_batch_rect(x, y, w, h, COL(60, 60, 60, 200));
+    ui_batch_rect(x + 1, y + 1, w - 2, h - 2, COL(40, 40, 40, 255));
+
+    // 70% brightness at the left end of the fill up to full at its right end
+    if (fill01 > 0) ui_batch_hgrad(x + 1, y + 1, w * fill01, h - 2, shade(fill_color, 0.7f), fill_color);
+}
+
+// I/O debug panel: one row per sceIo call in use, with its log2 latency
+// histogram drawn as a strip of bars scaled to the row's fullest bucket
+static void draw_io_panel(const FsIoStats* io) {
+    const float x = 20, y = 60, w = 920;
+    int rows = 0;
+    for(int i=0;i<FS_IO_OP_COUNT;i++) if(io->op[i].calls) rows++;
+    float h = 50 + (rows ? rows : 1) * 30;
+
+    ui_batch_rect(x, y, w, h, COL(0, 0, 0, 220));
+    ui_batch_rect(x, y, w, 2, COL(80, 120, 180, 255));
+    draw_text(x + 10, y + 24, COL(255,255,255,255), 1.0f,
+              "I/O per call  (START: frame time, SELECT: write log and reset)");
+    if(!rows) {
+        draw_text(x + 10, y + 54, COL(180,180,180,255), 0.9f, "No calls recorded yet");
+        return;
+    }
+
+    float ry = y + 54;
+    const float hx = x + 640, bw = 10;
+    for(int i=0;i<FS_IO_OP_COUNT;i++) {
+        const FsIoOpStats* o = &io->op[i];
+        if(!o->calls) continue;
+        char line[160];
+        fs_io_format(o, (FsIoOp)i, line, sizeof(line));
+        draw_text(x + 10, ry, o->errors ? COL(255,150,150,255) : COL(200,220,240,255), 0.75f, line);
+
+        uint32_t peak = 1;
+        for(int b=0;b<FS_IO_BUCKETS;b++) if(o->hist[b] > peak) peak = o->hist[b];
+        for(int b=0;b<FS_IO_BUCKETS;b++) {
+            float bh = o->hist[b] ? 2.0f + 18.0f * (float)o->hist[b] / (float)peak : 1.0f;
+            ui_batch_rect(hx + b * (bw + 1), ry - bh, bw, bh, COL(90, 190, 90, 255));
+        }
+        ry += 30;
+    }
+}
+
+// Frame profiler panel: frame time summary, average per phase and the last
+// FRAME_RING frames as bars stacked by phase, with 60 and 30 fps guides
+static void draw_frame_panel(void) {
+    static const uint32_t phase_col[FRAME_PHASE_COUNT] = {
+        RGBA8(200, 200, 200, 255), RGBA8(230, 150, 60, 255), RGBA8(90, 190, 90, 255),
+        RGBA8(90, 150, 230, 255), RGBA8(150, 100, 200, 255), RGBA8(70, 70, 70, 255)
+    };
+    const float x = 20, y = 60, w = 920, h = 250;
+    const float gx = x + 10 + (w - 20 - FRAME_RING * 3) / 2, gy = y + h - 10, gh = 130;
+    const float us_per_px = 33333.0f / gh;
+
+    FrameSummary fs;
+    frame_prof_summary(FRAME_RING, &fs);
+
+    ui_batch_rect(x, y, w, h, COL(0, 0, 0, 220));
+    ui_batch_rect(x, y, w, 2, COL(80, 120, 180, 255));
+    draw_text(x + 10, y + 24, COL(255,255,255,255), 1.0f,
+              "Frame time  (START: close, SELECT: write trace)");
+    char line[160];
+    uint64_t rendered, skipped;
+    frame_prof_totals(&rendered, &skipped);
+    snprintf(line, sizeof(line), "%u frames  min %.1f  avg %.1f  p99 %.1f  max %.1f ms  (%.1f fps)   "
+             "since start: %llu drawn, %llu skipped",
+             (unsigned)fs.frames, fs.min_us / 1000.0f, fs.avg_us / 1000.0f, fs.p99_us / 1000.0f,
+             fs.max_us / 1000.0f, fs.fps, (unsigned long long)rendered, (unsigned long long)skipped);
+    draw_text(x + 10, y + 50, COL(200,220,240,255), 0.8f, line);
+
+    float lx = x + 10;
+    for(int p=0;p<FRAME_PHASE_COUNT;p++) {
+        snprintf(line, sizeof(line), "%s %.2f ms", frame_prof_phase_name((FramePhase)p), fs.phase_avg_us[p] / 1000.0f);
+        ui_batch_rect(lx, y + 62, 10, 10, phase_col[p]);
+        draw_text(lx + 14, y + 72, COL(200,220,240,255), 0.75f, line);
+        lx += 145;
+    }
+
+    // Oldest frame on the left; anything above 33 ms is clipped at the top
+    uint32_t n = frame_prof_count();
+    for(uint32_t i=0;i<n;i++) {
+        const FrameRecord* f = frame_prof_get(i);
+        float bx = gx + (FRAME_RING - 1 - i) * 3, top = gy;
+        for(int p=0;p<FRAME_PHASE_COUNT && top > gy - gh;p++) {
+            float ph = f->phase_us[p] / us_per_px;
+            if(ph < 0.5f) continue;
+            if(top - ph < gy - gh) ph = top - (gy - gh);
+            top -= ph;
+            ui_batch_rect(bx, top, 2, ph, phase_col[p]);
+        }
+    }
+    ui_batch_rect(gx, gy - 16667.0f / us_per_px, FRAME_RING * 3, 1, COL(90, 220, 90, 160));
+    ui_batch_rect(gx, gy - gh, FRAME_RING * 3, 1, COL(220, 90, 90, 160));
+}
+
+// Closes the scene, charging submission and the swap to their own phases
+static void finish_frame(void) {
+    ui_batch_flush();
+    frame_prof_mark(FRAME_UI);
+    vita2d_end_drawing();
+    frame_prof_mark(FRAME_GPU);
+    vita2d_swap_buffers();
+    frame_prof_mark(FRAME_SWAP);
+}
+
+// The filter menu is still sliding in or out
+int ui_animating(void) {
+    return overlay_offset_x != (overlay_target ? 960 - 220 - 20 : 960);
+}
+
+// Boxed progress line under the header, with a fill of `frac` below it
+static void draw_status(const char* line, float frac) {
+    float msg_width = ui_text_width(1.0f, line);
+    float msg_x = 480 - msg_width/2.0f;
+    float msg_y = 85;
+    ui_batch_rect(msg_x - 20, msg_y - 22, msg_width + 40, 30, COL(20, 40, 60, 200));
+    ui_batch_rect(msg_x - 18, msg_y - 20, msg_width + 36, 26, COL(40, 80, 120, 150));
+    if(frac > 1.0f) frac = 1.0f;
+    ui_batch_rect(msg_x - 18, msg_y + 4, (msg_width + 36) * frac, 2, COL(150, 255, 150, 255));
+    draw_text(msg_x, msg_y, COL(150,255,150,255), 1.0f, line);
+}
+
+// Query line, keyboard and the controls of whichever side has the focus
+static void draw_search(int results) {
+    char line[96];
+    snprintf(line, sizeof(line), "Search: %s%s", g_search_query, g_search_results ? "" : "_");
+    draw_text(24, 118, COL(255,255,255,255), 1.2f, line);
+    if(g_search_query[0]) {
+        snprintf(line, sizeof(line), "%d result%s", results, results == 1 ? "" : "s");
+        draw_text(936 - ui_text_width(1.0f, line), 118, COL(180,255,180,255), 1.0f, line);
+    }
+
+    for(int k=0;k<UI_SEARCH_ROWS * UI_SEARCH_COLS;k++) {
+        float x = 24 + (k % UI_SEARCH_COLS) * 40, y = 148 + (k / UI_SEARCH_COLS) * 26;
+        int cursor = k == g_search_key && !g_search_results;
+        ui_batch_rect(x, y - 19, 36, 24, cursor ? COL(120, 140, 180, 220) : COL(40, 60, 100, 200));
+        char key[4] = { g_search_keys[k], '\0' };
+        const char* label = g_search_keys[k] == ' ' ? "sp" : key;
+        draw_text(x + 18 - ui_text_width(1.0f, label)/2.0f, y, cursor ? COL(255,255,100,255) : COL(220,230,240,255), 1.0f, label);
+    }
+
+    uint32_t hint = COL(200,220,240,255);
+    if(g_search_results) {
+        draw_text(480, 148, hint, 1.0f, "Up/Down: pick a result");
+        draw_text(480, 174, hint, 1.0f, "X: open its folder");
+        draw_text(480, 200, hint, 1.0f, "L: back to the keyboard");
+    } else {
+        draw_text(480, 148, hint, 1.0f, "X: type   O: erase");
+        draw_text(480, 174, hint, 1.0f, "L: go to the results");
+        draw_text(480, 200, hint, 1.0f, "Names match anywhere, any case");
+    }
+}
+
+// ---- Treemap ----
+
+#define TREEMAP_X      24
+#define TREEMAP_Y      258
+#define TREEMAP_LABELS 32
+
+// Names of the top-level tiles that have room for one, fitted once per layout
+typedef struct {
+    float x, y;
+    char  text[48];
+} TreemapLabel;
+
+static struct {
+    const FsTreemap* map;
+    uint32_t         gen, node;
+    int              count;
+    TreemapLabel     items[TREEMAP_LABELS];
+} g_map_labels;
+
+static void treemap_labels(const FsTreemap* m) {
+    if(g_map_labels.map == m && g_map_labels.gen == m->tree_gen && g_map_labels.node == m->node) return;
+    g_map_labels.map = m;
+    g_map_labels.gen = m->tree_gen;
+    g_map_labels.node = m->node;
+    g_map_labels.count = 0;
+    for(uint32_t i=0;i<m->count && g_map_labels.count<TREEMAP_LABELS;i++) {
+        const FsTile* t = &m->tiles[i];
+        if(t->depth > 0) break;
+        if(t->w < 48 || t->h < 16) continue;
+        char other[32];
+        const char* name = other;
+        if(t->flags & FS_TILE_OTHER) snprintf(other, sizeof(other), "%u more", (unsigned)t->merged);
+        else name = fs_tree_name(m->tree, t->node);
+        TreemapLabel* l = &g_map_labels.items[g_map_labels.count++];
+        l->x = TREEMAP_X + t->x + 3;
+        l->y = TREEMAP_Y + t->y + 13;
+        snprintf(l->text, sizeof(l->text), "%s", ui_text_fit(0.8f, name, (int)t->w - 6));
+    }
+}
+
+// Tiles go out as one quad each, inset by a pixel so the parent shows as a
+// border; the layout already merged everything too small to see, so the
+// quads and labels per frame are bounded whatever the folder holds.
+static void draw_treemap(const FsTreemap* m, uint32_t cursor_node) {
+    const FsTile* cursor = NULL;
+    for(uint32_t i=0;i<m->count;i++) {
+        const FsTile* t = &m->tiles[i];
+        float k = 1.0f - 0.12f * (t->depth < 5 ? t->depth : 5);
+        uint32_t c;
+        if(t->flags & FS_TILE_OTHER)    c = COL(90, 90, 90, 255);
+        else if(t->flags & FS_TILE_DIR) c = shade(COL(70, 110, 170, 255), k);
+        else                            c = shade(COL(90, 170, 110, 255), k);
+        ui_batch_rect(TREEMAP_X + t->x + 0.5f, TREEMAP_Y + t->y + 0.5f, t->w - 1, t->h - 1, c);
+        if(t->depth == 0 && (t->node == cursor_node || (!cursor && (t->flags & FS_TILE_OTHER)))) cursor = t;
+    }
+    if(cursor && cursor_node != FS_TREE_NONE) {
+        float x = TREEMAP_X + cursor->x, y = TREEMAP_Y + cursor->y, w = cursor->w, h = cursor->h;
+        uint32_t c = COL(255, 255, 100, 255);
+        ui_batch_rect(x, y, w, 2, c);
+        ui_batch_rect(x, y + h - 2, w, 2, c);
+        ui_batch_rect(x, y, 2, h, c);
+        ui_batch_rect(x + w - 2, y, 2, h, c);
+    }
+    treemap_labels(m);
+    for(int i=0;i<g_map_labels.count;i++)
+        draw_text(g_map_labels.items[i].x, g_map_labels.items[i].y, COL(255,255,255,255), 0.8f, g_map_labels.items[i].text);
+}
+
+// ---- Draw full UI ----
+void ui_draw(const UiFrame* f) {
+
+    overlay_target = f->overlay_active ? 1 : 0;
+    const float target_x = 960 - 220 - 20;
+    if(overlay_target){
+        if(overlay_offset_x > target_x) overlay_offset_x -= overlay_speed;
+        if(overlay_offset_x < target_x) overlay_offset_x = target_x;
+    } else {
+        if(overlay_offset_x < 960) overlay_offset_x += overlay_speed;
+        if(overlay_offset_x > 960) overlay_offset_x = 960;
+    }
+
+    vita2d_start_drawing();
+    vita2d_clear_screen();
+
+    // Completely solid black background - no gradients or effects
+    ui_batch_rect(0, 0, 960, 544, COL(0, 0, 0, 255));
+
+    // Draw header with nice color for "Free Space Analyzer" title
+    ui_batch_rect(0, 0, 960, 50, COL(40, 60, 100, 255));
+    // Add subtle border around header
+    ui_batch_rect(0, 0, 960, 1, COL(80, 120, 180, 255));
+    ui_batch_rect(0, 49, 960, 1, COL(80, 120, 180, 255));
+
+    // Section separators - black to blend with background
+    ui_batch_rect(0, 55, 960, 2, COL(0, 0, 0, 255));
+    ui_batch_rect(0, 195, 960, 2, COL(0, 0, 0, 255));
+    ui_batch_rect(0, 235, 960, 2, COL(0, 0, 0, 255));
+    ui_batch_rect(0, 255, 960, 2, COL(0, 0, 0, 255));
+
+    if(f->startup_active) {
+        ui_batch_rect(0, 0, 960, 544, COL(0, 0, 0, 255));
+        draw_text(480 - ui_text_width(1.5f, "Checking space of various partitions...")/2.0f,
+                  272 - 20, COL(255,255,255,255), 1.5f, "Checking space of various partitions...");
+        finish_frame();
+        return;
+    }
+
+    FrameSummary fs;
+    frame_prof_summary(30, &fs);
+    char hdr[128];
+    snprintf(hdr, sizeof(hdr), "Free Space Analyzer | Battery: %d%% | FPS: %.1f", f->battery_percent, fs.fps);
+    draw_text(24, 36, COL(255,255,255,255), 1.0f, hdr);
+
+    // Trash being emptied in the background
+    if(f->purge){
+        char done_buf[32], total_buf[32], line[96];
+        ui_text_format_bytes(f->purge->bytes, done_buf, sizeof(done_buf));
+        if(f->purge->total_bytes > f->purge->bytes) {
+            ui_text_format_bytes(f->purge->total_bytes, total_buf, sizeof(total_buf));
+            snprintf(line, sizeof(line), "Freeing %s / %s", done_buf, total_buf);
+        } else {
+            snprintf(line, sizeof(line), "Freeing %s", done_buf);
+        }
+        if(f->purge->errors) snprintf(line + strlen(line), sizeof(line) - strlen(line), " (%u failed)", (unsigned)f->purge->errors);
+        draw_text(936 - ui_text_width(1.0f, line), 36, COL(255,200,120,255), 1.0f, line);
+    } else if(g_notice[0]) {
+        draw_text(936 - ui_text_width(1.0f, g_notice), 36, COL(160,220,255,255), 1.0f, g_notice);
+    }
+
+    int folders_count = f->folders ? (int)f->folders->count : 0;
+
+    if(f->scan){
+        char done_buf[32], rate_buf[32], line[160];
+        ui_text_format_bytes(f->scan->bytes, done_buf, sizeof(done_buf));
+        ui_text_format_bytes(f->scan->bytes_per_sec, rate_buf, sizeof(rate_buf));
+        if(f->scan->eta_sec >= 0)
+            snprintf(line, sizeof(line), "Scanning... %llu files (%llu/s) | %s at %s/s | ETA %d:%02d",
+                     (unsigned long long)f->scan->files, (unsigned long long)f->scan->files_per_sec,
+                     done_buf, rate_buf, f->scan->eta_sec / 60, f->scan->eta_sec % 60);
+        else
+            snprintf(line, sizeof(line), "Scanning... %llu files | %s",
+                     (unsigned long long)f->scan->files, done_buf);
+
+        float frac = 0.0f;
+        if(f->scan->expected_bytes > 0) frac = (float)f->scan->bytes / (float)f->scan->expected_bytes;
+        draw_status(line, frac);
+    } else if(f->dupes){
+        char read_buf[32], line[160];
+        ui_text_format_bytes(f->dupes->bytes_read, read_buf, sizeof(read_buf));
+        float frac = 0.0f;
+        if(f->dupes->stage <= 1) {
+            snprintf(line, sizeof(line), "Finding duplicates... %llu / %llu same-size files | read %s",
+                     (unsigned long long)f->dupes->partial_files, (unsigned long long)f->dupes->candidates, read_buf);
+            if(f->dupes->candidates > 0) frac = (float)f->dupes->partial_files / (float)f->dupes->candidates;
+        } else {
+            snprintf(line, sizeof(line), "Comparing possible duplicates in full... %llu files | read %s",
+                     (unsigned long long)f->dupes->full_files, read_buf);
+        }
+        draw_status(line, frac);
+    } else if(f->calc_alpha>0.0f){
+        uint8_t alpha = (uint8_t)(255.0f * f->calc_alpha);
+        float msg_width = ui_text_width(1.4f, "Updating... Please wait");
+        float msg_x = 480 - msg_width/2.0f;
+        float msg_y = 85;
+
+        ui_batch_rect(msg_x - 20, msg_y - 25, msg_width + 40, 35, COL(20, 40, 60, (uint8_t)(alpha * 0.8f)));
+        ui_batch_rect(msg_x - 18, msg_y - 23, msg_width + 36, 31, COL(40, 80, 120, (uint8_t)(alpha * 0.6f)));
+        ui_batch_rect(msg_x - 22, msg_y - 27, msg_width + 44, 39, COL(60, 120, 180, (uint8_t)(alpha * 0.3f)));
+
+        draw_text(msg_x, msg_y, COL(150,255,150,alpha), 1.4f, "Updating... Please wait");
+    }
+
+    // Move partitions lower and make them look nicer
+    float px = 24, py = 120; 
+    for(int i=0;i<f->parts_count && !g_search_on;i++){
+        const PartitionInfo* p = &f->parts[i];
+        UiTextLine* line = &g_part_lines[i < MAX_PARTITIONS ? i : MAX_PARTITIONS - 1];
+        if(ui_text_stale(line, ui_text_key(ui_text_key(p->total_bytes, p->free_bytes), (uintptr_t)p->label))) {
+            char tbuf[64], fbuf[64];
+            ui_text_format_bytes(p->total_bytes, tbuf, sizeof(tbuf));
+            ui_text_format_bytes(p->free_bytes, fbuf, sizeof(fbuf));
+            snprintf(line->text,sizeof(line->text),"%s:/  %s free / %s total", p->label,fbuf,tbuf);
+        }
+        uint32_t color = (i==f->current_part_index)?COL(120,255,120,255):COL(200,220,240,255);
+
+        // Add even longer background highlight for current partition
+        if(i==f->current_part_index) {
+            ui_batch_rect(px - 24, py + i*32 - 24, 700, 28,
+                COL(60, 100, 140, 150));
+            ui_batch_rect(px - 26, py + i*32 - 26, 704, 32,
+                COL(100, 150, 200, 200));
+        }
+
+        if(i==f->current_part_index) draw_text(px-20, py+i*32, COL(255,255,100,255),1.2f,">");
+        draw_text(px, py+i*32, color,1.1f,line->text);
+    }
+
+    if(g_search_on) draw_search(folders_count);
+    else if(f->parts_count>0 && f->current_part_index>=0 && f->current_part_index<f->parts_count){
+        const PartitionInfo* p = &f->parts[f->current_part_index];
+        uint64_t info_key = ui_text_key(ui_text_key(p->total_bytes, p->free_bytes),
+                                        ui_text_key((uintptr_t)p->label, (uint64_t)folders_count));
+        if(ui_text_stale(&g_info_line, info_key)) {
+            char tbuf[64], fbuf[64];
+            ui_text_format_bytes(p->total_bytes, tbuf,sizeof(tbuf));
+            ui_text_format_bytes(p->free_bytes, fbuf,sizeof(fbuf));
+            snprintf(g_info_line.text,sizeof(g_info_line.text),
+                     "Partition: %s  |  Free: %s / %s  |  Items: %d",
+                     p->label, fbuf, tbuf, folders_count);
+        }
+        draw_text(24,180,COL(255,255,200,255),1.0f,g_info_line.text);
+
+        float usage = (float)(p->total_bytes - p->free_bytes) / (float)p->total_bytes;
+        int usage_label_x=24, usage_label_y=200;
+        draw_text(usage_label_x, usage_label_y, COL(255,255,255,255),1.0f,"Usage:");
+        int usage_label_width=ui_text_width(1.0f,"Usage:")+8;
+        draw_bar(usage_label_x+usage_label_width, usage_label_y-12,900,12,usage,color_for_usage(usage));
+        if(g_detail[0]) draw_text(24, 226, COL(200,220,240,255), 0.8f, g_detail);
+    }
+
+    float fx=24, fy=270;
+    int row_height=28;
+    const int bar_width = 900;
+
+    // The f->treemap takes the place of the rows; the cursor row is named above it
+    if(f->treemap_view) {
+        if(folders_count > 0 && f->current_folder_index < folders_count) {
+            const UiTextRow* row = ui_text_row(f->folders, f->current_folder_index);
+            draw_text(fx, 250, COL(255,255,100,255), 0.9f, row->name);
+            draw_text(936 - row->size_width, 250, COL(180,255,180,255), 1.0f, row->size);
+        }
+        if(f->treemap) {
+            uint32_t cursor = FS_TREE_NONE;
+            if(f->folders && f->folders->tree == f->treemap->tree && f->current_folder_index < folders_count)
+                cursor = fs_listing_node(f->folders, (uint32_t)f->current_folder_index);
+            draw_treemap(f->treemap, cursor);
+        } else {
+            draw_text(480 - ui_text_width(1.0f, "Laying out...")/2.0f, TREEMAP_Y + UI_TREEMAP_H/2, COL(180,180,180,255), 1.0f, "Laying out...");
+        }
+    }
+
+    if(f->treemap_view) folders_count = 0;
+    else if(folders_count <= g_max_visible) g_scroll_offset=0;
+    else {
+        if(f->current_folder_index<g_scroll_offset) g_scroll_offset=f->current_folder_index;
+        if(f->current_folder_index>=g_scroll_offset+g_max_visible) g_scroll_offset=f->current_folder_index-g_max_visible+1;
+    }
+    int start=g_scroll_offset;
+    int end=(folders_count<g_scroll_offset+g_max_visible)?folders_count:g_scroll_offset+g_max_visible;
+
+    // Only the visible window of the listing is touched, however long it is;
+    // row text is formatted once per listing
+    for(int i=start;i<end;i++){
+        const UiTextRow* row = ui_text_row(f->folders, i);
+        int is_dir = fs_listing_is_dir(f->folders, i);
+        uint64_t size_bytes = fs_listing_size(f->folders, i);
+
+        int text_x = fx, text_y = fy + (i - start) * row_height;
+        int visible_index = i - start;
+
+        if(i == f->current_folder_index) {
+            ui_batch_rect(text_x - 8, text_y - 24,
+                950, row_height + 8,
+                COL(80, 80, 120, 120));
+            ui_batch_rect(text_x - 10, text_y - 26,
+                970, row_height + 12,
+                COL(120, 140, 180, 180));
+        }
+
+        // Marked for a multi-item delete
+        if(f->selected && f->selected[i]) ui_batch_rect(text_x - 20, text_y - 14, 10, 10, COL(255, 200, 120, 255));
+
+        uint32_t name_color = is_dir ? COL(120, 200, 255, 255) : COL(255, 255, 255, 255);
+        draw_text(text_x, text_y, name_color, 1.0f, row->name);
+
+        int size_x = 800;
+        draw_text(size_x - row->size_width, text_y, COL(180, 255, 180, 255), 1.0f, row->size);
+        if(row->detail[0]) draw_text(size_x - 130 - row->detail_width, text_y, COL(200, 220, 240, 255), 0.8f, row->detail);
+
+        float bar_x = size_x + 20;
+        float bar_fill = 0;
+        if(f->parts_count > 0 && f->current_part_index >= 0 && f->current_part_index < f->parts_count){
+            uint64_t part_total = f->parts[f->current_part_index].total_bytes;
+            if(part_total > 0) bar_fill = (float)size_bytes / (float)part_total;
+        }
+        draw_bar(bar_x, text_y - 20, bar_width, 18, bar_fill, color_for_filter_label());
+    }
+
+    if(f->overlay_labels && f->overlay_count>0 && overlay_offset_x < 960){
+        float ox = overlay_offset_x;
+        float oy = 100;
+        // filters.txt can make the menu taller than the screen; it scrolls
+        // to keep the selection in view
+        int rows = f->overlay_count < OVERLAY_ROWS ? f->overlay_count : OVERLAY_ROWS;
+        int first = f->overlay_sel >= rows ? f->overlay_sel - rows + 1 : 0;
+        ui_batch_rect(ox-10, oy-30, 220, rows*26 + 40, COL(0,0,0,160));
+        draw_text(ox, oy-20, COL(255,255,255,255), 1.0f, "Choose a filter");
+        for(int i=first;i<first+rows;i++){
+            uint32_t col = (i==f->overlay_sel)?COL(255,255,0,255):COL(255,255,255,255);
+            if(strcasecmp(f->overlay_labels[i],g_filter_label)==0) col = COL(0,255,0,255);
+            draw_text(ox, oy+(i-first)*26, col, 1.0f, f->overlay_labels[i]);
+        }
+    }
+
+    if(f->io_panel) draw_io_panel(f->io_panel);
+    if(f->frame_panel) draw_frame_panel();
+
+    if(f->delete_confirm_active && f->delete_confirm_name) {
+        float dialog_x = 480 - 250, dialog_y = 272 - 50;
+        float dialog_w = 500, dialog_h = 100;
+        float dialog_center_x = dialog_x + dialog_w / 2.0f;
+        const int max_filename_width = 460;
+
+        ui_batch_vgrad(dialog_x, dialog_y, dialog_w, dialog_h, COL(30, 30, 50, 250), COL(70, 70, 80, 250));
+
+        ui_batch_rect(dialog_x-3, dialog_y-3, dialog_w+6, dialog_h+6, COL(255,100,100,200));
+        ui_batch_rect(dialog_x-2, dialog_y-2, dialog_w+4, dialog_h+4, COL(255,150,150,255));
+        ui_batch_rect(dialog_x-1, dialog_y-1, dialog_w+2, dialog_h+2, COL(255,200,200,255));
+
+        float title_width = ui_text_width(1.2f, "Delete this file/folder?");
+        draw_text(dialog_center_x - title_width/2.0f, dialog_y + 20, COL(255,100,100,255), 1.2f, "Delete this file/folder?");
+
+        const char* display_filename = ui_text_fit(1.0f, f->delete_confirm_name, max_filename_width);
+        float filename_width = ui_text_width(1.0f, display_filename);
+        draw_text(dialog_center_x - filename_width/2.0f, dialog_y + 45, COL(255,255,200,255), 1.0f, display_filename);
+
+        float buttons_width = ui_text_width(1.0f, "X: Yes     O: Cancel");
+        draw_text(dialog_center_x - buttons_width/2.0f, dialog_y + 75, COL(150,255,150,255), 1.0f, "X: Yes");
+        draw_text(dialog_center_x - buttons_width/2.0f + ui_text_width(1.0f, "X: Yes     "), dialog_y + 75, COL(255,150,150,255), 1.0f, "O: Cancel");
+    }
+
+    finish_frame();
+}
@@ -0,0 +1,66 @@
+#include "ui_batch.h"
+#include <vita2d.h>
+#include <string.h>
+
+// Rectangles and gradients are queued as vertex-colored triangles and sent
+// with one vita2d_draw_array per run, instead of one draw call each. The GPU
+// interpolates the corner colors, so a gradient costs the same as a fill.
+// Anything drawn straight through vita2d (text) has to flush first to keep
+// the painter's order.
+#define BATCH_QUADS 512
+
+static vita2d_color_vertex g_verts[BATCH_QUADS * 6];
+static uint32_t g_count;
+
+static void put(vita2d_color_vertex* v, float x, float y, uint32_t color)
+{
+    v->x = x;
+    v->y = y;
+    v->z = 0.5f;
+    v->color = color;
+}
+
+// Corners clockwise from the top left
+static void quad(float x, float y, float w, float h, uint32_t tl, uint32_t tr, uint32_t br, uint32_t bl)
+{
+    if (w <= 0 || h <= 0) return;
+    if (g_count + 6 > BATCH_QUADS * 6) ui_batch_flush();
+    vita2d_color_vertex* v = &g_verts[g_count];
+    put(&v[0], x, y, tl);
+    put(&v[1], x + w, y, tr);
+    put(&v[2], x, y + h, bl);
+    put(&v[3], x + w, y, tr);
+    put(&v[4], x + w, y + h, br);
+    put(&v[5], x, y + h, bl);
+    g_count += 6;
+}
+
+void ui_batch_rect(float x, float y, float w, float h, uint32_t color)
+{
+    quad(x, y, w, h, color, color, color, color);
+}
+
+void ui_batch_hgrad(float x, float y, float w, float h, uint32_t left, uint32_t right)
+{
+    quad(x, y, w, h, left, right, right, left);
+}
+
+void ui_batch_vgrad(float x, float y, float w, float h, uint32_t top, uint32_t bottom)
+{
+    quad(x, y, w, h, top, top, bottom, bottom);
+}
+
+// The GPU reads vertices after this returns, so they are copied into
+// vita2d's per-frame pool; a full pool drops the run like vita2d itself does.
+void ui_batch_flush(void)
+{
+    if (!g_count) return;
+    vita2d_color_vertex* v = (vita2d_color_vertex*)vita2d_pool_memalign(g_count * sizeof(vita2d_color_vertex),
+                                                                        sizeof(vita2d_color_vertex));
+    if (v) {
+        memcpy(v, g_verts, g_count * sizeof(vita2d_color_vertex));
+        vita2d_draw_array(SCE_GXM_PRIMITIVE_TRIANGLES, v, g_count);
+    }
+    g_count = 0;
+}
+
@@ -0,0 +1,145 @@
+#include "ui_text.h"
+#include <stdio.h>
+#include <string.h>
+
+// Strings and pixel widths the UI would otherwise rebuild and re-measure on
+// every frame. Rows are tagged with the listing generation, so they only go
+// stale when the listing itself changes; widths are keyed by a hash of the
+// text and scale. A glyph atlas could later sit behind the same calls.
+#define ROW_SLOTS   64
+#define WIDTH_SLOTS 256
+
+typedef struct {
+    uint64_t key;
+    int      width;
+} WidthSlot;
+
+static vita2d_pgf* g_font;
+static UiTextRow g_rows[ROW_SLOTS];
+static WidthSlot g_widths[WIDTH_SLOTS];
+
+static struct {
+    uint64_t key;
+    char     text[256];
+} g_fit;
+
+void ui_text_init(vita2d_pgf* font)
+{
+    g_font = font;
+    memset(g_rows, 0, sizeof(g_rows));
+    memset(g_widths, 0, sizeof(g_widths));
+    memset(&g_fit, 0, sizeof(g_fit));
+}
+
+void ui_text_format_bytes(uint64_t bytes, char* out, int outsz)
+{
+    const char* units[] = {"B","KB","MB","GB","TB"};
+    int unit = 0;
+    double b = (double)bytes;
+    while(b >= 1024.0 && unit < 4){ b /= 1024.0; unit++; }
+    snprintf(out, outsz, "%.2f %s", b, units[unit]);
+}
+
+// ---- keys -------------------------------------------------------------------
+
+// FNV-1a over the text, seeded with the scale's bits; 0 means an empty slot
+static uint64_t text_key(float scale, const char* text)
+{
+    uint32_t bits;
+    memcpy(&bits, &scale, sizeof(bits));
+    uint64_t h = 1469598103934665603ull ^ bits;
+    for (const unsigned char* p = (const unsigned char*)text; *p; ++p) h = (h ^ *p) * 1099511628211ull;
+    return h ? h : 1;
+}
+
+uint64_t ui_text_key(uint64_t a, uint64_t b)
+{
+    uint64_t h = (a ^ (b + 0x9E3779B97F4A7C15ull + (a << 6) + (a >> 2))) * 0xFF51AFD7ED558CCDull;
+    return h ^ (h >> 33);
+}
+
+// True when `line` was built from other values than `key` (and now has to
+// be reformatted by the caller).
+int ui_text_stale(UiTextLine* line, uint64_t key)
+{
+    if (line->valid && line->key == key) return 0;
+    line->key = key;
+    line->valid = 1;
+    return 1;
+}
+
+// ---- widths -----------------------------------------------------------------
+
+// YYYY-MM-DD in UTC, "-" for an unknown time
+void ui_text_format_date(uint32_t unix_secs, char* out, int outsz)
+{
+    if (!unix_secs) { snprintf(out, outsz, "-"); return; }
+    // civil-from-days, valid for the Gregorian calendar
+    int32_t z = (int32_t)(unix_secs / 86400u) + 719468;
+    int32_t era = z / 146097;
+    uint32_t doe = (uint32_t)(z - era * 146097);
+    uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    uint32_t mp = (5 * doy + 2) / 153;
+    uint32_t d = doy - (153 * mp + 2) / 5 + 1;
+    uint32_t m = mp < 10 ? mp + 3 : mp - 9;
+    int32_t y = (int32_t)yoe + era * 400 + (m <= 2);
+    snprintf(out, outsz, "%04d-%02u-%02u", (int)y, (unsigned)m, (unsigned)d);
+}
+
+int ui_text_width(float scale, const char* text)
+{
+    uint64_t key = text_key(scale, text);
+    WidthSlot* s = &g_widths[key % WIDTH_SLOTS];
+    if (s->key != key) {
+        s->key = key;
+        s->width = vita2d_pgf_text_width(g_font, scale, text);
+    }
+    return s->width;
+}
+
+// `text` cut to the longest prefix that still fits `max_width` with "..."
+// after it, or `text` itself when it fits. The prefix is found by bisection
+// and the result kept until another text or width is asked for.
+const char* ui_text_fit(float scale, const char* text, int max_width)
+{
+    if (ui_text_width(scale, text) <= max_width) return text;
+    uint64_t key = ui_text_key(text_key(scale, text), (uint64_t)max_width);
+    if (g_fit.key == key) return g_fit.text;
+
+    int lo = 0, hi = (int)strlen(text);
+    if (hi > (int)sizeof(g_fit.text) - 4) hi = (int)sizeof(g_fit.text) - 4;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        memcpy(g_fit.text, text, mid);
+        memcpy(g_fit.text + mid, "...", 4);
+        if (vita2d_pgf_text_width(g_font, scale, g_fit.text) <= max_width) lo = mid;
+        else hi = mid - 1;
+    }
+    memcpy(g_fit.text, text, lo);
+    memcpy(g_fit.text + lo, "...", 4);
+    g_fit.key = key;
+    return g_fit.text;
+}
+
+// ---- rows -------------------------------------------------------------------
+
+const UiTextRow* ui_text_row(const FsListing* l, uint32_t i)
+{
+    UiTextRow* r = &g_rows[i % ROW_SLOTS];
+    if (r->gen == l->gen && r->index == i && r->name[0]) return r;
+
+    r->gen = l->gen;
+    r->index = i;
+    snprintf(r->name, sizeof(r->name), "%2d. %s%s", (int)i + 1, fs_listing_name(l, i),
+             fs_listing_is_dir(l, i) ? "/" : "");
+    ui_text_format_bytes(fs_listing_size(l, i), r->size, sizeof(r->size));
+    r->size_width = vita2d_pgf_text_width(g_font, 1.0f, r->size);
+    r->detail[0] = '\0';
+    if (l->sort == FS_SORT_COUNT && fs_listing_is_dir(l, i))
+        snprintf(r->detail, sizeof(r->detail), "%u files", (unsigned)fs_listing_files(l, i));
+    else if (l->sort == FS_SORT_AGE)
+        ui_text_format_date(fs_listing_newest(l, i), r->detail, sizeof(r->detail));
+    r->detail_width = r->detail[0] ? vita2d_pgf_text_width(g_font, 0.8f, r->detail) : 0;
+    return r;
+}